@@ -0,0 +1,128 @@
+// Json解析吞吐基准
+//  以账号/角色服务的典型请求体为负载，对比标量扫描与SIMD扫描下
+//  Json::Reader、CharReader(严格模式)与InSituReader的解析吞吐
+//  用法：./json_reader_bench [重复次数]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "json.h"
+
+struct Payload
+{
+    std::string name;
+    std::string doc;
+};
+
+/*
+ * 生成角色信息列表，个性签名为较长的文本，模拟大请求体
+ *
+ */
+static std::string MakeCharacterList(int count, int profileLength, bool styled)
+{
+    Json::Value root;
+    root["serviceId"] = "s-001";
+    Json::Value &list = root["characterInfo"];
+    for (int i = 0; i < count; ++i)
+    {
+        Json::Value character;
+        character["characterId"] = "c-" + std::to_string(100000 + i);
+        character["userId"] = "u-" + std::to_string(i * 7919 % 100003);
+        character["characterName"] = "角色" + std::to_string(i);
+        character["characterMale"] = i % 2;
+        std::string profile;
+        while ((int)profile.size() < profileLength)
+            profile += "The quick brown fox jumps over the lazy dog. \"quoted\" ";
+        character["characterProfile"] = profile;
+        character["level"] = 1.5 * i;
+        list.append(character);
+    }
+    if (styled)
+        return root.toStyledString();
+    Json::FastWriter writer;
+    return writer.write(root);
+}
+
+/*
+ * 生成账号登录请求，短小请求体
+ *
+ */
+static std::string MakeLoginRequest()
+{
+    return "{\"userId\":\"u-10086\",\"password\":\"6f1ed002ab5595859014ebf0951522d9\",\"imageName\":\"defaultBlack.png\"}";
+}
+
+/*
+ * 以给定解析函数重复解析，返回吞吐（MB/s）
+ *
+ */
+static double Measure(const std::string &doc, int repeat, const std::function<bool(const std::string &)> &parse)
+{
+    if (!parse(doc))
+    {
+        std::fprintf(stderr, "parse failed\n");
+        std::exit(1);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; ++i)
+        parse(doc);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (double)doc.size() * repeat / seconds / (1024 * 1024);
+}
+
+int main(int argc, char *argv[])
+{
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 0;
+    std::vector<Payload> payloads = {
+        {"login (small)", MakeLoginRequest()},
+        {"characters compact", MakeCharacterList(2000, 64, false)},
+        {"characters styled", MakeCharacterList(2000, 64, true)},
+        {"profiles long-string", MakeCharacterList(200, 4096, false)},
+    };
+
+    Json::Reader reader;
+    Json::CharReaderBuilder builder;
+    Json::CharReaderBuilder::strictMode(&builder.settings_);
+    std::unique_ptr<Json::CharReader> charReader(builder.newCharReader());
+    Json::MonotonicArena arena;
+    std::string buffer;
+
+    std::vector<std::pair<std::string, std::function<bool(const std::string &)>>> readers = {
+        {"Json::Reader", [&](const std::string &doc) {
+             Json::Value root;
+             return reader.parse(doc.data(), doc.data() + doc.size(), root, false);
+         }},
+        {"CharReader", [&](const std::string &doc) {
+             Json::Value root;
+             return charReader->parse(doc.data(), doc.data() + doc.size(), &root, nullptr);
+         }},
+        {"InSituReader", [&](const std::string &doc) {
+             buffer.assign(doc);
+             arena.reset();
+             Json::InSituReader insitu(arena);
+             return insitu.parse(&buffer[0], &buffer[0] + buffer.size()) != nullptr;
+         }},
+    };
+
+    std::printf("scanner: %s\n", Json::getScannerName());
+    std::printf("%-22s %-14s %10s %12s %12s %8s\n", "payload", "reader", "bytes", "scalar MB/s", "simd MB/s", "speedup");
+    for (const Payload &payload : payloads)
+    {
+        // 按负载大小调整重复次数，每项约解析64MB
+        int times = repeat > 0 ? repeat : (int)std::max<size_t>(1, (64u << 20) / payload.doc.size());
+        for (auto &item : readers)
+        {
+            Json::setScalarScanner(true);
+            double scalar = Measure(payload.doc, times, item.second);
+            Json::setScalarScanner(false);
+            double simd = Measure(payload.doc, times, item.second);
+            std::printf("%-22s %-14s %10zu %12.1f %12.1f %7.2fx\n", payload.name.c_str(), item.first.c_str(),
+                        payload.doc.size(), scalar, simd, simd / scalar);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,1025 @@
+// HTTP负载生成器
+//  基于EventLoop/Poller的多线程压测客户端，每个线程一个EventLoop，负责一部分连接
+//  闭环模式（rate为0）：连接收到响应后立即发出下一个请求，测量服务能达到的最大吞吐
+//  开环模式（rate>0）：按固定速率安排每个请求的预定发出时间，延迟从预定时间起算，
+//   服务变慢时请求在客户端排队等待空闲连接的时间同样计入延迟，避免协调遗漏（coordinated omission）低估尾延迟
+//  支持长连接与短连接（每个请求新建连接，建连耗时计入延迟），长连接上可按pipeline深度连续发出多个请求
+//  场景文件为Json，见bench/scenarios，命令行参数可覆盖场景中的同名配置；结果以Json输出吞吐与延迟百分位
+//  用法：./load_generator <场景文件> [--host 地址] [--port 端口] [--connections 连接数] [--threads 线程数]
+//        [--duration 秒] [--warmup 秒] [--rate 每秒请求数] [--pipeline 深度] [--close] [--timeout 毫秒] [--out 结果文件]
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "EventLoop.hpp"
+#include "Metrics.hpp"
+#include "JsonStreamWriter.hpp"
+#include "json.h"
+
+#define LOAD_TICK_MS 1          // 安排开环请求、检查超时与重连的定时器间隔
+#define LOAD_READ_SIZE 65536    // 单次读取的字节数
+
+// 压测场景
+struct Scenario
+{
+    std::string name;
+    std::string host = "127.0.0.1";
+    int port = 80;
+    int connections = 16;  // 总连接数
+    int threads = 1;       // 线程数，连接平均分配到各线程
+    double duration = 10;  // 统计时长，秒
+    double warmup = 1;     // 预热时长，秒，期间的请求不计入结果
+    double rate = 0;       // 每秒请求数，0为闭环模式
+    int pipeline = 1;      // 长连接上未收到响应时可连续发出的请求数
+    bool keepAlive = true; // false时每个请求新建连接
+    int timeoutMs = 2000;  // 请求超时，超时的连接断开重连
+    Json::Value requests;  // 请求列表：method、path、headers、body、weight
+};
+
+// 已序列化的请求及其权重
+struct LoadRequest
+{
+    std::string data;
+    int weight;
+};
+
+// 已发出、等待响应的请求
+struct PendingRequest
+{
+    int64_t intended; // 预定发出时间，延迟由此起算
+    int64_t sent;     // 实际写入发送缓冲的时间，由此起算的为服务时间
+};
+
+// 单个线程的统计结果，线程结束后汇总
+struct LoadStats
+{
+    uint64_t completed = 0;     // 收到响应的请求数
+    uint64_t non2xx = 0;        // 状态码非2xx的响应数
+    uint64_t errors = 0;        // 连接被关闭或响应非法而丢失的请求数
+    uint64_t timeouts = 0;      // 超时或压测结束时仍未完成的请求数
+    uint64_t connectErrors = 0; // 建连失败次数
+    uint64_t connects = 0;      // 建连成功次数
+    uint64_t bytes = 0;         // 已完成响应的字节数
+    int64_t maxLatency = 0;     // 最大延迟，纳秒
+    std::map<int, uint64_t> status;
+
+    void Merge(const LoadStats &other)
+    {
+        completed += other.completed;
+        non2xx += other.non2xx;
+        errors += other.errors;
+        timeouts += other.timeouts;
+        connectErrors += other.connectErrors;
+        connects += other.connects;
+        bytes += other.bytes;
+        maxLatency = std::max(maxLatency, other.maxLatency);
+        for (std::map<int, uint64_t>::const_iterator iter = other.status.begin(); iter != other.status.end(); ++iter)
+            status[iter->first] += iter->second;
+    }
+};
+
+class LoadWorker;
+
+// 压测连接，只在所属LoadWorker的线程内使用
+class LoadConnection
+{
+public:
+    enum State
+    {
+        CLOSED,
+        CONNECTING,
+        CONNECTED
+    };
+    explicit LoadConnection(LoadWorker *worker);
+    ~LoadConnection();
+    void Connect();
+    void Close();
+    bool Ready() const;                       // 可以再发出一个请求
+    void Queue(int64_t intended, int64_t now); // 请求追加到发送缓冲
+    void Flush();                             // 发送缓冲写入套接字
+    void Fail(bool timeout);                  // 丢弃未完成的请求并断开
+    State GetState() const { return state_; }
+    int64_t GetConnectStart() const { return connectStart_; }
+    const std::deque<PendingRequest> &Inflight() const { return inflight_; }
+    int64_t GetLastProgress() const { return lastProgress_; }
+
+private:
+    LoadWorker *worker_;
+    Channel channel_;
+    int fd_;
+    State state_;
+    bool used_;                         // 短连接已发出请求
+    bool wantWrite_;                    // 当前是否监听EPOLLOUT
+    std::string out_;                   // 发送缓冲
+    size_t outOffset_;                  // 发送缓冲中已写出的字节数
+    std::string in_;                    // 接收缓冲
+    std::deque<PendingRequest> inflight_;
+    int64_t connectStart_;
+    int64_t lastProgress_;              // 最近一次发出或完成请求的时间，用于超时判断
+    bool headerDone_;                   // 当前响应的头部已解析
+    size_t headerLength_;
+    long contentLength_;                // -1表示无Content-Length，响应体持续到连接关闭
+    int status_;
+    void HandleRead();
+    void HandleWrite();
+    void HandleError();
+    void SetWriteInterest(bool write);
+    bool ParseResponses(bool eof);      // 解析接收缓冲中的完整响应，出错时返回false
+    bool ParseHeader(size_t begin, size_t headerEnd);
+};
+
+// 压测线程，持有一个EventLoop及其上的连接
+class LoadWorker
+{
+public:
+    LoadWorker(const Scenario &scenario, const std::vector<LoadRequest> &requests, const struct sockaddr_in &address,
+               int index, int connections, int64_t startNs, MetricsHistogram *latency, MetricsHistogram *serviceTime);
+    void Run(); // 在本线程创建EventLoop并运行至压测结束
+    EventLoop *GetLoop() const { return loop_; }
+    const struct sockaddr_in &GetAddress() const { return address_; }
+    const Scenario &GetScenario() const { return scenario_; }
+    const LoadStats &GetStats() const { return stats_; }
+    uint64_t GetScheduled() const; // 统计时段内安排的开环请求数
+    LoadStats &Stats() { return stats_; }
+    const std::string &NextRequest();                                 // 按权重选取下一个请求
+    void OnReady(LoadConnection *conn);                               // 连接可发出新请求
+    void OnResponse(const PendingRequest &request, int status, size_t bytes);
+    void OnLost(const std::deque<PendingRequest> &requests, bool timeout); // 连接断开时未完成的请求
+    void OnClosed(LoadConnection *conn);                              // 短连接完成请求后关闭，立即重连
+
+private:
+    const Scenario &scenario_;
+    const std::vector<LoadRequest> &requests_;
+    struct sockaddr_in address_;
+    int index_;
+    int connectionCount_;
+    EventLoop *loop_;
+    std::vector<std::unique_ptr<LoadConnection>> connections_;
+    size_t cursor_;                 // 开环模式轮询空闲连接的起点
+    std::deque<int64_t> backlog_;   // 已到预定时间但尚无空闲连接的请求
+    uint64_t scheduled_;            // 已安排的开环请求数
+    int64_t startNs_;
+    int64_t measureStartNs_;        // 预热结束
+    int64_t endNs_;                 // 停止发出新请求
+    int64_t drainEndNs_;            // 等待在途请求的最晚时间
+    int totalWeight_;
+    uint64_t random_;
+    LoadStats stats_;
+    MetricsHistogram *latency_;
+    MetricsHistogram *serviceTime_;
+    bool Measured(int64_t intended) const { return intended >= measureStartNs_ && intended < endNs_; }
+    int64_t Intended(uint64_t k) const; // 本线程第k个开环请求的预定时间
+    int scheduleFd_;                // 开环模式按下一个请求的预定时间触发的定时器，精度不受EventLoop毫秒定时器限制
+    Channel scheduleChannel_;
+    void Tick();
+    void Schedule(int64_t now);     // 预定时间已到的开环请求加入积压队列
+    void ArmSchedule();             // 按下一个请求的预定时间设置scheduleFd_
+    void HandleSchedule();
+    void Pump(int64_t now); // 开环模式将积压的请求分配到空闲连接
+};
+
+LoadConnection::LoadConnection(LoadWorker *worker)
+    : worker_(worker),
+      fd_(-1),
+      state_(CLOSED),
+      used_(false),
+      wantWrite_(false),
+      outOffset_(0),
+      connectStart_(0),
+      lastProgress_(0),
+      headerDone_(false),
+      headerLength_(0),
+      contentLength_(-1),
+      status_(0)
+{
+    channel_.SetReadHandle(std::bind(&LoadConnection::HandleRead, this));
+    channel_.SetWriteHandle(std::bind(&LoadConnection::HandleWrite, this));
+    channel_.SetErrorHandle(std::bind(&LoadConnection::HandleError, this));
+    channel_.SetCloseHandle(std::bind(&LoadConnection::HandleRead, this));
+}
+
+LoadConnection::~LoadConnection()
+{
+    Close();
+}
+
+/*
+ * 非阻塞建连，本机地址可能立即连上
+ *
+ */
+void LoadConnection::Connect()
+{
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+    {
+        ++worker_->Stats().connectErrors;
+        return;
+    }
+    int on = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    connectStart_ = Metrics::NowNs();
+    lastProgress_ = connectStart_;
+    used_ = false;
+    const struct sockaddr_in &address = worker_->GetAddress();
+    if (0 == connect(fd_, (const struct sockaddr *)&address, sizeof address))
+        state_ = CONNECTED;
+    else if (EINPROGRESS == errno)
+        state_ = CONNECTING;
+    else
+    {
+        ++worker_->Stats().connectErrors;
+        close(fd_);
+        fd_ = -1;
+        return;
+    }
+    wantWrite_ = CONNECTING == state_;
+    channel_.SetFd(fd_);
+    channel_.SetEvents(wantWrite_ ? EPOLLIN | EPOLLOUT : EPOLLIN);
+    worker_->GetLoop()->AddChannelToPoller(&channel_);
+    if (CONNECTED == state_)
+    {
+        ++worker_->Stats().connects;
+        worker_->OnReady(this);
+    }
+}
+
+void LoadConnection::Close()
+{
+    if (fd_ >= 0)
+    {
+        worker_->GetLoop()->RemoveChannelToPoller(&channel_);
+        close(fd_);
+        fd_ = -1;
+    }
+    state_ = CLOSED;
+    out_.clear();
+    outOffset_ = 0;
+    in_.clear();
+    inflight_.clear();
+    headerDone_ = false;
+}
+
+bool LoadConnection::Ready() const
+{
+    if (CONNECTED != state_)
+        return false;
+    if (worker_->GetScenario().keepAlive)
+        return inflight_.size() < (size_t)worker_->GetScenario().pipeline;
+    return !used_;
+}
+
+void LoadConnection::Queue(int64_t intended, int64_t now)
+{
+    out_.append(worker_->NextRequest());
+    if (inflight_.empty())
+        lastProgress_ = now;
+    inflight_.push_back(PendingRequest{intended, now});
+    used_ = true;
+}
+
+void LoadConnection::Flush()
+{
+    if (fd_ < 0)
+        return;
+    while (outOffset_ < out_.size())
+    {
+        ssize_t n = send(fd_, out_.data() + outOffset_, out_.size() - outOffset_, MSG_NOSIGNAL);
+        if (n > 0)
+            outOffset_ += n;
+        else if (n < 0 && EINTR == errno)
+            continue;
+        else if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+            break;
+        else
+        {
+            Fail(false);
+            return;
+        }
+    }
+    if (outOffset_ == out_.size())
+    {
+        out_.clear();
+        outOffset_ = 0;
+    }
+    SetWriteInterest(outOffset_ < out_.size());
+}
+
+/*
+ * 未完成的请求交由LoadWorker计入错误或超时，连接在下一次定时器触发时重连
+ *
+ */
+void LoadConnection::Fail(bool timeout)
+{
+    worker_->OnLost(inflight_, timeout);
+    Close();
+}
+
+void LoadConnection::SetWriteInterest(bool write)
+{
+    if (fd_ < 0 || write == wantWrite_)
+        return;
+    wantWrite_ = write;
+    channel_.SetEvents(write ? EPOLLIN | EPOLLOUT : EPOLLIN);
+    worker_->GetLoop()->UpdateChannelToPoller(&channel_);
+}
+
+/*
+ * 读至EAGAIN或连接关闭，水平触发下读不完也会再次通知，这里读完是为了在同一轮中识别连接关闭
+ * 建连完成时可能只报告EPOLLIN，先按写事件确认建连结果
+ *
+ */
+void LoadConnection::HandleRead()
+{
+    if (fd_ < 0)
+        return;
+    if (CONNECTING == state_)
+    {
+        HandleWrite();
+        if (CONNECTED != state_)
+            return;
+    }
+    char buffer[LOAD_READ_SIZE];
+    bool eof = false;
+    while (true)
+    {
+        ssize_t n = read(fd_, buffer, sizeof buffer);
+        if (n > 0)
+            in_.append(buffer, n);
+        else if (0 == n)
+        {
+            eof = true;
+            break;
+        }
+        else if (EINTR == errno)
+            continue;
+        else if (EAGAIN == errno || EWOULDBLOCK == errno)
+            break;
+        else
+        {
+            Fail(false);
+            return;
+        }
+    }
+    if (!ParseResponses(eof))
+    {
+        Fail(false);
+        return;
+    }
+    if (eof)
+    {
+        // 连接被对端关闭，未完成的请求计入错误
+        if (!inflight_.empty())
+            Fail(false);
+        else
+            Close();
+        if (!worker_->GetScenario().keepAlive)
+            worker_->OnClosed(this);
+        return;
+    }
+    if (!worker_->GetScenario().keepAlive && used_ && inflight_.empty())
+    {
+        // 短连接已完成请求，主动关闭
+        Close();
+        worker_->OnClosed(this);
+        return;
+    }
+    worker_->OnReady(this);
+}
+
+void LoadConnection::HandleWrite()
+{
+    if (fd_ < 0)
+        return;
+    if (CONNECTING == state_)
+    {
+        int err = 0;
+        socklen_t length = sizeof err;
+        if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &length) < 0 || err)
+        {
+            ++worker_->Stats().connectErrors;
+            Close();
+            return;
+        }
+        struct sockaddr_in peer;
+        length = sizeof peer;
+        if (getpeername(fd_, (struct sockaddr *)&peer, &length) < 0)
+            return; // 尚未连上，可能是重连前旧连接遗留的事件
+        state_ = CONNECTED;
+        ++worker_->Stats().connects;
+        SetWriteInterest(false);
+        worker_->OnReady(this);
+        return;
+    }
+    Flush();
+}
+
+void LoadConnection::HandleError()
+{
+    if (fd_ < 0)
+        return;
+    if (CONNECTING == state_)
+    {
+        ++worker_->Stats().connectErrors;
+        Close();
+        return;
+    }
+    Fail(false);
+}
+
+/*
+ * 按发出顺序依次匹配响应，支持Content-Length与以连接关闭结束的响应体，不支持chunked
+ *
+ */
+bool LoadConnection::ParseResponses(bool eof)
+{
+    size_t consumed = 0;
+    while (!inflight_.empty())
+    {
+        if (!headerDone_)
+        {
+            size_t headerEnd = in_.find("\r\n\r\n", consumed);
+            if (std::string::npos == headerEnd)
+                break;
+            if (!ParseHeader(consumed, headerEnd))
+                return false;
+        }
+        size_t total;
+        if (contentLength_ >= 0)
+        {
+            total = headerLength_ + contentLength_;
+            if (in_.size() - consumed < total)
+                break;
+        }
+        else
+        {
+            if (!eof)
+                break;
+            total = in_.size() - consumed;
+        }
+        PendingRequest request = inflight_.front();
+        inflight_.pop_front();
+        consumed += total;
+        headerDone_ = false;
+        lastProgress_ = Metrics::NowNs();
+        worker_->OnResponse(request, status_, total);
+    }
+    in_.erase(0, consumed);
+    if (inflight_.empty() && !in_.empty() && !eof)
+        return false; // 收到多余的数据
+    return true;
+}
+
+/*
+ * 解析in_中[begin, headerEnd)的响应头，取得状态码与Content-Length
+ *
+ */
+bool LoadConnection::ParseHeader(size_t begin, size_t headerEnd)
+{
+    const char *header = in_.data() + begin;
+    size_t length = headerEnd - begin;
+    if (length < 12 || 0 != strncmp(header, "HTTP/1.", 7))
+        return false;
+    status_ = atoi(header + 9);
+    contentLength_ = -1;
+    size_t lineBegin = in_.find("\r\n", begin);
+    while (lineBegin < headerEnd)
+    {
+        lineBegin += 2;
+        size_t lineEnd = in_.find("\r\n", lineBegin);
+        if (std::string::npos == lineEnd || lineEnd > headerEnd)
+            lineEnd = headerEnd;
+        if (lineEnd - lineBegin > 15 && 0 == strncasecmp(in_.data() + lineBegin, "Content-Length:", 15))
+            contentLength_ = atol(in_.data() + lineBegin + 15);
+        else if (lineEnd - lineBegin > 18 && 0 == strncasecmp(in_.data() + lineBegin, "Transfer-Encoding:", 18))
+            return false; // 不支持chunked
+        lineBegin = lineEnd;
+    }
+    if (status_ < 200 || 204 == status_ || 304 == status_)
+        contentLength_ = 0;
+    headerLength_ = headerEnd + 4 - begin;
+    headerDone_ = true;
+    return true;
+}
+
+LoadWorker::LoadWorker(const Scenario &scenario, const std::vector<LoadRequest> &requests, const struct sockaddr_in &address,
+                       int index, int connections, int64_t startNs, MetricsHistogram *latency, MetricsHistogram *serviceTime)
+    : scenario_(scenario),
+      requests_(requests),
+      address_(address),
+      index_(index),
+      connectionCount_(connections),
+      loop_(nullptr),
+      cursor_(0),
+      scheduled_(0),
+      startNs_(startNs),
+      measureStartNs_(startNs + (int64_t)(scenario.warmup * 1e9)),
+      endNs_(measureStartNs_ + (int64_t)(scenario.duration * 1e9)),
+      drainEndNs_(endNs_ + (int64_t)scenario.timeoutMs * 1000000),
+      totalWeight_(0),
+      random_(0x9E3779B97F4A7C15ULL * (index + 1)),
+      latency_(latency),
+      serviceTime_(serviceTime),
+      scheduleFd_(-1)
+{
+    for (size_t i = 0; i < requests_.size(); ++i)
+        totalWeight_ += requests_[i].weight;
+}
+
+void LoadWorker::Run()
+{
+    EventLoop loop;
+    loop_ = &loop;
+    for (int i = 0; i < connectionCount_; ++i)
+        connections_.emplace_back(new LoadConnection(this));
+    for (size_t i = 0; i < connections_.size(); ++i)
+        connections_[i]->Connect();
+    if (scenario_.rate > 0)
+    {
+        scheduleFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        scheduleChannel_.SetFd(scheduleFd_);
+        scheduleChannel_.SetEvents(EPOLLIN);
+        scheduleChannel_.SetReadHandle(std::bind(&LoadWorker::HandleSchedule, this));
+        loop.AddChannelToPoller(&scheduleChannel_);
+        ArmSchedule();
+    }
+    loop.RunEvery(LOAD_TICK_MS, std::bind(&LoadWorker::Tick, this));
+    loop.loop();
+    connections_.clear();
+    if (scheduleFd_ >= 0)
+    {
+        loop.RemoveChannelToPoller(&scheduleChannel_);
+        close(scheduleFd_);
+        scheduleFd_ = -1;
+    }
+    loop_ = nullptr;
+}
+
+uint64_t LoadWorker::GetScheduled() const
+{
+    uint64_t measured = 0;
+    for (uint64_t k = 0; k < scheduled_; ++k)
+    {
+        if (Measured(Intended(k)))
+            ++measured;
+    }
+    return measured;
+}
+
+const std::string &LoadWorker::NextRequest()
+{
+    if (1 == requests_.size())
+        return requests_[0].data;
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 7;
+    random_ ^= random_ << 17;
+    int pick = (int)(random_ % (uint64_t)totalWeight_);
+    for (size_t i = 0; i < requests_.size(); ++i)
+    {
+        pick -= requests_[i].weight;
+        if (pick < 0)
+            return requests_[i].data;
+    }
+    return requests_.back().data;
+}
+
+/*
+ * 闭环模式下连接空闲即补满请求，长连接的预定时间取当前时间，短连接取开始建连的时间
+ * 开环模式下从积压队列分配
+ *
+ */
+void LoadWorker::OnReady(LoadConnection *conn)
+{
+    int64_t now = Metrics::NowNs();
+    if (scenario_.rate > 0)
+    {
+        Pump(now);
+        return;
+    }
+    if (now >= endNs_ || !conn->Ready())
+        return;
+    int64_t intended = scenario_.keepAlive ? now : conn->GetConnectStart();
+    while (conn->Ready())
+        conn->Queue(intended, now);
+    conn->Flush();
+}
+
+void LoadWorker::OnResponse(const PendingRequest &request, int status, size_t bytes)
+{
+    if (!Measured(request.intended))
+        return;
+    int64_t now = Metrics::NowNs();
+    int64_t latency = now - request.intended;
+    ++stats_.completed;
+    ++stats_.status[status];
+    if (status < 200 || status >= 300)
+        ++stats_.non2xx;
+    stats_.bytes += bytes;
+    stats_.maxLatency = std::max(stats_.maxLatency, latency);
+    latency_->Record((uint64_t)latency);
+    serviceTime_->Record((uint64_t)(now - request.sent));
+}
+
+void LoadWorker::OnLost(const std::deque<PendingRequest> &requests, bool timeout)
+{
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        if (!Measured(requests[i].intended))
+            continue;
+        if (timeout)
+            ++stats_.timeouts;
+        else
+            ++stats_.errors;
+    }
+}
+
+void LoadWorker::OnClosed(LoadConnection *conn)
+{
+    if (Metrics::NowNs() < endNs_)
+        conn->Connect();
+}
+
+/*
+ * 本线程第k个开环请求的全局编号为index_ + k * threads，预定时间为startNs_ + 编号 * 1e9 / rate，各线程交错，合起来为匀速
+ *
+ */
+int64_t LoadWorker::Intended(uint64_t k) const
+{
+    return startNs_ + (int64_t)((index_ + k * scenario_.threads) * 1e9 / scenario_.rate);
+}
+
+/*
+ * 每毫秒执行：安排到期的开环请求、分配积压请求、断开超时连接、重连已断开的连接、判断压测是否结束
+ *
+ */
+void LoadWorker::Tick()
+{
+    int64_t now = Metrics::NowNs();
+    if (scenario_.rate > 0)
+        Schedule(now);
+    bool idle = backlog_.empty();
+    for (size_t i = 0; i < connections_.size(); ++i)
+    {
+        LoadConnection *conn = connections_[i].get();
+        if (!conn->Inflight().empty() && now - conn->GetLastProgress() > (int64_t)scenario_.timeoutMs * 1000000)
+            conn->Fail(true);
+        else if (LoadConnection::CONNECTING == conn->GetState() && now - conn->GetConnectStart() > (int64_t)scenario_.timeoutMs * 1000000)
+        {
+            ++stats_.connectErrors;
+            conn->Close();
+        }
+        if (LoadConnection::CLOSED == conn->GetState() && now < endNs_)
+            conn->Connect();
+        if (!conn->Inflight().empty())
+            idle = false;
+    }
+    if (now >= endNs_ && (idle || now >= drainEndNs_))
+    {
+        // 压测结束，仍在排队或在途的请求计入超时
+        for (size_t i = 0; i < backlog_.size(); ++i)
+        {
+            if (Measured(backlog_[i]))
+                ++stats_.timeouts;
+        }
+        backlog_.clear();
+        for (size_t i = 0; i < connections_.size(); ++i)
+            connections_[i]->Fail(true);
+        loop_->Quit();
+        return;
+    }
+    if (scenario_.rate > 0)
+        Pump(now);
+}
+
+void LoadWorker::Schedule(int64_t now)
+{
+    while (true)
+    {
+        int64_t intended = Intended(scheduled_);
+        if (intended > now || intended >= endNs_)
+            break;
+        backlog_.push_back(intended);
+        ++scheduled_;
+    }
+}
+
+/*
+ * 使用绝对时间，Metrics::NowNs取自steady_clock，与CLOCK_MONOTONIC一致
+ *
+ */
+void LoadWorker::ArmSchedule()
+{
+    int64_t next = Intended(scheduled_);
+    if (next >= endNs_)
+        return;
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof spec);
+    spec.it_value.tv_sec = next / 1000000000;
+    spec.it_value.tv_nsec = next % 1000000000;
+    timerfd_settime(scheduleFd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+void LoadWorker::HandleSchedule()
+{
+    uint64_t expirations = 0;
+    ssize_t n = read(scheduleFd_, &expirations, sizeof expirations);
+    (void)n;
+    int64_t now = Metrics::NowNs();
+    Schedule(now);
+    Pump(now);
+    ArmSchedule();
+}
+
+/*
+ * 每轮给每个可用连接分配一个请求，直至积压清空或没有可用连接，使请求均匀分布在连接上
+ *
+ */
+void LoadWorker::Pump(int64_t now)
+{
+    size_t count = connections_.size();
+    bool progress = true;
+    std::vector<LoadConnection *> queued;
+    while (!backlog_.empty() && progress)
+    {
+        progress = false;
+        for (size_t i = 0; i < count && !backlog_.empty(); ++i)
+        {
+            LoadConnection *conn = connections_[(cursor_ + i) % count].get();
+            if (!conn->Ready())
+                continue;
+            queued.push_back(conn);
+            conn->Queue(backlog_.front(), now);
+            backlog_.pop_front();
+            progress = true;
+        }
+        cursor_ = (cursor_ + 1) % count;
+    }
+    std::sort(queued.begin(), queued.end());
+    queued.erase(std::unique(queued.begin(), queued.end()), queued.end());
+    for (size_t i = 0; i < queued.size(); ++i)
+        queued[i]->Flush();
+}
+
+/*
+ * 读取场景文件，未配置的项保留默认值
+ *
+ */
+static bool LoadScenario(const std::string &path, Scenario &scenario)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        fprintf(stderr, "无法打开场景文件：%s\n", path.c_str());
+        return false;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    Json::Reader reader;
+    Json::Value root;
+    if (!reader.parse(content.str(), root) || !root.isObject())
+    {
+        fprintf(stderr, "场景文件格式错误：%s\n", reader.getFormattedErrorMessages().c_str());
+        return false;
+    }
+    scenario.name = root.get("name", path).asString();
+    scenario.host = root.get("host", scenario.host).asString();
+    scenario.port = root.get("port", scenario.port).asInt();
+    scenario.connections = root.get("connections", scenario.connections).asInt();
+    scenario.threads = root.get("threads", scenario.threads).asInt();
+    scenario.duration = root.get("duration", scenario.duration).asDouble();
+    scenario.warmup = root.get("warmup", scenario.warmup).asDouble();
+    scenario.rate = root.get("rate", scenario.rate).asDouble();
+    scenario.pipeline = root.get("pipeline", scenario.pipeline).asInt();
+    scenario.keepAlive = root.get("keepAlive", scenario.keepAlive).asBool();
+    scenario.timeoutMs = root.get("timeoutMs", scenario.timeoutMs).asInt();
+    scenario.requests = root["requests"];
+    if (!scenario.requests.isArray() || scenario.requests.empty())
+    {
+        fprintf(stderr, "场景文件缺少requests\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * 按场景的连接方式预先序列化所有请求，压测过程中只追加到发送缓冲
+ * 长连接显式携带Keep-Alive（HttpServer只认该取值），短连接携带close
+ *
+ */
+static void BuildRequests(const Scenario &scenario, std::vector<LoadRequest> &requests)
+{
+    for (Json::Value::ArrayIndex i = 0; i < scenario.requests.size(); ++i)
+    {
+        const Json::Value &spec = scenario.requests[i];
+        LoadRequest request;
+        std::string body = spec.get("body", "").asString();
+        request.data = spec.get("method", "GET").asString() + " " + spec.get("path", "/").asString() + " HTTP/1.1\r\n";
+        request.data += "Host: " + scenario.host + ":" + std::to_string(scenario.port) + "\r\n";
+        const Json::Value &headers = spec["headers"];
+        if (headers.isObject())
+        {
+            Json::Value::Members names = headers.getMemberNames();
+            for (size_t j = 0; j < names.size(); ++j)
+                request.data += names[j] + ": " + headers[names[j]].asString() + "\r\n";
+        }
+        if (!body.empty())
+            request.data += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        request.data += scenario.keepAlive ? "Connection: Keep-Alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        request.data += body;
+        request.weight = std::max(spec.get("weight", 1).asInt(), 1);
+        requests.push_back(request);
+    }
+}
+
+/*
+ * 命令行参数覆盖场景配置
+ *
+ */
+static bool ParseArgs(int argc, char *argv[], Scenario &scenario, std::string &outPath)
+{
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if ("--close" == arg)
+        {
+            scenario.keepAlive = false;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            fprintf(stderr, "参数缺少取值：%s\n", arg.c_str());
+            return false;
+        }
+        const char *value = argv[++i];
+        if ("--host" == arg)
+            scenario.host = value;
+        else if ("--port" == arg)
+            scenario.port = atoi(value);
+        else if ("--connections" == arg)
+            scenario.connections = atoi(value);
+        else if ("--threads" == arg)
+            scenario.threads = atoi(value);
+        else if ("--duration" == arg)
+            scenario.duration = atof(value);
+        else if ("--warmup" == arg)
+            scenario.warmup = atof(value);
+        else if ("--rate" == arg)
+            scenario.rate = atof(value);
+        else if ("--pipeline" == arg)
+            scenario.pipeline = atoi(value);
+        else if ("--timeout" == arg)
+            scenario.timeoutMs = atoi(value);
+        else if ("--out" == arg)
+            outPath = value;
+        else
+        {
+            fprintf(stderr, "未知参数：%s\n", arg.c_str());
+            return false;
+        }
+    }
+    scenario.threads = std::max(1, std::min(scenario.threads, scenario.connections));
+    scenario.pipeline = scenario.keepAlive ? std::max(1, scenario.pipeline) : 1;
+    if (scenario.connections < 1 || scenario.duration <= 0 || scenario.warmup < 0 || scenario.rate < 0)
+    {
+        fprintf(stderr, "场景配置无效\n");
+        return false;
+    }
+    return true;
+}
+
+static void WritePercentiles(JsonStreamWriter &writer, const MetricsHistogram &histogram, int64_t maxNs)
+{
+    static const double percentiles[] = {50, 90, 99, 99.9};
+    static const char *names[] = {"p50", "p90", "p99", "p999"};
+    uint64_t count = histogram.Count();
+    writer.Object();
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i)
+        writer.Key(names[i]).Value(count ? histogram.Percentile(percentiles[i]) / 1e6 : 0.0);
+    writer.Key("mean").Value(count ? (double)histogram.Sum() / count / 1e6 : 0.0);
+    if (maxNs >= 0)
+        writer.Key("max").Value(maxNs / 1e6);
+    writer.EndObject();
+}
+
+/*
+ * 输出压测结果，延迟单位为毫秒，百分位为所在直方图桶的上界（相对误差约6%）
+ * latency为从预定时间起算的延迟，serviceTime为从实际发出起算的时间，二者之差即客户端排队时间
+ *
+ */
+static void WriteResult(const Scenario &scenario, const LoadStats &stats, uint64_t scheduled,
+                        const MetricsHistogram &latency, const MetricsHistogram &serviceTime, std::string &out)
+{
+    JsonStreamWriter writer(out);
+    writer.Object();
+    writer.Key("scenario").Value(scenario.name);
+    writer.Key("target").Value(scenario.host + ":" + std::to_string(scenario.port));
+    writer.Key("mode").Value(scenario.rate > 0 ? "open-loop" : "closed-loop");
+    writer.Key("keepAlive").Value(scenario.keepAlive);
+    writer.Key("connections").Value(scenario.connections);
+    writer.Key("threads").Value(scenario.threads);
+    writer.Key("pipeline").Value(scenario.pipeline);
+    writer.Key("duration").Value(scenario.duration);
+    if (scenario.rate > 0)
+    {
+        writer.Key("targetRate").Value(scenario.rate);
+        writer.Key("scheduled").Value(scheduled);
+    }
+    writer.Key("requests").Value(stats.completed);
+    writer.Key("rps").Value(stats.completed / scenario.duration);
+    writer.Key("throughputMBps").Value(stats.bytes / scenario.duration / (1024.0 * 1024.0));
+    writer.Key("non2xx").Value(stats.non2xx);
+    writer.Key("errors").Value(stats.errors);
+    writer.Key("timeouts").Value(stats.timeouts);
+    writer.Key("connects").Value(stats.connects);
+    writer.Key("connectErrors").Value(stats.connectErrors);
+    writer.Key("status").Object();
+    for (std::map<int, uint64_t>::const_iterator iter = stats.status.begin(); iter != stats.status.end(); ++iter)
+        writer.Key(std::to_string(iter->first)).Value(iter->second);
+    writer.EndObject();
+    writer.Key("latencyMs");
+    WritePercentiles(writer, latency, stats.maxLatency);
+    writer.Key("serviceTimeMs");
+    WritePercentiles(writer, serviceTime, -1);
+    writer.EndObject();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "用法：%s <场景文件> [--host 地址] [--port 端口] [--connections 连接数] [--threads 线程数] "
+                        "[--duration 秒] [--warmup 秒] [--rate 每秒请求数] [--pipeline 深度] [--close] [--timeout 毫秒] [--out 结果文件]\n",
+                argv[0]);
+        return 1;
+    }
+    Scenario scenario;
+    std::string outPath;
+    if (!LoadScenario(argv[1], scenario) || !ParseArgs(argc, argv, scenario, outPath))
+        return 1;
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_port = htons(scenario.port);
+    if (1 != inet_pton(AF_INET, scenario.host.c_str(), &address.sin_addr))
+    {
+        fprintf(stderr, "目标地址须为IPv4地址：%s\n", scenario.host.c_str());
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    std::vector<LoadRequest> requests;
+    BuildRequests(scenario, requests);
+
+    MetricsHistogram latency(MetricsHistogram::LatencyBounds(), 1e-9);
+    MetricsHistogram serviceTime(MetricsHistogram::LatencyBounds(), 1e-9);
+    // 各线程从同一时刻开始，预留建连时间
+    int64_t startNs = Metrics::NowNs() + 100000000;
+    std::vector<std::unique_ptr<LoadWorker>> workers;
+    for (int i = 0; i < scenario.threads; ++i)
+    {
+        int connections = scenario.connections / scenario.threads + (i < scenario.connections % scenario.threads ? 1 : 0);
+        workers.emplace_back(new LoadWorker(scenario, requests, address, i, connections, startNs, &latency, &serviceTime));
+    }
+    fprintf(stderr, "%s：%s:%d，%d个连接，%d个线程，%s，预热%.1f秒，统计%.1f秒\n", scenario.name.c_str(), scenario.host.c_str(),
+            scenario.port, scenario.connections, scenario.threads,
+            scenario.rate > 0 ? ("开环" + std::to_string((long)scenario.rate) + "次/秒").c_str() : "闭环",
+            scenario.warmup, scenario.duration);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers.size(); ++i)
+        threads.emplace_back(&LoadWorker::Run, workers[i].get());
+    LoadStats stats;
+    uint64_t scheduled = 0;
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i].join();
+        stats.Merge(workers[i]->GetStats());
+        scheduled += workers[i]->GetScheduled();
+    }
+
+    std::string result;
+    WriteResult(scenario, stats, scheduled, latency, serviceTime, result);
+    printf("%s\n", result.c_str());
+    if (!outPath.empty())
+    {
+        std::ofstream out(outPath);
+        out << result << "\n";
+    }
+    return stats.completed ? 0 : 1;
+}
@@ -0,0 +1,367 @@
+// 热点组件微基准（Google Benchmark）
+//  单独测量请求处理路径上各组件的开销，作为优化前后对比的基线：
+//  ParseHttpRequest、BindDynamicHandler路由、TypeIdentify::getContentTypeByPath、Logger::Append、
+//  TimerManager增删改、ThreadPool::AddTask往返、EventLoop::AddTask跨线程延迟、任务入队出队（std::function对比UniqueFunction）、
+//  TcpConnection创建与析构（make_shared对比slab池）、socketpair上的recvn/sendn、jsoncpp解析与序列化
+//  以LOG_DISABLE编译，组件内的LOG调用不计入结果，日志本身的开销由Logger::Append单独测量；组件内直接写std::cout的输出重定向到空设备
+//  用法：./micro_bench [--benchmark_filter=正则] [--benchmark_format=json] [--benchmark_repetitions=N]
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "TcpServer.hpp"
+#include "ThreadPool.hpp"
+#include "TimerManager.hpp"
+#include "TypeIdentify.hpp"
+#include "json.h"
+
+typedef std::shared_ptr<TcpConnection> spTcpConnection;
+
+// 作用域内std::cout输出到空设备，避免组件内的打印影响结果及污染基准报告
+class StdoutToNull
+{
+public:
+    StdoutToNull() : null_("/dev/null"), saved_(std::cout.rdbuf(null_.rdbuf())) {}
+    ~StdoutToNull() { std::cout.rdbuf(saved_); }
+
+private:
+    std::ofstream null_;
+    std::streambuf *saved_;
+};
+
+static const char *kGetRequest =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:8000\r\n"
+    "Connection: Keep-Alive\r\n"
+    "\r\n";
+
+/*
+ * 浏览器的典型请求头加上小请求体
+ *
+ */
+static const char *kPostRequest =
+    "POST /ResourceService/GetImageResource HTTP/1.1\r\n"
+    "Host: 127.0.0.1:8000\r\n"
+    "Connection: Keep-Alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: application/json, text/plain, */*\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Content-Type: application/json\r\n"
+    "Cookie: session=4f2a9c1e8b7d6a5f3e2d1c0b9a8f7e6d; theme=dark\r\n"
+    "Referer: http://127.0.0.1:8000/index.html\r\n"
+    "Content-Length: 15\r\n"
+    "\r\n"
+    "{\"imageId\":\"1\"}";
+
+static void BM_ParseHttpRequest(benchmark::State &state)
+{
+    EventLoop loop;
+    struct sockaddr_in address = {};
+    spTcpConnection conn = std::make_shared<TcpConnection>(&loop, -1, address);
+    const std::string request = state.range(0) ? kPostRequest : kGetRequest;
+    for (auto _ : state)
+    {
+        conn->GetReqestBuffer().header.clear();
+        conn->GetBufferIn() = request;
+        benchmark::DoNotOptimize(conn->ParseHttpRequest());
+    }
+    state.SetBytesProcessed(state.iterations() * request.size());
+    state.SetLabel(state.range(0) ? "POST, 10 headers" : "GET, 2 headers");
+    StdoutToNull silence;
+    conn.reset();
+}
+BENCHMARK(BM_ParseHttpRequest)->Arg(0)->Arg(1);
+
+/*
+ * 路由到注册的服务函数、默认网站服务与内置/metrics
+ *
+ */
+static void BM_BindDynamicHandler(benchmark::State &state)
+{
+    static const char *urls[] = {"/BenchService/Echo", "/images/test.jpg", "/metrics"};
+    StdoutToNull silence;
+    EventLoop loop;
+    std::unique_ptr<TcpServer> server(new TcpServer(&loop, 0));
+    TcpServer::Callback noop = [](spTcpConnection &) {};
+    const char *handlers[] = {"ReadMessageHandler", "SendOverHandler", "CloseConnHandler", "ErrorConnHandler", "Echo"};
+    for (const char *handler : handlers)
+    {
+        server->RegisterHandler("BenchService", handler, noop);
+        server->RegisterHandler(TcpServer::HttpServiceName, handler, noop);
+    }
+    server->RegisterHandler(TcpServer::HttpServiceName, TcpServer::HttpHandler, noop);
+    struct sockaddr_in address = {};
+    spTcpConnection conn = std::make_shared<TcpConnection>(&loop, -1, address);
+    const std::string url = urls[state.range(0)];
+    for (auto _ : state)
+    {
+        conn->GetReqestBuffer().url = url;
+        server->BindDynamicHandler(conn);
+    }
+    state.SetLabel(url);
+    conn.reset();
+    server.reset();
+}
+BENCHMARK(BM_BindDynamicHandler)->DenseRange(0, 2);
+
+static void BM_GetContentTypeByPath(benchmark::State &state)
+{
+    static const char *paths[] = {"../../../resource/www/index.html", "../../../resource/www/fzg/test.jpg", "/download/archive.unknown"};
+    const std::string path = paths[state.range(0)];
+    for (auto _ : state)
+        benchmark::DoNotOptimize(TypeIdentify::getContentTypeByPath(path));
+    state.SetLabel(path);
+}
+BENCHMARK(BM_GetContentTypeByPath)->DenseRange(0, 2);
+
+/*
+ * 与LOG宏展开后的调用一致
+ *
+ */
+static void BM_LoggerAppend(benchmark::State &state)
+{
+    StdoutToNull silence;
+    Logger *logger = Logger::GetInstance();
+    int fd = 42;
+    for (auto _ : state)
+        logger->Append(LoggerLevel::INFO, __FILE__, __LINE__, __FUNCTION__, "%s，sockfd：%d\n", "函数触发", fd);
+}
+BENCHMARK(BM_LoggerAppend);
+
+/*
+ * 时间轮中已有range(0)个定时器时，单个定时器的添加、调整与删除
+ *
+ */
+static void BM_TimerManager(benchmark::State &state)
+{
+    TimerManager *manager = TimerManager::GetTimerManagerInstance();
+    std::vector<std::unique_ptr<Timer>> background;
+    for (int i = 0; i < state.range(0); ++i)
+    {
+        background.emplace_back(new Timer(i % 5000, Timer::TIMER_ONCE, [] {}));
+        manager->AddTimer(background.back().get());
+    }
+    Timer timer(1000, Timer::TIMER_ONCE, [] {});
+    for (auto _ : state)
+    {
+        timer.timeOut_ = 1000;
+        manager->AddTimer(&timer);
+        timer.timeOut_ = 3000;
+        manager->AdjustTimer(&timer);
+        manager->RemoveTimer(&timer);
+    }
+    for (size_t i = 0; i < background.size(); ++i)
+        manager->RemoveTimer(background[i].get());
+}
+BENCHMARK(BM_TimerManager)->Arg(0)->Arg(10000);
+
+/*
+ * 提交任务到工作线程执行完毕的往返延迟，调用线程自旋等待
+ * ThreadPool析构时会join已分离的线程，线程池在进程内常驻不析构，与服务中的用法一致
+ *
+ */
+static void BM_ThreadPoolRoundTrip(benchmark::State &state)
+{
+    static ThreadPool *pool = nullptr;
+    if (!pool)
+    {
+        pool = new ThreadPool(1);
+        pool->Start();
+    }
+    std::atomic<uint64_t> done(0);
+    uint64_t expected = 0;
+    for (auto _ : state)
+    {
+        pool->AddTask([&done] { done.fetch_add(1, std::memory_order_release); });
+        ++expected;
+        while (done.load(std::memory_order_acquire) != expected)
+            ;
+    }
+}
+BENCHMARK(BM_ThreadPoolRoundTrip)->UseRealTime();
+
+/*
+ * 其他线程向EventLoop投递任务到任务执行的延迟，包含eventfd唤醒
+ *
+ */
+static void BM_EventLoopAddTask(benchmark::State &state)
+{
+    std::atomic<EventLoop *> loopPtr(nullptr);
+    std::thread loopThread([&loopPtr]
+                           {
+                               EventLoop loop;
+                               loopPtr.store(&loop);
+                               loop.loop();
+                           });
+    EventLoop *loop;
+    while (!(loop = loopPtr.load()))
+        std::this_thread::yield();
+    std::atomic<uint64_t> done(0);
+    uint64_t expected = 0;
+    for (auto _ : state)
+    {
+        loop->AddTask([&done] { done.fetch_add(1, std::memory_order_release); });
+        ++expected;
+        while (done.load(std::memory_order_acquire) != expected)
+            ;
+    }
+    loop->AddTask([loop] { loop->Quit(); });
+    loopThread.join();
+}
+BENCHMARK(BM_EventLoopAddTask)->UseRealTime();
+
+/*
+ * 与TcpConnection::SendBufferOut相同的任务（成员函数指针+连接的shared_ptr）构造、入队、出队并执行
+ * 只测量任务对象本身的开销，不含加锁与唤醒；range(0)为0时使用std::function，为1时使用UniqueFunction
+ *
+ */
+template <typename Task>
+static void TaskQueueRoundTrip(benchmark::State &state, const spTcpConnection &conn)
+{
+    std::vector<Task> queue;
+    std::vector<Task> running;
+    queue.reserve(64);
+    running.reserve(64);
+    for (auto _ : state)
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            spTcpConnection sptcpconn = conn;
+            queue.push_back(std::bind(&TcpConnection::GetReceiveLength, std::move(sptcpconn)));
+        }
+        running.swap(queue);
+        for (Task &task : running)
+            task();
+        running.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * 64);
+}
+
+static void BM_TaskQueue(benchmark::State &state)
+{
+    EventLoop loop;
+    struct sockaddr_in address = {};
+    spTcpConnection conn = std::make_shared<TcpConnection>(&loop, -1, address);
+    if (state.range(0))
+        TaskQueueRoundTrip<UniqueFunction<void()>>(state, conn);
+    else
+        TaskQueueRoundTrip<std::function<void()>>(state, conn);
+    state.SetLabel(state.range(0) ? "UniqueFunction" : "std::function");
+    StdoutToNull silence;
+    conn.reset();
+}
+BENCHMARK(BM_TaskQueue)->Arg(0)->Arg(1);
+
+/*
+ * 与TcpServer::OnNewConnection相同的连接创建，随后释放，只含内存分配与构造析构，不含系统调用
+ * range(0)为0时使用std::make_shared，为1时从slab池分配
+ *
+ */
+static void BM_ConnectionChurn(benchmark::State &state)
+{
+    StdoutToNull silence;
+    EventLoop loop;
+    struct sockaddr_in address = {};
+    for (auto _ : state)
+    {
+        spTcpConnection conn = state.range(0) ? std::allocate_shared<TcpConnection>(PoolAllocator<TcpConnection>(), &loop, -1, address)
+                                              : std::make_shared<TcpConnection>(&loop, -1, address);
+        benchmark::DoNotOptimize(conn.get());
+    }
+    state.SetLabel(state.range(0) ? "slab pool" : "make_shared");
+}
+BENCHMARK(BM_ConnectionChurn)->Arg(0)->Arg(1);
+
+/*
+ * range(0)字节的消息经非阻塞socketpair由sendn写出、recvn读回
+ *
+ */
+static void BM_SendnRecvn(benchmark::State &state)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) < 0)
+    {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+    EventLoop loop;
+    struct sockaddr_in address = {};
+    spTcpConnection conn = std::make_shared<TcpConnection>(&loop, fds[0], address);
+    const std::string payload(state.range(0), 'x');
+    std::string received;
+    for (auto _ : state)
+    {
+        std::string message = payload;
+        conn->sendn(fds[0], message);
+        conn->recvn(fds[1], received);
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+    close(fds[1]);
+    StdoutToNull silence;
+    conn.reset(); // 析构时关闭fds[0]
+}
+BENCHMARK(BM_SendnRecvn)->Arg(128)->Arg(4096)->Arg(65536);
+
+/*
+ * 账号服务的典型请求体
+ *
+ */
+static std::string MakeJsonDocument()
+{
+    Json::Value root;
+    root["serviceId"] = "s-001";
+    root["accountId"] = "10001";
+    root["token"] = "4f2a9c1e8b7d6a5f3e2d1c0b9a8f7e6d";
+    Json::Value &list = root["characterInfo"];
+    for (int i = 0; i < 8; ++i)
+    {
+        Json::Value character;
+        character["characterId"] = 20000 + i;
+        character["name"] = "character-" + std::to_string(i);
+        character["level"] = i * 7;
+        character["online"] = i % 2 == 0;
+        list.append(character);
+    }
+    Json::FastWriter writer;
+    return writer.write(root);
+}
+
+static void BM_JsonParse(benchmark::State &state)
+{
+    const std::string document = MakeJsonDocument();
+    Json::Reader reader;
+    for (auto _ : state)
+    {
+        Json::Value root;
+        benchmark::DoNotOptimize(reader.parse(document, root));
+    }
+    state.SetBytesProcessed(state.iterations() * document.size());
+}
+BENCHMARK(BM_JsonParse);
+
+static void BM_JsonWrite(benchmark::State &state)
+{
+    Json::Value root;
+    Json::Reader reader;
+    reader.parse(MakeJsonDocument(), root);
+    Json::FastWriter writer;
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        std::string document = writer.write(root);
+        bytes += document.size();
+        benchmark::DoNotOptimize(document);
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_JsonWrite);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,85 @@
+#!/bin/bash
+# Poller实现对比脚本
+#  依次以epoll、只用就绪通知的io_uring（uring-poll）、io_uring、io_uring+SQPOLL启动HttpService（18080），用负载生成器运行同一场景，
+#  压测前后抓取/metrics中的netserver_poller_syscalls_total与netserver_io_syscalls_total，输出吞吐、延迟与每个请求的系统调用次数
+#  Poller系统调用为epoll_wait/epoll_ctl或io_uring_enter；I/O系统调用为accept、read、send等，io_uring下accept与read由Poller完成
+#  用法：./poller_bench.sh [场景名]，默认hello；额外的负载生成器参数通过环境变量LOAD_ARGS传入
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+OUT=$ROOT/bench/out
+RESULTS=$OUT/results
+IO_THREADS=${IO_THREADS:-2}
+WORKER_THREADS=${WORKER_THREADS:-4}
+SCENARIO=${1:-hello}
+PORT=18080
+
+mkdir -p "$RESULTS"
+
+cmake -S "$ROOT/bench" -B "$OUT/bench" >/dev/null
+cmake --build "$OUT/bench" -j"$(nproc)" --target load_generator >/dev/null
+cmake -S "$ROOT/services/HttpService" -B "$OUT/HttpService" >/dev/null
+cmake --build "$OUT/HttpService" -j"$(nproc)" >/dev/null
+
+PID=
+cleanup() {
+    if [ -n "$PID" ]; then
+        kill "$PID" 2>/dev/null || true
+        wait "$PID" 2>/dev/null || true
+    fi
+    PID=
+}
+trap cleanup EXIT
+
+wait_port() {
+    for _ in $(seq 50); do
+        if (echo > "/dev/tcp/127.0.0.1/$1") 2>/dev/null; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    echo "端口$1未就绪" >&2
+    return 1
+}
+
+# 各实现的系统调用计数之和
+poller_syscalls() {
+    curl -s "http://127.0.0.1:$PORT/metrics" | awk '/^netserver_poller_syscalls_total\{/ { sum += $2 } END { print sum + 0 }'
+}
+
+io_syscalls() {
+    curl -s "http://127.0.0.1:$PORT/metrics" | awk '/^netserver_io_syscalls_total / { print $2 + 0 }'
+}
+
+json_field() {
+    grep -o "\"$2\":[0-9.e+-]*" "$1" | head -n1 | cut -d: -f2
+}
+
+printf "%-16s %10s %10s %10s %10s %18s %14s\n" "backend" "rps" "p50(ms)" "p99(ms)" "errors" "poller syscalls/req" "io syscalls/req"
+for backend in epoll uring-poll io_uring io_uring+sqpoll; do
+    sqpoll=0
+    completion=1
+    poller=${backend%%+*}
+    [ "$backend" = "io_uring+sqpoll" ] && sqpoll=1
+    [ "$backend" = "uring-poll" ] && poller=io_uring && completion=0
+    mkdir -p "$ROOT/services/HttpService/out"
+    (cd "$ROOT/services/HttpService/out" &&
+        NETSERVER_POLLER=$poller NETSERVER_URING_SQPOLL=$sqpoll NETSERVER_URING_COMPLETION=$completion exec "$OUT/HttpService/server" "$PORT" "$IO_THREADS" "$WORKER_THREADS" >/dev/null 2>&1) &
+    PID=$!
+    wait_port "$PORT"
+    result="$RESULTS/poller_${SCENARIO}_${backend}.json"
+    before=$(poller_syscalls)
+    ioBefore=$(io_syscalls)
+    "$OUT/bench/load_generator" "$ROOT/bench/scenarios/$SCENARIO.json" --port "$PORT" --out "$result" $LOAD_ARGS >/dev/null 2>&1
+    after=$(poller_syscalls)
+    ioAfter=$(io_syscalls)
+    cleanup
+    requests=$(json_field "$result" requests)
+    errors=$(( $(json_field "$result" errors) + $(json_field "$result" timeouts) ))
+    # 系统调用计数包含预热阶段，以测量阶段的请求数为分母，结果略偏高
+    perRequest=$(awk -v calls=$((after - before)) -v requests="$requests" 'BEGIN { printf "%.3f", requests ? calls / requests : 0 }')
+    ioPerRequest=$(awk -v calls=$((ioAfter - ioBefore)) -v requests="$requests" 'BEGIN { printf "%.3f", requests ? calls / requests : 0 }')
+    printf "%-16s %10s %10s %10s %10s %18s %14s\n" "$backend" "$(json_field "$result" rps)" "$(json_field "$result" p50)" \
+        "$(json_field "$result" p99)" "$errors" "$perRequest" "$ioPerRequest"
+done
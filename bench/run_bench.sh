@@ -0,0 +1,77 @@
+#!/bin/bash
+# 服务压测脚本
+#  编译负载生成器与HttpService、AllService、PortProxyService，生成1KB/64KB/1MB的静态资源，
+#  启动HttpService（18080）、AllService（18081，含ResourceService）与原始TCP转发到HttpService的PortProxyService（18082），
+#  依次运行bench/scenarios下的场景，结果写入bench/out/results/<场景名>.json
+#  用法：./run_bench.sh [场景名...]，不指定时运行全部场景；额外的负载生成器参数通过环境变量LOAD_ARGS传入，如LOAD_ARGS="--duration 30"
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+OUT=$ROOT/bench/out
+RESULTS=$OUT/results
+IO_THREADS=${IO_THREADS:-2}
+WORKER_THREADS=${WORKER_THREADS:-4}
+
+mkdir -p "$RESULTS"
+
+# 编译
+cmake -S "$ROOT/bench" -B "$OUT/bench" >/dev/null
+cmake --build "$OUT/bench" -j"$(nproc)" --target load_generator >/dev/null
+for service in HttpService AllService PortProxyService; do
+    cmake -S "$ROOT/services/$service" -B "$OUT/$service" >/dev/null
+    cmake --build "$OUT/$service" -j"$(nproc)" >/dev/null
+done
+
+# 静态资源，随机内容避免压缩影响结果
+mkdir -p "$ROOT/resource/www/bench"
+for size in 1k:1024 64k:65536 1m:1048576; do
+    file="$ROOT/resource/www/bench/${size%%:*}.html"
+    if [ ! -f "$file" ]; then
+        head -c "${size##*:}" /dev/urandom | base64 -w 100 | head -c "${size##*:}" > "$file"
+    fi
+done
+
+# 启动服务，服务需在各自的out目录下运行以找到日志与资源的相对路径
+PIDS=()
+cleanup() {
+    for pid in "${PIDS[@]}"; do
+        kill "$pid" 2>/dev/null || true
+    done
+}
+trap cleanup EXIT
+
+start_service() {
+    local service=$1
+    shift
+    mkdir -p "$ROOT/services/$service/out"
+    (cd "$ROOT/services/$service/out" && exec "$OUT/$service/server" "$@" >/dev/null 2>&1) &
+    PIDS+=($!)
+}
+
+wait_port() {
+    for _ in $(seq 50); do
+        if (echo > "/dev/tcp/127.0.0.1/$1") 2>/dev/null; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    echo "端口$1未就绪" >&2
+    return 1
+}
+
+start_service HttpService 18080 "$IO_THREADS" "$WORKER_THREADS"
+start_service AllService 18081 "$IO_THREADS" "$WORKER_THREADS"
+# 原始转发模式每个连接占用一个工作线程，工作线程数不少于场景的连接数
+start_service PortProxyService 18082 "$IO_THREADS" 128 127.0.0.1 18080
+wait_port 18080
+wait_port 18081
+wait_port 18082
+
+# 运行场景
+if [ $# -eq 0 ]; then
+    set -- $(cd "$ROOT/bench/scenarios" && ls *.json | sed 's/\.json$//')
+fi
+for scenario in "$@"; do
+    "$OUT/bench/load_generator" "$ROOT/bench/scenarios/$scenario.json" --out "$RESULTS/$scenario.json" $LOAD_ARGS
+done
@@ -16,28 +16,56 @@
 //                  如果还需要继续监听这个socket的话，
 //                  需要再次把这个socket加入到EPOLL队列里；
 
+//  完成模式：所有者在加入Poller之前以SetCompletion请求由Poller代为accept或recv，
+//  io_uring下Poller以多次触发的accept/recv完成，新连接与收到的数据暂存在Channel内，再以EPOLLIN通知处理函数取走；
+//  epoll或内核不支持时CompletionActive为false，处理函数照常自行accept与read
+//  暂存区只在loop所在线程访问
+
 #pragma once
 
 #include <iostream>
+#include <deque>
+#include <string>
 #include <functional>
 #include <sys/epoll.h>
 #include "LogServer.hpp"
+#include "UniqueFunction.hpp"
 
 class Channel
 {
 public:
-    typedef std::function<void()> Callback;
+    typedef UniqueFunction<void()> Callback;
+    enum Completion
+    {
+        COMPLETION_NONE,   // 就绪通知，处理函数自行读写
+        COMPLETION_ACCEPT, // 监听套接字，由Poller以多次触发的accept接受新连接
+        COMPLETION_RECV    // 已连接套接字，由Poller以多次触发的recv接收数据
+    };
+    static const int RECV_CLOSED = 1; // RecvStatus：对端已关闭
     Channel();
     ~Channel();
     void SetFd(int fd);                      // 设置连接套接字fd
     int GetFd() const;                       // 获取连接套接字fd
     void SetEvents(uint32_t events);         // 设置连接监听事件epoll_event
     uint32_t GetEvents() const;              // 获取连接事件epoll_event
-    void SetReadHandle(const Callback &cb);  // 设置读事件（EPOLLIN）处理函数
-    void SetWriteHandle(const Callback &cb); // 设置写事件（EPOLLOUT）处理函数
-    void SetErrorHandle(const Callback &cb); // 设置出错处理函数
-    void SetCloseHandle(const Callback &cb); // 设置连接关闭函数
+    void SetReadHandle(Callback cb);         // 设置读事件（EPOLLIN）处理函数
+    void SetWriteHandle(Callback cb);        // 设置写事件（EPOLLOUT）处理函数
+    void SetErrorHandle(Callback cb);        // 设置出错处理函数
+    void SetCloseHandle(Callback cb);        // 设置连接关闭函数
     void HandleEvent();                      // 执行连接事件
+    void SetCompletion(Completion completion) { completion_ = completion; } // 请求完成模式，加入Poller之前调用
+    Completion GetCompletion() const { return completion_; }
+    bool CompletionActive() const { return completionActive_; }            // Poller是否正以完成模式处理
+    void SetCompletionActive(bool active) { completionActive_ = active; }  // 由Poller设置
+    bool TakeAccepted(int &fd);              // 取出一个Poller已accept的新连接，没有时返回false
+    void AddAccepted(int fd) { accepted_.push_back(fd); }                  // 由Poller调用
+    std::string &Received() { return received_; } // Poller已接收、尚未取走的数据
+    int RecvStatus() const { return recvStatus_; } // recv的结束状态：0为进行中，RECV_CLOSED为对端关闭，负数为-errno
+    void SetRecvStatus(int status) { recvStatus_ = status; }
+    size_t RecvLimit() const { return recvLimit_; } // 暂存数据达到该字节数时Poller暂停recv，0为Poller的默认值
+    void SetRecvLimit(size_t limit) { recvLimit_ = limit; }
+    bool RecvPaused() const { return recvPaused_; } // recv因暂存数据达到上限而暂停，取走后经UpdateChannel恢复
+    void SetRecvPaused(bool paused) { recvPaused_ = paused; }
 
 private:
     int fd_;                // 连接套接字描述符
@@ -46,11 +74,23 @@ private:
     Callback writeHandler;  // 写数据回调函数
     Callback errorHandler_; // 错误处理回调函数
     Callback closeHandler_; // 关闭连接回调函数
+    Completion completion_; // 请求的完成模式
+    bool completionActive_; // Poller正以完成模式处理
+    std::deque<int> accepted_; // Poller已accept、尚未取走的新连接
+    std::string received_;  // Poller已接收、尚未取走的数据
+    int recvStatus_;        // recv的结束状态
+    size_t recvLimit_;      // 暂存数据上限，所有者等待完整请求时可调大
+    bool recvPaused_;       // recv已因暂存数据达到上限而暂停
     
 };
 
 Channel::Channel()
-    : fd_(-1)
+    : fd_(-1),
+      completion_(COMPLETION_NONE),
+      completionActive_(false),
+      recvStatus_(0),
+      recvLimit_(0),
+      recvPaused_(false)
 {
     LOG(LoggerLevel::INFO, "函数触发，sockfd：%d\n", fd_);
 }
@@ -104,40 +144,53 @@ uint32_t Channel::GetEvents() const
  * 设置读事件（EPOLLIN）处理函数
  *
  */
-void Channel::SetReadHandle(const Callback &cb)
+void Channel::SetReadHandle(Callback cb)
 {
     LOG(LoggerLevel::INFO, "函数触发，sockfd：%d\n", fd_);
-    readHandler_ = cb;
+    readHandler_ = std::move(cb);
 }
 
 /*
  * 设置写事件（EPOLLOUT）处理函数
  *
  */
-void Channel::SetWriteHandle(const Callback &cb)
+void Channel::SetWriteHandle(Callback cb)
 {
     LOG(LoggerLevel::INFO, "函数触发，sockfd：%d\n", fd_);
-    writeHandler = cb;
+    writeHandler = std::move(cb);
 }
 
 /*
  * 设置出错处理函数
  *
  */
-void Channel::SetErrorHandle(const Callback &cb)
+void Channel::SetErrorHandle(Callback cb)
 {
     LOG(LoggerLevel::INFO, "函数触发，sockfd：%d\n", fd_);
-    errorHandler_ = cb;
+    errorHandler_ = std::move(cb);
 }
 
 /*
  * 设置连接关闭函数
  *
  */
-void Channel::SetCloseHandle(const Callback &cb)
+void Channel::SetCloseHandle(Callback cb)
 {
     LOG(LoggerLevel::INFO, "函数触发，sockfd：%d\n", fd_);
-    closeHandler_ = cb;
+    closeHandler_ = std::move(cb);
+}
+
+/*
+ * 取出一个Poller已accept的新连接
+ *
+ */
+bool Channel::TakeAccepted(int &fd)
+{
+    if (accepted_.empty())
+        return false;
+    fd = accepted_.front();
+    accepted_.pop_front();
+    return true;
 }
 
 /*
@@ -147,6 +200,7 @@ void Channel::SetCloseHandle(const Callback &cb)
 void Channel::HandleEvent()
 {
     LOG(LoggerLevel::INFO, "函数触发，sockfd：%d\n", fd_);
+    uint32_t events = events_; // 处理函数可能修改events_
     if (events_ & EPOLLRDHUP)
     {
         // 客户端异常关闭事件
@@ -159,6 +213,9 @@ void Channel::HandleEvent()
         LOG(LoggerLevel::INFO, "客户端有数据可读或正常关闭（EPOLLIN | EPOLLPRI），sockfd：%d\n", fd_);
         // std::cout << "Channel::HandleEvent 读取客户端的请求数据，sockfd：" << fd_ << std::endl;
         readHandler_();
+        // 读写事件同时到达时也要处理写事件，边缘触发下被忽略的可写事件不会再次通知，未发完的数据将一直滞留
+        if ((events & EPOLLOUT) && writeHandler)
+            writeHandler();
     }
     else if (events_ & EPOLLOUT)
     {
@@ -0,0 +1,115 @@
+// Codec类：
+//  连接的协议编解码接口，负责从接收缓冲区切分出完整的消息（成帧），以及将消息编码为待发送的数据
+//  TcpServer未设置编解码器时，连接使用内置的HTTP/1.1解析（含h2c与WebSocket升级）并按url动态绑定服务函数
+//  TcpServer::SetCodec设置编解码器后，新连接不再经过http解析与函数绑定，每条完整消息直接回调服务的消息处理函数
+//  内置LengthPrefixedCodec（4字节长度前缀的二进制帧）、LineCodec（按行分隔的文本）、RawCodec（收到的数据原样透传）
+//  编解码器不保存连接状态，同一个实例可被所有连接共享
+
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <arpa/inet.h>
+
+#define CODEC_MAX_FRAME_SIZE (16 * 1024 * 1024) // LengthPrefixedCodec默认的单帧最大长度
+#define CODEC_MAX_LINE_SIZE (64 * 1024)         // LineCodec默认的单行最大长度
+
+class Codec
+{
+public:
+    virtual ~Codec() {}
+    virtual const char *Name() const = 0; // 编解码器名称，用于日志
+    // 从data解析一条完整消息，message指向data内部不拷贝；返回消耗的字节数，数据不完整返回0，数据非法返回-1
+    virtual long Decode(const char *data, size_t size, const char *&message, size_t &length) const = 0;
+    // 将一条消息编码后追加到output
+    virtual void Encode(const char *message, size_t length, std::string &output) const = 0;
+};
+
+// 长度前缀的二进制帧：| 长度 4B（网络字节序，不含自身） | 消息 |
+class LengthPrefixedCodec : public Codec
+{
+public:
+    explicit LengthPrefixedCodec(size_t maxFrameSize = CODEC_MAX_FRAME_SIZE) : maxFrameSize_(maxFrameSize) {}
+    const char *Name() const override { return "length-prefixed"; }
+    long Decode(const char *data, size_t size, const char *&message, size_t &length) const override;
+    void Encode(const char *message, size_t length, std::string &output) const override;
+
+private:
+    size_t maxFrameSize_;
+};
+
+long LengthPrefixedCodec::Decode(const char *data, size_t size, const char *&message, size_t &length) const
+{
+    if (size < 4)
+        return 0;
+    uint32_t frameSize;
+    memcpy(&frameSize, data, 4);
+    frameSize = ntohl(frameSize);
+    if (frameSize > maxFrameSize_)
+        return -1;
+    if (size < 4 + (size_t)frameSize)
+        return 0;
+    message = data + 4;
+    length = frameSize;
+    return 4 + (long)frameSize;
+}
+
+void LengthPrefixedCodec::Encode(const char *message, size_t length, std::string &output) const
+{
+    uint32_t frameSize = htonl((uint32_t)length);
+    output.append((const char *)&frameSize, 4);
+    output.append(message, length);
+}
+
+// 按行分隔的文本，解码时以'\n'切分并去除行尾的'\r'，编码时追加分隔符
+class LineCodec : public Codec
+{
+public:
+    explicit LineCodec(size_t maxLineSize = CODEC_MAX_LINE_SIZE, const std::string &delimiter = "\r\n")
+        : maxLineSize_(maxLineSize), delimiter_(delimiter) {}
+    const char *Name() const override { return "line"; }
+    long Decode(const char *data, size_t size, const char *&message, size_t &length) const override;
+    void Encode(const char *message, size_t length, std::string &output) const override;
+
+private:
+    size_t maxLineSize_;
+    std::string delimiter_;
+};
+
+long LineCodec::Decode(const char *data, size_t size, const char *&message, size_t &length) const
+{
+    const char *lineEnd = (const char *)memchr(data, '\n', size);
+    if (!lineEnd)
+        return size > maxLineSize_ ? -1 : 0;
+    message = data;
+    length = lineEnd - data;
+    if (length > maxLineSize_)
+        return -1;
+    if (length > 0 && '\r' == data[length - 1])
+        --length;
+    return lineEnd - data + 1;
+}
+
+void LineCodec::Encode(const char *message, size_t length, std::string &output) const
+{
+    output.append(message, length);
+    output.append(delimiter_);
+}
+
+// 原样透传，每次收到的数据作为一条消息，适用于代理等不关心协议内容的服务
+class RawCodec : public Codec
+{
+public:
+    const char *Name() const override { return "raw"; }
+    long Decode(const char *data, size_t size, const char *&message, size_t &length) const override
+    {
+        message = data;
+        length = size;
+        return (long)size;
+    }
+    void Encode(const char *message, size_t length, std::string &output) const override
+    {
+        output.append(message, length);
+    }
+};
@@ -0,0 +1,199 @@
+// CpuAffinity类：
+//  loop线程与线程池工作线程的命名、CPU绑定与NUMA放置，EventLoopThread与ThreadPool的线程启动时调用BindThread
+//  线程按角色与启动顺序命名为io-N、worker-N（pthread_setname_np），便于top -H、perf与gdb区分
+//  环境变量NETSERVER_AFFINITY=1时绑定CPU：可用CPU取进程启动时sched_getaffinity的结果，
+//  前NETSERVER_IO_CPUS个（默认为一半，向上取整）留给loop线程，第N个loop线程固定在其中第N%个CPU上，不再迁移；
+//  工作线程共享其余的CPU，没有其余CPU时共享全部可用CPU
+//  NETSERVER_NUMA_NODE=n时可用CPU限定为该节点的CPU，线程以MPOL_PREFERRED优先从该节点分配内存；
+//  连接对象池（见ObjectPool.hpp）按线程划分，slab由所属线程首次写入，线程固定在节点内后池的内存即位于本节点
+//  ThreadNum解析服务的线程数启动参数，"auto"按可用CPU数确定loop线程与工作线程数量，避免线程数远超CPU数
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "LogServer.hpp"
+
+class CpuAffinity
+{
+public:
+    enum Role
+    {
+        IO,    // EventLoopThread的loop线程
+        WORKER // ThreadPool的工作线程
+    };
+    static CpuAffinity *GetInstance();
+    static int ThreadNum(const char *arg, Role role); // 解析线程数参数，"auto"按可用CPU数确定
+    void BindThread(Role role);                       // 在新线程内调用：命名，并按配置绑定CPU与NUMA节点
+    int CpuCount() const { return (int)cpus_.size(); } // 可用CPU数
+    int IoCpuCount() const { return (int)ioCpus_; }    // 留给loop线程的CPU数
+
+private:
+    CpuAffinity();
+    static std::vector<int> ParseCpuList(const std::string &list); // 解析"0-3,8"格式的CPU列表
+    bool SetAffinity(size_t begin, size_t end);                    // 当前线程绑定到cpus_[begin, end)
+
+    bool enabled_;                 // 是否绑定CPU
+    int numaNode_;                 // 限定的NUMA节点，-1表示不限定
+    std::vector<int> cpus_;        // 可用CPU编号
+    size_t ioCpus_;                // cpus_的前ioCpus_个留给loop线程
+    std::atomic<int> ioIndex_;     // 下一个loop线程的序号
+    std::atomic<int> workerIndex_; // 下一个工作线程的序号
+};
+
+CpuAffinity *CpuAffinity::GetInstance()
+{
+    static CpuAffinity affinity;
+    return &affinity;
+}
+
+/*
+ * 读取进程的可用CPU与环境变量
+ * NUMA节点的CPU列表取自/sys/devices/system/node/node<n>/cpulist，与可用CPU取交集，交集为空时忽略该配置
+ *
+ */
+CpuAffinity::CpuAffinity()
+    : enabled_(false),
+      numaNode_(-1),
+      cpus_(),
+      ioCpus_(0),
+      ioIndex_(0),
+      workerIndex_(0)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &set))
+                cpus_.push_back(cpu);
+    }
+    if (cpus_.empty())
+    {
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+        for (int cpu = 0; cpu < (count > 0 ? count : 1); ++cpu)
+            cpus_.push_back(cpu);
+    }
+    const char *enabled = getenv("NETSERVER_AFFINITY");
+    enabled_ = enabled && std::string(enabled) == "1";
+    const char *node = getenv("NETSERVER_NUMA_NODE");
+    if (node && *node)
+    {
+        std::ifstream in("/sys/devices/system/node/node" + std::string(node) + "/cpulist");
+        std::string list;
+        std::vector<int> nodeCpus;
+        if (std::getline(in, list))
+            nodeCpus = ParseCpuList(list);
+        std::vector<int> cpus;
+        for (int cpu : cpus_)
+            for (int nodeCpu : nodeCpus)
+                if (cpu == nodeCpu)
+                    cpus.push_back(cpu);
+        if (cpus.empty())
+        {
+            LOG(LoggerLevel::ERROR, "NUMA节点%s没有可用CPU，忽略NETSERVER_NUMA_NODE\n", node);
+        }
+        else
+        {
+            cpus_.swap(cpus);
+            numaNode_ = atoi(node);
+        }
+    }
+    ioCpus_ = (cpus_.size() + 1) / 2;
+    const char *ioCpus = getenv("NETSERVER_IO_CPUS");
+    if (ioCpus && atoi(ioCpus) > 0)
+        ioCpus_ = std::min((size_t)atoi(ioCpus), cpus_.size());
+    LOG(LoggerLevel::INFO, "可用CPU数：%d，loop线程CPU数：%d，绑定CPU：%d，NUMA节点：%d\n",
+        (int)cpus_.size(), (int)ioCpus_, (int)enabled_, numaNode_);
+}
+
+/*
+ * 解析线程数参数
+ * "auto"时loop线程数为留给loop线程的CPU数，工作线程数为其余CPU数，均至少为1；其他按整数解析
+ *
+ */
+int CpuAffinity::ThreadNum(const char *arg, Role role)
+{
+    if (std::string(arg) != "auto")
+        return atoi(arg);
+    CpuAffinity *affinity = GetInstance();
+    if (IO == role)
+        return std::max(affinity->IoCpuCount(), 1);
+    return std::max(affinity->CpuCount() - affinity->IoCpuCount(), 1);
+}
+
+/*
+ * 在新线程内调用，按角色与启动顺序命名线程
+ * 开启绑定时loop线程固定到一个CPU，工作线程绑定到其余CPU的集合，限定NUMA节点时优先从该节点分配内存
+ *
+ */
+void CpuAffinity::BindThread(Role role)
+{
+    int index = (IO == role ? ioIndex_ : workerIndex_).fetch_add(1, std::memory_order_relaxed);
+    char name[16];
+    snprintf(name, sizeof(name), "%s-%d", IO == role ? "io" : "worker", index);
+    pthread_setname_np(pthread_self(), name);
+    if (numaNode_ >= 0 && numaNode_ < (int)(sizeof(unsigned long) * 8))
+    {
+        unsigned long nodeMask = 1UL << numaNode_;
+        if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodeMask, sizeof(nodeMask) * 8) != 0)
+        {
+            LOG(LoggerLevel::ERROR, "线程%s设置NUMA内存策略失败，节点：%d\n", name, numaNode_);
+        }
+    }
+    if (!enabled_)
+        return;
+    bool bound;
+    if (IO == role)
+    {
+        size_t cpu = index % ioCpus_;
+        bound = SetAffinity(cpu, cpu + 1);
+    }
+    else if (ioCpus_ < cpus_.size())
+        bound = SetAffinity(ioCpus_, cpus_.size());
+    else
+        bound = SetAffinity(0, cpus_.size());
+    if (!bound)
+    {
+        LOG(LoggerLevel::ERROR, "线程%s绑定CPU失败\n", name);
+    }
+}
+
+bool CpuAffinity::SetAffinity(size_t begin, size_t end)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = begin; i < end; ++i)
+        CPU_SET(cpus_[i], &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+std::vector<int> CpuAffinity::ParseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size())
+    {
+        size_t comma = list.find(',', pos);
+        std::string range = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        size_t dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = dash == std::string::npos ? first : atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+        if (comma == std::string::npos)
+            break;
+        pos = comma + 1;
+    }
+    return cpus;
+}
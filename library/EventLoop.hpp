@@ -9,6 +9,8 @@
 //  只有一个时，主线程循环调用loop监听epoll直至结束
 //  多个线程时，子线程循环调用loop监听客户端连接直至子线程结束
 //  主线程循环调用loop专用于监听TceServer的Channel
+//  每个EventLoop内置一个timerfd，RunEvery添加的周期任务在loop所在线程执行
+//  就绪列表readyList_存放读预算用尽、socket内仍有数据的连接的续读任务，每轮在处理完新事件后执行，非空时poll不阻塞
 
 #pragma once
 
@@ -17,39 +19,71 @@
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include "Poller.hpp"
 #include "Channel.hpp"
 #include "LogServer.hpp"
+#include "Metrics.hpp"
+#include "RequestTrace.hpp"
+#include "UniqueFunction.hpp"
 
 class EventLoop
 {
 public:
-    typedef std::function<void()> Functor;
+    typedef UniqueFunction<void()> Functor;        // 任务函数，只可移动，常见的任务不分配堆内存
     typedef std::vector<Channel *> ChannelList;
+    typedef uint64_t TimerId;                      // 周期任务id，0表示无效
     EventLoop();
     ~EventLoop();
     std::thread::id GetThreadId() const;           // 获取EventLoop所在线程ID
     void loop();                                   // 循环监听事件并处理，以及执行functorList_上的任务
     void AddTask(Functor functor);                 // 添加任务到事件列表functorList_，唤醒工作线程
     void WakeUp();                                 // 唤醒工作线程
+    void HandleWakeUp();                           // 读取唤醒标志，清空eventfd计数
     void Quit();                                   // 停止运行EventLoop事件循环
     void ExecuteTask();                            // 执行functorList_里的所有任务函数
     void AddChannelToPoller(Channel *pchannel);    // Poller监听Channel对应新连接
     void RemoveChannelToPoller(Channel *pchannel); // Poller移除Channel对应连接监听
     void UpdateChannelToPoller(Channel *pchannel); // Poller更改Channel对应连接事件信息
+    TimerId RunEvery(int intervalMs, Functor functor); // 添加周期任务，每隔intervalMs毫秒在loop所在线程执行一次，可跨线程调用
+    void CancelTimer(TimerId timerId);                 // 取消周期任务，可跨线程调用
+    void QueueReady(Functor functor);                  // 添加续读任务到就绪列表，下一轮处理完新事件后执行，只能在loop所在线程调用
 
 private:
     std::mutex mutex_;                 // 锁
     std::vector<Functor> functorList_; // 任务列表
     std::thread::id tid_;              // 当前线程id
     ChannelList activeChannelList_;    // 连接列表，存储当前批次事件的Channel实例
-    Poller poller_;                    // epoll封装类实例
-    bool quit_;                        // 停止循环监听事件标志位
+    std::unique_ptr<Poller> poller_;   // 事件多路复用实例，epoll或io_uring，由Poller::Create选择
+    std::atomic<bool> quit_;           // 停止循环监听事件标志位，可由其他线程置位
     int wakeUpFd_;                     // 共享内存fd，用于唤醒线程
+    Channel wakeUpChannel_;            // wakeUpFd_对应的Channel，epoll_wait因其可读而返回
+    // 周期任务，仅在loop所在线程访问
+    typedef struct _LoopTimer
+    {
+        int64_t expiration; // 下次执行的时间点，steady_clock毫秒
+        int interval;       // 执行间隔，毫秒
+        Functor functor;    // 任务函数
+    } LoopTimer;
+    int timerFd_;                          // timerfd，到期时间为最早到期的周期任务
+    Channel timerChannel_;                 // timerFd_对应的Channel
+    std::atomic<TimerId> nextTimerId_;     // 下一个周期任务id
+    std::map<TimerId, LoopTimer> timers_;  // 周期任务id->周期任务
+    std::vector<Functor> readyList_;       // 就绪列表，仅在loop所在线程访问
+    void ExecuteReady(std::vector<Functor> &readyList); // 执行上一轮加入就绪列表的续读任务
+    void HandleTimer();                    // 执行到期的周期任务并重新设置timerFd_
+    void ResetTimerFd();                   // 按最早到期的周期任务设置timerFd_，无任务时停止
+    static int64_t NowMs();                // steady_clock当前毫秒数
     
 };
 
@@ -71,22 +105,55 @@ int CreateEventFd()
     return evtFd;
 }
 
+/*
+ * 创建timerfd，用于驱动EventLoop的周期任务
+ *
+ */
+int CreateTimerFd()
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerFd < 0)
+    {
+        LOG(LoggerLevel::ERROR, "%s\n", "创建定时器描述符失败，退出");
+        std::cout << "EventLoop::EventLoop 创建定时器描述符失败，退出" << std::endl;
+        perror("创建定时器描述符失败");
+        exit(1);
+    }
+    return timerFd;
+}
+
 EventLoop::EventLoop()
     : functorList_(),
       activeChannelList_(),
-      poller_(),
-      quit_(true),
+      poller_(Poller::Create()),
+      quit_(false),
       tid_(std::this_thread::get_id()),
       mutex_(),
-      wakeUpFd_(CreateEventFd())
+      wakeUpFd_(CreateEventFd()),
+      wakeUpChannel_(),
+      timerFd_(CreateTimerFd()),
+      timerChannel_(),
+      nextTimerId_(0)
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    wakeUpChannel_.SetFd(wakeUpFd_);
+    wakeUpChannel_.SetEvents(EPOLLIN | EPOLLET);
+    wakeUpChannel_.SetReadHandle(std::bind(&EventLoop::HandleWakeUp, this));
+    poller_->AddChannel(&wakeUpChannel_);
+    timerChannel_.SetFd(timerFd_);
+    timerChannel_.SetEvents(EPOLLIN | EPOLLET);
+    timerChannel_.SetReadHandle(std::bind(&EventLoop::HandleTimer, this));
+    poller_->AddChannel(&timerChannel_);
 }
 
 EventLoop::~EventLoop()
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    poller_->RemoveChannel(&wakeUpChannel_);
+    poller_->RemoveChannel(&timerChannel_);
     close(wakeUpFd_);
+    close(timerFd_);
 }
 
 /*
@@ -99,7 +166,7 @@ void EventLoop::AddChannelToPoller(Channel *pchannel)
     LOG(LoggerLevel::INFO, "一个EventLoop添加连接监听，目标sockfd：%d\n", pchannel->GetFd());
     // std::cout << "EventLoop::AddChannelToPoller 一个EventLoop添加连接监听，目标sockfd：" << pchannel->GetFd() << std::endl;
     // std::lock_guard<std::mutex> lock(mutex_);
-    poller_.AddChannel(pchannel);
+    poller_->AddChannel(pchannel);
 }
 
 /*
@@ -112,7 +179,7 @@ void EventLoop::RemoveChannelToPoller(Channel *pchannel)
     LOG(LoggerLevel::INFO, "一个EventLoop移除连接监听，目标sockfd：%d\n", pchannel->GetFd());
     // std::cout << "EventLoop::RemoveChannelToPoller 一个EventLoop移除连接监听，目标sockfd：" << pchannel->GetFd() << std::endl;
     std::lock_guard<std::mutex> lock(mutex_);
-    poller_.RemoveChannel(pchannel);
+    poller_->RemoveChannel(pchannel);
 }
 
 /*
@@ -124,17 +191,20 @@ void EventLoop::UpdateChannelToPoller(Channel *pchannel)
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     LOG(LoggerLevel::INFO, "一个EventLoop更新连接监听，目标sockfd：%d\n", pchannel->GetFd());
     // std::cout << "EventLoop::UpdateChannelToPoller 一个EventLoop更新连接监听，目标sockfd：" << pchannel->GetFd() << std::endl;
-    poller_.UpdateChannel(pchannel);
+    poller_->UpdateChannel(pchannel);
 }
 
 /*
- * 停止运行EventLoop事件循环
+ * 停止运行EventLoop事件循环，可跨线程调用
+ * 唤醒阻塞在poll内的loop，使其立即退出，而不是等待poll超时
+ * loop开始前调用同样有效，loop不会再清除退出标志
  *
  */
 void EventLoop::Quit()
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     quit_ = true;
+    WakeUp();
 }
 
 /*
@@ -149,34 +219,180 @@ std::thread::id EventLoop::GetThreadId() const
 
 /*
  * EventLoop添加任务到functorList_
- * 并唤醒工作线程
+ * 并唤醒工作线程，避免任务等待poll超时（1秒）后才被执行
+ * 任务列表非空时已有唤醒标志未被处理，无需重复写入
  */
 void EventLoop::AddTask(Functor functor)
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    bool wakeUp = false;
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        functorList_.push_back(functor);
+        wakeUp = functorList_.empty();
+        functorList_.push_back(std::move(functor));
     }
+    if (wakeUp)
+        WakeUp();
 }
 
 /*
  * 唤醒线程
  * 实则为向eventfd生成的文件描述符wakeUpFd_写入唤醒标志值
- * 此函数已废弃
+ * eventfd写入本身是原子的，无需加锁
  *
  */
 void EventLoop::WakeUp()
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     uint64_t one = 1;
-    std::lock_guard<std::mutex> lock(mutex_);
     ssize_t n = write(wakeUpFd_, (char *)(&one), sizeof one);
-    /* 读取唤醒标志方式：
-        uint64_t one = 1;
-        std::lock_guard<std::mutex> lock(mutex_);
-        ssize_t n = read(wakeUpFd_, &one, sizeof one);
-        */
+    if (n != sizeof one)
+        LOG(LoggerLevel::ERROR, "写入唤醒标志失败，写入字节数：%d\n", n);
+}
+
+/*
+ * 读取唤醒标志，清空eventfd计数
+ * 任务在本轮事件处理结束后由loop统一执行
+ *
+ */
+void EventLoop::HandleWakeUp()
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    uint64_t one = 0;
+    ssize_t n = read(wakeUpFd_, &one, sizeof one);
+    (void)n;
+}
+
+/*
+ * 添加周期任务，每隔intervalMs毫秒在loop所在线程执行一次
+ * 任务经任务队列加入timers_，因此可在任意线程调用，返回的id用于取消
+ *
+ */
+EventLoop::TimerId EventLoop::RunEvery(int intervalMs, Functor functor)
+{
+    LOG(LoggerLevel::INFO, "函数触发，间隔：%d毫秒\n", intervalMs);
+    TimerId timerId = ++nextTimerId_;
+    if (intervalMs < 1)
+        intervalMs = 1;
+    AddTask([this, timerId, intervalMs, functor = std::move(functor)]() mutable
+            {
+                LoopTimer timer;
+                timer.expiration = NowMs() + intervalMs;
+                timer.interval = intervalMs;
+                timer.functor = std::move(functor);
+                timers_[timerId] = std::move(timer);
+                ResetTimerFd(); });
+    return timerId;
+}
+
+/*
+ * 取消周期任务，可在任意线程调用
+ * 任务队列按添加顺序执行，取消总是在对应的添加之后生效
+ *
+ */
+void EventLoop::CancelTimer(TimerId timerId)
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    if (0 == timerId)
+        return;
+    AddTask([this, timerId]()
+            {
+                if (timers_.erase(timerId))
+                    ResetTimerFd(); });
+}
+
+/*
+ * 添加续读任务到就绪列表
+ * 连接读取达到预算后不再继续读，边缘触发下socket内剩余的数据不会再产生事件，由就绪列表保证下一轮继续读取
+ *
+ */
+void EventLoop::QueueReady(Functor functor)
+{
+    readyList_.push_back(std::move(functor));
+}
+
+/*
+ * 执行上一轮加入就绪列表的续读任务
+ * 列表在本轮poll返回后即交换出来，本轮新事件与续读任务中再次达到预算的连接都排到下一轮，各连接每轮最多读取一次预算
+ *
+ */
+void EventLoop::ExecuteReady(std::vector<Functor> &readyList)
+{
+    for (Functor &functor : readyList)
+        functor();
+    readyList.clear();
+}
+
+/*
+ * 执行到期的周期任务并重新设置timerFd_
+ * 任务函数内可能取消自身或其他周期任务，因此先收集到期的id，执行前再次查找
+ * 任务函数执行期间移出timers_，取消自身不会析构正在执行的函数，执行后仍未取消则放回
+ *
+ */
+void EventLoop::HandleTimer()
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    uint64_t expirations = 0;
+    ssize_t n = read(timerFd_, &expirations, sizeof expirations);
+    (void)n;
+    int64_t now = NowMs();
+    std::vector<TimerId> expired;
+    for (std::map<TimerId, LoopTimer>::iterator iter = timers_.begin(); iter != timers_.end(); ++iter)
+    {
+        if (iter->second.expiration <= now)
+            expired.push_back(iter->first);
+    }
+    for (TimerId timerId : expired)
+    {
+        std::map<TimerId, LoopTimer>::iterator iter = timers_.find(timerId);
+        if (timers_.end() == iter)
+            continue;
+        iter->second.expiration = now + iter->second.interval;
+        Functor functor = std::move(iter->second.functor);
+        try
+        {
+            functor();
+        }
+        catch (std::bad_function_call)
+        {
+            LOG(LoggerLevel::ERROR, "%s\n", "执行一个周期任务报错：std::bad_function_call，函数调用失败");
+        }
+        iter = timers_.find(timerId);
+        if (timers_.end() != iter)
+            iter->second.functor = std::move(functor);
+    }
+    ResetTimerFd();
+}
+
+/*
+ * 按最早到期的周期任务设置timerFd_，无任务时停止
+ *
+ */
+void EventLoop::ResetTimerFd()
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (!timers_.empty())
+    {
+        int64_t earliest = timers_.begin()->second.expiration;
+        for (std::map<TimerId, LoopTimer>::iterator iter = timers_.begin(); iter != timers_.end(); ++iter)
+            earliest = std::min(earliest, iter->second.expiration);
+        // it_value全为0会停止定时器，已到期的任务至少等待1毫秒
+        int64_t delay = std::max<int64_t>(earliest - NowMs(), 1);
+        spec.it_value.tv_sec = delay / 1000;
+        spec.it_value.tv_nsec = (delay % 1000) * 1000000;
+    }
+    if (timerfd_settime(timerFd_, 0, &spec, nullptr) < 0)
+        LOG(LoggerLevel::ERROR, "%s\n", "设置定时器描述符失败");
+}
+
+/*
+ * steady_clock当前毫秒数
+ *
+ */
+int64_t EventLoop::NowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 /*
@@ -194,6 +410,7 @@ void EventLoop::ExecuteTask()
         std::lock_guard<std::mutex> lock(mutex_);
         functorlists.swap(functorList_);
     }
+    Metrics::Server().loopTasks->Record(functorlists.size());
     // 执行拷贝的所有任务
     LOG(LoggerLevel::INFO, "EventLoop即将执行所在线程的IO任务，任务数量：%d\n", functorlists.size());
     // std::cout << "EventLoop::ExecuteTask EventLoop即将执行所在线程的IO任务，任务数量：" << functorlists.size() << std::endl;
@@ -222,11 +439,13 @@ void EventLoop::ExecuteTask()
 void EventLoop::loop()
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
-    quit_ = false;
     LOG(LoggerLevel::INFO, "%s\n", "开始循环监听");
     while (!quit_)
     {
-        poller_.poll(activeChannelList_);
+        poller_->poll(activeChannelList_, readyList_.empty() ? ServerConfig::GetInstance()->PollTimeoutMs() : 0);
+        RequestTracer::MarkPoll();
+        std::vector<Functor> readyList;
+        readyList.swap(readyList_);
         for (Channel *pchannel : activeChannelList_)
         {
             LOG(LoggerLevel::INFO, "EventLoop处理一个请求事件, 连接sockfd：%d\n", pchannel->GetFd());
@@ -234,6 +453,10 @@ void EventLoop::loop()
             pchannel->HandleEvent();
         }
         activeChannelList_.clear();
+        if (!readyList.empty())
+        {
+            ExecuteReady(readyList);
+        }
         if (functorList_.size())
         {
             ExecuteTask();
@@ -1,6 +1,7 @@
 
 // EventLoopThread类：
 //  特殊任务线程
+//  线程启动时经CpuAffinity命名为io-N，并按配置绑定CPU，见CpuAffinity.hpp
 
 #pragma once
 
@@ -8,7 +9,10 @@
 #include <sstream>
 #include <string>
 #include <thread> 
+#include <mutex>
+#include <condition_variable>
 #include "EventLoop.hpp"
+#include "CpuAffinity.hpp"
 
 class EventLoopThread
 {
@@ -23,6 +27,8 @@ private:
     std::thread::id curThreadId_;   // 当前线程ID，使用时由子线程内部为其赋值
     std::string threadName_;        // 线程名，使用时由子线程内部为其补全赋值
     EventLoop *loop_;               // 事件池实例对象
+    std::mutex mutex_;              // 保护loop_的初始化
+    std::condition_variable cond_;  // 子线程创建事件池后通知构造函数
 
 };
 
@@ -32,9 +38,11 @@ EventLoopThread::EventLoopThread()
       threadName_(""),
       loop_(NULL)
 {
-    // 线程实体构造完成即在运行
+    // 线程实体构造完成即在运行，等待子线程创建事件池，避免GetLoop返回空指针
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     childThread_ = std::thread(&EventLoopThread::ThreadFunc, this);
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return loop_ != NULL; });
 }
 
 EventLoopThread::~EventLoopThread()
@@ -63,9 +71,15 @@ void EventLoopThread::ThreadFunc()
 {
     // 子线程内部
     LOG(LoggerLevel::INFO, "函数触发，回调函数可能位于子线程内，curThread: %d\n", curThreadId_);
+    // 先绑定CPU再创建事件池，事件池及之后本线程分配的内存位于所绑定的CPU所在的节点
+    CpuAffinity::GetInstance()->BindThread(CpuAffinity::IO);
     EventLoop loop;
-    loop_ = &loop;
     curThreadId_ = std::this_thread::get_id();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loop_ = &loop;
+    }
+    cond_.notify_one();
     std::stringstream sin;
     sin << curThreadId_;
     threadName_ += sin.str();
@@ -16,6 +16,7 @@ public:
     EventLoopThreadPool(EventLoop *mainloop, int threadnum = 0);
     ~EventLoopThreadPool();
     EventLoop* GetNextLoop();   // 轮询分发EventLoop指针
+    void Stop();                // 退出并回收所有事件池线程，之后GetNextLoop返回主事件池
 
 private:
     std::vector<EventLoopThread*> eventLoopThreadList_; // 任务线程实例列表
@@ -42,6 +43,16 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *mainloop, int threadNum)
 }
 
 EventLoopThreadPool::~EventLoopThreadPool()
+{
+    Stop();
+}
+
+/*
+ * 退出并回收所有事件池线程，可重复调用
+ * EventLoopThread析构时退出其loop并等待线程结束，返回后不再有事件池线程执行任务
+ *
+ */
+void EventLoopThreadPool::Stop()
 {
     // 删除每一个事件池线程实例
     for (int i = 0; i < threadNum_; ++i)
@@ -50,6 +61,8 @@ EventLoopThreadPool::~EventLoopThreadPool()
     }
     // 清空eventLoopThreadList_列表内所有已失效的子线程实例对象
     eventLoopThreadList_.clear();
+    threadNum_ = 0;
+    index_ = 0;
 }
 
 /*
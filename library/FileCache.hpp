@@ -0,0 +1,287 @@
+// FileCache类：
+//  静态资源文件缓存，单例模式
+//  以文件路径为键缓存文件元信息（inode、大小、修改时间）与原始内容，并按编码方式缓存预压缩内容
+//  每次获取缓存项时通过stat校验文件是否已变更，变更则重新生成缓存项
+//  缓存项仅保存元信息与校验器（ETag、Last-Modified），原始内容在首次需要发送时才读取，条件请求命中时无需打开文件
+//  预压缩内容首次被请求时构建一次，若存在比原文件新的".gz"兄弟文件则直接使用其内容作为gzip版本
+//  超过fileCacheMaxFileSize的文件不常驻缓存，读取时分块流式读取与压缩，超过compressMaxSize的文件协商时即不压缩
+//  缓存总量计入常驻的原始内容与全部预压缩内容，超过上限时按最近最少使用（LRU）淘汰
+//  单文件与总大小上限取自ServerConfig，热加载后对之后新建的缓存项生效，缓存总量在下次插入时按新上限淘汰
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <sys/stat.h>
+#include "LogServer.hpp"
+#include "HttpCompress.hpp"
+#include "TypeIdentify.hpp"
+#include "ServerConfig.hpp"
+
+#define FILE_READ_CHUNK 65536 // 读取文件的单次块大小
+
+// 缓存项，元信息与校验器构造后不再修改，原始内容与预压缩内容由mutex_保护
+class FileCacheEntry
+{
+public:
+    std::string path;         // 文件路径
+    std::string contentType;  // 文件类型
+    ino_t inode;              // 文件inode
+    off_t size;               // 文件大小
+    time_t mtime;             // 文件修改时间
+    bool cached;              // 原始内容是否常驻缓存
+    std::string etag;         // 由inode、大小、修改时间生成的强校验器，不含引号
+    std::string lastModified; // 修改时间的http日期格式
+    std::shared_ptr<const std::string> body;                          // 原始内容，cached为false或尚未读取时为空
+    std::mutex mutex_;                                                // 原始内容及预压缩内容锁
+    std::map<std::string, std::shared_ptr<const std::string>> encodedBody; // 编码方式->预压缩内容
+    bool resident;            // 是否仍在缓存表内，由FileCache的mutex_保护
+    size_t charged;           // 计入缓存总量的字节数，由FileCache的mutex_保护
+
+};
+
+class FileCache
+{
+public:
+    typedef std::shared_ptr<FileCacheEntry> spFileCacheEntry;
+    static FileCache *GetInstance();      // 获取FileCache单例指针
+    // 获取文件缓存项，仅stat文件不读取内容，文件不存在时返回nullptr
+    spFileCacheEntry Get(const std::string &filePath, const std::string &contentType);
+    static std::string FormatHttpDate(time_t t); // 格式化为http日期：Sun, 06 Nov 1994 08:49:37 GMT
+    // 获取指定编码方式的响应内容，encoding为空时返回原始内容，失败返回nullptr
+    std::shared_ptr<const std::string> GetBody(const spFileCacheEntry &entry, const std::string &encoding);
+
+private:
+    typedef std::list<spFileCacheEntry> LruList;
+    FileCache();
+    std::mutex mutex_;                           // 缓存表锁
+    size_t totalSize_;                           // 当前缓存的原始内容与预压缩内容总大小
+    LruList lru_;                                // 缓存项按最近使用排列，最近使用的在前
+    std::map<std::string, LruList::iterator> entries_; // 文件路径->缓存项在lru_中的位置
+    void Remove(std::map<std::string, LruList::iterator>::iterator iter); // 移除缓存项，调用者持有mutex_
+    void Evict(const spFileCacheEntry &keep, size_t incoming);            // 淘汰最久未使用的缓存项直至可再容纳incoming字节，调用者持有mutex_
+    void Charge(const spFileCacheEntry &entry, size_t bytes);             // 预压缩内容计入缓存总量
+    static bool ReadFile(const std::string &filePath, std::string &out);   // 读取完整文件内容
+    static bool ReadFileCompressed(const std::string &filePath, const std::string &encoding, std::string &out); // 分块读取并压缩文件
+    static bool LoadSiblingGzip(const spFileCacheEntry &entry, std::string &out); // 读取比原文件新的.gz兄弟文件
+
+};
+
+FileCache::FileCache()
+    : totalSize_(0)
+{
+}
+
+/*
+ * 获取FileCache单例指针
+ *
+ */
+FileCache *FileCache::GetInstance()
+{
+    static FileCache fileCache;
+    return &fileCache;
+}
+
+/*
+ * 获取文件缓存项
+ * 缓存项与文件的inode、大小、修改时间一致时直接返回，否则重新stat并生成缓存项
+ *
+ */
+FileCache::spFileCacheEntry FileCache::Get(const std::string &filePath, const std::string &contentType)
+{
+    struct stat st;
+    if (stat(filePath.c_str(), &st) < 0 || !S_ISREG(st.st_mode))
+    {
+        LOG(LoggerLevel::INFO, "未寻到资源文件：%s\n", filePath.c_str());
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, LruList::iterator>::iterator iter = entries_.find(filePath);
+        if (entries_.end() != iter)
+        {
+            const spFileCacheEntry &entry = *iter->second;
+            if (entry->inode == st.st_ino && entry->size == st.st_size && entry->mtime == st.st_mtime)
+            {
+                lru_.splice(lru_.begin(), lru_, iter->second);
+                return entry;
+            }
+            // 文件已变更，移除旧缓存项
+            Remove(iter);
+        }
+    }
+    spFileCacheEntry entry = std::make_shared<FileCacheEntry>();
+    entry->path = filePath;
+    entry->contentType = contentType;
+    entry->inode = st.st_ino;
+    entry->size = st.st_size;
+    entry->mtime = st.st_mtime;
+    entry->cached = (size_t)st.st_size <= ServerConfig::GetInstance()->FileCacheMaxFileSize();
+    entry->resident = true;
+    entry->charged = entry->cached ? st.st_size : 0;
+    char etag[64];
+    snprintf(etag, sizeof(etag), "%lx-%lx-%lx", (unsigned long)st.st_ino, (unsigned long)st.st_size, (unsigned long)st.st_mtime);
+    entry->etag = etag;
+    entry->lastModified = FormatHttpDate(st.st_mtime);
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 其他线程可能已为同一文件插入缓存项
+    std::map<std::string, LruList::iterator>::iterator iter = entries_.find(filePath);
+    if (entries_.end() != iter)
+        Remove(iter);
+    // 缓存总量超限时淘汰最久未使用的缓存项
+    Evict(nullptr, entry->charged);
+    totalSize_ += entry->charged;
+    lru_.push_front(entry);
+    entries_[filePath] = lru_.begin();
+    return entry;
+}
+
+/*
+ * 移除缓存项，正在发送的内容由调用方持有的智能指针保持有效
+ *
+ */
+void FileCache::Remove(std::map<std::string, LruList::iterator>::iterator iter)
+{
+    const spFileCacheEntry &entry = *iter->second;
+    entry->resident = false;
+    totalSize_ -= entry->charged;
+    lru_.erase(iter->second);
+    entries_.erase(iter);
+}
+
+/*
+ * 从lru_尾部淘汰最久未使用的缓存项，直至缓存总量加上incoming不超过上限，keep不被淘汰
+ *
+ */
+void FileCache::Evict(const spFileCacheEntry &keep, size_t incoming)
+{
+    size_t maxTotalSize = ServerConfig::GetInstance()->FileCacheMaxTotalSize();
+    while (!lru_.empty() && totalSize_ + incoming > maxTotalSize && lru_.back() != keep)
+        Remove(entries_.find(lru_.back()->path));
+}
+
+/*
+ * 预压缩内容计入缓存总量，超限时淘汰其他缓存项，已被移出缓存表的缓存项不再计入
+ *
+ */
+void FileCache::Charge(const spFileCacheEntry &entry, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!entry->resident)
+        return;
+    Evict(entry, bytes);
+    entry->charged += bytes;
+    totalSize_ += bytes;
+}
+
+/*
+ * 获取指定编码方式的响应内容
+ * 常驻缓存的文件首次请求某编码时构建预压缩内容并保存在原始内容旁，之后直接复用
+ * 不常驻缓存的大文件每次分块读取，压缩时边读边压缩
+ *
+ */
+std::shared_ptr<const std::string> FileCache::GetBody(const spFileCacheEntry &entry, const std::string &encoding)
+{
+    if (!entry->cached)
+    {
+        std::shared_ptr<std::string> body = std::make_shared<std::string>();
+        if (encoding.empty() ? !ReadFile(entry->path, *body) : !ReadFileCompressed(entry->path, encoding, *body))
+            return nullptr;
+        return body;
+    }
+    std::lock_guard<std::mutex> lock(entry->mutex_);
+    if (!entry->body)
+    {
+        // 首次发送时读取原始内容并常驻缓存
+        std::shared_ptr<std::string> body = std::make_shared<std::string>();
+        if (!ReadFile(entry->path, *body))
+            return nullptr;
+        entry->body = body;
+    }
+    if (encoding.empty())
+        return entry->body;
+    std::map<std::string, std::shared_ptr<const std::string>>::iterator iter = entry->encodedBody.find(encoding);
+    if (entry->encodedBody.end() != iter)
+        return iter->second;
+    std::shared_ptr<std::string> body = std::make_shared<std::string>();
+    if (!("gzip" == encoding && LoadSiblingGzip(entry, *body)))
+    {
+        body->clear();
+        if (!HttpCompress::Compress(encoding, entry->body->data(), entry->body->size(), *body))
+            return nullptr;
+    }
+    LOG(LoggerLevel::INFO, "构建预压缩内容：%s（%s），原始大小：%d，压缩后大小：%d\n",
+        entry->path.c_str(), encoding.c_str(), (int)entry->size, (int)body->size());
+    entry->encodedBody[encoding] = body;
+    Charge(entry, body->size());
+    return body;
+}
+
+/*
+ * 格式化为http日期（RFC 7231 IMF-fixdate）
+ *
+ */
+std::string FileCache::FormatHttpDate(time_t t)
+{
+    char buffer[64];
+    struct tm tmTime;
+    gmtime_r(&t, &tmTime);
+    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tmTime);
+    return buffer;
+}
+
+/*
+ * 读取完整文件内容
+ *
+ */
+bool FileCache::ReadFile(const std::string &filePath, std::string &out)
+{
+    std::ifstream file(filePath.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+    size_t length = file.tellg();
+    file.seekg(0, std::ios::beg);
+    out.resize(length);
+    if (length > 0)
+        file.read(&out[0], length);
+    return file.good() || file.eof();
+}
+
+/*
+ * 分块读取并压缩文件，不在内存中保留完整的原始内容
+ *
+ */
+bool FileCache::ReadFileCompressed(const std::string &filePath, const std::string &encoding, std::string &out)
+{
+    std::ifstream file(filePath.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return false;
+    CompressStream stream(encoding, out);
+    if (!stream.IsValid())
+        return false;
+    char buffer[FILE_READ_CHUNK];
+    while (file)
+    {
+        file.read(buffer, FILE_READ_CHUNK);
+        if (file.gcount() > 0 && !stream.Write(buffer, file.gcount()))
+            return false;
+    }
+    return stream.Finish();
+}
+
+/*
+ * 读取与原文件同目录的".gz"兄弟文件，仅当其修改时间不早于原文件时可用
+ *
+ */
+bool FileCache::LoadSiblingGzip(const spFileCacheEntry &entry, std::string &out)
+{
+    std::string gzPath = entry->path + ".gz";
+    struct stat st;
+    if (stat(gzPath.c_str(), &st) < 0 || !S_ISREG(st.st_mode) || st.st_mtime < entry->mtime)
+        return false;
+    return ReadFile(gzPath, out);
+}
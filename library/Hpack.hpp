@@ -0,0 +1,584 @@
+// Hpack类：
+//  HTTP/2头部压缩（RFC 7541）编解码
+//  HpackTable为静态表与动态表的统一索引视图，动态表按FIFO淘汰，每项大小为名称长度+值长度+32
+//  HpackDecoder维护与对端编码器同步的动态表，支持索引表示、三种字面量表示、动态表大小更新及Huffman解码
+//  HpackEncoder维护本端动态表，重复出现的响应头编码为索引，逐响应变化的头部编码为不索引字面量，字符串按较短者选择Huffman编码
+
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+typedef std::pair<std::string, std::string> HpackHeader; // 头部名称（小写）->值
+typedef std::vector<HpackHeader> HpackHeaderList;
+
+#define HPACK_DEFAULT_TABLE_SIZE 4096 // 动态表缺省大小上限（SETTINGS_HEADER_TABLE_SIZE初始值）
+#define HPACK_ENTRY_OVERHEAD 32       // 动态表每项的额外开销
+
+// Huffman编码表（RFC 7541 附录B），下标为字节值
+static const uint32_t HuffmanCodes[256] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+};
+static const uint8_t HuffmanCodeLen[256] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+};
+
+class HpackTable
+{
+public:
+    static const size_t StaticTableSize = 61;
+    HpackTable(size_t maxSize = HPACK_DEFAULT_TABLE_SIZE);
+    bool Get(size_t index, HpackHeader &header) const; // 按索引获取表项，索引从1开始，静态表在前
+    void Add(const std::string &name, const std::string &value); // 插入动态表头部，超限时淘汰最早的表项
+    void SetMaxSize(size_t maxSize);                   // 设置动态表大小上限并淘汰超出的表项
+    size_t GetMaxSize() const { return maxSize_; }
+    // 查找表项，名称与值均匹配时nameOnly为false，仅名称匹配时为true，未找到返回0
+    size_t Find(const std::string &name, const std::string &value, bool &nameOnly) const;
+
+private:
+    static const char *StaticTable[StaticTableSize][2]; // 静态表（RFC 7541 附录A）
+    std::deque<HpackHeader> dynamic_;                   // 动态表，头部为最新插入项
+    size_t size_;                                       // 动态表当前大小
+    size_t maxSize_;                                    // 动态表大小上限
+    void Evict(size_t maxSize);                         // 淘汰表项直至大小不超过maxSize
+
+};
+
+const char *HpackTable::StaticTable[HpackTable::StaticTableSize][2] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+HpackTable::HpackTable(size_t maxSize)
+    : size_(0),
+      maxSize_(maxSize)
+{
+}
+
+/*
+ * 按索引获取表项，1至61为静态表，62起为动态表（最新插入项在前）
+ *
+ */
+bool HpackTable::Get(size_t index, HpackHeader &header) const
+{
+    if (0 == index)
+        return false;
+    if (index <= StaticTableSize)
+    {
+        header.first = StaticTable[index - 1][0];
+        header.second = StaticTable[index - 1][1];
+        return true;
+    }
+    index -= StaticTableSize + 1;
+    if (index >= dynamic_.size())
+        return false;
+    header = dynamic_[index];
+    return true;
+}
+
+/*
+ * 插入动态表，表项大于上限时清空动态表且不插入（RFC 7541 4.4）
+ *
+ */
+void HpackTable::Add(const std::string &name, const std::string &value)
+{
+    size_t entrySize = name.size() + value.size() + HPACK_ENTRY_OVERHEAD;
+    if (entrySize > maxSize_)
+    {
+        Evict(0);
+        return;
+    }
+    Evict(maxSize_ - entrySize);
+    dynamic_.emplace_front(name, value);
+    size_ += entrySize;
+}
+
+/*
+ * 设置动态表大小上限并淘汰超出的表项
+ *
+ */
+void HpackTable::SetMaxSize(size_t maxSize)
+{
+    maxSize_ = maxSize;
+    Evict(maxSize_);
+}
+
+/*
+ * 淘汰最早插入的表项直至大小不超过maxSize
+ *
+ */
+void HpackTable::Evict(size_t maxSize)
+{
+    while (size_ > maxSize && !dynamic_.empty())
+    {
+        size_ -= dynamic_.back().first.size() + dynamic_.back().second.size() + HPACK_ENTRY_OVERHEAD;
+        dynamic_.pop_back();
+    }
+}
+
+/*
+ * 查找表项，完全匹配优先，其次为首个名称匹配项
+ *
+ */
+size_t HpackTable::Find(const std::string &name, const std::string &value, bool &nameOnly) const
+{
+    size_t nameIndex = 0;
+    for (size_t i = 0; i < StaticTableSize; ++i)
+    {
+        if (name == StaticTable[i][0])
+        {
+            if (value == StaticTable[i][1])
+            {
+                nameOnly = false;
+                return i + 1;
+            }
+            if (!nameIndex)
+                nameIndex = i + 1;
+        }
+    }
+    for (size_t i = 0; i < dynamic_.size(); ++i)
+    {
+        if (name == dynamic_[i].first)
+        {
+            if (value == dynamic_[i].second)
+            {
+                nameOnly = false;
+                return StaticTableSize + 1 + i;
+            }
+            if (!nameIndex)
+                nameIndex = StaticTableSize + 1 + i;
+        }
+    }
+    nameOnly = true;
+    return nameIndex;
+}
+
+class HpackDecoder
+{
+public:
+    HpackDecoder(size_t maxTableSize = HPACK_DEFAULT_TABLE_SIZE);
+    bool Decode(const std::string &block, HpackHeaderList &headers); // 解码完整的头部块，出错返回false（COMPRESSION_ERROR）
+
+private:
+    HpackTable table_;      // 与对端编码器同步的动态表
+    size_t maxAllowedSize_; // 本端通告的SETTINGS_HEADER_TABLE_SIZE，动态表大小更新不得超过此值
+    static bool DecodeInteger(const uint8_t *&pos, const uint8_t *end, int prefixBits, uint64_t &value);
+    static bool DecodeString(const uint8_t *&pos, const uint8_t *end, std::string &out);
+    static bool HuffmanDecode(const uint8_t *data, size_t length, std::string &out);
+
+};
+
+HpackDecoder::HpackDecoder(size_t maxTableSize)
+    : table_(maxTableSize),
+      maxAllowedSize_(maxTableSize)
+{
+}
+
+/*
+ * 解码完整的头部块
+ * 首字节前缀区分表示方式：1xxxxxxx索引，01xxxxxx增量索引字面量，001xxxxx动态表大小更新，
+ * 0000xxxx不索引字面量，0001xxxx永不索引字面量
+ *
+ */
+bool HpackDecoder::Decode(const std::string &block, HpackHeaderList &headers)
+{
+    const uint8_t *pos = (const uint8_t *)block.data();
+    const uint8_t *end = pos + block.size();
+    bool headerSeen = false;
+    while (pos < end)
+    {
+        uint8_t first = *pos;
+        uint64_t index;
+        HpackHeader header;
+        if (first & 0x80)
+        {
+            if (!DecodeInteger(pos, end, 7, index) || !table_.Get(index, header))
+                return false;
+            headers.push_back(std::move(header));
+            headerSeen = true;
+        }
+        else if (0x20 == (first & 0xe0))
+        {
+            // 动态表大小更新只能出现在头部块开头
+            if (headerSeen || !DecodeInteger(pos, end, 5, index) || index > maxAllowedSize_)
+                return false;
+            table_.SetMaxSize(index);
+        }
+        else
+        {
+            bool incremental = (0x40 == (first & 0xc0));
+            if (!DecodeInteger(pos, end, incremental ? 6 : 4, index))
+                return false;
+            if (index)
+            {
+                if (!table_.Get(index, header))
+                    return false;
+            }
+            else if (!DecodeString(pos, end, header.first))
+            {
+                return false;
+            }
+            if (!DecodeString(pos, end, header.second))
+                return false;
+            if (incremental)
+                table_.Add(header.first, header.second);
+            headers.push_back(std::move(header));
+            headerSeen = true;
+        }
+    }
+    return true;
+}
+
+/*
+ * 解码前缀整数（RFC 7541 5.1）
+ *
+ */
+bool HpackDecoder::DecodeInteger(const uint8_t *&pos, const uint8_t *end, int prefixBits, uint64_t &value)
+{
+    if (pos >= end)
+        return false;
+    uint64_t maxPrefix = (1u << prefixBits) - 1;
+    value = *pos++ & maxPrefix;
+    if (value < maxPrefix)
+        return true;
+    for (int shift = 0; pos < end && shift <= 28; shift += 7)
+    {
+        uint8_t byte = *pos++;
+        value += (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/*
+ * 解码字符串字面量，首字节最高位表示是否为Huffman编码
+ *
+ */
+bool HpackDecoder::DecodeString(const uint8_t *&pos, const uint8_t *end, std::string &out)
+{
+    if (pos >= end)
+        return false;
+    bool huffman = *pos & 0x80;
+    uint64_t length;
+    if (!DecodeInteger(pos, end, 7, length) || length > (uint64_t)(end - pos))
+        return false;
+    out.clear();
+    bool result = true;
+    if (huffman)
+        result = HuffmanDecode(pos, length, out);
+    else
+        out.assign((const char *)pos, length);
+    pos += length;
+    return result;
+}
+
+/*
+ * Huffman解码，首次调用时由编码表构建解码树
+ * 末尾填充须为不超过7位的EOS前缀（全1），否则视为解码错误
+ *
+ */
+bool HpackDecoder::HuffmanDecode(const uint8_t *data, size_t length, std::string &out)
+{
+    // 解码树节点，child为0表示无子节点，symbol为-1表示非叶子节点
+    struct Node
+    {
+        int child[2];
+        int symbol;
+    };
+    static const std::vector<Node> tree = []()
+    {
+        std::vector<Node> nodes(1, Node{{0, 0}, -1});
+        for (int symbol = 0; symbol < 256; ++symbol)
+        {
+            int current = 0;
+            for (int bit = HuffmanCodeLen[symbol] - 1; bit >= 0; --bit)
+            {
+                int branch = (HuffmanCodes[symbol] >> bit) & 1;
+                if (!nodes[current].child[branch])
+                {
+                    nodes[current].child[branch] = nodes.size();
+                    nodes.push_back(Node{{0, 0}, -1});
+                }
+                current = nodes[current].child[branch];
+            }
+            nodes[current].symbol = symbol;
+        }
+        return nodes;
+    }();
+    int current = 0, depth = 0;
+    bool allOnes = true;
+    for (size_t i = 0; i < length; ++i)
+    {
+        for (int bit = 7; bit >= 0; --bit)
+        {
+            int branch = (data[i] >> bit) & 1;
+            current = tree[current].child[branch];
+            if (!current)
+                return false;
+            ++depth;
+            allOnes = allOnes && branch;
+            if (tree[current].symbol >= 0)
+            {
+                out.push_back((char)tree[current].symbol);
+                current = 0;
+                depth = 0;
+                allOnes = true;
+            }
+        }
+    }
+    return depth < 8 && allOnes;
+}
+
+class HpackEncoder
+{
+public:
+    HpackEncoder(size_t maxTableSize = HPACK_DEFAULT_TABLE_SIZE);
+    void SetMaxTableSize(size_t maxTableSize);                       // 对端通告SETTINGS_HEADER_TABLE_SIZE时调用
+    void Encode(const HpackHeaderList &headers, std::string &out);   // 编码头部列表，结果追加到out
+
+private:
+    HpackTable table_;        // 本端动态表
+    bool sizeUpdatePending_;  // 下一个头部块开头是否需要发送动态表大小更新
+    size_t minPendingSize_;   // 两个头部块之间出现过的最小表大小，需先于最终大小发送
+    static bool NeverIndexed(const std::string &name);               // 逐响应变化或敏感的头部不进入动态表
+    static void EncodeInteger(uint64_t value, int prefixBits, uint8_t prefix, std::string &out);
+    static void EncodeString(const std::string &value, std::string &out);
+
+};
+
+HpackEncoder::HpackEncoder(size_t maxTableSize)
+    : table_(maxTableSize),
+      sizeUpdatePending_(false),
+      minPendingSize_(maxTableSize)
+{
+}
+
+/*
+ * 对端通告新的表大小上限，本端动态表最大使用HPACK_DEFAULT_TABLE_SIZE
+ *
+ */
+void HpackEncoder::SetMaxTableSize(size_t maxTableSize)
+{
+    if (maxTableSize > HPACK_DEFAULT_TABLE_SIZE)
+        maxTableSize = HPACK_DEFAULT_TABLE_SIZE;
+    if (maxTableSize == table_.GetMaxSize() && !sizeUpdatePending_)
+        return;
+    if (!sizeUpdatePending_ || maxTableSize < minPendingSize_)
+        minPendingSize_ = maxTableSize;
+    sizeUpdatePending_ = true;
+    table_.SetMaxSize(maxTableSize);
+}
+
+/*
+ * 编码头部列表
+ * 表内完全匹配的头部编码为索引，其余头部编码为增量索引字面量，NeverIndexed的头部编码为不索引字面量
+ *
+ */
+void HpackEncoder::Encode(const HpackHeaderList &headers, std::string &out)
+{
+    if (sizeUpdatePending_)
+    {
+        if (minPendingSize_ < table_.GetMaxSize())
+            EncodeInteger(minPendingSize_, 5, 0x20, out);
+        EncodeInteger(table_.GetMaxSize(), 5, 0x20, out);
+        sizeUpdatePending_ = false;
+    }
+    for (const HpackHeader &header : headers)
+    {
+        bool nameOnly = true;
+        size_t index = table_.Find(header.first, header.second, nameOnly);
+        if (index && !nameOnly)
+        {
+            EncodeInteger(index, 7, 0x80, out);
+            continue;
+        }
+        bool indexing = !NeverIndexed(header.first);
+        if (indexing)
+            EncodeInteger(index, 6, 0x40, out);
+        else
+            EncodeInteger(index, 4, 0x00, out);
+        if (!index)
+            EncodeString(header.first, out);
+        EncodeString(header.second, out);
+        if (indexing)
+            table_.Add(header.first, header.second);
+    }
+}
+
+/*
+ * 逐响应变化或敏感的头部，插入动态表只会挤出可复用的表项
+ *
+ */
+bool HpackEncoder::NeverIndexed(const std::string &name)
+{
+    return "content-length" == name || "etag" == name || "last-modified" == name || "date" == name ||
+           "content-range" == name || "set-cookie" == name || "location" == name;
+}
+
+/*
+ * 编码前缀整数（RFC 7541 5.1），prefix为首字节高位的表示方式标志
+ *
+ */
+void HpackEncoder::EncodeInteger(uint64_t value, int prefixBits, uint8_t prefix, std::string &out)
+{
+    uint64_t maxPrefix = (1u << prefixBits) - 1;
+    if (value < maxPrefix)
+    {
+        out.push_back((char)(prefix | value));
+        return;
+    }
+    out.push_back((char)(prefix | maxPrefix));
+    value -= maxPrefix;
+    while (value >= 0x80)
+    {
+        out.push_back((char)(0x80 | (value & 0x7f)));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+/*
+ * 编码字符串字面量，Huffman编码更短时使用Huffman编码
+ *
+ */
+void HpackEncoder::EncodeString(const std::string &value, std::string &out)
+{
+    size_t bits = 0;
+    for (unsigned char c : value)
+        bits += HuffmanCodeLen[c];
+    size_t huffmanLength = (bits + 7) / 8;
+    if (huffmanLength >= value.size())
+    {
+        EncodeInteger(value.size(), 7, 0x00, out);
+        out.append(value);
+        return;
+    }
+    EncodeInteger(huffmanLength, 7, 0x80, out);
+    uint64_t buffer = 0;
+    int pending = 0;
+    for (unsigned char c : value)
+    {
+        buffer = (buffer << HuffmanCodeLen[c]) | HuffmanCodes[c];
+        pending += HuffmanCodeLen[c];
+        while (pending >= 8)
+        {
+            pending -= 8;
+            out.push_back((char)(buffer >> pending));
+        }
+    }
+    if (pending > 0)
+    {
+        // 以EOS前缀（全1）填充末字节
+        out.push_back((char)((buffer << (8 - pending)) | (0xff >> pending)));
+    }
+}
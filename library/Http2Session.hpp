@@ -0,0 +1,969 @@
+// Http2Session类：
+//  明文HTTP/2（h2c，RFC 7540）连接会话，负责帧的解析与生成、流状态、SETTINGS协商与流量控制
+//  会话只处理协议本身，不直接读写套接字：输入为TcpConnection收到的字节，输出通过outputCallback_交给TcpConnection发送
+//  请求的头部块与DATA帧接收完整后通过requestCallback_交出，由TcpConnection映射为HttpRequestContext并按现有服务函数分发
+//  响应体按流与连接两级发送窗口切分为DATA帧，窗口耗尽时挂起，收到WINDOW_UPDATE或SETTINGS后继续发送
+//  文件响应体按DATA帧切分，帧头作为发送段的head，文件内容仍以sendfile从指定偏移发送
+//  接收方向跟踪本端通告的连接与流窗口，对端超出窗口时以FLOW_CONTROL_ERROR结束连接或流
+//  单个请求体超过上限时响应413并重置流，连接上尚未交出的请求体总量超过上限时以REFUSED_STREAM拒绝当前流，对端可重试
+//  窗口只按已消费的数据归还：存入受上述上限约束的请求体、或被丢弃的DATA与填充，累计达到窗口一半时发送WINDOW_UPDATE
+
+#pragma once
+
+#include <map>
+#include <deque>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <arpa/inet.h>
+#include "Hpack.hpp"
+#include "LogServer.hpp"
+
+#define HTTP2_DEFAULT_WINDOW_SIZE 65535   // 流与连接的初始窗口大小
+#define HTTP2_DEFAULT_FRAME_SIZE 16384    // SETTINGS_MAX_FRAME_SIZE初始值，也是本端接收的帧大小上限
+#define HTTP2_MAX_CONCURRENT_STREAMS 100  // 本端允许的最大并发流数
+#define HTTP2_MAX_HEADER_BLOCK 65536      // 单个请求头部块的大小上限
+#define HTTP2_MAX_WINDOW_SIZE 0x7fffffff  // 窗口大小上限
+#define HTTP2_MAX_REQUEST_BODY (1024 * 1024)     // 单个请求体的大小上限，超过时响应413
+#define HTTP2_MAX_BUFFERED_BODY (8 * 1024 * 1024) // 连接上尚未交出的请求体总量上限，超过时拒绝新数据所在的流
+
+// 响应体数据源，先发送data，再从文件的offset处发送length字节
+typedef struct _Http2DataSource
+{
+    std::string data;            // 内存中的响应数据
+    std::shared_ptr<int> fileFd; // 文件描述符，为空表示无文件部分
+    off_t offset;                // 文件发送偏移
+    size_t length;               // 剩余待发送的文件字节数
+} Http2DataSource;
+
+class Http2Session
+{
+public:
+    // 帧类型
+    enum FrameType
+    {
+        FRAME_DATA = 0x0,
+        FRAME_HEADERS = 0x1,
+        FRAME_PRIORITY = 0x2,
+        FRAME_RST_STREAM = 0x3,
+        FRAME_SETTINGS = 0x4,
+        FRAME_PUSH_PROMISE = 0x5,
+        FRAME_PING = 0x6,
+        FRAME_GOAWAY = 0x7,
+        FRAME_WINDOW_UPDATE = 0x8,
+        FRAME_CONTINUATION = 0x9
+    };
+    // 帧标志
+    enum FrameFlag
+    {
+        FLAG_END_STREAM = 0x1,
+        FLAG_ACK = 0x1,
+        FLAG_END_HEADERS = 0x4,
+        FLAG_PADDED = 0x8,
+        FLAG_PRIORITY = 0x20
+    };
+    // 错误码
+    enum ErrorCode
+    {
+        NO_ERROR = 0x0,
+        PROTOCOL_ERROR = 0x1,
+        INTERNAL_ERROR = 0x2,
+        FLOW_CONTROL_ERROR = 0x3,
+        STREAM_CLOSED = 0x5,
+        FRAME_SIZE_ERROR = 0x6,
+        REFUSED_STREAM = 0x7,
+        CANCEL = 0x8,
+        COMPRESSION_ERROR = 0x9
+    };
+    // 请求接收完整时回调：流id、解码后的头部列表（含伪头部）、请求体
+    typedef std::function<void(uint32_t streamId, HpackHeaderList &headers, std::string &body)> RequestCallback;
+    // 输出回调：先发送data，fileFd非空时再从文件offset处发送length字节
+    typedef std::function<void(std::string &data, const std::shared_ptr<int> &fileFd, off_t offset, size_t length)> OutputCallback;
+    static const std::string ConnectionPreface; // 客户端连接序言
+
+    Http2Session(const RequestCallback &requestCallback, const OutputCallback &outputCallback);
+    void Start();                                        // 发送本端SETTINGS，prior knowledge方式在收到序言前调用
+    bool StartUpgrade(const std::string &http2Settings); // HTTP/1.1升级方式：应用HTTP2-Settings并将升级请求作为流1
+    bool Feed(const char *data, size_t length);          // 输入收到的字节，连接级错误时发送GOAWAY并返回false
+    // 提交流的响应，status为状态码，headers名称须为小写，sources依次构成响应体
+    void SubmitResponse(uint32_t streamId, int status, const HpackHeaderList &headers, std::deque<Http2DataSource> &sources);
+    void GoAway(ErrorCode errorCode);                    // 发送GOAWAY，不再接受新的流
+    void CancelStream(uint32_t streamId);                // 服务端放弃尚未提交响应的流，发送RST_STREAM(INTERNAL_ERROR)
+
+private:
+    // 流状态，仅跟踪本端关心的部分：请求是否接收完整、响应是否发送完毕
+    typedef struct _Http2Stream
+    {
+        bool remoteClosed;                   // 对端已发送END_STREAM
+        bool localClosed;                    // 本端已发送END_STREAM
+        bool responding;                     // 已提交响应，pending内为待发送的响应体
+        bool endStreamOnHeaders;             // 正在接收的头部块所在HEADERS帧带有END_STREAM
+        bool trailers;                       // 正在接收的头部块为尾部头部
+        bool refused;                        // 超出并发限制已被拒绝，头部块仅解码不分发
+        int64_t sendWindow;                  // 流的发送窗口
+        int64_t recvWindow;                  // 本端为流通告的剩余接收窗口
+        HpackHeaderList headers;             // 请求头部
+        std::string body;                    // 请求体
+        std::deque<Http2DataSource> pending; // 待发送的响应体
+    } Http2Stream;
+
+    RequestCallback requestCallback_; // 请求接收完整回调
+    OutputCallback outputCallback_;   // 输出回调
+    HpackDecoder decoder_;            // 请求头部解码器
+    HpackEncoder encoder_;            // 响应头部编码器
+    std::map<uint32_t, Http2Stream> streams_; // 流id->流状态
+    std::string inBuffer_;            // 未处理完的输入字节
+    std::string outBuffer_;           // 待交给outputCallback_的帧
+    std::string headerBlock_;         // 正在接收的头部块
+    bool prefaceReceived_;            // 是否已收到客户端连接序言
+    bool goAwaySent_;                 // 是否已发送GOAWAY
+    uint32_t continuationStream_;     // 等待CONTINUATION帧的流，0表示无
+    uint32_t lastStreamId_;           // 已接受的最大客户端流id
+    int64_t connSendWindow_;          // 连接的发送窗口
+    int64_t connRecvWindow_;          // 本端为连接通告的剩余接收窗口
+    size_t bufferedBody_;             // 已接收但尚未交出的请求体总量
+    uint32_t peerInitialWindow_;      // 对端SETTINGS_INITIAL_WINDOW_SIZE
+    uint32_t peerMaxFrameSize_;       // 对端SETTINGS_MAX_FRAME_SIZE
+
+    bool ProcessFrame(uint8_t type, uint8_t flags, uint32_t streamId, const char *payload, uint32_t length);
+    bool ProcessData(uint8_t flags, uint32_t streamId, const char *payload, uint32_t length);
+    bool ProcessHeaders(uint8_t flags, uint32_t streamId, const char *payload, uint32_t length);
+    bool ProcessSettings(uint8_t flags, uint32_t streamId, const char *payload, uint32_t length);
+    bool ProcessWindowUpdate(uint32_t streamId, const char *payload, uint32_t length);
+    bool ApplySetting(uint16_t id, uint32_t value);
+    bool EndHeaderBlock(uint32_t streamId);           // 头部块接收完整，解码并在请求完整时分发
+    void FinishRequest(uint32_t streamId, Http2Stream &stream);
+    void SendData();                                  // 按窗口发送各流待发送的响应体
+    void CloseStreamIfDone(uint32_t streamId);        // 双向均已关闭时移除流
+    void ResetStream(uint32_t streamId, ErrorCode errorCode);
+    void WriteFrameHeader(std::string &out, uint32_t length, uint8_t type, uint8_t flags, uint32_t streamId);
+    void WriteWindowUpdate(uint32_t streamId, uint32_t increment);
+    void UpdateConnRecvWindow();                      // 归还连接接收窗口
+    void UpdateStreamRecvWindow(uint32_t streamId, Http2Stream &stream); // 归还流接收窗口
+    void RejectStream(uint32_t streamId, int status); // 请求未接收完整即响应错误状态码并重置流
+    void Flush();                                     // 将outBuffer_交给outputCallback_
+    static uint32_t ReadUint32(const char *p);
+    static bool Base64UrlDecode(const std::string &in, std::string &out);
+
+};
+
+const std::string Http2Session::ConnectionPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+Http2Session::Http2Session(const RequestCallback &requestCallback, const OutputCallback &outputCallback)
+    : requestCallback_(requestCallback),
+      outputCallback_(outputCallback),
+      prefaceReceived_(false),
+      goAwaySent_(false),
+      continuationStream_(0),
+      lastStreamId_(0),
+      connSendWindow_(HTTP2_DEFAULT_WINDOW_SIZE),
+      connRecvWindow_(HTTP2_DEFAULT_WINDOW_SIZE),
+      bufferedBody_(0),
+      peerInitialWindow_(HTTP2_DEFAULT_WINDOW_SIZE),
+      peerMaxFrameSize_(HTTP2_DEFAULT_FRAME_SIZE)
+{
+}
+
+/*
+ * 发送本端SETTINGS：最大并发流数
+ * 其余设置使用协议缺省值，连接与流的接收窗口均为HTTP2_DEFAULT_WINDOW_SIZE
+ *
+ */
+void Http2Session::Start()
+{
+    LOG(LoggerLevel::INFO, "%s\n", "HTTP/2会话开始，发送SETTINGS");
+    WriteFrameHeader(outBuffer_, 6, FRAME_SETTINGS, 0, 0);
+    outBuffer_.push_back(0);
+    outBuffer_.push_back(0x3); // SETTINGS_MAX_CONCURRENT_STREAMS
+    uint32_t value = htonl(HTTP2_MAX_CONCURRENT_STREAMS);
+    outBuffer_.append((const char *)&value, 4);
+    Flush();
+}
+
+/*
+ * HTTP/1.1升级方式：应用HTTP2-Settings（base64url编码的SETTINGS帧负载）
+ * 升级请求视为流1，其请求已完整接收（半关闭），由调用者直接分发
+ *
+ */
+bool Http2Session::StartUpgrade(const std::string &http2Settings)
+{
+    std::string payload;
+    if (!Base64UrlDecode(http2Settings, payload) || payload.size() % 6)
+        return false;
+    for (size_t i = 0; i < payload.size(); i += 6)
+    {
+        uint16_t id = ((uint8_t)payload[i] << 8) | (uint8_t)payload[i + 1];
+        if (!ApplySetting(id, ReadUint32(payload.data() + i + 2)))
+            return false;
+    }
+    Start();
+    Http2Stream &stream = streams_[1];
+    stream.remoteClosed = true;
+    stream.localClosed = false;
+    stream.responding = false;
+    stream.endStreamOnHeaders = false;
+    stream.trailers = false;
+    stream.refused = false;
+    stream.sendWindow = peerInitialWindow_;
+    stream.recvWindow = HTTP2_DEFAULT_WINDOW_SIZE;
+    lastStreamId_ = 1;
+    return true;
+}
+
+/*
+ * 输入收到的字节，逐帧处理
+ * 不完整的序言或帧保留在inBuffer_内等待后续数据
+ *
+ */
+bool Http2Session::Feed(const char *data, size_t length)
+{
+    inBuffer_.append(data, length);
+    size_t pos = 0;
+    bool result = true;
+    if (!prefaceReceived_)
+    {
+        size_t compareLength = std::min(inBuffer_.size(), ConnectionPreface.size());
+        if (0 != inBuffer_.compare(0, compareLength, ConnectionPreface, 0, compareLength))
+        {
+            LOG(LoggerLevel::ERROR, "%s\n", "HTTP/2连接序言错误");
+            GoAway(PROTOCOL_ERROR);
+            return false;
+        }
+        if (inBuffer_.size() < ConnectionPreface.size())
+            return true;
+        prefaceReceived_ = true;
+        pos = ConnectionPreface.size();
+    }
+    while (result && inBuffer_.size() - pos >= 9)
+    {
+        const uint8_t *header = (const uint8_t *)inBuffer_.data() + pos;
+        uint32_t length = (header[0] << 16) | (header[1] << 8) | header[2];
+        uint8_t type = header[3], flags = header[4];
+        uint32_t streamId = ReadUint32((const char *)header + 5) & 0x7fffffff;
+        if (length > HTTP2_DEFAULT_FRAME_SIZE)
+        {
+            LOG(LoggerLevel::ERROR, "HTTP/2帧过大：%d\n", (int)length);
+            GoAway(FRAME_SIZE_ERROR);
+            result = false;
+            break;
+        }
+        if (inBuffer_.size() - pos - 9 < length)
+            break;
+        result = ProcessFrame(type, flags, streamId, inBuffer_.data() + pos + 9, length);
+        pos += 9 + length;
+    }
+    inBuffer_.erase(0, pos);
+    SendData();
+    Flush();
+    return result;
+}
+
+/*
+ * 处理单个帧，返回false表示连接级错误，已发送GOAWAY
+ *
+ */
+bool Http2Session::ProcessFrame(uint8_t type, uint8_t flags, uint32_t streamId, const char *payload, uint32_t length)
+{
+    // 头部块必须连续，期间只能出现同一流的CONTINUATION帧
+    if (continuationStream_ && (FRAME_CONTINUATION != type || streamId != continuationStream_))
+    {
+        GoAway(PROTOCOL_ERROR);
+        return false;
+    }
+    switch (type)
+    {
+    case FRAME_DATA:
+        return ProcessData(flags, streamId, payload, length);
+    case FRAME_HEADERS:
+        return ProcessHeaders(flags, streamId, payload, length);
+    case FRAME_PRIORITY:
+        if (0 == streamId || 5 != length)
+        {
+            GoAway(0 == streamId ? PROTOCOL_ERROR : FRAME_SIZE_ERROR);
+            return false;
+        }
+        return true;
+    case FRAME_RST_STREAM:
+        if (0 == streamId || 4 != length || streamId > lastStreamId_)
+        {
+            GoAway(4 != length ? FRAME_SIZE_ERROR : PROTOCOL_ERROR);
+            return false;
+        }
+        // 流被对端取消，正在处理中的响应提交时会被丢弃
+        {
+            std::map<uint32_t, Http2Stream>::iterator iter = streams_.find(streamId);
+            if (streams_.end() != iter)
+            {
+                bufferedBody_ -= iter->second.body.size();
+                streams_.erase(iter);
+                UpdateConnRecvWindow();
+            }
+        }
+        return true;
+    case FRAME_SETTINGS:
+        return ProcessSettings(flags, streamId, payload, length);
+    case FRAME_PING:
+        if (0 != streamId || 8 != length)
+        {
+            GoAway(0 != streamId ? PROTOCOL_ERROR : FRAME_SIZE_ERROR);
+            return false;
+        }
+        if (!(flags & FLAG_ACK))
+        {
+            WriteFrameHeader(outBuffer_, 8, FRAME_PING, FLAG_ACK, 0);
+            outBuffer_.append(payload, 8);
+        }
+        return true;
+    case FRAME_GOAWAY:
+        LOG(LoggerLevel::INFO, "%s\n", "收到HTTP/2 GOAWAY");
+        return true;
+    case FRAME_WINDOW_UPDATE:
+        return ProcessWindowUpdate(streamId, payload, length);
+    case FRAME_CONTINUATION:
+        if (!continuationStream_)
+        {
+            GoAway(PROTOCOL_ERROR);
+            return false;
+        }
+        headerBlock_.append(payload, length);
+        if (headerBlock_.size() > HTTP2_MAX_HEADER_BLOCK)
+        {
+            GoAway(PROTOCOL_ERROR);
+            return false;
+        }
+        if (flags & FLAG_END_HEADERS)
+        {
+            continuationStream_ = 0;
+            return EndHeaderBlock(streamId);
+        }
+        return true;
+    case FRAME_PUSH_PROMISE:
+        // 客户端不能推送
+        GoAway(PROTOCOL_ERROR);
+        return false;
+    default:
+        // 忽略未知类型的帧
+        return true;
+    }
+}
+
+/*
+ * 处理DATA帧：检查接收窗口，追加请求体并按消费情况归还窗口
+ * 帧长度（含填充）计入连接与流的窗口；超出连接窗口为连接错误，超出流窗口为流错误
+ *
+ */
+bool Http2Session::ProcessData(uint8_t flags, uint32_t streamId, const char *payload, uint32_t length)
+{
+    if (0 == streamId)
+    {
+        GoAway(PROTOCOL_ERROR);
+        return false;
+    }
+    uint32_t padding = 0;
+    if (flags & FLAG_PADDED)
+    {
+        if (0 == length || (uint8_t)payload[0] >= length)
+        {
+            GoAway(PROTOCOL_ERROR);
+            return false;
+        }
+        padding = (uint8_t)payload[0] + 1;
+    }
+    if (length > connRecvWindow_)
+    {
+        LOG(LoggerLevel::ERROR, "HTTP/2 DATA帧超出连接接收窗口，流：%d\n", (int)streamId);
+        GoAway(FLOW_CONTROL_ERROR);
+        return false;
+    }
+    connRecvWindow_ -= length;
+    std::map<uint32_t, Http2Stream>::iterator iter = streams_.find(streamId);
+    if (streams_.end() == iter || iter->second.remoteClosed)
+    {
+        if (streamId > lastStreamId_)
+        {
+            GoAway(PROTOCOL_ERROR);
+            return false;
+        }
+        // 丢弃的数据视为已消费，归还连接窗口，否则对端其他流会因连接窗口耗尽而停滞
+        ResetStream(streamId, STREAM_CLOSED);
+        UpdateConnRecvWindow();
+        return true;
+    }
+    Http2Stream &stream = iter->second;
+    if (length > stream.recvWindow)
+    {
+        LOG(LoggerLevel::ERROR, "HTTP/2 DATA帧超出流接收窗口，流：%d\n", (int)streamId);
+        bufferedBody_ -= stream.body.size();
+        streams_.erase(iter);
+        ResetStream(streamId, FLOW_CONTROL_ERROR);
+        UpdateConnRecvWindow();
+        return true;
+    }
+    stream.recvWindow -= length;
+    size_t dataLength = length - padding;
+    if (stream.body.size() + dataLength > HTTP2_MAX_REQUEST_BODY)
+    {
+        LOG(LoggerLevel::ERROR, "HTTP/2请求体超过上限，流：%d\n", (int)streamId);
+        bufferedBody_ -= stream.body.size();
+        RejectStream(streamId, 413);
+        UpdateConnRecvWindow();
+        return true;
+    }
+    if (bufferedBody_ + dataLength > HTTP2_MAX_BUFFERED_BODY)
+    {
+        LOG(LoggerLevel::ERROR, "HTTP/2连接上未交出的请求体过多，拒绝流：%d\n", (int)streamId);
+        bufferedBody_ -= stream.body.size();
+        streams_.erase(iter);
+        ResetStream(streamId, REFUSED_STREAM);
+        UpdateConnRecvWindow();
+        return true;
+    }
+    stream.body.append(payload + (padding ? 1 : 0), dataLength);
+    bufferedBody_ += dataLength;
+    if (flags & FLAG_END_STREAM)
+        FinishRequest(streamId, stream);
+    else
+        UpdateStreamRecvWindow(streamId, stream);
+    UpdateConnRecvWindow();
+    return true;
+}
+
+/*
+ * 处理HEADERS帧：新建流或接收尾部头部，头部块未结束时等待CONTINUATION帧
+ *
+ */
+bool Http2Session::ProcessHeaders(uint8_t flags, uint32_t streamId, const char *payload, uint32_t length)
+{
+    if (0 == streamId || 0 == (streamId & 1))
+    {
+        GoAway(PROTOCOL_ERROR);
+        return false;
+    }
+    uint32_t begin = 0, padding = 0;
+    if (flags & FLAG_PADDED)
+    {
+        if (0 == length)
+        {
+            GoAway(PROTOCOL_ERROR);
+            return false;
+        }
+        padding = (uint8_t)payload[0];
+        begin = 1;
+    }
+    if (flags & FLAG_PRIORITY)
+        begin += 5;
+    if (begin + padding > length)
+    {
+        GoAway(PROTOCOL_ERROR);
+        return false;
+    }
+    std::map<uint32_t, Http2Stream>::iterator iter = streams_.find(streamId);
+    if (streams_.end() != iter)
+    {
+        // 已存在的流上的HEADERS为尾部头部，必须结束请求
+        if (iter->second.remoteClosed || !(flags & FLAG_END_STREAM))
+        {
+            GoAway(PROTOCOL_ERROR);
+            return false;
+        }
+        iter->second.trailers = true;
+    }
+    else
+    {
+        if (streamId <= lastStreamId_)
+        {
+            GoAway(PROTOCOL_ERROR);
+            return false;
+        }
+        lastStreamId_ = streamId;
+        size_t openStreams = 0;
+        for (const std::pair<const uint32_t, Http2Stream> &item : streams_)
+        {
+            if (!item.second.refused)
+                ++openStreams;
+        }
+        Http2Stream &stream = streams_[streamId];
+        stream.remoteClosed = false;
+        stream.localClosed = false;
+        stream.responding = false;
+        stream.trailers = false;
+        stream.refused = goAwaySent_ || openStreams >= HTTP2_MAX_CONCURRENT_STREAMS;
+        stream.sendWindow = peerInitialWindow_;
+        stream.recvWindow = HTTP2_DEFAULT_WINDOW_SIZE;
+        iter = streams_.find(streamId);
+    }
+    iter->second.endStreamOnHeaders = flags & FLAG_END_STREAM;
+    headerBlock_.assign(payload + begin, length - begin - padding);
+    if (flags & FLAG_END_HEADERS)
+        return EndHeaderBlock(streamId);
+    continuationStream_ = streamId;
+    return true;
+}
+
+/*
+ * 头部块接收完整：解码（即使流已被拒绝也必须解码以保持动态表同步），请求完整时分发
+ *
+ */
+bool Http2Session::EndHeaderBlock(uint32_t streamId)
+{
+    HpackHeaderList headers;
+    bool decoded = decoder_.Decode(headerBlock_, headers);
+    headerBlock_.clear();
+    if (!decoded)
+    {
+        LOG(LoggerLevel::ERROR, "HTTP/2头部块解码失败，流：%d\n", (int)streamId);
+        GoAway(COMPRESSION_ERROR);
+        return false;
+    }
+    std::map<uint32_t, Http2Stream>::iterator iter = streams_.find(streamId);
+    if (streams_.end() == iter)
+        return true;
+    Http2Stream &stream = iter->second;
+    if (stream.refused)
+    {
+        streams_.erase(iter);
+        ResetStream(streamId, REFUSED_STREAM);
+        return true;
+    }
+    if (stream.trailers)
+    {
+        // 尾部头部不参与分发，仅结束请求
+        FinishRequest(streamId, stream);
+        return true;
+    }
+    stream.headers.swap(headers);
+    bool hasMethod = false, hasPath = false;
+    for (const HpackHeader &header : stream.headers)
+    {
+        hasMethod = hasMethod || ":method" == header.first;
+        hasPath = hasPath || ":path" == header.first;
+    }
+    if (!hasMethod || !hasPath)
+    {
+        streams_.erase(iter);
+        ResetStream(streamId, PROTOCOL_ERROR);
+        return true;
+    }
+    if (stream.endStreamOnHeaders)
+        FinishRequest(streamId, stream);
+    return true;
+}
+
+/*
+ * 请求接收完整，交给requestCallback_，请求体随之从未交出的总量中扣除
+ *
+ */
+void Http2Session::FinishRequest(uint32_t streamId, Http2Stream &stream)
+{
+    stream.remoteClosed = true;
+    bufferedBody_ -= stream.body.size();
+    LOG(LoggerLevel::INFO, "HTTP/2请求接收完整，流：%d\n", (int)streamId);
+    requestCallback_(streamId, stream.headers, stream.body);
+    stream.headers.clear();
+    stream.body.clear();
+}
+
+/*
+ * 处理SETTINGS帧，非ACK的SETTINGS应用后回复ACK
+ *
+ */
+bool Http2Session::ProcessSettings(uint8_t flags, uint32_t streamId, const char *payload, uint32_t length)
+{
+    if (0 != streamId)
+    {
+        GoAway(PROTOCOL_ERROR);
+        return false;
+    }
+    if (flags & FLAG_ACK)
+    {
+        if (0 != length)
+        {
+            GoAway(FRAME_SIZE_ERROR);
+            return false;
+        }
+        return true;
+    }
+    if (length % 6)
+    {
+        GoAway(FRAME_SIZE_ERROR);
+        return false;
+    }
+    for (uint32_t i = 0; i < length; i += 6)
+    {
+        uint16_t id = ((uint8_t)payload[i] << 8) | (uint8_t)payload[i + 1];
+        if (!ApplySetting(id, ReadUint32(payload + i + 2)))
+            return false;
+    }
+    WriteFrameHeader(outBuffer_, 0, FRAME_SETTINGS, FLAG_ACK, 0);
+    return true;
+}
+
+/*
+ * 应用对端的单项设置，INITIAL_WINDOW_SIZE的变化量作用于所有已存在的流
+ *
+ */
+bool Http2Session::ApplySetting(uint16_t id, uint32_t value)
+{
+    switch (id)
+    {
+    case 0x1: // SETTINGS_HEADER_TABLE_SIZE
+        encoder_.SetMaxTableSize(value);
+        break;
+    case 0x2: // SETTINGS_ENABLE_PUSH
+        if (value > 1)
+        {
+            GoAway(PROTOCOL_ERROR);
+            return false;
+        }
+        break;
+    case 0x4: // SETTINGS_INITIAL_WINDOW_SIZE
+        if (value > HTTP2_MAX_WINDOW_SIZE)
+        {
+            GoAway(FLOW_CONTROL_ERROR);
+            return false;
+        }
+        for (std::pair<const uint32_t, Http2Stream> &item : streams_)
+            item.second.sendWindow += (int64_t)value - peerInitialWindow_;
+        peerInitialWindow_ = value;
+        break;
+    case 0x5: // SETTINGS_MAX_FRAME_SIZE
+        if (value < HTTP2_DEFAULT_FRAME_SIZE || value > 0xffffff)
+        {
+            GoAway(PROTOCOL_ERROR);
+            return false;
+        }
+        peerMaxFrameSize_ = value;
+        break;
+    default:
+        // SETTINGS_MAX_CONCURRENT_STREAMS、SETTINGS_MAX_HEADER_LIST_SIZE及未知设置无需处理
+        break;
+    }
+    return true;
+}
+
+/*
+ * 处理WINDOW_UPDATE帧，增大连接或流的发送窗口
+ *
+ */
+bool Http2Session::ProcessWindowUpdate(uint32_t streamId, const char *payload, uint32_t length)
+{
+    if (4 != length)
+    {
+        GoAway(FRAME_SIZE_ERROR);
+        return false;
+    }
+    uint32_t increment = ReadUint32(payload) & 0x7fffffff;
+    if (0 == streamId)
+    {
+        if (0 == increment || connSendWindow_ + increment > HTTP2_MAX_WINDOW_SIZE)
+        {
+            GoAway(0 == increment ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR);
+            return false;
+        }
+        connSendWindow_ += increment;
+        return true;
+    }
+    std::map<uint32_t, Http2Stream>::iterator iter = streams_.find(streamId);
+    if (streams_.end() == iter)
+        return true;
+    if (0 == increment || iter->second.sendWindow + increment > HTTP2_MAX_WINDOW_SIZE)
+    {
+        bufferedBody_ -= iter->second.body.size();
+        streams_.erase(iter);
+        ResetStream(streamId, 0 == increment ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR);
+        return true;
+    }
+    iter->second.sendWindow += increment;
+    return true;
+}
+
+/*
+ * 提交流的响应：HEADERS帧（超出帧大小上限时拆分为CONTINUATION）及按窗口发送的DATA帧
+ * 流已被对端重置时丢弃响应
+ *
+ */
+void Http2Session::SubmitResponse(uint32_t streamId, int status, const HpackHeaderList &headers, std::deque<Http2DataSource> &sources)
+{
+    std::map<uint32_t, Http2Stream>::iterator iter = streams_.find(streamId);
+    if (streams_.end() == iter || iter->second.responding)
+    {
+        LOG(LoggerLevel::INFO, "HTTP/2流已关闭，丢弃响应，流：%d\n", (int)streamId);
+        return;
+    }
+    Http2Stream &stream = iter->second;
+    stream.responding = true;
+    for (Http2DataSource &source : sources)
+    {
+        if (!source.data.empty() || source.length > 0)
+            stream.pending.push_back(std::move(source));
+    }
+    HpackHeaderList responseHeaders;
+    responseHeaders.reserve(headers.size() + 1);
+    responseHeaders.emplace_back(":status", std::to_string(status));
+    responseHeaders.insert(responseHeaders.end(), headers.begin(), headers.end());
+    std::string block;
+    encoder_.Encode(responseHeaders, block);
+    size_t pos = 0;
+    do
+    {
+        size_t chunk = std::min(block.size() - pos, (size_t)peerMaxFrameSize_);
+        uint8_t flags = (pos + chunk == block.size()) ? FLAG_END_HEADERS : 0;
+        if (0 == pos && stream.pending.empty())
+            flags |= FLAG_END_STREAM;
+        WriteFrameHeader(outBuffer_, chunk, 0 == pos ? FRAME_HEADERS : FRAME_CONTINUATION, flags, streamId);
+        outBuffer_.append(block, pos, chunk);
+        pos += chunk;
+    } while (pos < block.size());
+    if (stream.pending.empty())
+    {
+        stream.localClosed = true;
+        CloseStreamIfDone(streamId);
+    }
+    SendData();
+    Flush();
+}
+
+/*
+ * 服务端放弃尚未提交响应的流，例如服务函数出错关闭了流连接
+ * 已提交响应或已被对端重置的流不处理
+ *
+ */
+void Http2Session::CancelStream(uint32_t streamId)
+{
+    std::map<uint32_t, Http2Stream>::iterator iter = streams_.find(streamId);
+    if (streams_.end() == iter || iter->second.responding)
+        return;
+    bufferedBody_ -= iter->second.body.size();
+    streams_.erase(iter);
+    ResetStream(streamId, INTERNAL_ERROR);
+    Flush();
+}
+
+/*
+ * 按窗口发送各流待发送的响应体，各流轮流发送一帧以免单个大响应独占连接
+ *
+ */
+void Http2Session::SendData()
+{
+    bool progress = true;
+    while (progress && connSendWindow_ > 0)
+    {
+        progress = false;
+        for (std::map<uint32_t, Http2Stream>::iterator iter = streams_.begin(); iter != streams_.end() && connSendWindow_ > 0;)
+        {
+            Http2Stream &stream = iter->second;
+            uint32_t streamId = iter->first;
+            ++iter;
+            if (!stream.responding || stream.pending.empty() || stream.sendWindow <= 0)
+                continue;
+            Http2DataSource &source = stream.pending.front();
+            size_t limit = std::min((int64_t)peerMaxFrameSize_, std::min(stream.sendWindow, connSendWindow_));
+            size_t chunk;
+            bool fromFile = source.data.empty();
+            if (!fromFile)
+                chunk = std::min(limit, source.data.size());
+            else
+                chunk = std::min(limit, source.length);
+            bool last = (stream.pending.size() == 1) && (fromFile ? chunk == source.length : (chunk == source.data.size() && 0 == source.length));
+            WriteFrameHeader(outBuffer_, chunk, FRAME_DATA, last ? FLAG_END_STREAM : 0, streamId);
+            if (!fromFile)
+            {
+                outBuffer_.append(source.data, 0, chunk);
+                source.data.erase(0, chunk);
+            }
+            else
+            {
+                // 文件内容作为帧负载直接以sendfile发送
+                outputCallback_(outBuffer_, source.fileFd, source.offset, chunk);
+                outBuffer_.clear();
+                source.offset += chunk;
+                source.length -= chunk;
+            }
+            stream.sendWindow -= chunk;
+            connSendWindow_ -= chunk;
+            if (source.data.empty() && 0 == source.length)
+                stream.pending.pop_front();
+            progress = true;
+            if (last)
+            {
+                stream.localClosed = true;
+                CloseStreamIfDone(streamId);
+            }
+        }
+    }
+}
+
+/*
+ * 双向均已关闭时移除流
+ *
+ */
+void Http2Session::CloseStreamIfDone(uint32_t streamId)
+{
+    std::map<uint32_t, Http2Stream>::iterator iter = streams_.find(streamId);
+    if (streams_.end() != iter && iter->second.remoteClosed && iter->second.localClosed)
+        streams_.erase(iter);
+}
+
+/*
+ * 发送RST_STREAM
+ *
+ */
+void Http2Session::ResetStream(uint32_t streamId, ErrorCode errorCode)
+{
+    LOG(LoggerLevel::INFO, "重置HTTP/2流：%d，错误码：%d\n", (int)streamId, (int)errorCode);
+    WriteFrameHeader(outBuffer_, 4, FRAME_RST_STREAM, 0, streamId);
+    uint32_t value = htonl(errorCode);
+    outBuffer_.append((const char *)&value, 4);
+}
+
+/*
+ * 发送GOAWAY，携带已接受的最大流id
+ *
+ */
+void Http2Session::GoAway(ErrorCode errorCode)
+{
+    if (goAwaySent_)
+        return;
+    goAwaySent_ = true;
+    LOG(LoggerLevel::INFO, "发送HTTP/2 GOAWAY，错误码：%d\n", (int)errorCode);
+    WriteFrameHeader(outBuffer_, 8, FRAME_GOAWAY, 0, 0);
+    uint32_t value = htonl(lastStreamId_);
+    outBuffer_.append((const char *)&value, 4);
+    value = htonl(errorCode);
+    outBuffer_.append((const char *)&value, 4);
+    Flush();
+}
+
+/*
+ * 写入9字节帧头
+ *
+ */
+void Http2Session::WriteFrameHeader(std::string &out, uint32_t length, uint8_t type, uint8_t flags, uint32_t streamId)
+{
+    char header[9];
+    header[0] = (char)(length >> 16);
+    header[1] = (char)(length >> 8);
+    header[2] = (char)length;
+    header[3] = (char)type;
+    header[4] = (char)flags;
+    uint32_t id = htonl(streamId & 0x7fffffff);
+    memcpy(header + 5, &id, 4);
+    out.append(header, 9);
+}
+
+/*
+ * 发送WINDOW_UPDATE帧
+ *
+ */
+void Http2Session::WriteWindowUpdate(uint32_t streamId, uint32_t increment)
+{
+    WriteFrameHeader(outBuffer_, 4, FRAME_WINDOW_UPDATE, 0, streamId);
+    uint32_t value = htonl(increment);
+    outBuffer_.append((const char *)&value, 4);
+}
+
+/*
+ * 归还连接接收窗口，调用时已消费的数据均已从窗口中扣除
+ * 请求体总量受HTTP2_MAX_BUFFERED_BODY约束，不因未交出而扣留窗口，否则多个未接收完整的流会互相等待窗口而停滞
+ * 累计达到窗口一半时才发送WINDOW_UPDATE，避免每个DATA帧都回复一帧
+ *
+ */
+void Http2Session::UpdateConnRecvWindow()
+{
+    int64_t increment = HTTP2_DEFAULT_WINDOW_SIZE - connRecvWindow_;
+    if (increment * 2 >= HTTP2_DEFAULT_WINDOW_SIZE)
+    {
+        WriteWindowUpdate(0, increment);
+        connRecvWindow_ = HTTP2_DEFAULT_WINDOW_SIZE;
+    }
+}
+
+/*
+ * 归还流接收窗口，数据已存入请求体即视为消费，请求体大小由HTTP2_MAX_REQUEST_BODY限制
+ *
+ */
+void Http2Session::UpdateStreamRecvWindow(uint32_t streamId, Http2Stream &stream)
+{
+    int64_t increment = HTTP2_DEFAULT_WINDOW_SIZE - stream.recvWindow;
+    if (increment * 2 >= HTTP2_DEFAULT_WINDOW_SIZE)
+    {
+        WriteWindowUpdate(streamId, increment);
+        stream.recvWindow = HTTP2_DEFAULT_WINDOW_SIZE;
+    }
+}
+
+/*
+ * 请求未接收完整即响应错误状态码，随后以NO_ERROR重置流，通知对端停止发送请求体
+ *
+ */
+void Http2Session::RejectStream(uint32_t streamId, int status)
+{
+    HpackHeaderList headers;
+    headers.emplace_back("content-length", "0");
+    std::deque<Http2DataSource> sources;
+    SubmitResponse(streamId, status, headers, sources);
+    streams_.erase(streamId);
+    ResetStream(streamId, NO_ERROR);
+}
+
+/*
+ * 将outBuffer_交给outputCallback_
+ *
+ */
+void Http2Session::Flush()
+{
+    if (outBuffer_.empty())
+        return;
+    outputCallback_(outBuffer_, nullptr, 0, 0);
+    outBuffer_.clear();
+}
+
+/*
+ * 读取网络字节序的32位整数
+ *
+ */
+uint32_t Http2Session::ReadUint32(const char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return ntohl(value);
+}
+
+/*
+ * base64url解码（RFC 4648 5），HTTP2-Settings不含填充
+ *
+ */
+bool Http2Session::Base64UrlDecode(const std::string &in, std::string &out)
+{
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : in)
+    {
+        int value;
+        if (c >= 'A' && c <= 'Z')
+            value = c - 'A';
+        else if (c >= 'a' && c <= 'z')
+            value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9')
+            value = c - '0' + 52;
+        else if ('-' == c || '+' == c)
+            value = 62;
+        else if ('_' == c || '/' == c)
+            value = 63;
+        else if ('=' == c)
+            break;
+        else
+            return false;
+        buffer = (buffer << 6) | value;
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out.push_back((char)(buffer >> bits));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,167 @@
+// HttpCache类：
+//  http缓存协商工具类，负责生成校验器响应头、评估条件请求（If-None-Match、If-Modified-Since）
+//  校验器来自FileCache缓存项的inode、大小、修改时间，条件请求命中时返回304且无需打开文件
+//  CacheControlPolicy按url路径前缀配置Cache-Control响应头，最长前缀优先匹配
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <ctime>
+#include "LogServer.hpp"
+#include "FileCache.hpp"
+#include "WebSocket.hpp"
+
+class CacheControlPolicy
+{
+public:
+    CacheControlPolicy(const std::string &defaultPolicy = "no-cache");
+    void SetPolicy(const std::string &prefix, const std::string &cacheControl); // 设置url前缀对应的Cache-Control值
+    std::string GetPolicy(const std::string &urlPath);                          // 获取url路径最长匹配前缀的Cache-Control值
+
+private:
+    std::mutex mutex_;
+    std::string defaultPolicy_;                  // 无前缀匹配时使用的缺省值
+    std::map<std::string, std::string> policies_; // url前缀->Cache-Control值
+
+};
+
+CacheControlPolicy::CacheControlPolicy(const std::string &defaultPolicy)
+    : defaultPolicy_(defaultPolicy)
+{
+}
+
+/*
+ * 设置url前缀对应的Cache-Control值，值为空时移除该前缀
+ *
+ */
+void CacheControlPolicy::SetPolicy(const std::string &prefix, const std::string &cacheControl)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cacheControl.empty())
+        policies_.erase(prefix);
+    else
+        policies_[prefix] = cacheControl;
+}
+
+/*
+ * 获取url路径最长匹配前缀的Cache-Control值
+ * policies_按字典序有序，从不大于urlPath的最后一项向前查找即可找到最长前缀
+ *
+ */
+std::string CacheControlPolicy::GetPolicy(const std::string &urlPath)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, std::string>::const_iterator iter = policies_.upper_bound(urlPath);
+    while (iter != policies_.begin())
+    {
+        --iter;
+        if (0 == urlPath.compare(0, iter->first.size(), iter->first))
+            return iter->second;
+    }
+    return defaultPolicy_;
+}
+
+class HttpCache
+{
+public:
+    // 生成ETag响应值，不同编码的表示拥有不同的强校验器
+    static std::string MakeETag(const FileCache::spFileCacheEntry &entry, const std::string &encoding);
+    // 评估条件请求，资源未变更时返回true，应响应304
+    static bool NotModified(const std::map<std::string, std::string> &header, const std::string &etag, time_t mtime);
+    // 生成校验器及缓存控制响应头
+    static std::string ValidatorHeaders(const std::string &etag, const std::string &lastModified, const std::string &cacheControl);
+    static time_t ParseHttpDate(const std::string &date); // 解析http日期，失败返回-1
+
+private:
+    static bool MatchETag(const std::string &ifNoneMatch, const std::string &etag); // If-None-Match弱比较
+
+};
+
+/*
+ * 生成ETag响应值
+ *
+ */
+std::string HttpCache::MakeETag(const FileCache::spFileCacheEntry &entry, const std::string &encoding)
+{
+    if (encoding.empty())
+        return "\"" + entry->etag + "\"";
+    return "\"" + entry->etag + "-" + encoding + "\"";
+}
+
+/*
+ * 评估条件请求
+ * If-None-Match存在时优先，忽略If-Modified-Since（RFC 7232 6）
+ *
+ */
+bool HttpCache::NotModified(const std::map<std::string, std::string> &header, const std::string &etag, time_t mtime)
+{
+    // HTTP/1.x请求头保留客户端的大小写，名称不区分大小写查找
+    const std::string *ifNoneMatch = WebSocket::FindHeader(header, "If-None-Match");
+    if (ifNoneMatch)
+        return MatchETag(*ifNoneMatch, etag);
+    const std::string *ifModifiedSince = WebSocket::FindHeader(header, "If-Modified-Since");
+    if (ifModifiedSince)
+    {
+        time_t since = ParseHttpDate(*ifModifiedSince);
+        return since >= 0 && mtime <= since;
+    }
+    return false;
+}
+
+/*
+ * If-None-Match弱比较，去除W/前缀后逐项与etag比较，"*"匹配任意资源
+ *
+ */
+bool HttpCache::MatchETag(const std::string &ifNoneMatch, const std::string &etag)
+{
+    size_t prev = 0, next;
+    while (prev < ifNoneMatch.size())
+    {
+        next = ifNoneMatch.find(',', prev);
+        if (std::string::npos == next)
+            next = ifNoneMatch.size();
+        size_t begin = ifNoneMatch.find_first_not_of(" \t", prev);
+        size_t end = ifNoneMatch.find_last_not_of(" \t", next - 1);
+        prev = next + 1;
+        if (std::string::npos == begin || begin >= next)
+            continue;
+        std::string tag = ifNoneMatch.substr(begin, end - begin + 1);
+        if ("*" == tag)
+            return true;
+        if (0 == tag.compare(0, 2, "W/"))
+            tag.erase(0, 2);
+        if (tag == etag)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * 生成校验器及缓存控制响应头
+ *
+ */
+std::string HttpCache::ValidatorHeaders(const std::string &etag, const std::string &lastModified, const std::string &cacheControl)
+{
+    std::string headers;
+    headers += "ETag: " + etag + "\r\n";
+    headers += "Last-Modified: " + lastModified + "\r\n";
+    if (!cacheControl.empty())
+        headers += "Cache-Control: " + cacheControl + "\r\n";
+    return headers;
+}
+
+/*
+ * 解析http日期，仅支持IMF-fixdate格式：Sun, 06 Nov 1994 08:49:37 GMT
+ *
+ */
+time_t HttpCache::ParseHttpDate(const std::string &date)
+{
+    struct tm tmTime;
+    memset(&tmTime, 0, sizeof(tmTime));
+    const char *end = strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tmTime);
+    if (!end)
+        return -1;
+    return timegm(&tmTime);
+}
@@ -0,0 +1,374 @@
+// HttpCompress类：
+//  http响应压缩工具类，负责Accept-Encoding协商与gzip/deflate（可选brotli）压缩
+//  CompressStream为流式压缩器，分块输入原始数据、分块输出压缩数据，不需要先缓存完整的原始内容
+//  静态文件：仅对TypeIdentify判定为可压缩的资源类型、且长度介于MinCompressSize与配置的compressMaxSize之间的文件压缩，
+//  压缩结果由FileCache缓存在原始内容旁，更大的文件经sendfile原样发送
+//  动态响应：长度未知，由ChunkedCompressor边生成边压缩，压缩输出以chunked传输编码分块追加到发送缓冲区，仅用于HTTP/1.1
+//  编译时定义ENABLE_BROTLI并链接brotlienc后启用br编码
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <zlib.h>
+#ifdef ENABLE_BROTLI
+#include <brotli/encode.h>
+#endif
+#include "LogServer.hpp"
+#include "TypeIdentify.hpp"
+#include "ServerConfig.hpp"
+#include "WebSocket.hpp"
+
+#define COMPRESS_CHUNK 16384 // 流式压缩单次输出块大小
+
+class CompressStream
+{
+public:
+    CompressStream(const std::string &encoding, std::string &out);
+    ~CompressStream();
+    bool Write(const char *data, size_t length); // 输入一块原始数据，压缩结果追加到out_
+    bool Finish();                               // 结束压缩，输出剩余数据
+    bool IsValid() const { return valid_; }      // 压缩器是否初始化成功
+
+private:
+    std::string encoding_; // 编码方式：gzip、deflate、br
+    std::string &out_;     // 压缩结果输出缓冲区
+    bool valid_;           // 压缩器初始化状态
+    bool finished_;        // 压缩结束标志
+    z_stream zstream_;     // zlib压缩流
+#ifdef ENABLE_BROTLI
+    BrotliEncoderState *brotliState_; // brotli压缩流
+#endif
+    bool Deflate(int flush); // zlib压缩并输出
+#ifdef ENABLE_BROTLI
+    bool BrotliCompress(BrotliEncoderOperation op, const char *data, size_t length); // brotli压缩并输出
+#endif
+
+};
+
+CompressStream::CompressStream(const std::string &encoding, std::string &out)
+    : encoding_(encoding),
+      out_(out),
+      valid_(false),
+      finished_(false)
+#ifdef ENABLE_BROTLI
+      , brotliState_(nullptr)
+#endif
+{
+    memset(&zstream_, 0, sizeof(zstream_));
+#ifdef ENABLE_BROTLI
+    if ("br" == encoding_)
+    {
+        brotliState_ = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+        if (brotliState_)
+        {
+            // 质量5兼顾动态压缩速度与压缩率
+            BrotliEncoderSetParameter(brotliState_, BROTLI_PARAM_QUALITY, 5);
+            valid_ = true;
+        }
+        return;
+    }
+#endif
+    // windowBits为15+16时输出gzip格式，为15时输出zlib格式（即http的deflate编码）
+    int windowBits = ("gzip" == encoding_) ? 15 + 16 : 15;
+    if ("gzip" == encoding_ || "deflate" == encoding_)
+    {
+        valid_ = (Z_OK == deflateInit2(&zstream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY));
+    }
+    if (!valid_)
+    {
+        LOG(LoggerLevel::ERROR, "初始化压缩流失败，编码方式：%s\n", encoding_.c_str());
+    }
+}
+
+CompressStream::~CompressStream()
+{
+#ifdef ENABLE_BROTLI
+    if (brotliState_)
+    {
+        BrotliEncoderDestroyInstance(brotliState_);
+        return;
+    }
+#endif
+    if (valid_)
+        deflateEnd(&zstream_);
+}
+
+/*
+ * 输入一块原始数据，压缩结果追加到out_
+ *
+ */
+bool CompressStream::Write(const char *data, size_t length)
+{
+    if (!valid_ || finished_)
+        return false;
+#ifdef ENABLE_BROTLI
+    if (brotliState_)
+        return BrotliCompress(BROTLI_OPERATION_PROCESS, data, length);
+#endif
+    zstream_.next_in = (Bytef *)data;
+    zstream_.avail_in = length;
+    return Deflate(Z_NO_FLUSH);
+}
+
+/*
+ * 结束压缩，输出剩余数据
+ *
+ */
+bool CompressStream::Finish()
+{
+    if (!valid_ || finished_)
+        return false;
+    finished_ = true;
+#ifdef ENABLE_BROTLI
+    if (brotliState_)
+        return BrotliCompress(BROTLI_OPERATION_FINISH, nullptr, 0);
+#endif
+    zstream_.next_in = nullptr;
+    zstream_.avail_in = 0;
+    return Deflate(Z_FINISH);
+}
+
+/*
+ * zlib压缩并输出，每次最多输出COMPRESS_CHUNK字节直至输入耗尽
+ *
+ */
+bool CompressStream::Deflate(int flush)
+{
+    char buffer[COMPRESS_CHUNK];
+    int result;
+    do
+    {
+        zstream_.next_out = (Bytef *)buffer;
+        zstream_.avail_out = COMPRESS_CHUNK;
+        result = deflate(&zstream_, flush);
+        if (Z_STREAM_ERROR == result)
+        {
+            LOG(LoggerLevel::ERROR, "压缩数据失败，编码方式：%s\n", encoding_.c_str());
+            return false;
+        }
+        out_.append(buffer, COMPRESS_CHUNK - zstream_.avail_out);
+    } while (0 == zstream_.avail_out);
+    return true;
+}
+
+#ifdef ENABLE_BROTLI
+/*
+ * brotli压缩并输出
+ *
+ */
+bool CompressStream::BrotliCompress(BrotliEncoderOperation op, const char *data, size_t length)
+{
+    const uint8_t *nextIn = (const uint8_t *)data;
+    size_t availIn = length;
+    uint8_t buffer[COMPRESS_CHUNK];
+    do
+    {
+        uint8_t *nextOut = buffer;
+        size_t availOut = COMPRESS_CHUNK;
+        if (!BrotliEncoderCompressStream(brotliState_, op, &availIn, &nextIn, &availOut, &nextOut, nullptr))
+        {
+            LOG(LoggerLevel::ERROR, "%s\n", "压缩数据失败，编码方式：br");
+            return false;
+        }
+        out_.append((const char *)buffer, COMPRESS_CHUNK - availOut);
+    } while (availIn > 0 || BrotliEncoderHasMoreOutput(brotliState_) ||
+             (BROTLI_OPERATION_FINISH == op && !BrotliEncoderIsFinished(brotliState_)));
+    return true;
+}
+#endif
+
+// 动态响应的流式压缩输出：原始内容分块输入，已产生的压缩数据作为一个chunk追加到out，不缓存完整的原始或压缩内容
+// 调用者先写入含Content-Encoding与Transfer-Encoding: chunked的响应头，每次Write后可调用SendBufferOut把已有的chunk发出
+class ChunkedCompressor
+{
+public:
+    ChunkedCompressor(const std::string &encoding, std::string &out);
+    bool Write(const char *data, size_t length); // 输入一块原始内容，压缩输出作为一个chunk追加到out_
+    bool Finish();                               // 结束压缩，输出剩余数据与结束chunk
+    bool IsValid() const { return stream_.IsValid(); } // 压缩器是否初始化成功
+
+private:
+    std::string &out_;      // 发送缓冲区
+    std::string pending_;   // 压缩器本次输出的数据，封装为chunk后清空
+    CompressStream stream_; // 压缩流，输出到pending_
+    void AppendChunk();     // pending_封装为一个chunk追加到out_
+
+};
+
+ChunkedCompressor::ChunkedCompressor(const std::string &encoding, std::string &out)
+    : out_(out),
+      pending_(),
+      stream_(encoding, pending_)
+{
+}
+
+/*
+ * 输入一块原始内容，压缩输出作为一个chunk追加到out_
+ * 压缩器内部缓存不足一块的数据时没有输出，不追加空chunk
+ *
+ */
+bool ChunkedCompressor::Write(const char *data, size_t length)
+{
+    if (!stream_.Write(data, length))
+        return false;
+    AppendChunk();
+    return true;
+}
+
+/*
+ * 结束压缩，输出剩余数据与结束chunk
+ *
+ */
+bool ChunkedCompressor::Finish()
+{
+    if (!stream_.Finish())
+        return false;
+    AppendChunk();
+    out_.append("0\r\n\r\n");
+    return true;
+}
+
+/*
+ * pending_封装为一个chunk追加到out_：十六进制长度、CRLF、数据、CRLF
+ *
+ */
+void ChunkedCompressor::AppendChunk()
+{
+    if (pending_.empty())
+        return;
+    char size[20];
+    int n = snprintf(size, sizeof(size), "%zx\r\n", pending_.size());
+    out_.append(size, n);
+    out_.append(pending_);
+    out_.append("\r\n");
+    pending_.clear();
+}
+
+class HttpCompress
+{
+public:
+    static const size_t MinCompressSize; // 可压缩的最小内容长度，过小的内容压缩收益低于开销
+    // 根据请求头的Accept-Encoding、资源类型及内容长度协商编码方式，返回空字符串表示不压缩
+    static std::string NegotiateEncoding(const std::map<std::string, std::string> &header,
+                                         const std::string &contentType, size_t contentLength);
+    // 长度未知的动态响应协商编码方式，仅HTTP/1.1请求可用chunked传输编码，返回空字符串表示不压缩
+    static std::string NegotiateStreamEncoding(const std::map<std::string, std::string> &header,
+                                               const std::string &version, const std::string &contentType);
+    // 一次性压缩data，结果追加到out
+    static bool Compress(const std::string &encoding, const char *data, size_t length, std::string &out);
+
+private:
+    static std::string AcceptedEncoding(const std::map<std::string, std::string> &header); // 按Accept-Encoding选择编码方式
+    static double ParseQuality(const std::string &token); // 解析编码项的q值
+
+};
+
+const size_t HttpCompress::MinCompressSize = 1024;
+
+/*
+ * 根据请求头的Accept-Encoding、资源类型及内容长度协商编码方式
+ *
+ */
+std::string HttpCompress::NegotiateEncoding(const std::map<std::string, std::string> &header,
+                                            const std::string &contentType, size_t contentLength)
+{
+    if (contentLength < MinCompressSize || contentLength > ServerConfig::GetInstance()->CompressMaxSize() ||
+        !TypeIdentify::isCompressibleType(contentType))
+        return "";
+    return AcceptedEncoding(header);
+}
+
+/*
+ * 长度未知的动态响应协商编码方式
+ * 压缩输出以chunked传输编码发送，HTTP/1.0不支持，h2c连接的响应由TcpConnection转换为DATA帧，均不压缩
+ *
+ */
+std::string HttpCompress::NegotiateStreamEncoding(const std::map<std::string, std::string> &header,
+                                                  const std::string &version, const std::string &contentType)
+{
+    if ("HTTP/1.1" != version || !TypeIdentify::isCompressibleType(contentType))
+        return "";
+    return AcceptedEncoding(header);
+}
+
+/*
+ * 按请求头的Accept-Encoding选择编码方式
+ * 优先级：br（启用时） > gzip > deflate，q=0的编码视为客户端拒绝
+ * "*"只作用于未列出的编码，不覆盖显式的q=0
+ *
+ */
+std::string HttpCompress::AcceptedEncoding(const std::map<std::string, std::string> &header)
+{
+    // HTTP/1.x请求头保留客户端的大小写，名称不区分大小写查找
+    const std::string *accept = WebSocket::FindHeader(header, "Accept-Encoding");
+    if (!accept)
+        return "";
+    // 小于0表示未列出
+    double br = -1, gzip = -1, deflate = -1, wildcard = 0;
+    size_t prev = 0, next;
+    const std::string &acceptEncoding = *accept;
+    while (prev < acceptEncoding.size())
+    {
+        next = acceptEncoding.find(',', prev);
+        if (std::string::npos == next)
+            next = acceptEncoding.size();
+        std::string token = acceptEncoding.substr(prev, next - prev);
+        prev = next + 1;
+        // 去除首尾空白
+        size_t begin = token.find_first_not_of(" \t");
+        if (std::string::npos == begin)
+            continue;
+        size_t end = token.find_first_of(" \t;", begin);
+        std::string coding = token.substr(begin, (std::string::npos == end ? token.size() : end) - begin);
+        double q = ParseQuality(token);
+        if ("br" == coding)
+            br = q;
+        else if ("gzip" == coding || "x-gzip" == coding)
+            gzip = q;
+        else if ("deflate" == coding)
+            deflate = q;
+        else if ("*" == coding)
+            wildcard = q;
+    }
+    if (br < 0)
+        br = wildcard;
+    if (gzip < 0)
+        gzip = wildcard;
+    if (deflate < 0)
+        deflate = wildcard;
+#ifdef ENABLE_BROTLI
+    if (br > 0 && br >= gzip && br >= deflate)
+        return "br";
+#endif
+    if (gzip > 0 && gzip >= deflate)
+        return "gzip";
+    if (deflate > 0)
+        return "deflate";
+    return "";
+}
+
+/*
+ * 解析编码项的q值，缺省为1
+ *
+ */
+double HttpCompress::ParseQuality(const std::string &token)
+{
+    size_t pos = token.find("q=");
+    if (std::string::npos == pos)
+        return 1;
+    return atof(token.c_str() + pos + 2);
+}
+
+/*
+ * 一次性压缩data，结果追加到out
+ *
+ */
+bool HttpCompress::Compress(const std::string &encoding, const char *data, size_t length, std::string &out)
+{
+    CompressStream stream(encoding, out);
+    return stream.IsValid() && stream.Write(data, length) && stream.Finish();
+}
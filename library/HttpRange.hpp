@@ -0,0 +1,240 @@
+// HttpRange类：
+//  http范围请求工具类，负责解析Range请求头、评估If-Range条件并生成206部分响应
+//  仅支持bytes单位，多个范围排序并合并重叠部分后以multipart/byteranges响应，单个范围直接响应
+//  部分响应的文件内容通过TcpConnection的文件段队列以sendfile从指定偏移发送，不读入用户态内存
+//  范围请求作用于未压缩的原始内容，命中范围请求时不进行压缩编码
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "LogServer.hpp"
+#include "FileCache.hpp"
+#include "HttpCache.hpp"
+#include "TcpConnection.hpp"
+#include "WebSocket.hpp"
+
+// 闭区间字节范围
+typedef struct _ByteRange
+{
+    off_t first; // 起始字节偏移
+    off_t last;  // 结束字节偏移（含）
+} ByteRange;
+
+class HttpRange
+{
+public:
+    typedef std::shared_ptr<TcpConnection> spTcpConnection;
+    static const size_t MaxRangeCount; // 单个请求允许的最大范围数量，超出时忽略Range返回完整内容
+    // Range请求头的评估结果
+    enum class RangeResult
+    {
+        RANGE_NONE,          // 无Range请求头、格式错误或If-Range不匹配，返回完整内容
+        RANGE_SATISFIABLE,   // 范围有效，返回206
+        RANGE_UNSATISFIABLE  // 范围均超出文件大小，返回416
+    };
+    // 评估Range与If-Range请求头，范围有效时ranges为排序合并后的范围
+    static RangeResult Evaluate(const std::map<std::string, std::string> &header, const FileCache::spFileCacheEntry &entry,
+                                std::vector<ByteRange> &ranges);
+    // 追加部分响应的Content-Type、Content-Range、Content-Length头及空行到responsecontext，并将文件段加入发送队列
+    static bool AppendPartial(spTcpConnection &sptcpconn, const FileCache::spFileCacheEntry &entry,
+                              const std::vector<ByteRange> &ranges, std::string &responsecontext);
+    // 生成416响应所需的Content-Range头
+    static std::string UnsatisfiableHeader(const FileCache::spFileCacheEntry &entry);
+
+private:
+    static bool ParseRange(const std::string &range, off_t size, std::vector<ByteRange> &ranges, bool &satisfiable);
+    static bool IfRangeMatches(const std::string &ifRange, const FileCache::spFileCacheEntry &entry);
+    static std::string ContentRange(const ByteRange &range, off_t size); // 生成"bytes first-last/size"
+
+};
+
+const size_t HttpRange::MaxRangeCount = 16;
+
+/*
+ * 评估Range与If-Range请求头
+ * If-Range与当前资源不匹配时忽略Range返回完整内容（RFC 7233 3.2）
+ *
+ */
+HttpRange::RangeResult HttpRange::Evaluate(const std::map<std::string, std::string> &header, const FileCache::spFileCacheEntry &entry,
+                                           std::vector<ByteRange> &ranges)
+{
+    // HTTP/1.x请求头保留客户端的大小写，名称不区分大小写查找
+    const std::string *range = WebSocket::FindHeader(header, "Range");
+    if (!range)
+        return RangeResult::RANGE_NONE;
+    const std::string *ifRange = WebSocket::FindHeader(header, "If-Range");
+    if (ifRange && !IfRangeMatches(*ifRange, entry))
+        return RangeResult::RANGE_NONE;
+    bool satisfiable = false;
+    if (!ParseRange(*range, entry->size, ranges, satisfiable))
+    {
+        LOG(LoggerLevel::INFO, "忽略无法解析的Range请求头：%s\n", range->c_str());
+        ranges.clear();
+        return RangeResult::RANGE_NONE;
+    }
+    return satisfiable ? RangeResult::RANGE_SATISFIABLE : RangeResult::RANGE_UNSATISFIABLE;
+}
+
+/*
+ * 解析Range请求头：bytes=0-499, 500-, -200
+ * 格式错误或范围过多时返回false；超出文件大小的范围被丢弃，全部被丢弃时satisfiable为false
+ * 有效范围按起始偏移排序，重叠或相邻的范围合并为一个
+ *
+ */
+bool HttpRange::ParseRange(const std::string &range, off_t size, std::vector<ByteRange> &ranges, bool &satisfiable)
+{
+    size_t pos = range.find_first_not_of(" \t");
+    if (std::string::npos == pos || 0 != range.compare(pos, 6, "bytes="))
+        return false;
+    pos += 6;
+    size_t count = 0;
+    while (pos < range.size())
+    {
+        size_t next = range.find(',', pos);
+        if (std::string::npos == next)
+            next = range.size();
+        std::string spec = range.substr(pos, next - pos);
+        pos = next + 1;
+        size_t begin = spec.find_first_not_of(" \t");
+        if (std::string::npos == begin)
+            continue;
+        size_t end = spec.find_last_not_of(" \t");
+        spec = spec.substr(begin, end - begin + 1);
+        if (++count > MaxRangeCount)
+            return false;
+        size_t dash = spec.find('-');
+        if (std::string::npos == dash || std::string::npos != spec.find_first_not_of("0123456789-") ||
+            std::string::npos != spec.find('-', dash + 1))
+            return false;
+        std::string firstStr = spec.substr(0, dash), lastStr = spec.substr(dash + 1);
+        ByteRange byteRange;
+        if (firstStr.empty())
+        {
+            // 后缀范围：最后N个字节
+            if (lastStr.empty())
+                return false;
+            off_t suffix = strtoll(lastStr.c_str(), nullptr, 10);
+            if (0 == suffix || 0 == size)
+                continue;
+            byteRange.first = suffix >= size ? 0 : size - suffix;
+            byteRange.last = size - 1;
+        }
+        else
+        {
+            byteRange.first = strtoll(firstStr.c_str(), nullptr, 10);
+            byteRange.last = lastStr.empty() ? size - 1 : strtoll(lastStr.c_str(), nullptr, 10);
+            if (!lastStr.empty() && byteRange.last < byteRange.first)
+                return false;
+            if (byteRange.first >= size)
+                continue;
+            if (byteRange.last >= size)
+                byteRange.last = size - 1;
+        }
+        ranges.push_back(byteRange);
+    }
+    if (0 == count)
+        return false;
+    satisfiable = !ranges.empty();
+    std::sort(ranges.begin(), ranges.end(), [](const ByteRange &a, const ByteRange &b)
+              { return a.first < b.first; });
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); ++i)
+    {
+        if (ranges[i].first <= ranges[merged].last + 1)
+            ranges[merged].last = std::max(ranges[merged].last, ranges[i].last);
+        else
+            ranges[++merged] = ranges[i];
+    }
+    if (!ranges.empty())
+        ranges.resize(merged + 1);
+    return true;
+}
+
+/*
+ * If-Range匹配：实体标签需强比较相等，日期需与Last-Modified完全一致
+ *
+ */
+bool HttpRange::IfRangeMatches(const std::string &ifRange, const FileCache::spFileCacheEntry &entry)
+{
+    size_t begin = ifRange.find_first_not_of(" \t");
+    if (std::string::npos == begin)
+        return false;
+    size_t end = ifRange.find_last_not_of(" \t");
+    std::string value = ifRange.substr(begin, end - begin + 1);
+    if ('"' == value[0] || 0 == value.compare(0, 2, "W/"))
+        return value == HttpCache::MakeETag(entry, "");
+    return HttpCache::ParseHttpDate(value) == entry->mtime;
+}
+
+/*
+ * 生成"bytes first-last/size"
+ *
+ */
+std::string HttpRange::ContentRange(const ByteRange &range, off_t size)
+{
+    char buffer[96];
+    snprintf(buffer, sizeof(buffer), "bytes %lld-%lld/%lld", (long long)range.first, (long long)range.last, (long long)size);
+    return buffer;
+}
+
+/*
+ * 生成416响应所需的Content-Range头
+ *
+ */
+std::string HttpRange::UnsatisfiableHeader(const FileCache::spFileCacheEntry &entry)
+{
+    return "Content-Range: bytes */" + std::to_string(entry->size) + "\r\n";
+}
+
+/*
+ * 追加部分响应的内容头并将文件段加入发送队列
+ * 单个范围直接发送该范围内容；多个范围以multipart/byteranges发送，每段前附带分段头
+ * 打开文件失败时返回false，responsecontext保持不变
+ *
+ */
+bool HttpRange::AppendPartial(spTcpConnection &sptcpconn, const FileCache::spFileCacheEntry &entry,
+                              const std::vector<ByteRange> &ranges, std::string &responsecontext)
+{
+    std::shared_ptr<int> fileFd = TcpConnection::OpenSendFile(entry->path);
+    if (!fileFd)
+    {
+        LOG(LoggerLevel::ERROR, "打开资源文件失败：%s\n", entry->path.c_str());
+        return false;
+    }
+    if (1 == ranges.size())
+    {
+        const ByteRange &range = ranges.front();
+        responsecontext += "Content-Type: " + entry->contentType + "; charset=utf-8\r\n";
+        responsecontext += "Content-Range: " + ContentRange(range, entry->size) + "\r\n";
+        responsecontext += "Content-Length: " + std::to_string(range.last - range.first + 1) + "\r\n\r\n";
+        sptcpconn->AddSendFile(fileFd, range.first, range.last - range.first + 1);
+        return true;
+    }
+    // 分隔符由inode与修改时间生成，不会出现在分段头中
+    std::string boundary = "NetServerRange" + entry->etag;
+    std::vector<std::string> heads;
+    size_t contentLength = 0;
+    for (const ByteRange &range : ranges)
+    {
+        std::string head = "\r\n--" + boundary + "\r\n";
+        head += "Content-Type: " + entry->contentType + "; charset=utf-8\r\n";
+        head += "Content-Range: " + ContentRange(range, entry->size) + "\r\n\r\n";
+        contentLength += head.size() + (range.last - range.first + 1);
+        heads.push_back(std::move(head));
+    }
+    std::string tail = "\r\n--" + boundary + "--\r\n";
+    contentLength += tail.size();
+    responsecontext += "Content-Type: multipart/byteranges; boundary=" + boundary + "\r\n";
+    responsecontext += "Content-Length: " + std::to_string(contentLength) + "\r\n\r\n";
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        sptcpconn->AddSendFile(fileFd, ranges[i].first, ranges[i].last - ranges[i].first + 1, heads[i]);
+    }
+    sptcpconn->AddSendFile(nullptr, 0, 0, tail);
+    return true;
+}
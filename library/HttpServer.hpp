@@ -53,10 +53,14 @@
 #include <functional>
 #include "Timer.hpp"
 #include "Resource.hpp"
+#include "FileCache.hpp"
+#include "HttpCache.hpp"
+#include "HttpRange.hpp"
 #include "TcpServer.hpp"
 #include "EventLoop.hpp"
 #include "LogServer.hpp"
 #include "ThreadPool.hpp"
+#include "HttpCompress.hpp"
 #include "TypeIdentify.hpp"
 #include "TcpConnection.hpp"
 
@@ -65,6 +69,7 @@ class HttpServer
 public:
     HttpServer(EventLoop *loop, const int workThreadNum = 2, ThreadPool *threadPool = NULL, const int loopThreadNum = 0, const int port = 80, TcpServer *shareTcpServer = NULL);
     ~HttpServer();
+    void SetCacheControl(const std::string &prefix, const std::string &cacheControl); // 设置url前缀对应的Cache-Control响应头
 
 private:
     typedef std::shared_ptr<TcpConnection> spTcpConnection;
@@ -74,6 +79,7 @@ private:
     int tcpServerPort_;                           // tcpServer的EPOLL的服务端口
     TcpServer *tcpserver_;                        // 基础网络服务TcpServer
     ThreadPool *threadpool_;                      // 线程池
+    CacheControlPolicy cacheControl_;             // 按url前缀配置的Cache-Control策略
     int getFileSize(char *file_name);             // 获取文件大小
     void HttpProcess(spTcpConnection &sptcpconn); // 处理请求并响应
     // 处理错误http请求，返回错误描述
@@ -118,6 +124,17 @@ HttpServer::~HttpServer()
     }
 }
 
+/*
+ * 设置url前缀对应的Cache-Control响应头，最长前缀优先匹配，未匹配时为no-cache
+ * 例如：SetCacheControl("/fzg/", "public, max-age=86400")
+ *
+ */
+void HttpServer::SetCacheControl(const std::string &prefix, const std::string &cacheControl)
+{
+    LOG(LoggerLevel::INFO, "设置Cache-Control策略，前缀：%s，值：%s\n", prefix.c_str(), cacheControl.c_str());
+    cacheControl_.SetPolicy(prefix, cacheControl);
+}
+
 /*
  * HttpServer模式处理收到的请求
  *
@@ -126,7 +143,7 @@ void HttpServer::HandleMessage(spTcpConnection &sptcpconn)
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     // 修改定时器参数
-    sptcpconn->GetTimer()->Adjust(5000, Timer::TimerType::TIMER_ONCE, std::bind(&TcpConnection::Shutdown, sptcpconn));
+    sptcpconn->GetTimer()->Adjust(ServerConfig::GetInstance()->IdleTimeoutMs(), Timer::TimerType::TIMER_ONCE);
     sptcpconn->SetAsyncProcessing(false);
     if (false == sptcpconn->GetReqHealthy())
     {
@@ -138,7 +155,7 @@ void HttpServer::HandleMessage(spTcpConnection &sptcpconn)
         // 已开启线程池，设置异步处理标志
         sptcpconn->SetAsyncProcessing(true);
         // 线程池在此添加任务并唤醒一工作线程执行之
-        threadpool_->AddTask([&]()
+        threadpool_->AddTask([this, sptcpconn]() mutable
                              {
                                 // 执行动态绑定的处理函数
                                 LOG(LoggerLevel::INFO, "工作线程即将执行sptcpconn的绑定函数，此时sptcpconn->IsDisconnected()：%s，sockfd：%d\n", sptcpconn->IsDisconnected() ? "true" : "false", sptcpconn->fd());
@@ -156,7 +173,6 @@ void HttpServer::HandleMessage(spTcpConnection &sptcpconn)
                                     catch(std::bad_function_call)
                                     {
                                         LOG(LoggerLevel::ERROR, "工作线程执行sptcpconn的绑定函数报错：std::bad_function_call，连接绑定函数异常，sockfd：%d\n", sptcpconn->fd());
-                                        sptcpconn->SetAsyncProcessing(false);
                                     }
                                     sptcpconn->SetAsyncProcessing(false);
                                 } });
@@ -242,16 +258,39 @@ void HttpServer::HttpProcess(spTcpConnection &sptcpconn)
     {
         // '/hello'处理为以下内容，作为参考
         responsebody = ("hello world");
+        // 动态响应按协商结果以chunked传输编码流式压缩，内容过短时不压缩
+        // 分块生成的响应体可在每次Write后调用SendBufferOut发出已压缩的chunk，不必缓存完整内容
+        std::string encoding;
+        bool healthy = true;
+        if (responsebody.size() >= HttpCompress::MinCompressSize)
+            encoding = HttpCompress::NegotiateStreamEncoding(httprequestcontext.header, httprequestcontext.version, filetype);
         responsecontext += httprequestcontext.version + " 200 OK\r\n";
         responsecontext += "Server: Qiu Hai's NetServer/HttpService\r\n";
         responsecontext += "Content-Type: " + filetype + "; charset=utf-8\r\n";
+        responsecontext += "Vary: Accept-Encoding\r\n";
         if (iter != httprequestcontext.header.end())
         {
             responsecontext += "Connection: " + iter->second + "\r\n";
         }
-        responsecontext += "Content-Length: " + std::to_string(responsebody.size()) + "\r\n\r\n";
-        responsecontext += responsebody;
+        if (!encoding.empty())
+        {
+            responsecontext += "Content-Encoding: " + encoding + "\r\n";
+            responsecontext += "Transfer-Encoding: chunked\r\n\r\n";
+            ChunkedCompressor compressor(encoding, responsecontext);
+            healthy = compressor.Write(responsebody.data(), responsebody.size()) && compressor.Finish();
+        }
+        else
+        {
+            responsecontext += "Content-Length: " + std::to_string(responsebody.size()) + "\r\n\r\n";
+            responsecontext += responsebody;
+        }
         sptcpconn->SendBufferOut();
+        if (!healthy)
+        {
+            // 响应头已发出，无法改为错误响应，关闭连接使客户端得知响应不完整
+            LOG(LoggerLevel::ERROR, "动态响应压缩失败，编码方式：%s\n", encoding.c_str());
+            sptcpconn->Shutdown();
+        }
         return;
     }
     else
@@ -269,7 +308,7 @@ void HttpServer::HttpProcess(spTcpConnection &sptcpconn)
 void HttpServer::SendResource(spTcpConnection &sptcpconn, const std::string &filePath)
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
-    std::string filetype = TypeIdentify::getContentTypeByPath(filePath);
+    std::string filetype(TypeIdentify::getContentTypeByPath(filePath));
     HttpRequestContext &httprequestcontext = sptcpconn->GetReqestBuffer();
     if (filetype.empty())
     {
@@ -279,54 +318,127 @@ void HttpServer::SendResource(spTcpConnection &sptcpconn, const std::string &fil
         HttpError(sptcpconn, 404, "Not Found Resource : \"" + filePath.substr(npos + 1) + "\" ,unknown file-type");
         return;
     }
-    std::string &responsecontext = sptcpconn->GetBufferOut(); // 存储响应头+响应内容
-    std::string responsebody;                                 // 暂存响应内容
-    FILE *fp = NULL;
-    if ((fp = fopen(filePath.c_str(), "rb")) == NULL)
+    FileCache::spFileCacheEntry entry = FileCache::GetInstance()->Get(filePath, filetype);
+    if (!entry)
     {
         // 未定位到资源文件
-        LOG(LoggerLevel::INFO, "未寻到资源：%s\n", filePath);
+        LOG(LoggerLevel::INFO, "未寻到资源：%s\n", filePath.c_str());
         size_t npos = filePath.rfind('/');
         HttpError(sptcpconn, 404, "Not Found Resource : \"" + filePath.substr(npos + 1) + "\" ");
         return;
     }
-    else
+    // 协商压缩编码，常驻缓存的文件直接使用预压缩内容
+    std::string encoding = HttpCompress::NegotiateEncoding(httprequestcontext.header, filetype, entry->size);
+    // 生成校验器并评估条件请求，资源未变更时直接响应304，无需读取文件
+    std::string etag = HttpCache::MakeETag(entry, encoding);
+    std::string urlPath = httprequestcontext.url.substr(0, httprequestcontext.url.find('?'));
+    std::string validators = HttpCache::ValidatorHeaders(etag, entry->lastModified, cacheControl_.GetPolicy(urlPath));
+    std::map<std::string, std::string>::const_iterator iter = httprequestcontext.header.find("Connection");
+    if (HttpCache::NotModified(httprequestcontext.header, etag, entry->mtime))
     {
-        // 读取并发送请求的资源文件
-        std::fstream tmpfile;
-        tmpfile.open(filePath.c_str(), std::ios::in | std::ios::binary | std::ios::ate); // 二进制输入(读取),定位到文件末尾
-        if (tmpfile.is_open())
+        std::string &responsecontext = sptcpconn->GetBufferOut();
+        responsecontext += httprequestcontext.version + " 304 Not Modified\r\n";
+        responsecontext += "Server: QiuHai's NetServer/ResourceService\r\n";
+        responsecontext += validators;
+        if (TypeIdentify::isCompressibleType(filetype))
+        {
+            responsecontext += "Vary: Accept-Encoding\r\n";
+        }
+        if (iter != httprequestcontext.header.end())
         {
-            size_t length = tmpfile.tellg(); // 获取文件大小
-            tmpfile.seekg(0, std::ios::beg); // 定位到文件开始
-            char data[BUFSIZE];
-            while (length >= BUFSIZE)
-            {
-                tmpfile.read(data, BUFSIZE);
-                responsebody.append(data, BUFSIZE);
-                length -= BUFSIZE;
-            }
-            if (length > 0)
-            {
-                tmpfile.read(data, length);
-                responsebody.append(data, length);
-                length = 0;
-            }
+            responsecontext += "Connection: " + iter->second + "\r\n";
         }
-        fclose(fp);
+        responsecontext += "\r\n";
+        LOG(LoggerLevel::INFO, "资源未变更，响应304：%s\n", filePath.c_str());
+        sptcpconn->SendBufferOut();
+        return;
     }
+    // 评估范围请求，部分响应基于未压缩的原始内容，以sendfile从指定偏移发送
+    std::vector<ByteRange> ranges;
+    HttpRange::RangeResult rangeResult = HttpRange::Evaluate(httprequestcontext.header, entry, ranges);
+    if (HttpRange::RangeResult::RANGE_UNSATISFIABLE == rangeResult)
+    {
+        std::string &responsecontext = sptcpconn->GetBufferOut();
+        responsecontext += httprequestcontext.version + " 416 Range Not Satisfiable\r\n";
+        responsecontext += "Server: QiuHai's NetServer/ResourceService\r\n";
+        responsecontext += HttpRange::UnsatisfiableHeader(entry);
+        if (iter != httprequestcontext.header.end())
+        {
+            responsecontext += "Connection: " + iter->second + "\r\n";
+        }
+        responsecontext += "Content-Length: 0\r\n\r\n";
+        LOG(LoggerLevel::INFO, "请求范围无效，响应416：%s\n", filePath.c_str());
+        sptcpconn->SendBufferOut();
+        return;
+    }
+    if (HttpRange::RangeResult::RANGE_SATISFIABLE == rangeResult)
+    {
+        std::string &responsecontext = sptcpconn->GetBufferOut();
+        responsecontext += httprequestcontext.version + " 206 Partial Content\r\n";
+        responsecontext += "Server: QiuHai's NetServer/ResourceService\r\n";
+        responsecontext += "Accept-Ranges: bytes\r\n";
+        if (TypeIdentify::isCompressibleType(filetype))
+        {
+            responsecontext += "Vary: Accept-Encoding\r\n";
+        }
+        responsecontext += HttpCache::ValidatorHeaders(HttpCache::MakeETag(entry, ""), entry->lastModified, cacheControl_.GetPolicy(urlPath));
+        if (iter != httprequestcontext.header.end())
+        {
+            responsecontext += "Connection: " + iter->second + "\r\n";
+        }
+        if (!HttpRange::AppendPartial(sptcpconn, entry, ranges, responsecontext))
+        {
+            HttpError(sptcpconn, 500, "Internal Server Error");
+            return;
+        }
+        LOG(LoggerLevel::INFO, "即将发送文件的%d个范围：%s\n", (int)ranges.size(), filePath.c_str());
+        sptcpconn->SendBufferOut();
+        return;
+    }
+    std::shared_ptr<const std::string> responsebody;
+    std::shared_ptr<int> fileFd;
+    if (!encoding.empty())
+    {
+        responsebody = FileCache::GetInstance()->GetBody(entry, encoding);
+    }
+    if (!responsebody)
+    {
+        encoding.clear();
+        // 不常驻缓存的大文件以sendfile发送，不读入内存
+        if (entry->cached)
+            responsebody = FileCache::GetInstance()->GetBody(entry, encoding);
+        else
+            fileFd = TcpConnection::OpenSendFile(filePath);
+    }
+    if (!responsebody && !fileFd)
+    {
+        HttpError(sptcpconn, 500, "Internal Server Error");
+        return;
+    }
+    std::string &responsecontext = sptcpconn->GetBufferOut(); // 存储响应头+响应内容
     responsecontext += httprequestcontext.version + " 200 OK\r\n";
     responsecontext += "Server: QiuHai's NetServer/ResourceService\r\n";
     responsecontext += "Content-Type: " + filetype + "; charset=utf-8\r\n";
+    if (TypeIdentify::isCompressibleType(filetype))
+    {
+        responsecontext += "Vary: Accept-Encoding\r\n";
+    }
+    if (!encoding.empty())
+    {
+        responsecontext += "Content-Encoding: " + encoding + "\r\n";
+    }
+    responsecontext += "Accept-Ranges: bytes\r\n";
+    responsecontext += validators;
     // keepalive判断处理，包含Connection字段
-    std::map<std::string, std::string>::const_iterator iter = httprequestcontext.header.find("Connection");
     if (iter != httprequestcontext.header.end())
     {
         responsecontext += "Connection: " + iter->second + "\r\n";
     }
-    // responsecontext += "Content-Length: " + std::to_string(getFileSize(filePath.data())) + "\r\n\r\n";
-    responsecontext += "Content-Length: " + std::to_string(responsebody.length()) + "\r\n\r\n";
-    responsecontext.append(responsebody, 0, responsebody.length());
+    responsecontext += "Content-Length: " + std::to_string(responsebody ? (off_t)responsebody->length() : entry->size) + "\r\n\r\n";
+    if (responsebody)
+        responsecontext.append(*responsebody);
+    else
+        sptcpconn->AddSendFile(fileFd, 0, entry->size);
     LOG(LoggerLevel::INFO, "即将发送文件：%s，文件类型：%s\n", filePath, filetype);
     sptcpconn->SendBufferOut();
 }
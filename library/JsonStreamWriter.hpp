@@ -0,0 +1,312 @@
+// JsonStreamWriter类：
+//  流式Json序列化工具类，以Object/Array/Key/Value逐个写入元素，直接追加到目标字符串（如TcpConnection的bufferOut_）
+//  无需构造Json::Value树，也不产生中间文档字符串；整数以两位一组查表格式化，浮点数以std::to_chars生成最短往返表示
+//  BeginContentLength/EndContentLength为HTTP响应预留定长Content-Length并在响应体写完后回填，避免响应体的二次拷贝
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <type_traits>
+
+#define JSON_STREAM_MAX_DEPTH 64    // 允许的最大嵌套层数
+#define JSON_STREAM_LENGTH_WIDTH 20 // Content-Length占位宽度，足以容纳任意size_t
+
+class JsonStreamWriter
+{
+public:
+    explicit JsonStreamWriter(std::string &out);
+    JsonStreamWriter &Object();                               // 开始对象
+    JsonStreamWriter &EndObject();                            // 结束对象
+    JsonStreamWriter &Array();                                // 开始数组
+    JsonStreamWriter &EndArray();                             // 结束数组
+    JsonStreamWriter &Key(const char *key, size_t length);    // 写入对象成员名
+    JsonStreamWriter &Key(const char *key);
+    JsonStreamWriter &Key(const std::string &key);
+    JsonStreamWriter &Value(const char *value, size_t length); // 写入字符串值
+    JsonStreamWriter &Value(const char *value);
+    JsonStreamWriter &Value(const std::string &value);
+    JsonStreamWriter &Value(bool value);
+    JsonStreamWriter &Value(double value);
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value, JsonStreamWriter &>::type Value(T value); // 写入整数值
+    JsonStreamWriter &Null();                                 // 写入null
+    bool Complete() const;                                    // 顶层值已写完且括号均已闭合
+    static size_t BeginContentLength(std::string &out);       // 写入定长Content-Length占位及头部结束符，返回占位位置
+    static void EndContentLength(std::string &out, size_t pos); // 以占位之后的响应体长度回填Content-Length
+
+private:
+    std::string &out_;
+    int depth_;                             // 当前嵌套层数
+    bool hasElement_[JSON_STREAM_MAX_DEPTH]; // 各层是否已写入元素，用于决定是否写入逗号
+    bool afterKey_;                         // 刚写入成员名，下一个值无需逗号
+    bool started_;                          // 是否已写入顶层值
+    static const char digitPairs_[201];     // 00~99的两位数字表
+    static const char escapeTable_[256];    // 字符的转义方式：0不转义，'u'为\u00XX，其余为\后的字符
+    void Prefix();                          // 写入值之前的逗号
+    void WriteString(const char *data, size_t length); // 写入带引号并转义的字符串
+    static char *FormatUnsigned(uint64_t value, char *end); // 从end向前写入无符号整数，返回起始位置
+};
+
+const char JsonStreamWriter::digitPairs_[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+const char JsonStreamWriter::escapeTable_[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 'u'};
+
+JsonStreamWriter::JsonStreamWriter(std::string &out)
+    : out_(out),
+      depth_(0),
+      afterKey_(false),
+      started_(false)
+{
+    hasElement_[0] = false;
+}
+
+/*
+ * 写入值之前的逗号，成员名之后的值与容器的首个元素不写逗号
+ *
+ */
+void JsonStreamWriter::Prefix()
+{
+    if (afterKey_)
+    {
+        afterKey_ = false;
+        return;
+    }
+    if (depth_ > 0)
+    {
+        if (hasElement_[depth_])
+            out_.push_back(',');
+        hasElement_[depth_] = true;
+    }
+    started_ = true;
+}
+
+JsonStreamWriter &JsonStreamWriter::Object()
+{
+    Prefix();
+    out_.push_back('{');
+    if (depth_ + 1 < JSON_STREAM_MAX_DEPTH)
+        hasElement_[++depth_] = false;
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::EndObject()
+{
+    out_.push_back('}');
+    if (depth_ > 0)
+        --depth_;
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Array()
+{
+    Prefix();
+    out_.push_back('[');
+    if (depth_ + 1 < JSON_STREAM_MAX_DEPTH)
+        hasElement_[++depth_] = false;
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::EndArray()
+{
+    out_.push_back(']');
+    if (depth_ > 0)
+        --depth_;
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Key(const char *key, size_t length)
+{
+    Prefix();
+    WriteString(key, length);
+    out_.push_back(':');
+    afterKey_ = true;
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Key(const char *key)
+{
+    return Key(key, strlen(key));
+}
+
+JsonStreamWriter &JsonStreamWriter::Key(const std::string &key)
+{
+    return Key(key.data(), key.size());
+}
+
+JsonStreamWriter &JsonStreamWriter::Value(const char *value, size_t length)
+{
+    Prefix();
+    WriteString(value, length);
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Value(const char *value)
+{
+    return Value(value, strlen(value));
+}
+
+JsonStreamWriter &JsonStreamWriter::Value(const std::string &value)
+{
+    return Value(value.data(), value.size());
+}
+
+JsonStreamWriter &JsonStreamWriter::Value(bool value)
+{
+    Prefix();
+    if (value)
+        out_.append("true", 4);
+    else
+        out_.append("false", 5);
+    return *this;
+}
+
+/*
+ * 写入浮点数，std::to_chars输出最短的可往返表示，整数值补".0"以保留类型
+ * Json不支持NaN与无穷大，以null代替
+ *
+ */
+JsonStreamWriter &JsonStreamWriter::Value(double value)
+{
+    if (value != value || value - value != 0)
+        return Null();
+    Prefix();
+    char buffer[32];
+    char *end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+    if (!memchr(buffer, '.', end - buffer) && !memchr(buffer, 'e', end - buffer))
+    {
+        *end++ = '.';
+        *end++ = '0';
+    }
+    out_.append(buffer, end - buffer);
+    return *this;
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, JsonStreamWriter &>::type JsonStreamWriter::Value(T value)
+{
+    if (std::is_same<T, bool>::value)
+        return Value(static_cast<bool>(value));
+    Prefix();
+    char buffer[24];
+    char *end = buffer + sizeof(buffer);
+    char *begin;
+    if (std::is_signed<T>::value && value < 0)
+    {
+        // 取反前先转为无符号，避免最小值溢出
+        begin = FormatUnsigned(0 - static_cast<uint64_t>(value), end);
+        *--begin = '-';
+    }
+    else
+    {
+        begin = FormatUnsigned(static_cast<uint64_t>(value), end);
+    }
+    out_.append(begin, end - begin);
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Null()
+{
+    Prefix();
+    out_.append("null", 4);
+    return *this;
+}
+
+bool JsonStreamWriter::Complete() const
+{
+    return started_ && 0 == depth_ && !afterKey_;
+}
+
+/*
+ * 从end向前以两位一组写入无符号整数
+ *
+ */
+char *JsonStreamWriter::FormatUnsigned(uint64_t value, char *end)
+{
+    while (value >= 100)
+    {
+        unsigned index = static_cast<unsigned>(value % 100) * 2;
+        value /= 100;
+        *--end = digitPairs_[index + 1];
+        *--end = digitPairs_[index];
+    }
+    if (value >= 10)
+    {
+        unsigned index = static_cast<unsigned>(value) * 2;
+        *--end = digitPairs_[index + 1];
+        *--end = digitPairs_[index];
+    }
+    else
+    {
+        *--end = static_cast<char>('0' + value);
+    }
+    return end;
+}
+
+/*
+ * 写入带引号的字符串，无需转义的连续片段整段追加，UTF-8多字节字符原样写入
+ *
+ */
+void JsonStreamWriter::WriteString(const char *data, size_t length)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    out_.push_back('"');
+    const char *run = data;
+    const char *end = data + length;
+    for (const char *p = data; p != end; ++p)
+    {
+        unsigned char c = static_cast<unsigned char>(*p);
+        char escape = c < 128 ? escapeTable_[c] : 0;
+        if (!escape)
+            continue;
+        out_.append(run, p - run);
+        run = p + 1;
+        char sequence[6] = {'\\', escape, '0', '0', hexDigits[c >> 4], hexDigits[c & 0xF]};
+        out_.append(sequence, 'u' == escape ? 6 : 2);
+    }
+    out_.append(run, end - run);
+    out_.push_back('"');
+}
+
+/*
+ * 写入定长的Content-Length占位及头部结束符，响应体随后直接追加到out
+ * 占位以空格填充，回填时数字右对齐，前导空格属于头部值前的可选空白
+ *
+ */
+size_t JsonStreamWriter::BeginContentLength(std::string &out)
+{
+    out.append("Content-Length: ");
+    size_t pos = out.size();
+    out.append(JSON_STREAM_LENGTH_WIDTH, ' ');
+    out.append("\r\n\r\n");
+    return pos;
+}
+
+void JsonStreamWriter::EndContentLength(std::string &out, size_t pos)
+{
+    size_t bodyLength = out.size() - (pos + JSON_STREAM_LENGTH_WIDTH + 4);
+    char buffer[24];
+    char *end = buffer + sizeof(buffer);
+    char *begin = FormatUnsigned(bodyLength, end);
+    out.replace(pos + JSON_STREAM_LENGTH_WIDTH - (end - begin), end - begin, begin, end - begin);
+}
@@ -8,6 +8,7 @@
 #include <string.h>
 #include <stdarg.h>
 
+#include <atomic>
 #include <iostream>
 #include <queue>
 #include <map>
@@ -29,12 +30,19 @@ class Logger;
         Logger::GetInstance()->Init(logdir);      \
     } while (0)
 
-// 仿函数，日志写入
+// 仿函数，日志写入；定义LOG_DISABLE时不输出日志，用于压测工具等对日志开销敏感的程序
+#ifdef LOG_DISABLE
+#define LOG(level, fmt, ...) \
+    do                       \
+    {                        \
+    } while (0)
+#else
 #define LOG(level, fmt, ...)                                                                          \
     do                                                                                                \
     {                                                                                                 \
         Logger::GetInstance()->Append(level, __FILE__, __LINE__, __FUNCTION__, fmt, __VA_ARGS__);     \
     } while (0)
+#endif
 
 // 日志类型
 enum LoggerLevel
@@ -131,6 +139,7 @@ private:
     std::queue<LogBuffer *> freebufqueue;  // FREE队列，不在写入文件状态的缓冲区队列
     std::thread flushthread; // 工作线程
     bool start;           // 工作线程状态，init后置为true，若再置为false则工作线程停止运行
+    std::atomic<int> level_; // 最低记录级别，低于该级别的日志直接丢弃
     char save_ymdhms[64]; // save_ymdhms数组，保存年月日时分秒以便复用
     // std::hash<std::thread::id> tid_hash;
 
@@ -144,6 +153,8 @@ public:
         return &logger;
     }
     void Append(int level, const char *file, int line, const char *func, const char *fmt, ...); // 写日志__FILE__, __LINE__, __func__,
+    void SetLevel(int level) { level_.store(level, std::memory_order_relaxed); }                // 设置最低记录级别，可在运行中调整
+    int GetLevel() const { return level_.load(std::memory_order_relaxed); }
     void Flush();                                                                               // 写入数据到文件，线程回调函数
 };
 
@@ -154,7 +165,8 @@ public:
 Logger::Logger(/* args */) : fp(nullptr),
                             //  currentlogbuffer(nullptr),
                              buftotalnum(0),
-                             start(false)
+                             start(false),
+                             level_(DEBUG)
 {
 }
 
@@ -231,6 +243,8 @@ void Logger::Init(const char *logdir)
 void Logger::Append(int level, const char *file, int line, const char *func, const char *fmt, ...)
 {    
     // std::cout << "Logger::Append 函数触发" << std::endl;
+    if (level < level_.load(std::memory_order_relaxed))
+        return;
     char logline[LOGLINESIZE]; // 单行日志内容
     struct timeval tv;
     gettimeofday(&tv, NULL);
@@ -0,0 +1,371 @@
+// Metrics类：
+//  进程内的运行指标，计数器与延迟直方图按线程分片，每个分片独占缓存行，记录时只对本线程分片做relaxed原子加，不加锁
+//  直方图采用HDR式的对数线性分桶：每个2的幂区间再均分为16个子桶，相对误差不超过1/16，覆盖1ns到约68s
+//  读取时汇总所有分片，ExportPrometheus输出Prometheus文本格式，由TcpServer的内置服务在/metrics上提供
+//  指标按名称与标签注册一次，返回的指针在进程内一直有效，热路径上应缓存指针而不是每次按名称查找
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+#define METRICS_SHARDS 16           // 分片数量，线程按启动顺序轮流分配到各分片
+#define METRICS_SUB_BUCKET_BITS 4   // 每个2的幂区间的子桶数量为2^4
+#define METRICS_MAX_EXPONENT 36     // 直方图记录的最大值为2^36-1，更大的值计入最后一个桶
+#define METRICS_BUCKETS ((METRICS_MAX_EXPONENT - METRICS_SUB_BUCKET_BITS + 1) << METRICS_SUB_BUCKET_BITS)
+
+// 当前线程的分片索引
+inline int MetricsShard()
+{
+    static std::atomic<int> nextShard(0);
+    static thread_local int shard = nextShard.fetch_add(1, std::memory_order_relaxed) % METRICS_SHARDS;
+    return shard;
+}
+
+// 按线程分片的计数器，Add可传入负数用作当前值（如活动连接数）
+class MetricsCounter
+{
+public:
+    MetricsCounter();
+    void Add(int64_t value = 1) { cells_[MetricsShard()].value.fetch_add(value, std::memory_order_relaxed); }
+    int64_t Value() const; // 汇总所有分片
+
+private:
+    struct alignas(64) Cell
+    {
+        std::atomic<int64_t> value;
+    };
+    Cell cells_[METRICS_SHARDS];
+};
+
+MetricsCounter::MetricsCounter()
+{
+    for (int i = 0; i < METRICS_SHARDS; ++i)
+        cells_[i].value.store(0, std::memory_order_relaxed);
+}
+
+int64_t MetricsCounter::Value() const
+{
+    int64_t sum = 0;
+    for (int i = 0; i < METRICS_SHARDS; ++i)
+        sum += cells_[i].value.load(std::memory_order_relaxed);
+    return sum;
+}
+
+// 按线程分片的对数线性直方图，记录非负整数值（延迟以纳秒记录）
+class MetricsHistogram
+{
+public:
+    // bounds为导出时的累计桶上界（原始单位），unit为导出时的单位换算系数，如纳秒换算为秒为1e-9
+    MetricsHistogram(const std::vector<uint64_t> &bounds, double unit);
+    void Record(uint64_t value);
+    uint64_t Count() const;
+    uint64_t Sum() const;
+    uint64_t Percentile(double percentile) const; // 返回百分位所在桶的上界，percentile取值0~100
+    void Snapshot(std::vector<uint64_t> &buckets, uint64_t &count, uint64_t &sum) const; // 汇总所有分片的各桶计数
+    const std::vector<uint64_t> &Bounds() const { return bounds_; }
+    double Unit() const { return unit_; }
+    static int BucketIndex(uint64_t value);   // 值所在的桶
+    static uint64_t BucketUpper(int index);   // 桶内的最大值
+    static const std::vector<uint64_t> &LatencyBounds(); // 1us~10s的1-2.5-5序列，单位纳秒
+    static const std::vector<uint64_t> &DepthBounds();   // 1~4096的2的幂序列，用于队列深度等计数
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> buckets[METRICS_BUCKETS];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+    };
+    std::unique_ptr<Shard[]> shards_;
+    std::vector<uint64_t> bounds_;
+    double unit_;
+};
+
+MetricsHistogram::MetricsHistogram(const std::vector<uint64_t> &bounds, double unit)
+    : shards_(new Shard[METRICS_SHARDS]),
+      bounds_(bounds),
+      unit_(unit)
+{
+    for (int i = 0; i < METRICS_SHARDS; ++i)
+    {
+        for (int j = 0; j < METRICS_BUCKETS; ++j)
+            shards_[i].buckets[j].store(0, std::memory_order_relaxed);
+        shards_[i].count.store(0, std::memory_order_relaxed);
+        shards_[i].sum.store(0, std::memory_order_relaxed);
+    }
+}
+
+/*
+ * 小于16的值每个值一个桶，之后每个2的幂区间[2^k, 2^(k+1))按最高位之后的4位均分为16个桶
+ *
+ */
+int MetricsHistogram::BucketIndex(uint64_t value)
+{
+    if (value < (1u << METRICS_SUB_BUCKET_BITS))
+        return (int)value;
+    int exponent = 63 - __builtin_clzll(value) - METRICS_SUB_BUCKET_BITS;
+    int index = (exponent << METRICS_SUB_BUCKET_BITS) + (int)(value >> exponent);
+    return index < METRICS_BUCKETS ? index : METRICS_BUCKETS - 1;
+}
+
+uint64_t MetricsHistogram::BucketUpper(int index)
+{
+    if (index < (2 << METRICS_SUB_BUCKET_BITS))
+        return index;
+    int exponent = (index >> METRICS_SUB_BUCKET_BITS) - 1;
+    uint64_t mantissa = (index & ((1 << METRICS_SUB_BUCKET_BITS) - 1)) + (1 << METRICS_SUB_BUCKET_BITS);
+    return ((mantissa + 1) << exponent) - 1;
+}
+
+void MetricsHistogram::Record(uint64_t value)
+{
+    Shard &shard = shards_[MetricsShard()];
+    shard.buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t MetricsHistogram::Count() const
+{
+    uint64_t count = 0;
+    for (int i = 0; i < METRICS_SHARDS; ++i)
+        count += shards_[i].count.load(std::memory_order_relaxed);
+    return count;
+}
+
+uint64_t MetricsHistogram::Sum() const
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < METRICS_SHARDS; ++i)
+        sum += shards_[i].sum.load(std::memory_order_relaxed);
+    return sum;
+}
+
+void MetricsHistogram::Snapshot(std::vector<uint64_t> &buckets, uint64_t &count, uint64_t &sum) const
+{
+    buckets.assign(METRICS_BUCKETS, 0);
+    count = 0;
+    sum = 0;
+    for (int i = 0; i < METRICS_SHARDS; ++i)
+    {
+        for (int j = 0; j < METRICS_BUCKETS; ++j)
+            buckets[j] += shards_[i].buckets[j].load(std::memory_order_relaxed);
+        sum += shards_[i].sum.load(std::memory_order_relaxed);
+    }
+    // count以各桶之和为准，避免与并发写入的桶计数不一致
+    for (int j = 0; j < METRICS_BUCKETS; ++j)
+        count += buckets[j];
+}
+
+uint64_t MetricsHistogram::Percentile(double percentile) const
+{
+    std::vector<uint64_t> buckets;
+    uint64_t count, sum;
+    Snapshot(buckets, count, sum);
+    if (0 == count)
+        return 0;
+    uint64_t rank = (uint64_t)(percentile / 100.0 * count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int j = 0; j < METRICS_BUCKETS; ++j)
+    {
+        seen += buckets[j];
+        if (seen >= rank)
+            return BucketUpper(j);
+    }
+    return BucketUpper(METRICS_BUCKETS - 1);
+}
+
+const std::vector<uint64_t> &MetricsHistogram::LatencyBounds()
+{
+    static const std::vector<uint64_t> bounds = {
+        1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+        1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000, 250000000, 500000000,
+        1000000000, 2500000000, 5000000000, 10000000000};
+    return bounds;
+}
+
+const std::vector<uint64_t> &MetricsHistogram::DepthBounds()
+{
+    static const std::vector<uint64_t> bounds = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+    return bounds;
+}
+
+class Metrics
+{
+public:
+    // 框架内置的指标，首次调用时注册
+    struct ServerMetrics
+    {
+        MetricsCounter *accepts;           // 接受的连接数
+        MetricsCounter *activeConnections; // 当前连接数
+        MetricsCounter *bytesIn;           // 接收字节数
+        MetricsCounter *bytesOut;          // 发送字节数
+        MetricsCounter *parseErrors;       // 请求解析失败次数，包括HTTP/1.1、HTTP/2与编解码器
+        MetricsCounter *readRequeues;      // 读预算用尽、连接排入就绪列表下一轮再读的次数
+        MetricsCounter *outputPauses;      // 连接输出队列越过高水位、暂停读取的次数
+        MetricsCounter *outputOverflows;   // 输出队列超过硬上限而关闭的连接数
+        MetricsCounter *ioSyscalls;        // 接受连接与连接读写的系统调用次数（accept、getpeername、fcntl、read、send、sendfile），不含Poller自身
+        MetricsHistogram *queueWait;       // 任务在ThreadPool队列中的等待时间
+        MetricsHistogram *loopTasks;       // EventLoop每次执行时functorList_内的任务数
+    };
+    static Metrics *GetInstance();
+    static ServerMetrics &Server();
+    static int64_t NowNs(); // 单调时钟，纳秒
+    // 按名称与标签注册或获取指标，labels为Prometheus标签体，如service="HttpService"
+    MetricsCounter *Counter(const std::string &name, const std::string &help, const std::string &labels = "", bool gauge = false);
+    MetricsHistogram *Histogram(const std::string &name, const std::string &help, const std::string &labels = "",
+                                const std::vector<uint64_t> &bounds = MetricsHistogram::LatencyBounds(), double unit = 1e-9);
+    void ExportPrometheus(std::string &out); // 输出Prometheus文本格式
+
+private:
+    struct Family
+    {
+        std::string help;
+        std::string type; // counter、gauge或histogram
+        std::map<std::string, std::unique_ptr<MetricsCounter>> counters;
+        std::map<std::string, std::unique_ptr<MetricsHistogram>> histograms;
+    };
+    std::mutex mutex_;
+    std::map<std::string, Family> families_;
+    Metrics() {}
+    Family &GetFamily(const std::string &name, const std::string &help, const char *type);
+    static void AppendSample(std::string &out, const std::string &name, const std::string &labels, const char *value);
+};
+
+Metrics *Metrics::GetInstance()
+{
+    static Metrics metrics;
+    return &metrics;
+}
+
+Metrics::ServerMetrics &Metrics::Server()
+{
+    static ServerMetrics server = []()
+    {
+        Metrics *metrics = GetInstance();
+        ServerMetrics s;
+        s.accepts = metrics->Counter("netserver_accepted_connections_total", "Accepted TCP connections.");
+        s.activeConnections = metrics->Counter("netserver_active_connections", "Currently open TCP connections.", "", true);
+        s.bytesIn = metrics->Counter("netserver_received_bytes_total", "Bytes read from client connections.");
+        s.bytesOut = metrics->Counter("netserver_sent_bytes_total", "Bytes written to sockets by connections.");
+        s.parseErrors = metrics->Counter("netserver_parse_errors_total", "Requests or frames that failed to parse.");
+        s.readRequeues = metrics->Counter("netserver_read_budget_requeues_total", "Reads stopped at the per-event budget and resumed on a later loop iteration.");
+        s.outputPauses = metrics->Counter("netserver_output_high_watermark_total", "Times a connection output queue crossed its high watermark and reading paused.");
+        s.outputOverflows = metrics->Counter("netserver_output_limit_closes_total", "Connections closed because their output queue exceeded the hard limit.");
+        s.ioSyscalls = metrics->Counter("netserver_io_syscalls_total", "System calls made outside the event poller to accept connections and read or write them.");
+        s.queueWait = metrics->Histogram("netserver_threadpool_queue_wait_seconds", "Time tasks wait in the ThreadPool queue.");
+        s.loopTasks = metrics->Histogram("netserver_eventloop_pending_tasks", "Queued functors executed per EventLoop iteration.", "",
+                                         MetricsHistogram::DepthBounds(), 1);
+        return s;
+    }();
+    return server;
+}
+
+int64_t Metrics::NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Metrics::Family &Metrics::GetFamily(const std::string &name, const std::string &help, const char *type)
+{
+    Family &family = families_[name];
+    if (family.type.empty())
+    {
+        family.help = help;
+        family.type = type;
+    }
+    return family;
+}
+
+MetricsCounter *Metrics::Counter(const std::string &name, const std::string &help, const std::string &labels, bool gauge)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_ptr<MetricsCounter> &counter = GetFamily(name, help, gauge ? "gauge" : "counter").counters[labels];
+    if (!counter)
+        counter.reset(new MetricsCounter());
+    return counter.get();
+}
+
+MetricsHistogram *Metrics::Histogram(const std::string &name, const std::string &help, const std::string &labels,
+                                     const std::vector<uint64_t> &bounds, double unit)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_ptr<MetricsHistogram> &histogram = GetFamily(name, help, "histogram").histograms[labels];
+    if (!histogram)
+        histogram.reset(new MetricsHistogram(bounds, unit));
+    return histogram.get();
+}
+
+void Metrics::AppendSample(std::string &out, const std::string &name, const std::string &labels, const char *value)
+{
+    out += name;
+    if (!labels.empty())
+    {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+/*
+ * 输出Prometheus文本格式
+ * 直方图的累计桶由细分桶汇总，只计入上界不超过le的细分桶，跨越le的细分桶计入下一个le
+ *
+ */
+void Metrics::ExportPrometheus(std::string &out)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    char value[64];
+    std::vector<uint64_t> buckets;
+    for (std::map<std::string, Family>::iterator family = families_.begin(); family != families_.end(); ++family)
+    {
+        const std::string &name = family->first;
+        out += "# HELP " + name + " " + family->second.help + "\n";
+        out += "# TYPE " + name + " " + family->second.type + "\n";
+        for (std::map<std::string, std::unique_ptr<MetricsCounter>>::iterator counter = family->second.counters.begin();
+             counter != family->second.counters.end(); ++counter)
+        {
+            snprintf(value, sizeof(value), "%lld", (long long)counter->second->Value());
+            AppendSample(out, name, counter->first, value);
+        }
+        for (std::map<std::string, std::unique_ptr<MetricsHistogram>>::iterator histogram = family->second.histograms.begin();
+             histogram != family->second.histograms.end(); ++histogram)
+        {
+            uint64_t count, sum;
+            histogram->second->Snapshot(buckets, count, sum);
+            const std::string &labels = histogram->first;
+            std::string prefix = labels.empty() ? "le=\"" : labels + ",le=\"";
+            const std::vector<uint64_t> &bounds = histogram->second->Bounds();
+            double unit = histogram->second->Unit();
+            uint64_t cumulative = 0;
+            int index = 0;
+            for (size_t i = 0; i < bounds.size(); ++i)
+            {
+                while (index < METRICS_BUCKETS && MetricsHistogram::BucketUpper(index) <= bounds[i])
+                    cumulative += buckets[index++];
+                snprintf(value, sizeof(value), "%g", bounds[i] * unit);
+                snprintf(value + 32, sizeof(value) - 32, "%llu", (unsigned long long)cumulative);
+                AppendSample(out, name + "_bucket", prefix + value + "\"", value + 32);
+            }
+            snprintf(value, sizeof(value), "%llu", (unsigned long long)count);
+            AppendSample(out, name + "_bucket", prefix + "+Inf\"", value);
+            snprintf(value, sizeof(value), "%.9g", sum * unit);
+            AppendSample(out, name + "_sum", labels, value);
+            snprintf(value, sizeof(value), "%llu", (unsigned long long)count);
+            AppendSample(out, name + "_count", labels, value);
+        }
+    }
+}
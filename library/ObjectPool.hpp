@@ -0,0 +1,173 @@
+// SlabPool类与PoolAllocator类：
+//  按块大小划分的slab内存池，用于频繁创建销毁的连接对象，连接建立与关闭不再经过malloc
+//  每个线程每种块大小各有一个池，TcpServer在accept所在的loop线程分配连接，因此连接实际来自主loop线程的池
+//  slab为SLAB_SIZE字节、按SLAB_SIZE对齐的大块内存，头部记录所属的池，块按缓存行对齐，释放时由地址找到slab与所属的池
+//  所属线程释放的块直接放回本地空闲链表，其他线程（最后一个引用在工作线程或其他loop线程释放）释放的块无锁压入远端链表，
+//  所属线程本地链表用尽时一次取回远端链表，仍为空才分配新的slab
+//  slab在进程内常驻不归还系统，内存占用取决于并发连接数的峰值；线程退出时池不析构，其他线程仍可归还块
+//  PoolAllocator满足标准分配器要求，std::allocate_shared以之分配时shared_ptr控制块与对象位于同一个块内
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include "Metrics.hpp"
+
+#define SLAB_SIZE (256 * 1024) // slab字节数，同时是slab的对齐值
+#define POOL_ALIGN 64          // 块对齐，缓存行大小
+
+class SlabPool
+{
+public:
+    // 当前线程块大小为size的池，size为对齐后的块大小
+    template <size_t size>
+    static SlabPool *Local()
+    {
+        static thread_local SlabPool *pool = new SlabPool(size);
+        return pool;
+    }
+    void *Allocate();             // 取出一个空闲块，在所属线程调用
+    static void Free(void *block); // 归还块到所属的池，可在任意线程调用
+
+private:
+    // 空闲块复用块首部存放下一个空闲块
+    typedef struct _FreeBlock
+    {
+        struct _FreeBlock *next;
+    } FreeBlock;
+    // slab头部，占用slab的第一个缓存行
+    typedef struct _SlabHeader
+    {
+        SlabPool *owner;
+    } SlabHeader;
+
+    explicit SlabPool(size_t blockSize);
+    void Refill(); // 本地空闲链表用尽时取回远端链表或分配新的slab
+    bool IsOwner() const { return owner_ == Self(); }
+    static const void *Self(); // 区分线程的地址
+
+    size_t blockSize_;                  // 块大小
+    const void *owner_;                 // 所属线程
+    FreeBlock *localFree_;              // 本地空闲链表，仅所属线程访问
+    std::atomic<FreeBlock *> remoteFree_; // 其他线程归还的块
+    MetricsCounter *slabs_;             // 已分配的slab数
+    MetricsCounter *blocks_;            // 使用中的块数
+};
+
+SlabPool::SlabPool(size_t blockSize)
+    : blockSize_(blockSize),
+      owner_(Self()),
+      localFree_(nullptr),
+      remoteFree_(nullptr),
+      slabs_(Metrics::GetInstance()->Counter("netserver_pool_slabs_total", "Slabs allocated by the connection object pools.",
+                                             "block=\"" + std::to_string(blockSize) + "\"")),
+      blocks_(Metrics::GetInstance()->Counter("netserver_pool_blocks", "Object pool blocks in use.",
+                                              "block=\"" + std::to_string(blockSize) + "\"", true))
+{
+}
+
+const void *SlabPool::Self()
+{
+    static thread_local char self;
+    return &self;
+}
+
+/*
+ * 取出一个空闲块
+ * 只在创建池的线程调用，Local保证了这一点
+ *
+ */
+void *SlabPool::Allocate()
+{
+    if (!localFree_)
+        Refill();
+    FreeBlock *block = localFree_;
+    localFree_ = block->next;
+    blocks_->Add(1);
+    return block;
+}
+
+/*
+ * 归还块到所属的池
+ * 由块地址向下取整到SLAB_SIZE得到slab头部，所属线程直接放回本地链表，其他线程以CAS压入远端链表
+ *
+ */
+void SlabPool::Free(void *ptr)
+{
+    SlabHeader *slab = reinterpret_cast<SlabHeader *>(reinterpret_cast<uintptr_t>(ptr) & ~(uintptr_t)(SLAB_SIZE - 1));
+    SlabPool *pool = slab->owner;
+    FreeBlock *block = static_cast<FreeBlock *>(ptr);
+    pool->blocks_->Add(-1);
+    if (pool->IsOwner())
+    {
+        block->next = pool->localFree_;
+        pool->localFree_ = block;
+        return;
+    }
+    FreeBlock *head = pool->remoteFree_.load(std::memory_order_relaxed);
+    do
+    {
+        block->next = head;
+    } while (!pool->remoteFree_.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+/*
+ * 本地空闲链表用尽，先一次取走远端链表的全部块，仍为空时分配新的slab并切分为块
+ * 远端链表只整体取走，不存在单个弹出的ABA问题
+ *
+ */
+void SlabPool::Refill()
+{
+    localFree_ = remoteFree_.exchange(nullptr, std::memory_order_acquire);
+    if (localFree_)
+        return;
+    char *slab = static_cast<char *>(aligned_alloc(SLAB_SIZE, SLAB_SIZE));
+    if (!slab)
+        throw std::bad_alloc();
+    slabs_->Add();
+    reinterpret_cast<SlabHeader *>(slab)->owner = this;
+    // 第一个缓存行留给slab头部，从后向前压入，分配时按地址递增取出
+    size_t count = (SLAB_SIZE - POOL_ALIGN) / blockSize_;
+    for (size_t i = count; i > 0; --i)
+    {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(slab + POOL_ALIGN + (i - 1) * blockSize_);
+        block->next = localFree_;
+        localFree_ = block;
+    }
+}
+
+template <typename T>
+class PoolAllocator
+{
+public:
+    typedef T value_type;
+    PoolAllocator() noexcept {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+    // 块大小为sizeof(T)按缓存行向上取整，超过slab四分之一的对象与数组直接使用operator new
+    static constexpr size_t BLOCK_BYTES = (sizeof(T) + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN;
+    static constexpr bool IN_POOL = BLOCK_BYTES <= SLAB_SIZE / 4 && alignof(T) <= POOL_ALIGN;
+
+    T *allocate(size_t n)
+    {
+        if (IN_POOL && 1 == n)
+            return static_cast<T *>(SlabPool::Local<BLOCK_BYTES>()->Allocate());
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T *p, size_t n) noexcept
+    {
+        if (IN_POOL && 1 == n)
+            SlabPool::Free(p);
+        else
+            ::operator delete(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &) noexcept { return true; }
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &) noexcept { return false; }
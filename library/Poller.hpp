@@ -1,5 +1,10 @@
-
-// Poller类，对epoll的封装
+// Poller类，事件多路复用的抽象接口
+//  EpollPoller为对epoll的封装，UringPoller为基于io_uring多次触发poll与accept/recv的实现，见UringPoller.hpp
+//  Channel的events_与返回的事件均沿用epoll的事件位；请求了完成模式的Channel在io_uring下由Poller代为accept/recv（见Channel.hpp），
+//  其所有者同时支持两种方式，对EventLoop透明
+//  EventLoop创建时由Poller::Create选择实现：环境变量NETSERVER_POLLER=io_uring时使用io_uring，内核不支持时回退到epoll
+//  每次epoll_wait/epoll_ctl或io_uring_enter计入netserver_poller_syscalls_total，接受连接与连接读写自行发起的系统调用
+//  计入netserver_io_syscalls_total，用于对比两种实现的系统调用次数
 
 #pragma once
 
@@ -7,35 +12,60 @@
 #include <vector>
 #include <mutex>
 #include <map>
+#include <string>
+#include <cstdlib>
 #include <sys/epoll.h>
 #include "Channel.hpp"
 #include "EventLoop.hpp"
-
-#define MAXEVENTNUM 4096 // 最大触发事件数量
-#define TIMEOUT 1000     // epoll_wait 超时时间设置
+#include "Metrics.hpp"
+#include "ServerConfig.hpp"
 
 class Poller
 {
 public:
     typedef std::vector<Channel *> ChannelList;
-    std::vector<struct epoll_event> eventList_;
-    Poller();
-    ~Poller();
+    static Poller *Create(); // 按环境变量NETSERVER_POLLER创建Poller实例
+    Poller(const char *backend);
+    virtual ~Poller() {}
     std::mutex mutex_;
-    int pollFd_;                               // epoll监听描述符
-    std::map<int, Channel *> channelMap_;      // 套接字描述符->Channel实例，存储所有连接Channel实例
-    void AddChannel(Channel *pchannel);        // 添加事件，EPOLL_CTL_ADD
-    void RemoveChannel(Channel *pchannel);     // 移除事件，EPOLL_CTL_DEL
-    void UpdateChannel(Channel *pchannel);     // 修改事件，EPOLL_CTL_MOD
-    void poll(ChannelList &activeChannelList); // 获取一批次新事件
+    std::map<int, Channel *> channelMap_;                      // 套接字描述符->Channel实例，存储所有连接Channel实例
+    const char *GetBackend() const { return backend_; }        // 实现名称，epoll或io_uring
+    virtual void AddChannel(Channel *pchannel) = 0;            // 添加事件
+    virtual void RemoveChannel(Channel *pchannel) = 0;         // 移除事件
+    virtual void UpdateChannel(Channel *pchannel) = 0;         // 修改事件
+    virtual void poll(ChannelList &activeChannelList, int timeoutMs) = 0; // 获取一批次新事件，最多等待timeoutMs毫秒
+
+protected:
+    const char *backend_;
+    MetricsCounter *syscalls_; // 本实现的系统调用次数
 
 };
 
-Poller::Poller()
-    : pollFd_(-1),
-      eventList_(MAXEVENTNUM),
-      channelMap_(),
-      mutex_()
+Poller::Poller(const char *backend)
+    : backend_(backend),
+      syscalls_(Metrics::GetInstance()->Counter("netserver_poller_syscalls_total", "System calls made by the event poller.",
+                                                std::string("backend=\"") + backend + "\""))
+{
+}
+
+class EpollPoller : public Poller
+{
+public:
+    std::vector<struct epoll_event> eventList_;
+    EpollPoller();
+    ~EpollPoller();
+    int pollFd_;                                        // epoll监听描述符
+    void AddChannel(Channel *pchannel) override;        // 添加事件，EPOLL_CTL_ADD
+    void RemoveChannel(Channel *pchannel) override;     // 移除事件，EPOLL_CTL_DEL
+    void UpdateChannel(Channel *pchannel) override;     // 修改事件，EPOLL_CTL_MOD
+    void poll(ChannelList &activeChannelList, int timeoutMs) override; // 获取一批次新事件
+
+};
+
+EpollPoller::EpollPoller()
+    : Poller("epoll"),
+      pollFd_(-1),
+      eventList_(ServerConfig::GetInstance()->MaxEvents())
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     pollFd_ = epoll_create(1000); // 从Linux 2.6.8开始，max_size参数将被忽略，但必须大于零
@@ -48,7 +78,7 @@ Poller::Poller()
     }
 }
 
-Poller::~Poller()
+EpollPoller::~EpollPoller()
 {
     LOG(LoggerLevel::INFO, "函数触发，pollFd: %d\n", pollFd_);
     close(pollFd_);
@@ -58,7 +88,7 @@ Poller::~Poller()
  * 向pollFd_添加监听Channel对应的新连接
  *
  */
-void Poller::AddChannel(Channel *pchannel)
+void EpollPoller::AddChannel(Channel *pchannel)
 {
     LOG(LoggerLevel::INFO, "函数触发，pollFd: %d\n", pollFd_);
     struct epoll_event ev;
@@ -70,6 +100,7 @@ void Poller::AddChannel(Channel *pchannel)
         std::lock_guard<std::mutex> lock(mutex_);
         channelMap_[fd] = pchannel;
     }
+    syscalls_->Add();
     if (epoll_ctl(pollFd_, EPOLL_CTL_ADD, fd, &ev) == -1)
     {
         LOG(LoggerLevel::ERROR, "epoll添加监听Channel失败，pollFd: %d\n", pollFd_);
@@ -83,7 +114,7 @@ void Poller::AddChannel(Channel *pchannel)
  * 移除pollFd_里Channel对应的连接的监听
  *
  */
-void Poller::RemoveChannel(Channel *pchannel)
+void EpollPoller::RemoveChannel(Channel *pchannel)
 {
     LOG(LoggerLevel::INFO, "函数触发，pollFd: %d\n", pollFd_);
     int fd = pchannel->GetFd();
@@ -97,6 +128,7 @@ void Poller::RemoveChannel(Channel *pchannel)
         std::lock_guard<std::mutex> lock(mutex_);
         channelMap_.erase(fd);
     }
+    syscalls_->Add();
     // epoll添加客户端连接监听
     if (epoll_ctl(pollFd_, EPOLL_CTL_DEL, fd, &ev) == -1)
     // if (epoll_ctl(pollFd_, EPOLL_CTL_DEL, fd, NULL) == -1)
@@ -112,7 +144,7 @@ void Poller::RemoveChannel(Channel *pchannel)
  * 更新pollFd_里Channel对应监听事件的信息
  *
  */
-void Poller::UpdateChannel(Channel *pchannel)
+void EpollPoller::UpdateChannel(Channel *pchannel)
 {
     LOG(LoggerLevel::INFO, "函数触发，pollFd: %d\n", pollFd_);
     int fd = pchannel->GetFd();
@@ -120,6 +152,7 @@ void Poller::UpdateChannel(Channel *pchannel)
     ev.events = pchannel->GetEvents();
     // ev.data.fd = fd;
     ev.data.ptr = pchannel;
+    syscalls_->Add();
     if (epoll_ctl(pollFd_, EPOLL_CTL_MOD, fd, &ev) == -1)
     {
         LOG(LoggerLevel::INFO, "epoll更新Channel监听事件失败，pollFd: %d\n", pollFd_);
@@ -133,13 +166,15 @@ void Poller::UpdateChannel(Channel *pchannel)
  * 封装epoll_wait函数，获取处于监听状态的已连接客户端的一批次新事件
  * 由事件池一个常驻线程获取新任务时调用
  * 将有连接事件的连接转为Channel结构存入activeChannelList指针内
- * 
+ * EventLoop的就绪列表非空时timeoutMs为0，不阻塞
+ *
  */
-void Poller::poll(ChannelList &activeChannelList)
+void EpollPoller::poll(ChannelList &activeChannelList, int timeoutMs)
 {
     // LOG(LoggerLevel::INFO, "函数触发，pollFd: %d\n", pollFd_);
-    int timeout = TIMEOUT;
+    int timeout = timeoutMs;
     // 监听一批次epoll网络请求
+    syscalls_->Add();
     int nfds = epoll_wait(pollFd_, &*eventList_.begin(), (int)eventList_.capacity(), timeout);
     if (nfds == -1)
     {
@@ -184,3 +219,27 @@ void Poller::poll(ChannelList &activeChannelList)
     }
     eventList_.clear();
 }
+
+#include "UringPoller.hpp"
+
+/*
+ * 按环境变量NETSERVER_POLLER选择实现，未设置或为epoll时使用epoll
+ * 为io_uring时尝试创建UringPoller，NETSERVER_URING_SQPOLL=1时开启内核提交线程，NETSERVER_URING_COMPLETION=0时只使用就绪通知
+ * 内核不支持io_uring或缺少所需特性（如容器内被seccomp禁用）时回退到epoll
+ *
+ */
+Poller *Poller::Create()
+{
+    const char *backend = getenv("NETSERVER_POLLER");
+    if (backend && (std::string(backend) == "io_uring" || std::string(backend) == "uring"))
+    {
+        const char *sqpoll = getenv("NETSERVER_URING_SQPOLL");
+        const char *completion = getenv("NETSERVER_URING_COMPLETION");
+        UringPoller *poller = UringPoller::Create(sqpoll && std::string(sqpoll) == "1", !completion || std::string(completion) != "0");
+        if (poller)
+            return poller;
+        LOG(LoggerLevel::ERROR, "%s\n", "io_uring不可用，回退到epoll");
+        std::cout << "Poller::Create io_uring不可用，回退到epoll" << std::endl;
+    }
+    return new EpollPoller();
+}
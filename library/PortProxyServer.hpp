@@ -20,6 +20,7 @@
 #include "TcpServer.hpp"
 #include "EventLoop.hpp"
 #include "ThreadPool.hpp"
+#include "Codec.hpp"
 #include "TypeIdentify.hpp"
 #include "TcpConnection.hpp"
 
@@ -31,6 +32,9 @@ public:
     ~PortProxyServer();
 	// 存入键值对targetServerName:vector<pair<target_ip, target_port>>、targetServerName:proxyIndex
 	void registerPortProxy(const std::string &targetServerName, const std::string &target_ip, unsigned int target_port);
+	// 切换为原始TCP转发模式，连接不经过http解析，收到的字节流原样转发到targetServerName的地址，适用于任意协议
+	// 需在Start之前调用
+	void SetRawProxy(const std::string &targetServerName);
 	void Start();
 	
 private:
@@ -38,6 +42,8 @@ private:
 	std::map<std::string, std::vector<std::pair<std::string, int>>> targetServices;	// 存储目标服务可用IP:PORT地址
 	// 存储目标服务当前可用IP：PORT，若某服务在targetServices内有不止1个可跳转地址则对应targetSelectIndex负责循环依次调用
 	std::map<std::string, int> targetSelectIndex;
+	std::mutex targetMutex_;			// 目标地址选择锁，工作线程与多个IO线程均会选择目标地址
+	std::string rawTargetName_;			// 原始TCP转发模式的目标服务名，为空时按http请求的服务名转发
     typedef std::shared_ptr<TcpConnection> spTcpConnection;
 	const std::string tcpServerIP_;		// 端口代理服务的本地绑定ip
 	const int tcpServerPort_; 			// 端口代理服务监听端口
@@ -47,6 +53,10 @@ private:
     int  getFileSize(char *file_name);  // 获取文件大小	
 	void HttpError(spTcpConnection &sptcpconn, const std::string &short_msg);
 	void ProxyProcess(spTcpConnection &sptcpconn); // 处理请求并响应，代理两个连接之间进行数据通信函数
+	void RawProxyProcess(spTcpConnection &sptcpconn, const char *data, size_t length); // 原始TCP转发模式处理连接的首段数据
+	bool SelectTarget(const std::string &serviceName, std::string &target_ip, int &target_port); // 轮询选取目标服务地址
+	int ConnectTarget(const std::string &target_ip, int target_port); // 连接目标服务，失败返回-1
+	void Relay(int client_fd, int target_fd); // 在两个连接之间双向转发数据，直至任意一端断开
 	void HandleMessage(spTcpConnection &sptcpconn);
 	void HandleError(spTcpConnection &sptcpconn);
 	void HandleClose(spTcpConnection &sptcpconn);
@@ -86,6 +96,8 @@ void PortProxyServer::Start()
     {    
 		if(tcpServerPort_)
         	threadpool_->Start();
+		// SIGTERM/SIGINT时优雅退出，设置NETSERVER_HANDOFF_PATH时支持热重启，见ServerLifecycle.hpp
+		ServerLifecycle::GetInstance()->Start(&loop);
         loop.loop();
     }
     catch (std::bad_alloc &ba)
@@ -103,7 +115,7 @@ void PortProxyServer::HandleMessage(spTcpConnection &sptcpconn)
 {
     LOG(LoggerLevel::INFO, "函数触发，工作端口：%s:%d\n", tcpServerIP_.data(), tcpServerPort_);
     // 修改定时器参数
-    sptcpconn->GetTimer()->Adjust(5000, Timer::TimerType::TIMER_ONCE, std::bind(&TcpConnection::Shutdown, sptcpconn));
+    sptcpconn->GetTimer()->Adjust(ServerConfig::GetInstance()->IdleTimeoutMs(), Timer::TimerType::TIMER_ONCE);
     sptcpconn->SetAsyncProcessing(false);
     if (false == sptcpconn->GetReqHealthy())
     {
@@ -115,7 +127,7 @@ void PortProxyServer::HandleMessage(spTcpConnection &sptcpconn)
         // 已开启线程池，设置异步处理标志
         sptcpconn->SetAsyncProcessing(true);
         // 线程池在此添加任务并唤醒一工作线程执行之
-        threadpool_->AddTask([&]()
+        threadpool_->AddTask([this, sptcpconn]() mutable
                              {
                                 // 执行动态绑定的处理函数
     							LOG(LoggerLevel::INFO, "工作线程执行sptcpconn的绑定函数，此时sptcpconn->IsDisconnected()：%s，sockfd：%d工作端口：%s:%d\n", sptcpconn->IsDisconnected() ? "true" : "false", sptcpconn->fd(), tcpServerIP_.data(), tcpServerPort_);
@@ -133,7 +145,6 @@ void PortProxyServer::HandleMessage(spTcpConnection &sptcpconn)
                                     {
     									LOG(LoggerLevel::ERROR, "工作线程执行sptcpconn的绑定函数报错：std::bad_function_call，连接绑定函数异常，sockfd：%d工作端口：%s:%d\n", sptcpconn->fd(), tcpServerIP_.data(), tcpServerPort_);
                                         std::cout << "PortProxyServer::HandleMessage 工作线程执行sptcpconn的绑定函数报错：std::bad_function_call，连接绑定函数异常，sockfd：" << sptcpconn->fd() << std::endl;
-                                        sptcpconn->SetAsyncProcessing(false);
                                     }
                                     sptcpconn->SetAsyncProcessing(false);
                                 } });
@@ -166,6 +177,97 @@ void PortProxyServer::registerPortProxy(const std::string &targetServerName, con
 	targetSelectIndex[targetServerName] = targetServices[targetServerName].size();
 }
 
+/*
+ * 切换为原始TCP转发模式
+ * tcpserver_使用RawCodec，连接建立后收到的首段数据即触发转发，之后由工作线程在两个连接之间透传字节流
+ *
+ */
+void PortProxyServer::SetRawProxy(const std::string &targetServerName)
+{
+    LOG(LoggerLevel::INFO, "函数触发，目标服务：%s，工作端口：%s:%d\n", targetServerName.c_str(), tcpServerIP_.data(), tcpServerPort_);
+	rawTargetName_ = targetServerName;
+	tcpserver_->SetCodec(std::make_shared<RawCodec>(),
+						 std::bind(&PortProxyServer::RawProxyProcess, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+						 std::bind(&PortProxyServer::HandleClose, this, std::placeholders::_1));
+}
+
+/*
+ * 原始TCP转发模式处理连接的首段数据，在连接所在loop线程调用
+ * 移除epoll对客户端连接的监听后交给工作线程，工作线程连接目标服务、转发首段数据并双向透传，结束后关闭客户端连接
+ * io_uring的recv完成模式下，移除监听时Poller已接收、尚未交给编解码器的数据随首段数据一并转发
+ *
+ */
+void PortProxyServer::RawProxyProcess(spTcpConnection &sptcpconn, const char *data, size_t length)
+{
+    LOG(LoggerLevel::INFO, "函数触发，sockfd：%d，工作端口：%s:%d\n", sptcpconn->fd(), tcpServerIP_.data(), tcpServerPort_);
+	sptcpconn->GetLoop()->RemoveChannelToPoller(sptcpconn->GetChannel());
+	sptcpconn->SetAsyncProcessing(true);
+	std::shared_ptr<std::string> firstData = std::make_shared<std::string>(data, length);
+	firstData->append(sptcpconn->GetChannel()->Received());
+	sptcpconn->GetChannel()->Received().clear();
+	std::function<void()> task = [this, sptcpconn, firstData]() mutable
+	{
+		std::string target_ip;
+		int target_port;
+		int req_socket = -1;
+		if (SelectTarget(rawTargetName_, target_ip, target_port))
+			req_socket = ConnectTarget(target_ip, target_port);
+		if (-1 != req_socket)
+		{
+			sptcpconn->sendn(req_socket, *firstData);
+			Relay(sptcpconn->fd(), req_socket);
+			close(req_socket);
+		}
+		sptcpconn->SetAsyncProcessing(false);
+		sptcpconn->Shutdown();
+	};
+	if (threadpool_->GetThreadNum() > 0)
+		threadpool_->AddTask(task);
+	else
+		task();
+}
+
+/*
+ * 轮询选取目标服务地址，服务未注册返回false
+ *
+ */
+bool PortProxyServer::SelectTarget(const std::string &serviceName, std::string &target_ip, int &target_port)
+{
+	std::lock_guard<std::mutex> lock(targetMutex_);
+	if(targetSelectIndex.end() == targetSelectIndex.find(serviceName) || targetServices.end() == targetServices.find(serviceName))
+	{
+    	LOG(LoggerLevel::ERROR, "没有reqServiceName=%s，工作端口：%s:%d\n", serviceName.c_str(), tcpServerIP_.data(), tcpServerPort_);
+    	std::cout << "PortProxyServer::SelectTarget 没有reqServiceName=" << serviceName << std::endl;
+		return false;
+	}
+	targetSelectIndex[serviceName] = (targetSelectIndex[serviceName] + 1) % targetServices[serviceName].size();
+	std::tie(target_ip, target_port) = targetServices[serviceName][targetSelectIndex[serviceName]];
+	return true;
+}
+
+/*
+ * 连接目标服务，失败返回-1
+ *
+ */
+int PortProxyServer::ConnectTarget(const std::string &target_ip, int target_port)
+{
+	int req_socket = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in addr_serv;
+	addr_serv.sin_addr.s_addr = inet_addr(target_ip.c_str());
+	addr_serv.sin_family = AF_INET;
+	addr_serv.sin_port = htons(target_port);
+	if (-1 == connect(req_socket, (sockaddr *)&addr_serv, sizeof(sockaddr)))
+	{
+    	LOG(LoggerLevel::ERROR, "获取代理服务连接失败, 连接sockfd：%d，工作端口：%s:%d\n", req_socket, tcpServerIP_.data(), tcpServerPort_);
+		std::cout << "PortProxyServer::ConnectTarget 获取代理服务连接失败, 连接sockfd：" << req_socket << std::endl;
+		close(req_socket);
+		return -1;
+	}
+    LOG(LoggerLevel::INFO, "获取代理服务连接成功, 连接sockfd：%d，工作端口：%s:%d\n", req_socket, tcpServerIP_.data(), tcpServerPort_);
+	std::cout << "PortProxyServer::ConnectTarget 获取代理服务连接成功, 连接sockfd：" << req_socket << std::endl;
+	return req_socket;
+}
+
 /*
  * PortProxyServer模式数据发送客户端完毕
  *
@@ -244,103 +346,81 @@ void PortProxyServer::ProxyProcess(spTcpConnection &sptcpconn)
 {
     LOG(LoggerLevel::INFO, "函数触发，工作端口：%s:%d\n", tcpServerIP_.data(), tcpServerPort_);
 	HttpRequestContext &httpReq = sptcpconn->GetReqestBuffer();
-	std::string reqServiceName = httpReq.serviceName;
-	std::string &ioBuffer = sptcpconn->GetBufferIn();
 	std::string target_ip;
 	int target_port;
-	if(targetSelectIndex.end() == targetSelectIndex.find(reqServiceName) || targetServices.end() == targetServices.find(reqServiceName))
+	int req_socket = -1;
+	if (SelectTarget(httpReq.serviceName, target_ip, target_port))
+		req_socket = ConnectTarget(target_ip, target_port);
+	if (-1 == req_socket)
 	{
-    	LOG(LoggerLevel::ERROR, "没有reqServiceName=%s，工作端口：%s:%d\n", reqServiceName.c_str(), tcpServerIP_.data(), tcpServerPort_);
-    	std::cout << "PortProxyServer::ProxyProcess 没有reqServiceName=" << reqServiceName << std::endl;
 		HttpError(sptcpconn, "目标服务请求失败，请稍后重试");
+		return;
 	}
-	else
+	// 移除基于epoll的tcpserver_对客户端连接的监听，转为由工作线程通过poll函数控制
+	// io_uring的recv完成模式下Poller已接收的后续数据随请求一并转发
+	sptcpconn->GetLoop()->RemoveChannelToPoller(sptcpconn->GetChannel());
+	sptcpconn->requestToOut();
+	sptcpconn->GetBufferOut().append(sptcpconn->GetChannel()->Received());
+	sptcpconn->GetChannel()->Received().clear();
+	sptcpconn->sendn(req_socket, sptcpconn->GetBufferOut());
+	Relay(sptcpconn->fd(), req_socket);
+	close(req_socket);
+}
+
+/*
+ * 在两个连接之间双向转发数据，直至任意一端断开
+ * 每个方向一个固定大小的缓冲区：读入的数据未写完时暂停读取来源端，改为等待接收端可写，
+ * 慢速的一端使另一端的数据停留在其套接字缓冲区内（TCP流量控制随之生效），转发占用的内存不随慢速端增长
+ *
+ */
+void PortProxyServer::Relay(int client_fd, int target_fd)
+{
+	int fds[2] = {client_fd, target_fd};
+	const size_t bufsize = ServerConfig::GetInstance()->ProxyBufferSize(); // 默认PROXY_RELAY_BUFSIZE，可由配置文件修改
+	std::vector<char> bufs[2] = {std::vector<char>(bufsize), std::vector<char>(bufsize)};
+	size_t begin[2] = {0, 0}, end[2] = {0, 0}; // bufs[i]内由fds[i]读入、尚未写往另一端的数据区间
+	struct pollfd pollFd[2];
+	bool closed = false;
+	while (!closed)
 	{
-		targetSelectIndex[reqServiceName] = (targetSelectIndex[reqServiceName] + 1) % targetServices[reqServiceName].size();
-		std::tie(target_ip, target_port) = targetServices[reqServiceName][targetSelectIndex[reqServiceName]];
-		int req_socket = socket(AF_INET, SOCK_STREAM, 0);
-		sockaddr_in addr_serv;
-		addr_serv.sin_addr.s_addr = inet_addr(target_ip.c_str());
-		addr_serv.sin_family = AF_INET;
-		addr_serv.sin_port = htons(target_port);
-		int conn_res = connect(req_socket, (sockaddr *)&addr_serv, sizeof(sockaddr));
-		if (-1 != conn_res)
+		for (int i = 0; i < 2; ++i)
 		{
-    		LOG(LoggerLevel::INFO, "获取代理服务连接成功, 连接sockfd：%d，工作端口：%s:%d\n", req_socket, tcpServerIP_.data(), tcpServerPort_);
-			std::cout << "PortProxyServer::ProxyProcess 获取代理服务连接成功, 连接sockfd：" << req_socket << std::endl;
-			// 移除基于epoll的tcpserver_对客户端连接的监听，转为由工作线程通过poll函数控制
-			loop.RemoveChannelToPoller(sptcpconn->GetChannel()); 
-			sptcpconn->requestToOut();
-			sptcpconn->sendn(req_socket, sptcpconn->GetBufferOut());
-			struct pollfd pollFd[2];
-			pollFd[0].fd = sptcpconn->fd();
-			pollFd[0].events = POLLRDNORM;
-			pollFd[1].fd = req_socket;
-			pollFd[1].events = POLLRDNORM;
-			int buflen = 3 * 1024 * 1024;
-			char *buf = new char[buflen];
-			// TCP状态检测，主要是检测断开连接
-			struct tcp_info tcpinfo;
-			int tcpinfolen = sizeof(tcpinfo);
-			while(true)
+			pollFd[i].fd = fds[i];
+			pollFd[i].events = (begin[i] == end[i] ? POLLRDNORM : 0) | (begin[1 - i] != end[1 - i] ? POLLOUT : 0);
+		}
+		int nfds = poll(pollFd, 2, 1000);
+		if (nfds < 0 && errno != EINTR)
+			break;
+		if (nfds <= 0)
+			continue;
+		for (int i = 0; i < 2 && !closed; ++i)
+		{
+			// 从fds[i]接收数据，连接断开或出错时结束转发
+			if (begin[i] == end[i] && (pollFd[i].revents & (POLLRDNORM | POLLHUP | POLLERR)))
 			{
-				while (0 == poll(pollFd, 2, 1000))
-					continue;
-				int index = 0;
-				for (; index < 2; index++)
-				{
-					// 连接两端任意一端发来数据
-					if (pollFd[index].revents & POLLRDNORM)
-					{
-						break;
-					}
-				}
-				if (index >= 2)
-					continue;
-				int this_fd = pollFd[index].fd; // 数据来源端
-				int other_fd = pollFd[(index ? 0 : 1)].fd; // 数据接收端
-				// 从this_fd接收数据
-				int rcv_len = recv(this_fd, buf, buflen, 0);
-				if (rcv_len >= 0)
-				{
-					// printf("socket[%d] = %d\t接收到数据(%dB)：%s\n", index, this_fd, rcv_len, buf);
-				}
-				else if (rcv_len == -1)
+				ssize_t rcv_len = recv(fds[i], bufs[i].data(), bufs[i].size(), MSG_DONTWAIT);
+				if (rcv_len > 0)
 				{
-					printf("接收数据失败[%d]！\n", index);
-					break;
+					begin[i] = 0;
+					end[i] = rcv_len;
 				}
-				// 转发数据给other_fd
-				int snd_len = send(other_fd, buf, rcv_len, 0);
-				if (snd_len >= 0)
+				else if (0 == rcv_len || (errno != EAGAIN && errno != EINTR))
 				{
-					// printf("socket[%d] = %d\t发送数据(%dB)：%s\n", index, other_fd, snd_len, buf);
+					closed = true;
 				}
-				else if (snd_len == -1)
-				{
-					printf("发送失败[%d]！\n", index);
-					break;
-				}
-				// TCP连接状态检查
-				getsockopt(this_fd, IPPROTO_TCP, TCP_INFO, (void *)&tcpinfo, (socklen_t *)&tcpinfolen);
-				// 连接断开，退出for循环
-				if (tcpinfo.tcpi_state == TCP_CLOSE_WAIT)
+			}
+			// 转发给另一端，写不完的部分等待可写事件
+			if (begin[i] != end[i] && !closed)
+			{
+				ssize_t snd_len = send(fds[1 - i], bufs[i].data() + begin[i], end[i] - begin[i], MSG_DONTWAIT | MSG_NOSIGNAL);
+				if (snd_len > 0)
+					begin[i] += snd_len;
+				else if (snd_len < 0 && errno != EAGAIN && errno != EINTR)
 				{
-					break;
+					printf("发送失败[%d]！\n", i);
+					closed = true;
 				}
 			}
-			delete[] buf;
-			close(req_socket);
-		}
-		else
-		{
-    		LOG(LoggerLevel::ERROR, "获取代理服务连接失败, 连接sockfd：%d，工作端口：%s:%d\n", req_socket, tcpServerIP_.data(), tcpServerPort_);
-			std::cout << "PortProxyServer::ProxyProcess 获取代理服务连接失败, 连接sockfd：" << req_socket << std::endl;
-			close(req_socket);
-			HttpError(sptcpconn, "目标服务请求失败，请稍后重试");
 		}
 	}
 }
-
-
-
@@ -0,0 +1,275 @@
+// RequestTracer类：
+//  按采样率记录HTTP/1.1请求在各处理阶段的时间戳，用于定位慢请求的耗时究竟花在哪一段
+//  阶段依次为：epoll_wait返回、开始recvn、recvn结束、ParseHttpRequest结束、BindDynamicHandler结束、交给服务的messageCallback_、
+//  处理函数开始（与上一阶段之差即ThreadPool排队时间）、处理函数提交响应、回到loop线程开始发送、响应发送完毕
+//  时间戳取自TSC（非x86平台为单调时钟），导出时按进程启动以来的TSC与单调时钟之比换算为纳秒
+//  完成的请求按总耗时保留最慢的N个，由TcpServer的内置服务在/trace上导出为Chrome trace-event JSON，可在Perfetto或chrome://tracing中查看
+//  采样率默认为0即关闭，关闭时每个请求只多一次原子读
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "JsonStreamWriter.hpp"
+
+#define TRACE_DEFAULT_CAPACITY 64 // 默认保留的最慢请求数
+
+enum TraceStage
+{
+    TRACE_POLL = 0,      // epoll_wait返回
+    TRACE_READ,          // 开始recvn
+    TRACE_RECV,          // recvn结束
+    TRACE_PARSE,         // ParseHttpRequest结束
+    TRACE_BIND,          // BindDynamicHandler结束
+    TRACE_DISPATCH,      // 交给服务的messageCallback_
+    TRACE_HANDLER,       // 处理函数开始
+    TRACE_RESPONSE,      // 处理函数提交响应（SendBufferOut）
+    TRACE_SEND,          // loop线程开始发送
+    TRACE_DONE,          // 响应发送完毕
+    TRACE_STAGES
+};
+
+struct RequestTrace
+{
+    std::atomic<uint64_t> stamps[TRACE_STAGES]; // 各阶段的时间戳，0表示未经过该阶段；处理函数相关阶段由工作线程写入
+    int fd;
+    std::string method;
+    std::string url;
+    std::string serviceName;
+    std::string handlerName;
+    RequestTrace() : fd(-1)
+    {
+        for (int stage = 0; stage < TRACE_STAGES; ++stage)
+            stamps[stage].store(0, std::memory_order_relaxed);
+    }
+    uint64_t Start() const { return stamps[TRACE_POLL] ? stamps[TRACE_POLL] : stamps[TRACE_READ]; }
+    uint64_t Total() const { return stamps[TRACE_DONE] - Start(); }
+};
+
+class RequestTracer
+{
+public:
+    static RequestTracer *GetInstance();
+    static uint64_t Now(); // 读取TSC
+    static void MarkPoll(); // 记录本线程epoll_wait返回的时间，由EventLoop调用
+    static uint64_t LastPoll() { return lastPoll_; }
+    void SetSampleRate(double rate); // 采样率，0~1
+    double GetSampleRate() const { return sampleThreshold_.load(std::memory_order_relaxed) / 1e6; }
+    bool Enabled() const { return sampleThreshold_.load(std::memory_order_relaxed) > 0; }
+    bool Sample();                                    // 按采样率决定是否追踪本次请求
+    void SetCapacity(size_t capacity);                // 保留的最慢请求数
+    void Finish(std::unique_ptr<RequestTrace> &trace); // 请求完成，按总耗时决定是否保留
+    void Reset();                                     // 清空已保留的请求
+    void ExportChromeTrace(std::string &out);          // 输出Chrome trace-event JSON
+    double NsPerTick();                               // TSC每个计数对应的纳秒数
+
+private:
+    std::atomic<uint32_t> sampleThreshold_; // 采样阈值，每百万个请求中追踪的数量
+    std::mutex mutex_;
+    size_t capacity_;
+    uint64_t finished_;                                // 已完成的追踪数
+    std::vector<std::unique_ptr<RequestTrace>> slowest_; // 最慢的capacity_个请求，无序
+    uint64_t epochTicks_;                              // 进程启动时的TSC
+    int64_t epochNs_;                                  // 进程启动时的单调时钟
+    static thread_local uint64_t lastPoll_;
+    static const char *stageNames_[TRACE_STAGES];      // 以该阶段结束的时间段名称
+    RequestTracer();
+    static int64_t SteadyNs();
+};
+
+thread_local uint64_t RequestTracer::lastPoll_ = 0;
+
+const char *RequestTracer::stageNames_[TRACE_STAGES] = {
+    "",
+    "event dispatch",
+    "recvn",
+    "ParseHttpRequest",
+    "BindDynamicHandler",
+    "messageCallback",
+    "ThreadPool queue",
+    "handler",
+    "AddTask to loop",
+    "sendn"};
+
+RequestTracer::RequestTracer()
+    : sampleThreshold_(0),
+      capacity_(TRACE_DEFAULT_CAPACITY),
+      finished_(0),
+      epochTicks_(Now()),
+      epochNs_(SteadyNs())
+{
+}
+
+RequestTracer *RequestTracer::GetInstance()
+{
+    static RequestTracer tracer;
+    return &tracer;
+}
+
+int64_t RequestTracer::SteadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t RequestTracer::Now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return SteadyNs();
+#endif
+}
+
+/*
+ * 每次epoll_wait返回都记录，避免开启追踪后取到过期的时间；读取TSC的开销相对系统调用可忽略
+ *
+ */
+void RequestTracer::MarkPoll()
+{
+    lastPoll_ = Now();
+}
+
+void RequestTracer::SetSampleRate(double rate)
+{
+    rate = std::min(std::max(rate, 0.0), 1.0);
+    sampleThreshold_.store((uint32_t)(rate * 1e6 + 0.5), std::memory_order_relaxed);
+}
+
+/*
+ * 每个线程独立的xorshift随机数，不加锁
+ *
+ */
+bool RequestTracer::Sample()
+{
+    uint32_t threshold = sampleThreshold_.load(std::memory_order_relaxed);
+    if (0 == threshold)
+        return false;
+    if (threshold >= 1000000)
+        return true;
+    static thread_local uint64_t state = Now() | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state % 1000000 < threshold;
+}
+
+void RequestTracer::SetCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    while (slowest_.size() > capacity_)
+        slowest_.pop_back();
+}
+
+/*
+ * 请求完成，服务函数未提交响应或未发送完毕的追踪直接丢弃
+ * 已满时替换其中最快的一个，N较小，线性查找即可
+ *
+ */
+void RequestTracer::Finish(std::unique_ptr<RequestTrace> &trace)
+{
+    if (!trace->stamps[TRACE_RESPONSE] || !trace->stamps[TRACE_DONE] || !trace->Start())
+    {
+        trace.reset();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++finished_;
+    if (slowest_.size() < capacity_)
+    {
+        slowest_.push_back(std::move(trace));
+        return;
+    }
+    std::vector<std::unique_ptr<RequestTrace>>::iterator fastest = std::min_element(
+        slowest_.begin(), slowest_.end(),
+        [](const std::unique_ptr<RequestTrace> &a, const std::unique_ptr<RequestTrace> &b)
+        { return a->Total() < b->Total(); });
+    if (fastest != slowest_.end() && (*fastest)->Total() < trace->Total())
+        fastest->swap(trace);
+    trace.reset();
+}
+
+void RequestTracer::Reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    slowest_.clear();
+    finished_ = 0;
+}
+
+/*
+ * 以进程启动以来的TSC增量与单调时钟增量之比换算，运行时间越长越准确
+ * 刚启动不足10ms时等待至10ms
+ *
+ */
+double RequestTracer::NsPerTick()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t ticks;
+    int64_t ns;
+    do
+    {
+        ticks = Now();
+        ns = SteadyNs();
+    } while (ns - epochNs_ < 10000000);
+    return (double)(ns - epochNs_) / (double)(ticks - epochTicks_);
+#else
+    return 1.0;
+#endif
+}
+
+/*
+ * 输出Chrome trace-event JSON
+ * 每个请求占一行（tid），按总耗时从慢到快排列，相邻两个已记录阶段之间为一个时间段，以结束阶段命名
+ * ts与dur的单位为微秒，ts为进程启动以来的时间
+ *
+ */
+void RequestTracer::ExportChromeTrace(std::string &out)
+{
+    double nsPerTick = NsPerTick();
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<const RequestTrace *> traces;
+    for (size_t i = 0; i < slowest_.size(); ++i)
+        traces.push_back(slowest_[i].get());
+    std::sort(traces.begin(), traces.end(), [](const RequestTrace *a, const RequestTrace *b)
+              { return a->Total() > b->Total(); });
+    JsonStreamWriter writer(out);
+    writer.Object().Key("traceEvents").Array();
+    for (size_t i = 0; i < traces.size(); ++i)
+    {
+        const RequestTrace *trace = traces[i];
+        int tid = (int)i + 1;
+        std::string title = "#" + std::to_string(tid) + " " + trace->method + " " + trace->url + " " +
+                            std::to_string(trace->Total() * nsPerTick / 1000.0) + "us";
+        writer.Object().Key("name").Value("thread_name").Key("ph").Value("M").Key("pid").Value(1).Key("tid").Value(tid);
+        writer.Key("args").Object().Key("name").Value(title).EndObject().EndObject();
+        uint64_t previous = 0;
+        for (int stage = 0; stage < TRACE_STAGES; ++stage)
+        {
+            uint64_t stamp = trace->stamps[stage];
+            if (!stamp)
+                continue;
+            if (previous)
+            {
+                writer.Object().Key("name").Value(stageNames_[stage]).Key("ph").Value("X").Key("pid").Value(1).Key("tid").Value(tid);
+                writer.Key("ts").Value((double)(previous - epochTicks_) * nsPerTick / 1000.0);
+                writer.Key("dur").Value((double)(stamp - previous) * nsPerTick / 1000.0);
+                writer.Key("args").Object().Key("fd").Value(trace->fd).Key("service").Value(trace->serviceName);
+                writer.Key("handler").Value(trace->handlerName).EndObject().EndObject();
+            }
+            previous = stamp;
+        }
+    }
+    writer.EndArray().Key("displayTimeUnit").Value("ns");
+    writer.Key("otherData").Object().Key("sampleRate").Value(GetSampleRate()).Key("finished").Value(finished_);
+    writer.Key("nsPerTick").Value(nsPerTick).EndObject().EndObject();
+}
@@ -16,12 +16,17 @@
 #include <functional>
 #include "Timer.hpp"
 #include "Resource.hpp"
+#include "FileCache.hpp"
+#include "HttpCache.hpp"
+#include "HttpRange.hpp"
 #include "TcpServer.hpp"
 #include "EventLoop.hpp"
 #include "LogServer.hpp"
 #include "ThreadPool.hpp"
+#include "HttpCompress.hpp"
 #include "TypeIdentify.hpp"
 #include "TcpConnection.hpp"
+#include "JsonStreamWriter.hpp"
 #include "jsoncpp/json.h"
 
 
@@ -30,6 +35,7 @@ class ResourceServer
 public:
     ResourceServer(EventLoop *loop, const int workThreadNum = 2, ThreadPool *threadPool = NULL, const int loopThreadNum = 0, const int port = 80, TcpServer *shareTcpServer = NULL);
     ~ResourceServer();
+    void SetCacheControl(const std::string &prefix, const std::string &cacheControl); // 设置url前缀对应的Cache-Control响应头
 
 private:
     typedef std::shared_ptr<TcpConnection> spTcpConnection;
@@ -40,10 +46,11 @@ private:
     int tcpServerPort_;         // tcpServer的EPOLL的服务端口
     TcpServer *tcpserver_;      // 基础网络服务TcpServer
     ThreadPool *threadpool_;    // 线程池
+    CacheControlPolicy cacheControl_;   // 按url前缀配置的Cache-Control策略
     int getFileSize(char* file_name);                       // 获取文件大小
     void GetImageResource(spTcpConnection &sptcpconn);      // 获取图片资源文件
     void SendResource(spTcpConnection &sptcpconn, const std::string &filePath); // 发送请求的资源到客户端
-    void HttpError(spTcpConnection &sptcpconn, const std::string &short_msg);  // 解析请求内容失败
+    void HttpError(spTcpConnection &sptcpconn, int resCode, const std::string &aqlRes); // 以Json格式回复请求处理失败
     void HandleMessage(spTcpConnection &sptcpconn);         // ResourceServer模式处理收到的请求
     void HandleSendComplete(spTcpConnection &sptcpconn);    // ResourceServer模式数据处理发送客户端完毕
     void HandleClose(spTcpConnection &sptcpconn);           // ResourceServer模式处理连接断开
@@ -82,6 +89,17 @@ ResourceServer::~ResourceServer()
     }
 }
 
+/*
+ * 设置url前缀对应的Cache-Control响应头，最长前缀优先匹配，未匹配时为no-cache
+ * 例如：SetCacheControl("/fzg/", "public, max-age=86400")
+ *
+ */
+void ResourceServer::SetCacheControl(const std::string &prefix, const std::string &cacheControl)
+{
+    LOG(LoggerLevel::INFO, "设置Cache-Control策略，前缀：%s，值：%s\n", prefix.c_str(), cacheControl.c_str());
+    cacheControl_.SetPolicy(prefix, cacheControl);
+}
+
 /*
  * ResourceServer模式处理收到的请求
  * 
@@ -90,13 +108,10 @@ void ResourceServer::HandleMessage(spTcpConnection &sptcpconn)
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     // 修改定时器参数
-    sptcpconn->GetTimer()->Adjust(5000, Timer::TimerType::TIMER_ONCE, std::bind(&TcpConnection::Shutdown, sptcpconn));
+    sptcpconn->GetTimer()->Adjust(ServerConfig::GetInstance()->IdleTimeoutMs(), Timer::TimerType::TIMER_ONCE);
     if (false == sptcpconn->GetReqHealthy())
     {
-        Json::Value resMsg;
-        resMsg["resCode"] = 400;
-        resMsg["aqlRes"] = "Bad request'";
-        HttpError(sptcpconn, resMsg.toStyledString());
+        HttpError(sptcpconn, 400, "Bad request'");
         return;
     }
     if (threadpool_->GetThreadNum() > 0)
@@ -104,7 +119,7 @@ void ResourceServer::HandleMessage(spTcpConnection &sptcpconn)
         // 已开启线程池，设置异步处理标志
         sptcpconn->SetAsyncProcessing(true);
         // 线程池在此添加任务并唤醒一工作线程执行之
-        threadpool_->AddTask([&]()
+        threadpool_->AddTask([this, sptcpconn]() mutable
                             {
                                 // 执行动态绑定的处理函数
                                 sptcpconn->GetReqHandler()(sptcpconn);
@@ -122,7 +137,7 @@ void ResourceServer::HandleMessage(spTcpConnection &sptcpconn)
  * 处理错误http请求，返回错误描述
  * 
  */
-void ResourceServer::HttpError(spTcpConnection &sptcpconn, const std::string &short_msg)
+void ResourceServer::HttpError(spTcpConnection &sptcpconn, int resCode, const std::string &aqlRes)
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     std::string &responsecontext = sptcpconn->GetBufferOut();
@@ -131,8 +146,11 @@ void ResourceServer::HttpError(spTcpConnection &sptcpconn, const std::string &sh
     responsecontext += "Server: Qiu Hai's NetServer/ResourceServer\r\n";
     responsecontext += "Content-Type: application/json\r\n";
     responsecontext += "Connection: close\r\n";
-    responsecontext += "Content-Length: " + std::to_string(short_msg.size()) + "\r\n\r\n";
-    responsecontext.append(short_msg, 0, short_msg.length());
+    // 响应体直接序列化到发送缓冲区，写完后回填Content-Length
+    size_t lengthPos = JsonStreamWriter::BeginContentLength(responsecontext);
+    JsonStreamWriter writer(responsecontext);
+    writer.Object().Key("resCode").Value(resCode).Key("aqlRes").Value(aqlRes).EndObject();
+    JsonStreamWriter::EndContentLength(responsecontext, lengthPos);
     sptcpconn->SendBufferOut();
 }
 
@@ -186,69 +204,137 @@ int ResourceServer::getFileSize(char* file_name)
 void ResourceServer::SendResource(spTcpConnection &sptcpconn, const std::string &filePath)
 {    
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
-    std::string filetype = TypeIdentify::getContentTypeByPath(filePath);
-    Json::Value resMsg;
+    std::string filetype(TypeIdentify::getContentTypeByPath(filePath));
     if(filetype.empty())
     {
         // 未知的资源类型
         LOG(LoggerLevel::ERROR, "未知的资源类型：%s（%s）\n", filePath, filetype);
         std::cout << "ResourceServer::SendResource 未知的资源类型：" << filePath << " (" << filetype << ")" << std::endl;
-        resMsg["resCode"] = 404;
         size_t npos = filePath.rfind('/');
-        resMsg["aqlRes"] = "not found " + filePath.substr(npos + 1) + " ,unknown file-type";
-        HttpError(sptcpconn, resMsg.toStyledString());
+        HttpError(sptcpconn, 404, "not found " + filePath.substr(npos + 1) + " ,unknown file-type");
         return;
     }
     HttpRequestContext &httprequestcontext = sptcpconn->GetReqestBuffer();
-    std::string &responsecontext = sptcpconn->GetBufferOut();   // 存储响应头+响应内容
-    std::string responsebody;   // 暂存响应内容
-    FILE *fp = NULL;
-    if ((fp = fopen(filePath.c_str(), "rb")) == NULL)
+    FileCache::spFileCacheEntry entry = FileCache::GetInstance()->Get(filePath, filetype);
+    if (!entry)
     {
         // 未定位到资源文件
-        resMsg["resCode"] = 404;
         size_t npos = filePath.rfind('/');
-        resMsg["aqlRes"] = "not found " + filePath.substr(npos + 1);
-        HttpError(sptcpconn, resMsg.toStyledString());
+        HttpError(sptcpconn, 404, "not found " + filePath.substr(npos + 1));
         return;
     }
-    else
+    // 协商压缩编码，常驻缓存的文件直接使用预压缩内容
+    std::string encoding = HttpCompress::NegotiateEncoding(httprequestcontext.header, filetype, entry->size);
+    // 生成校验器并评估条件请求，资源未变更时直接响应304，无需读取文件
+    std::string etag = HttpCache::MakeETag(entry, encoding);
+    std::string urlPath = httprequestcontext.url.substr(0, httprequestcontext.url.find('?'));
+    std::string validators = HttpCache::ValidatorHeaders(etag, entry->lastModified, cacheControl_.GetPolicy(urlPath));
+    std::map<std::string, std::string>::const_iterator iter = httprequestcontext.header.find("Connection");
+    if (HttpCache::NotModified(httprequestcontext.header, etag, entry->mtime))
     {
-        // 读取并发送请求的资源文件
-        std::fstream tmpfile;
-        tmpfile.open(filePath.c_str(), std::ios::in | std::ios::binary | std::ios::ate); // 二进制输入(读取),定位到文件末尾
-        if (tmpfile.is_open())
+        std::string &responsecontext = sptcpconn->GetBufferOut();
+        responsecontext += httprequestcontext.version + " 304 Not Modified\r\n";
+        responsecontext += "Server: QiuHai's NetServer/ResourceService\r\n";
+        responsecontext += validators;
+        if (TypeIdentify::isCompressibleType(filetype))
         {
-            size_t length = tmpfile.tellg(); // 获取文件大小
-            tmpfile.seekg(0, std::ios::beg); // 定位到文件开始
-            char data[BUFSIZE];
-            while (length >= BUFSIZE)
-            {
-                tmpfile.read(data, BUFSIZE);
-                responsebody.append(data, BUFSIZE);
-                length -= BUFSIZE;
-            }
-            if (length > 0)
-            {
-                tmpfile.read(data, length);
-                responsebody.append(data, length);
-                length = 0;
-            }
+            responsecontext += "Vary: Accept-Encoding\r\n";
         }
-        fclose(fp);
+        if (iter != httprequestcontext.header.end())
+        {
+            responsecontext += "Connection: " + iter->second + "\r\n";
+        }
+        responsecontext += "\r\n";
+        LOG(LoggerLevel::INFO, "资源未变更，响应304：%s\n", filePath.c_str());
+        sptcpconn->SendBufferOut();
+        return;
     }
+    // 评估范围请求，部分响应基于未压缩的原始内容，以sendfile从指定偏移发送
+    std::vector<ByteRange> ranges;
+    HttpRange::RangeResult rangeResult = HttpRange::Evaluate(httprequestcontext.header, entry, ranges);
+    if (HttpRange::RangeResult::RANGE_UNSATISFIABLE == rangeResult)
+    {
+        std::string &responsecontext = sptcpconn->GetBufferOut();
+        responsecontext += httprequestcontext.version + " 416 Range Not Satisfiable\r\n";
+        responsecontext += "Server: QiuHai's NetServer/ResourceService\r\n";
+        responsecontext += HttpRange::UnsatisfiableHeader(entry);
+        if (iter != httprequestcontext.header.end())
+        {
+            responsecontext += "Connection: " + iter->second + "\r\n";
+        }
+        responsecontext += "Content-Length: 0\r\n\r\n";
+        LOG(LoggerLevel::INFO, "请求范围无效，响应416：%s\n", filePath.c_str());
+        sptcpconn->SendBufferOut();
+        return;
+    }
+    if (HttpRange::RangeResult::RANGE_SATISFIABLE == rangeResult)
+    {
+        std::string &responsecontext = sptcpconn->GetBufferOut();
+        responsecontext += httprequestcontext.version + " 206 Partial Content\r\n";
+        responsecontext += "Server: QiuHai's NetServer/ResourceService\r\n";
+        responsecontext += "Accept-Ranges: bytes\r\n";
+        if (TypeIdentify::isCompressibleType(filetype))
+        {
+            responsecontext += "Vary: Accept-Encoding\r\n";
+        }
+        responsecontext += HttpCache::ValidatorHeaders(HttpCache::MakeETag(entry, ""), entry->lastModified, cacheControl_.GetPolicy(urlPath));
+        if (iter != httprequestcontext.header.end())
+        {
+            responsecontext += "Connection: " + iter->second + "\r\n";
+        }
+        if (!HttpRange::AppendPartial(sptcpconn, entry, ranges, responsecontext))
+        {
+            HttpError(sptcpconn, 500, "read resource failed");
+            return;
+        }
+        LOG(LoggerLevel::INFO, "即将发送文件的%d个范围：%s\n", (int)ranges.size(), filePath.c_str());
+        sptcpconn->SendBufferOut();
+        return;
+    }
+    std::shared_ptr<const std::string> responsebody;
+    std::shared_ptr<int> fileFd;
+    if (!encoding.empty())
+    {
+        responsebody = FileCache::GetInstance()->GetBody(entry, encoding);
+    }
+    if (!responsebody)
+    {
+        encoding.clear();
+        // 不常驻缓存的大文件以sendfile发送，不读入内存
+        if (entry->cached)
+            responsebody = FileCache::GetInstance()->GetBody(entry, encoding);
+        else
+            fileFd = TcpConnection::OpenSendFile(filePath);
+    }
+    if (!responsebody && !fileFd)
+    {
+        HttpError(sptcpconn, 500, "read resource failed");
+        return;
+    }
+    std::string &responsecontext = sptcpconn->GetBufferOut();   // 存储响应头+响应内容
     responsecontext += httprequestcontext.version + " 200 OK\r\n";
     responsecontext += "Server: QiuHai's NetServer/ResourceService\r\n";
     responsecontext += "Content-Type: " + filetype + "; charset=utf-8\r\n";
+    if (TypeIdentify::isCompressibleType(filetype))
+    {
+        responsecontext += "Vary: Accept-Encoding\r\n";
+    }
+    if (!encoding.empty())
+    {
+        responsecontext += "Content-Encoding: " + encoding + "\r\n";
+    }
+    responsecontext += "Accept-Ranges: bytes\r\n";
+    responsecontext += validators;
     // keepalive判断处理，包含Connection字段
-    std::map<std::string, std::string>::const_iterator iter = httprequestcontext.header.find("Connection");
     if (iter != httprequestcontext.header.end())
     {
         responsecontext += "Connection: " + iter->second + "\r\n";
     }
-    // responsecontext += "Content-Length: " + std::to_string(getFileSize(filePath.data())) + "\r\n\r\n";
-    responsecontext += "Content-Length: " + std::to_string(responsebody.length()) + "\r\n\r\n";
-    responsecontext.append(responsebody, 0, responsebody.length());
+    responsecontext += "Content-Length: " + std::to_string(responsebody ? (off_t)responsebody->length() : entry->size) + "\r\n\r\n";
+    if (responsebody)
+        responsecontext.append(*responsebody);
+    else
+        sptcpconn->AddSendFile(fileFd, 0, entry->size);
     LOG(LoggerLevel::INFO, "即将发送文件:%s（%s）\n", filePath, filetype);
     sptcpconn->SendBufferOut();
 }
@@ -262,20 +348,26 @@ void ResourceServer::GetImageResource(spTcpConnection &sptcpconn)
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     LOG(LoggerLevel::INFO, "开始处理一个TcpConnection连接的Http请求，连接sockfd：%d\n", sptcpconn->fd());
     // 修改定时器参数
-    sptcpconn->GetTimer()->Adjust(5000, Timer::TimerType::TIMER_ONCE, std::bind(&TcpConnection::Shutdown, sptcpconn));
-    Json::Reader reader;
-    Json::Value jsonBody;
-    if (reader.parse(sptcpconn->GetReqestBuffer().body.data(), jsonBody))  // reader将Json字符串解析到root，root将包含Json里所有子元素  
-    {  
-        std::string imageName = jsonBody["imageName"].asString();
-        std::string path = imgRoot + imageName;
+    sptcpconn->GetTimer()->Adjust(ServerConfig::GetInstance()->IdleTimeoutMs(), Timer::TimerType::TIMER_ONCE);
+    // 以线程内复用的内存池原地解析请求体，字符串直接指向请求体缓冲区，预热后不再产生堆分配
+    static thread_local Json::MonotonicArena arena;
+    arena.reset();
+    Json::InSituReader reader(arena);
+    std::string &body = sptcpconn->GetReqestBuffer().body;
+    const Json::InSituValue *jsonBody = reader.parse(&body[0], &body[0] + body.size());
+    const Json::InSituValue *imageName = jsonBody ? jsonBody->find("imageName") : nullptr;
+    const char *nameBegin = nullptr, *nameEnd = nullptr;
+    if (imageName && imageName->getString(&nameBegin, &nameEnd))
+    {
+        std::string path = imgRoot;
+        path.append(nameBegin, nameEnd);
         SendResource(sptcpconn, path);
     }
     else
     {
-        Json::Value resMsg;
-        resMsg["resCode"] = 400;
-        resMsg["aqlRes"] = "not found [string] for 'imageName'";
-        HttpError(sptcpconn, resMsg.toStyledString());
+        if (!jsonBody)
+            LOG(LoggerLevel::ERROR, "请求体Json解析失败：%s（偏移%d）\n", reader.getError(), (int)reader.getErrorOffset());
+        HttpError(sptcpconn, 400, "not found [string] for 'imageName'");
     }
 }
+
@@ -0,0 +1,570 @@
+// RpcServer类：
+//  基于protobuf的二进制RPC服务类，连接以"/RpcService/Connect"的HTTP Upgrade请求（Upgrade: qhrpc）切换协议，
+//  之后不再经过http解析与Json编解码，双方以长度前缀的二进制帧通信：
+//      | 长度 4B | 类型 1B | 请求id 4B | 方法id 4B | 负载 |    （网络字节序，长度为其后所有字节数）
+//  方法id为方法全名（如"echoService.echoService.EchoFun"）的FNV-1a散列，双方无需协商即可确定
+//  收到的请求在loop所在线程解析到按调用分配的protobuf Arena内，交给线程池调用注册的google::protobuf::Service，
+//  同一连接上的多个调用并发执行，响应按完成顺序发送，由请求id匹配
+//  RpcChannel为阻塞式客户端通道，可直接用于protoc生成的Stub
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <memory>
+#include <cstring>
+#include <functional>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/message.h>
+#include <google/protobuf/service.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/stubs/common.h>
+#include "TcpServer.hpp"
+#include "EventLoop.hpp"
+#include "LogServer.hpp"
+#include "ThreadPool.hpp"
+#include "TcpConnection.hpp"
+
+#define RPC_PROTOCOL "qhrpc"                       // Upgrade头部的协议名
+#define RPC_HEADER_SIZE 13                         // 帧头长度：长度4B+类型1B+请求id4B+方法id4B
+#define RPC_MAX_FRAME_SIZE (16 * 1024 * 1024)      // 单帧最大长度，超过时关闭连接
+#define RPC_ARENA_INITIAL_BLOCK 2048               // 每次调用的Arena初始块大小，小消息无需额外分配
+
+// RPC帧编解码
+class RpcFrame
+{
+public:
+    enum FrameType
+    {
+        RPC_REQUEST = 0,  // 请求，负载为请求消息
+        RPC_RESPONSE = 1, // 响应，负载为响应消息
+        RPC_ERROR = 2     // 调用失败，负载为错误描述
+    };
+    FrameType type;
+    uint32_t requestId;
+    uint32_t methodId;
+    const char *payload; // 指向输入缓冲区，不拷贝
+    size_t payloadSize;
+    static std::string Encode(FrameType type, uint32_t requestId, uint32_t methodId, const std::string &payload);
+    // 从data解析一帧，返回消耗的字节数；数据不完整返回0，帧非法返回-1
+    static long Decode(const char *data, size_t size, RpcFrame &frame);
+    static uint32_t MethodId(const std::string &fullName); // 方法全名的FNV-1a散列
+};
+
+/*
+ * 编码一帧
+ *
+ */
+std::string RpcFrame::Encode(FrameType type, uint32_t requestId, uint32_t methodId, const std::string &payload)
+{
+    std::string frame(RPC_HEADER_SIZE, '\0');
+    uint32_t length = htonl((uint32_t)(RPC_HEADER_SIZE - 4 + payload.size()));
+    requestId = htonl(requestId);
+    methodId = htonl(methodId);
+    memcpy(&frame[0], &length, 4);
+    frame[4] = (char)type;
+    memcpy(&frame[5], &requestId, 4);
+    memcpy(&frame[9], &methodId, 4);
+    frame.append(payload);
+    return frame;
+}
+
+/*
+ * 从data解析一帧，负载指向data内部
+ *
+ */
+long RpcFrame::Decode(const char *data, size_t size, RpcFrame &frame)
+{
+    if (size < 4)
+        return 0;
+    uint32_t length;
+    memcpy(&length, data, 4);
+    length = ntohl(length);
+    if (length < RPC_HEADER_SIZE - 4 || length > RPC_MAX_FRAME_SIZE)
+        return -1;
+    if (size < 4 + (size_t)length)
+        return 0;
+    uint8_t type = (uint8_t)data[4];
+    if (type > RPC_ERROR)
+        return -1;
+    frame.type = (FrameType)type;
+    memcpy(&frame.requestId, data + 5, 4);
+    memcpy(&frame.methodId, data + 9, 4);
+    frame.requestId = ntohl(frame.requestId);
+    frame.methodId = ntohl(frame.methodId);
+    frame.payload = data + RPC_HEADER_SIZE;
+    frame.payloadSize = length - (RPC_HEADER_SIZE - 4);
+    return 4 + (long)length;
+}
+
+uint32_t RpcFrame::MethodId(const std::string &fullName)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : fullName)
+    {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// RPC调用控制器，服务端与客户端共用
+class RpcController : public google::protobuf::RpcController
+{
+public:
+    RpcController() : failed_(false) {}
+    void Reset() override { failed_ = false; errorText_.clear(); }
+    bool Failed() const override { return failed_; }
+    std::string ErrorText() const override { return errorText_; }
+    void StartCancel() override {}
+    void SetFailed(const std::string &reason) override { failed_ = true; errorText_ = reason; }
+    bool IsCanceled() const override { return false; }
+    void NotifyOnCancel(google::protobuf::Closure *callback) override {}
+
+private:
+    bool failed_;
+    std::string errorText_;
+};
+
+class RpcServer
+{
+public:
+    typedef std::shared_ptr<TcpConnection> spTcpConnection;
+    RpcServer(EventLoop *loop, const int workThreadNum = 2, ThreadPool *threadPool = NULL, const int loopThreadNum = 0, const int port = 0, TcpServer *shareTcpServer = NULL);
+    ~RpcServer();
+    bool RegisterService(google::protobuf::Service *service); // 注册服务的所有方法，不接管service的所有权，方法id冲突时返回false
+
+private:
+    typedef struct _RpcMethod
+    {
+        google::protobuf::Service *service;
+        const google::protobuf::MethodDescriptor *method;
+    } RpcMethod;
+    // 单次调用的上下文，请求与响应消息分配在arena内，调用完成后随上下文一起释放
+    typedef struct _RpcCall
+    {
+        char initialBlock[RPC_ARENA_INITIAL_BLOCK];
+        google::protobuf::Arena arena;
+        RpcController controller;
+        google::protobuf::Message *request;
+        google::protobuf::Message *response;
+        spTcpConnection sptcpconn;
+        uint32_t requestId;
+        uint32_t methodId;
+        _RpcCall() : arena(MakeArenaOptions(initialBlock)), request(nullptr), response(nullptr) {}
+        static google::protobuf::ArenaOptions MakeArenaOptions(char *block)
+        {
+            google::protobuf::ArenaOptions options;
+            options.initial_block = block;
+            options.initial_block_size = RPC_ARENA_INITIAL_BLOCK;
+            return options;
+        }
+    } RpcCall;
+    std::string serviceName_;
+    int workThreadNum_;
+    int loopThreadNum_;
+    int tcpServerPort_;         // tcpServer的EPOLL的服务端口
+    ThreadPool *threadpool_;    // 线程池，执行服务方法
+    TcpServer *tcpserver_;      // 基础网络服务TcpServer
+    std::mutex mutex_;          // 保护methods_
+    std::map<uint32_t, RpcMethod> methods_; // 方法id->服务方法
+    void Connect(spTcpConnection &sptcpconn);                      // 校验升级请求并切换为RPC字节流
+    bool OnStream(spTcpConnection &sptcpconn, std::string &bufferIn); // 解析缓冲区内完整的帧并分发调用
+    void Dispatch(spTcpConnection &sptcpconn, const RpcFrame &frame); // 解析请求消息并交给线程池调用服务方法
+    static void OnCallDone(RpcCall *call);                          // 调用完成，发送响应并释放上下文
+    void HttpError(spTcpConnection &sptcpconn, const int err_num, const std::string &short_msg);
+    void HandleMessage(spTcpConnection &sptcpconn);      // 处理升级请求
+    void HandleSendComplete(spTcpConnection &sptcpconn); // 数据发送完毕
+    void HandleClose(spTcpConnection &sptcpconn);        // 连接断开
+    void HandleError(spTcpConnection &sptcpconn);        // 连接出错
+
+};
+
+RpcServer::RpcServer(EventLoop *loop, const int workThreadNum, ThreadPool *threadPool, const int loopThreadNum, const int port, TcpServer *shareTcpServer)
+    : serviceName_("RpcService"),
+      workThreadNum_(workThreadNum),
+      loopThreadNum_(loopThreadNum),
+      tcpServerPort_(port),
+      threadpool_(threadPool ? threadPool : (workThreadNum_ > 0 ? new ThreadPool(workThreadNum_) : NULL)),
+      tcpserver_(shareTcpServer ? shareTcpServer : new TcpServer(loop, tcpServerPort_, loopThreadNum))
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    tcpserver_->RegisterHandler(serviceName_, TcpServer::ReadMessageHandler, std::bind(&RpcServer::HandleMessage, this, std::placeholders::_1));
+    tcpserver_->RegisterHandler(serviceName_, TcpServer::SendOverHandler, std::bind(&RpcServer::HandleSendComplete, this, std::placeholders::_1));
+    tcpserver_->RegisterHandler(serviceName_, TcpServer::CloseConnHandler, std::bind(&RpcServer::HandleClose, this, std::placeholders::_1));
+    tcpserver_->RegisterHandler(serviceName_, TcpServer::ErrorConnHandler, std::bind(&RpcServer::HandleError, this, std::placeholders::_1));
+    tcpserver_->RegisterHandler(serviceName_, "Connect", std::bind(&RpcServer::Connect, this, std::placeholders::_1));
+    if (!threadPool && threadpool_)
+        threadpool_->Start();
+}
+
+RpcServer::~RpcServer()
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    if (workThreadNum_)
+    {
+        delete threadpool_;
+    }
+    if (tcpServerPort_)
+    {
+        delete tcpserver_;
+    }
+}
+
+/*
+ * 注册服务的所有方法，方法id由方法全名计算
+ *
+ */
+bool RpcServer::RegisterService(google::protobuf::Service *service)
+{
+    const google::protobuf::ServiceDescriptor *descriptor = service->GetDescriptor();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < descriptor->method_count(); ++i)
+    {
+        const google::protobuf::MethodDescriptor *method = descriptor->method(i);
+        uint32_t methodId = RpcFrame::MethodId(method->full_name());
+        std::map<uint32_t, RpcMethod>::iterator iter = methods_.find(methodId);
+        if (methods_.end() != iter && iter->second.method != method)
+        {
+            LOG(LoggerLevel::ERROR, "RPC方法id冲突：%s与%s\n", method->full_name().c_str(), iter->second.method->full_name().c_str());
+            return false;
+        }
+        methods_[methodId] = RpcMethod{service, method};
+        LOG(LoggerLevel::INFO, "注册RPC方法：%s，方法id：%u\n", method->full_name().c_str(), methodId);
+    }
+    return true;
+}
+
+/*
+ * 处理升级请求，在连接所在的EventLoop线程执行
+ *
+ */
+void RpcServer::HandleMessage(spTcpConnection &sptcpconn)
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    if (false == sptcpconn->GetReqHealthy())
+    {
+        HttpError(sptcpconn, 400, "Bad request");
+        return;
+    }
+    try
+    {
+        sptcpconn->GetReqHandler()(sptcpconn);
+    }
+    catch (std::bad_function_call)
+    {
+        LOG(LoggerLevel::ERROR, "执行sptcpconn的绑定函数报错：std::bad_function_call，连接绑定函数异常，sockfd：%d\n", sptcpconn->fd());
+    }
+}
+
+/*
+ * 校验升级请求并切换为RPC字节流
+ * 没有"Upgrade: qhrpc"头部的请求返回426
+ *
+ */
+void RpcServer::Connect(spTcpConnection &sptcpconn)
+{
+    LOG(LoggerLevel::INFO, "函数触发，sockfd：%d\n", sptcpconn->fd());
+    const std::string *upgrade = WebSocket::FindHeader(sptcpconn->GetReqestBuffer().header, "Upgrade");
+    if (!upgrade || RPC_PROTOCOL != *upgrade)
+    {
+        HttpError(sptcpconn, 426, "Upgrade Required");
+        return;
+    }
+    if (!sptcpconn->UpgradeStream(RPC_PROTOCOL, std::bind(&RpcServer::OnStream, this, std::placeholders::_1, std::placeholders::_2)))
+        HttpError(sptcpconn, 400, "Bad request");
+}
+
+/*
+ * 解析缓冲区内完整的帧并分发调用，未成帧的数据留在缓冲区
+ * 帧非法或收到非请求帧时关闭连接
+ *
+ */
+bool RpcServer::OnStream(spTcpConnection &sptcpconn, std::string &bufferIn)
+{
+    size_t offset = 0;
+    bool healthy = true;
+    while (offset < bufferIn.size())
+    {
+        RpcFrame frame;
+        long consumed = RpcFrame::Decode(bufferIn.data() + offset, bufferIn.size() - offset, frame);
+        if (consumed == 0)
+            break;
+        if (consumed < 0 || RpcFrame::RPC_REQUEST != frame.type)
+        {
+            LOG(LoggerLevel::ERROR, "非法的RPC帧，关闭连接，sockfd：%d\n", sptcpconn->fd());
+            healthy = false;
+            break;
+        }
+        Dispatch(sptcpconn, frame);
+        offset += consumed;
+    }
+    bufferIn.erase(0, offset);
+    return healthy;
+}
+
+/*
+ * 在Arena内解析请求消息并交给线程池调用服务方法，未开启线程池时直接调用
+ * 未知方法或请求解析失败时直接回复错误帧
+ *
+ */
+void RpcServer::Dispatch(spTcpConnection &sptcpconn, const RpcFrame &frame)
+{
+    RpcMethod method;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<uint32_t, RpcMethod>::iterator iter = methods_.find(frame.methodId);
+        if (methods_.end() == iter)
+        {
+            LOG(LoggerLevel::ERROR, "未知的RPC方法id：%u，sockfd：%d\n", frame.methodId, sptcpconn->fd());
+            sptcpconn->SendStream(std::make_shared<const std::string>(RpcFrame::Encode(RpcFrame::RPC_ERROR, frame.requestId, frame.methodId, "unknown method")));
+            return;
+        }
+        method = iter->second;
+    }
+    RpcCall *call = new RpcCall();
+    call->sptcpconn = sptcpconn;
+    call->requestId = frame.requestId;
+    call->methodId = frame.methodId;
+    call->request = method.service->GetRequestPrototype(method.method).New(&call->arena);
+    call->response = method.service->GetResponsePrototype(method.method).New(&call->arena);
+    if (!call->request->ParseFromArray(frame.payload, (int)frame.payloadSize))
+    {
+        call->controller.SetFailed("bad request");
+        OnCallDone(call);
+        return;
+    }
+    google::protobuf::Closure *done = google::protobuf::NewCallback(&RpcServer::OnCallDone, call);
+    if (threadpool_ && threadpool_->GetThreadNum() > 0)
+    {
+        threadpool_->AddTask([method, call, done]()
+                             { method.service->CallMethod(method.method, &call->controller, call->request, call->response, done); });
+    }
+    else
+    {
+        method.service->CallMethod(method.method, &call->controller, call->request, call->response, done);
+    }
+}
+
+/*
+ * 调用完成，发送响应或错误帧并释放上下文，可在任意线程执行
+ *
+ */
+void RpcServer::OnCallDone(RpcCall *call)
+{
+    std::string payload;
+    RpcFrame::FrameType type = RpcFrame::RPC_RESPONSE;
+    if (call->controller.Failed())
+    {
+        type = RpcFrame::RPC_ERROR;
+        payload = call->controller.ErrorText();
+    }
+    else if (!call->response->SerializeToString(&payload))
+    {
+        type = RpcFrame::RPC_ERROR;
+        payload = "serialize response failed";
+    }
+    call->sptcpconn->SendStream(std::make_shared<const std::string>(RpcFrame::Encode(type, call->requestId, call->methodId, payload)));
+    delete call;
+}
+
+/*
+ * 处理错误请求，返回错误描述
+ *
+ */
+void RpcServer::HttpError(spTcpConnection &sptcpconn, const int err_num, const std::string &short_msg)
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", sptcpconn->fd());
+    std::string &responsecontext = sptcpconn->GetBufferOut();
+    responsecontext.clear();
+    std::string responsebody = std::to_string(err_num) + " " + short_msg + "\n";
+    responsecontext += "HTTP/1.1 " + std::to_string(err_num) + " " + short_msg + "\r\n";
+    responsecontext += "Server: Qiu Hai's NetServer/RpcService\r\n";
+    if (426 == err_num)
+    {
+        responsecontext += "Upgrade: " RPC_PROTOCOL "\r\n";
+        responsecontext += "Connection: Upgrade\r\n";
+    }
+    responsecontext += "Content-Type: text/plain\r\n";
+    responsecontext += "Content-Length: " + std::to_string(responsebody.size()) + "\r\n\r\n";
+    responsecontext += responsebody;
+    sptcpconn->SendBufferOut();
+}
+
+/*
+ * RpcServer模式数据发送客户端完毕
+ *
+ */
+void RpcServer::HandleSendComplete(spTcpConnection &sptcpconn)
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+}
+
+/*
+ * RpcServer模式处理连接断开，进行中的调用完成后其响应被丢弃
+ *
+ */
+void RpcServer::HandleClose(spTcpConnection &sptcpconn)
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+}
+
+/*
+ * RpcServer模式处理连接出错
+ *
+ */
+void RpcServer::HandleError(spTcpConnection &sptcpconn)
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+}
+
+// 阻塞式RPC客户端通道，同一时刻只有一个调用在途，可直接用于protoc生成的Stub
+class RpcChannel : public google::protobuf::RpcChannel
+{
+public:
+    RpcChannel();
+    ~RpcChannel();
+    bool Connect(const std::string &ip, int port); // 连接服务端并完成协议升级
+    void CallMethod(const google::protobuf::MethodDescriptor *method, google::protobuf::RpcController *controller,
+                    const google::protobuf::Message *request, google::protobuf::Message *response,
+                    google::protobuf::Closure *done) override;
+
+private:
+    int fd_;
+    uint32_t nextRequestId_;
+    std::string bufferIn_;
+    bool SendAll(const std::string &data);
+    bool RecvMore(); // 接收更多数据追加到bufferIn_
+};
+
+RpcChannel::RpcChannel()
+    : fd_(-1),
+      nextRequestId_(0)
+{
+}
+
+RpcChannel::~RpcChannel()
+{
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+/*
+ * 连接服务端并发送升级请求，收到101后连接切换为RPC字节流
+ *
+ */
+bool RpcChannel::Connect(const std::string &ip, int port)
+{
+    if (fd_ >= 0)
+        close(fd_);
+    bufferIn_.clear();
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in serveraddr;
+    memset(&serveraddr, 0, sizeof(serveraddr));
+    serveraddr.sin_family = AF_INET;
+    serveraddr.sin_port = htons(port);
+    inet_pton(AF_INET, ip.c_str(), &serveraddr.sin_addr);
+    if (fd_ < 0 || connect(fd_, (struct sockaddr *)&serveraddr, sizeof(serveraddr)) < 0 ||
+        !SendAll("GET /RpcService/Connect HTTP/1.1\r\nHost: " + ip + "\r\nConnection: Upgrade\r\nUpgrade: " RPC_PROTOCOL "\r\n\r\n"))
+        return false;
+    size_t headerEnd;
+    while (std::string::npos == (headerEnd = bufferIn_.find("\r\n\r\n")))
+    {
+        if (!RecvMore())
+            return false;
+    }
+    bool upgraded = 0 == bufferIn_.compare(0, 12, "HTTP/1.1 101");
+    bufferIn_.erase(0, headerEnd + 4);
+    return upgraded;
+}
+
+/*
+ * 发送请求并阻塞等待同一请求id的响应
+ *
+ */
+void RpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method, google::protobuf::RpcController *controller,
+                            const google::protobuf::Message *request, google::protobuf::Message *response,
+                            google::protobuf::Closure *done)
+{
+    uint32_t requestId = ++nextRequestId_;
+    std::string payload;
+    request->SerializeToString(&payload);
+    if (!SendAll(RpcFrame::Encode(RpcFrame::RPC_REQUEST, requestId, RpcFrame::MethodId(method->full_name()), payload)))
+    {
+        controller->SetFailed("send request failed");
+    }
+    else
+    {
+        for (;;)
+        {
+            RpcFrame frame;
+            long consumed = RpcFrame::Decode(bufferIn_.data(), bufferIn_.size(), frame);
+            if (consumed < 0)
+            {
+                controller->SetFailed("bad response frame");
+                break;
+            }
+            if (consumed == 0)
+            {
+                if (!RecvMore())
+                {
+                    controller->SetFailed("connection closed");
+                    break;
+                }
+                continue;
+            }
+            if (frame.requestId == requestId)
+            {
+                if (RpcFrame::RPC_RESPONSE == frame.type)
+                {
+                    if (!response->ParseFromArray(frame.payload, (int)frame.payloadSize))
+                        controller->SetFailed("bad response");
+                }
+                else
+                {
+                    controller->SetFailed(std::string(frame.payload, frame.payloadSize));
+                }
+                bufferIn_.erase(0, consumed);
+                break;
+            }
+            bufferIn_.erase(0, consumed);
+        }
+    }
+    if (done)
+        done->Run();
+}
+
+bool RpcChannel::SendAll(const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+bool RpcChannel::RecvMore()
+{
+    char buffer[READ_BUFSIZE];
+    for (;;)
+    {
+        ssize_t n = recv(fd_, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        bufferIn_.append(buffer, n);
+        return true;
+    }
+}
@@ -0,0 +1,262 @@
+// ServerConfig类：
+//  服务的运行参数，取代原先需要重新编译才能修改的宏，各宏保留为默认值
+//  配置文件为json格式，路径取环境变量NETSERVER_CONFIG，未设置时为工作目录下的netserver.json，文件不存在时全部使用默认值
+//  文件内未出现的键使用默认值（热加载时保持原值），示例见services/netserver.json
+//  启动参数只在启动时读取：port、httpPort（AllService的网站端口）、ioThreads、workerThreads（可为"auto"）、maxEvents，
+//  服务main的命令行参数优先于配置文件
+//  其余参数可热加载：SIGHUP时重新读取配置文件（见ServerLifecycle.hpp），之后的读写、新连接与新的转发立即使用新值，
+//  配置文件格式错误或取值越界时保留原值；启动参数的修改需重启（可热重启）生效
+//  参数以原子变量保存，热路径上的读取为一次relaxed load
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "jsoncpp/json.h"
+#include "LogServer.hpp"
+#include "CpuAffinity.hpp"
+
+#define MAXEVENTNUM 4096                         // 最大触发事件数量
+#define TIMEOUT 1000                             // epoll_wait 超时时间设置
+#define MAXCONNECTION 20000                      // 最大连接数
+#define READ_BUFSIZE 4096                        // 连接每次read的字节数
+#define READ_BUFSIZE_MAX (64 * 1024)             // 连接每次read的字节数上限
+#define IDLE_TIMEOUT 5000                        // 连接空闲超时毫秒数，超时后关闭连接
+#define OUTPUT_LOW_WATERMARK (1024 * 1024)       // 输出队列低水位，越过高水位后回落到此值以下时恢复
+#define OUTPUT_HIGH_WATERMARK (4 * 1024 * 1024)  // 输出队列高水位，超过时暂停读取该连接并通知生产者
+#define OUTPUT_LIMIT (64 * 1024 * 1024)          // 输出队列硬上限，追加数据超过时丢弃并关闭连接
+#define PROXY_RELAY_BUFSIZE (256 * 1024)         // 代理每个转发方向的缓冲区大小
+#define FILE_CACHE_MAX_FILE_SIZE (4 * 1024 * 1024)   // 单个文件常驻缓存的大小上限
+#define FILE_CACHE_MAX_TOTAL_SIZE (64 * 1024 * 1024) // 文件缓存总大小上限
+#define COMPRESS_MAX_SIZE (4 * 1024 * 1024)      // 可压缩的内容长度上限，压缩结果整体保存在内存中
+#define DRAIN_TIMEOUT 10000                      // 优雅退出时排空连接的期限毫秒数
+#define ADMIN_REMOTE_ACCESS 0                    // 内置的/metrics与/trace是否对非本机地址开放，默认仅本机可访问
+
+class ServerConfig
+{
+public:
+    static ServerConfig *GetInstance();
+    bool Reload(); // 重新读取配置文件，只更新可热加载的参数，在主loop所在线程调用
+
+    // 启动参数，配置文件未设置时返回defaultValue
+    int Port(int defaultValue) const { return StartupInt("port", defaultValue); }
+    int HttpPort(int defaultValue) const { return StartupInt("httpPort", defaultValue); }
+    int IoThreads(int defaultValue) const { return StartupThreads("ioThreads", defaultValue, CpuAffinity::IO); }
+    int WorkerThreads(int defaultValue) const { return StartupThreads("workerThreads", defaultValue, CpuAffinity::WORKER); }
+    int MaxEvents() const { return (int)maxEvents_.load(std::memory_order_relaxed); }
+
+    // 可热加载的参数
+    int PollTimeoutMs() const { return (int)pollTimeoutMs_.load(std::memory_order_relaxed); }
+    int MaxConnections() const { return (int)maxConnections_.load(std::memory_order_relaxed); }
+    size_t ReadBufferSize() const { return (size_t)readBufferSize_.load(std::memory_order_relaxed); }
+    int IdleTimeoutMs() const { return (int)idleTimeoutMs_.load(std::memory_order_relaxed); }
+    size_t OutputLowWaterMark() const { return (size_t)outputLowWaterMark_.load(std::memory_order_relaxed); }
+    size_t OutputHighWaterMark() const { return (size_t)outputHighWaterMark_.load(std::memory_order_relaxed); }
+    size_t OutputLimit() const { return (size_t)outputLimit_.load(std::memory_order_relaxed); }
+    size_t ProxyBufferSize() const { return (size_t)proxyBufferSize_.load(std::memory_order_relaxed); }
+    size_t FileCacheMaxFileSize() const { return (size_t)fileCacheMaxFileSize_.load(std::memory_order_relaxed); }
+    size_t FileCacheMaxTotalSize() const { return (size_t)fileCacheMaxTotalSize_.load(std::memory_order_relaxed); }
+    size_t CompressMaxSize() const { return (size_t)compressMaxSize_.load(std::memory_order_relaxed); }
+    int DrainTimeoutMs() const { return (int)drainTimeoutMs_.load(std::memory_order_relaxed); }
+    bool AdminRemoteAccess() const { return 0 != adminRemoteAccess_.load(std::memory_order_relaxed); }
+
+private:
+    // 数值参数：键、取值、取值范围、是否可热加载
+    typedef struct _Knob
+    {
+        const char *key;
+        std::atomic<int64_t> *value;
+        int64_t min;
+        int64_t max;
+        bool reloadable;
+    } Knob;
+
+    ServerConfig();
+    bool Load(bool reload);                                   // 读取配置文件，reload为true时只更新可热加载的参数
+    bool Parse(Json::Value &root);                            // 读取并解析配置文件
+    int StartupInt(const char *key, int defaultValue) const;
+    int StartupThreads(const char *key, int defaultValue, CpuAffinity::Role role) const;
+    static int ParseLogLevel(const Json::Value &value);      // "DEBUG"~"FATAL"或0~4，无效时返回-1
+
+    std::string path_;      // 配置文件路径
+    Json::Value startup_;   // 启动时读取的配置，供启动参数查询
+    std::vector<Knob> knobs_;
+    std::atomic<int64_t> maxEvents_;
+    std::atomic<int64_t> pollTimeoutMs_;
+    std::atomic<int64_t> maxConnections_;
+    std::atomic<int64_t> readBufferSize_;
+    std::atomic<int64_t> idleTimeoutMs_;
+    std::atomic<int64_t> outputLowWaterMark_;
+    std::atomic<int64_t> outputHighWaterMark_;
+    std::atomic<int64_t> outputLimit_;
+    std::atomic<int64_t> proxyBufferSize_;
+    std::atomic<int64_t> fileCacheMaxFileSize_;
+    std::atomic<int64_t> fileCacheMaxTotalSize_;
+    std::atomic<int64_t> compressMaxSize_;
+    std::atomic<int64_t> drainTimeoutMs_;
+    std::atomic<int64_t> adminRemoteAccess_;
+};
+
+ServerConfig *ServerConfig::GetInstance()
+{
+    static ServerConfig config;
+    return &config;
+}
+
+ServerConfig::ServerConfig()
+    : maxEvents_(MAXEVENTNUM),
+      pollTimeoutMs_(TIMEOUT),
+      maxConnections_(MAXCONNECTION),
+      readBufferSize_(READ_BUFSIZE),
+      idleTimeoutMs_(IDLE_TIMEOUT),
+      outputLowWaterMark_(OUTPUT_LOW_WATERMARK),
+      outputHighWaterMark_(OUTPUT_HIGH_WATERMARK),
+      outputLimit_(OUTPUT_LIMIT),
+      proxyBufferSize_(PROXY_RELAY_BUFSIZE),
+      fileCacheMaxFileSize_(FILE_CACHE_MAX_FILE_SIZE),
+      fileCacheMaxTotalSize_(FILE_CACHE_MAX_TOTAL_SIZE),
+      compressMaxSize_(COMPRESS_MAX_SIZE),
+      drainTimeoutMs_(DRAIN_TIMEOUT),
+      adminRemoteAccess_(ADMIN_REMOTE_ACCESS)
+{
+    const int64_t maxBytes = (int64_t)1 << 40;
+    knobs_ = {
+        {"maxEvents", &maxEvents_, 1, 1 << 20, false},
+        {"pollTimeoutMs", &pollTimeoutMs_, 1, 60000, true},
+        {"maxConnections", &maxConnections_, 1, 1 << 24, true},
+        {"readBufferSize", &readBufferSize_, 512, READ_BUFSIZE_MAX, true},
+        {"idleTimeoutMs", &idleTimeoutMs_, 1, 24 * 3600 * 1000, true},
+        {"outputLowWaterMark", &outputLowWaterMark_, 0, maxBytes, true},
+        {"outputHighWaterMark", &outputHighWaterMark_, 1, maxBytes, true},
+        {"outputLimit", &outputLimit_, 1, maxBytes, true},
+        {"proxyBufferSize", &proxyBufferSize_, 4096, 64 * 1024 * 1024, true},
+        {"fileCacheMaxFileSize", &fileCacheMaxFileSize_, 0, maxBytes, true},
+        {"fileCacheMaxTotalSize", &fileCacheMaxTotalSize_, 0, maxBytes, true},
+        {"compressMaxSize", &compressMaxSize_, 0, maxBytes, true},
+        {"drainTimeoutMs", &drainTimeoutMs_, 0, 3600 * 1000, true},
+        {"adminRemoteAccess", &adminRemoteAccess_, 0, 1, true}};
+    const char *path = getenv("NETSERVER_CONFIG");
+    path_ = path && *path ? path : "netserver.json";
+    Load(false);
+}
+
+bool ServerConfig::Reload()
+{
+    LOG(LoggerLevel::INFO, "重新读取配置文件：%s\n", path_.c_str());
+    return Load(true);
+}
+
+/*
+ * 读取配置文件并更新参数
+ * 先校验全部取值再统一写入，任一取值越界或水位不满足低水位<=高水位<=硬上限时不更新任何参数
+ * 热加载时启动参数的修改只记录日志
+ *
+ */
+bool ServerConfig::Load(bool reload)
+{
+    Json::Value root;
+    if (!Parse(root))
+        return false;
+    std::vector<int64_t> values;
+    for (const Knob &knob : knobs_)
+    {
+        int64_t value = knob.value->load(std::memory_order_relaxed);
+        if (root.isMember(knob.key))
+        {
+            const Json::Value &item = root[knob.key];
+            if (!item.isIntegral() || item.asInt64() < knob.min || item.asInt64() > knob.max)
+            {
+                LOG(LoggerLevel::ERROR, "配置项%s取值无效，应为%lld~%lld的整数，配置文件未生效：%s\n",
+                    knob.key, (long long)knob.min, (long long)knob.max, path_.c_str());
+                return false;
+            }
+            if (!reload || knob.reloadable)
+                value = item.asInt64();
+            else if (item.asInt64() != value)
+                LOG(LoggerLevel::WARNING, "配置项%s需重启生效\n", knob.key);
+        }
+        values.push_back(value);
+    }
+    std::function<int64_t(const std::atomic<int64_t> &)> pending = [this, &values](const std::atomic<int64_t> &target)
+    {
+        for (size_t i = 0; i < knobs_.size(); ++i)
+            if (knobs_[i].value == &target)
+                return values[i];
+        return target.load(std::memory_order_relaxed);
+    };
+    int logLevel = root.isMember("logLevel") ? ParseLogLevel(root["logLevel"]) : Logger::GetInstance()->GetLevel();
+    if (logLevel < 0 || pending(outputLowWaterMark_) > pending(outputHighWaterMark_) || pending(outputHighWaterMark_) > pending(outputLimit_))
+    {
+        LOG(LoggerLevel::ERROR, "配置项logLevel或输出队列水位无效，配置文件未生效：%s\n", path_.c_str());
+        return false;
+    }
+    for (size_t i = 0; i < knobs_.size(); ++i)
+        knobs_[i].value->store(values[i], std::memory_order_relaxed);
+    Logger::GetInstance()->SetLevel(logLevel);
+    if (!reload)
+        startup_ = root;
+    LOG(LoggerLevel::INFO, "配置文件已生效：%s\n", path_.c_str());
+    return true;
+}
+
+/*
+ * 读取并解析配置文件，文件不存在时返回false且不记录错误
+ *
+ */
+bool ServerConfig::Parse(Json::Value &root)
+{
+    std::ifstream file(path_);
+    if (!file)
+    {
+        if (getenv("NETSERVER_CONFIG"))
+            LOG(LoggerLevel::ERROR, "无法打开配置文件：%s\n", path_.c_str());
+        return false;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    Json::Reader reader;
+    if (!reader.parse(content.str(), root) || !root.isObject())
+    {
+        LOG(LoggerLevel::ERROR, "配置文件格式错误：%s，%s\n", path_.c_str(), reader.getFormattedErrorMessages().c_str());
+        return false;
+    }
+    return true;
+}
+
+int ServerConfig::StartupInt(const char *key, int defaultValue) const
+{
+    const Json::Value &value = startup_[key];
+    return value.isIntegral() ? value.asInt() : defaultValue;
+}
+
+/*
+ * 线程数可为整数或"auto"，"auto"按可用CPU数确定，见CpuAffinity::ThreadNum
+ *
+ */
+int ServerConfig::StartupThreads(const char *key, int defaultValue, CpuAffinity::Role role) const
+{
+    const Json::Value &value = startup_[key];
+    if (value.isIntegral())
+        return value.asInt();
+    if (value.isString())
+        return CpuAffinity::ThreadNum(value.asCString(), role);
+    return defaultValue;
+}
+
+int ServerConfig::ParseLogLevel(const Json::Value &value)
+{
+    if (value.isIntegral())
+        return value.asInt() >= DEBUG && value.asInt() <= FATAL ? value.asInt() : -1;
+    if (!value.isString())
+        return -1;
+    for (int level = DEBUG; level <= FATAL; ++level)
+        if (value.asString() == LevelString[level])
+            return level;
+    return -1;
+}
@@ -0,0 +1,432 @@
+// ServerLifecycle类：
+//  进程级的优雅退出与热重启，协调进程内所有TcpServer，由TcpServer.hpp在TcpServer类定义之后包含
+//  TcpServer构造时登记、析构时注销；服务main在进入主loop前调用Start，进程内的TcpServer须共用这个主loop
+//  优雅退出：SIGTERM/SIGINT时所有TcpServer停止accept并排空连接（见TcpConnection::Drain），在途请求的响应发送完毕后关闭连接，
+//  超过配置的drainTimeoutMs毫秒（默认10000）仍未关闭的连接强制关闭，之后退出主loop，由各对象析构回收事件池线程与线程池
+//  热重启：环境变量NETSERVER_HANDOFF_PATH指定Unix域套接字路径，旧进程在该路径上等待交接
+//    1. 新进程启动时连接该路径，旧进程以SCM_RIGHTS发送全部监听套接字及其端口
+//    2. 新进程的TcpServer按端口接管继承的监听套接字，不再bind；全部构造完毕后Start通知旧进程，并在该路径上等待下一次交接
+//    3. 旧进程收到通知后停止accept并排空，与优雅退出相同
+//    新旧进程共享同一个监听套接字，交接期间到达的连接留在backlog中由新进程accept，不会被拒绝；
+//    新进程在通知前退出时旧进程照常服务
+//  SIGHUP时重新读取配置文件，见ServerConfig.hpp
+//  信号处理函数只记录信号并向eventfd写入，排空与重新读取配置在主loop内执行
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <csignal>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include "Channel.hpp"
+#include "EventLoop.hpp"
+#include "LogServer.hpp"
+#include "ServerConfig.hpp"
+
+#define HANDOFF_MAX_LISTENERS 64 // 一次交接的监听套接字数量上限
+#define DRAIN_CHECK_MS 100       // 排空期间检查剩余连接数的间隔
+#define ABORT_GRACE_MS 1000      // 强制关闭后等待连接清理完毕的最长时间
+
+class ServerLifecycle
+{
+public:
+    static ServerLifecycle *GetInstance();
+    int TakeListener(int port);          // 取出从旧进程继承的端口为port的监听套接字，没有时返回-1
+    void Register(TcpServer *server);    // TcpServer构造时登记
+    void Unregister(TcpServer *server);  // TcpServer析构时注销
+    void Start(EventLoop *loop);         // 在主loop所在线程调用：安装信号处理，完成热重启交接，开始等待下一次交接
+    void BeginDrain();                   // 停止accept并排空连接，完毕后退出主loop，在主loop所在线程调用
+
+private:
+    ServerLifecycle();
+    void Inherit();                      // 连接旧进程，接收监听套接字
+    void ListenHandoff();                // 在NETSERVER_HANDOFF_PATH上等待新进程
+    void OnHandoffAccept();              // 新进程连接：发送全部监听套接字
+    void OnHandoffReady();               // 新进程的通知：开始排空
+    void CloseHandoff();                 // 关闭交接连接
+    void OnSignal();                     // 信号eventfd可读：重新读取配置或开始排空
+    void CheckDrained();                 // 周期任务：检查剩余连接数与期限
+    static void SignalHandler(int sig);
+    static int64_t NowMs();
+
+    std::mutex mutex_;                   // 保护servers_与inherited_
+    std::vector<TcpServer *> servers_;   // 进程内的TcpServer
+    std::map<int, int> inherited_;       // 端口->从旧进程继承、尚未被接管的监听套接字
+    EventLoop *loop_;                    // 主loop
+    std::string handoffPath_;            // 交接路径，为空时不支持热重启
+    int handoffConn_;                    // 新进程：与旧进程的交接连接；旧进程：与新进程的交接连接
+    int handoffListenFd_;                // 在交接路径上等待新进程的套接字
+    Channel handoffListenChannel_;
+    Channel handoffConnChannel_;
+    Channel signalChannel_;
+    static int signalFd_;                // 信号处理函数写入的eventfd
+    static volatile sig_atomic_t exitPending_;   // 收到SIGTERM/SIGINT
+    static volatile sig_atomic_t reloadPending_; // 收到SIGHUP
+    bool draining_;                      // 已开始排空
+    int64_t deadline_;                   // 排空期限的时间点，强制关闭后为等待清理的时间点
+    bool aborted_;                       // 已强制关闭剩余连接
+    EventLoop::TimerId drainTimer_;      // 排空检查周期任务
+};
+
+int ServerLifecycle::signalFd_ = -1;
+volatile sig_atomic_t ServerLifecycle::exitPending_ = 0;
+volatile sig_atomic_t ServerLifecycle::reloadPending_ = 0;
+
+ServerLifecycle *ServerLifecycle::GetInstance()
+{
+    static ServerLifecycle lifecycle;
+    return &lifecycle;
+}
+
+ServerLifecycle::ServerLifecycle()
+    : loop_(nullptr),
+      handoffConn_(-1),
+      handoffListenFd_(-1),
+      draining_(false),
+      deadline_(0),
+      aborted_(false),
+      drainTimer_(0)
+{
+    const char *path = getenv("NETSERVER_HANDOFF_PATH");
+    if (path && *path)
+    {
+        handoffPath_ = path;
+        Inherit();
+    }
+}
+
+/*
+ * 连接交接路径上的旧进程，接收监听套接字
+ * 没有旧进程（路径不存在或无人监听）时直接返回，之后的TcpServer正常bind
+ * 消息内容为端口数组，控制消息按同样的顺序携带监听套接字
+ *
+ */
+void ServerLifecycle::Inherit()
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, handoffPath_.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+    int ports[HANDOFF_MAX_LISTENERS];
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_LISTENERS)];
+    struct iovec iov = {ports, sizeof(ports)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    struct cmsghdr *cmsg = n > 0 ? CMSG_FIRSTHDR(&msg) : nullptr;
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+    {
+        LOG(LoggerLevel::ERROR, "热重启交接失败，未收到监听套接字，路径：%s\n", handoffPath_.c_str());
+        close(fd);
+        return;
+    }
+    int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    int *fds = (int *)CMSG_DATA(cmsg);
+    for (int i = 0; i < count; ++i)
+    {
+        if (i < n / (ssize_t)sizeof(int))
+            inherited_[ports[i]] = fds[i];
+        else
+            close(fds[i]);
+    }
+    handoffConn_ = fd;
+    LOG(LoggerLevel::INFO, "从旧进程继承%d个监听套接字，路径：%s\n", (int)inherited_.size(), handoffPath_.c_str());
+    std::cout << "ServerLifecycle::Inherit 从旧进程继承" << inherited_.size() << "个监听套接字" << std::endl;
+}
+
+int ServerLifecycle::TakeListener(int port)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<int, int>::iterator iter = inherited_.find(port);
+    if (inherited_.end() == iter)
+        return -1;
+    int fd = iter->second;
+    inherited_.erase(iter);
+    return fd;
+}
+
+void ServerLifecycle::Register(TcpServer *server)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    servers_.push_back(server);
+}
+
+void ServerLifecycle::Unregister(TcpServer *server)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    servers_.erase(std::remove(servers_.begin(), servers_.end(), server), servers_.end());
+}
+
+/*
+ * 在主loop所在线程、进入loop之前调用
+ * 忽略SIGPIPE，SIGTERM/SIGINT开始排空，SIGHUP重新读取配置；继承了监听套接字时通知旧进程开始排空，未被接管的套接字关闭
+ *
+ */
+void ServerLifecycle::Start(EventLoop *loop)
+{
+    loop_ = loop;
+    signal(SIGPIPE, SIG_IGN);
+    signalFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    signalChannel_.SetFd(signalFd_);
+    signalChannel_.SetEvents(EPOLLIN | EPOLLET);
+    signalChannel_.SetReadHandle(std::bind(&ServerLifecycle::OnSignal, this));
+    loop_->AddChannelToPoller(&signalChannel_);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &ServerLifecycle::SignalHandler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGHUP, &action, nullptr);
+    if (handoffConn_ >= 0)
+    {
+        char ready = 'R';
+        if (write(handoffConn_, &ready, 1) != 1)
+            LOG(LoggerLevel::ERROR, "通知旧进程排空失败，路径：%s\n", handoffPath_.c_str());
+        close(handoffConn_);
+        handoffConn_ = -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::map<int, int>::iterator iter = inherited_.begin(); iter != inherited_.end(); ++iter)
+            close(iter->second);
+        inherited_.clear();
+    }
+    if (!handoffPath_.empty())
+        ListenHandoff();
+}
+
+void ServerLifecycle::SignalHandler(int sig)
+{
+    // 信号处理函数内只设置标志并调用异步信号安全的write
+    if (SIGHUP == sig)
+        reloadPending_ = 1;
+    else
+        exitPending_ = 1;
+    uint64_t one = 1;
+    ssize_t n = write(signalFd_, &one, sizeof(one));
+    (void)n;
+}
+
+void ServerLifecycle::OnSignal()
+{
+    uint64_t count = 0;
+    ssize_t n = read(signalFd_, &count, sizeof(count));
+    (void)n;
+    if (reloadPending_)
+    {
+        reloadPending_ = 0;
+        ServerConfig::GetInstance()->Reload();
+    }
+    if (exitPending_)
+    {
+        exitPending_ = 0;
+        LOG(LoggerLevel::INFO, "%s\n", "收到退出信号，开始排空连接");
+        std::cout << "ServerLifecycle::OnSignal 收到退出信号，开始排空连接" << std::endl;
+        BeginDrain();
+    }
+}
+
+/*
+ * 在交接路径上等待新进程，路径上的旧套接字文件（旧进程已交接或已退出）先删除
+ *
+ */
+void ServerLifecycle::ListenHandoff()
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, handoffPath_.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(handoffPath_.c_str());
+    handoffListenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (handoffListenFd_ < 0 || bind(handoffListenFd_, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(handoffListenFd_, 1) < 0)
+    {
+        LOG(LoggerLevel::ERROR, "监听热重启交接路径失败，路径：%s\n", handoffPath_.c_str());
+        perror("监听热重启交接路径失败");
+        if (handoffListenFd_ >= 0)
+            close(handoffListenFd_);
+        handoffListenFd_ = -1;
+        return;
+    }
+    handoffListenChannel_.SetFd(handoffListenFd_);
+    handoffListenChannel_.SetEvents(EPOLLIN);
+    handoffListenChannel_.SetReadHandle(std::bind(&ServerLifecycle::OnHandoffAccept, this));
+    loop_->AddChannelToPoller(&handoffListenChannel_);
+}
+
+/*
+ * 新进程连接交接路径，发送全部监听套接字，之后等待其通知
+ * 同一时刻只处理一个新进程，排空开始后不再交接
+ *
+ */
+void ServerLifecycle::OnHandoffAccept()
+{
+    int fd = accept4(handoffListenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+    if (draining_ || handoffConn_ >= 0)
+    {
+        close(fd);
+        return;
+    }
+    int ports[HANDOFF_MAX_LISTENERS];
+    int fds[HANDOFF_MAX_LISTENERS];
+    int count = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < servers_.size() && count < HANDOFF_MAX_LISTENERS; ++i)
+        {
+            struct sockaddr_in addr;
+            socklen_t length = sizeof(addr);
+            fds[count] = servers_[i]->ListenFd();
+            if (getsockname(fds[count], (struct sockaddr *)&addr, &length) == 0)
+                ports[count++] = ntohs(addr.sin_port);
+        }
+    }
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_LISTENERS)];
+    memset(control, 0, sizeof(control));
+    struct iovec iov = {ports, sizeof(int) * count};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+    if (0 == count || sendmsg(fd, &msg, MSG_NOSIGNAL) < 0)
+    {
+        LOG(LoggerLevel::ERROR, "向新进程发送监听套接字失败，路径：%s\n", handoffPath_.c_str());
+        close(fd);
+        return;
+    }
+    LOG(LoggerLevel::INFO, "已向新进程发送%d个监听套接字，等待其就绪\n", count);
+    std::cout << "ServerLifecycle::OnHandoffAccept 已向新进程发送" << count << "个监听套接字，等待其就绪" << std::endl;
+    handoffConn_ = fd;
+    handoffConnChannel_.SetFd(handoffConn_);
+    handoffConnChannel_.SetEvents(EPOLLIN);
+    handoffConnChannel_.SetReadHandle(std::bind(&ServerLifecycle::OnHandoffReady, this));
+    loop_->AddChannelToPoller(&handoffConnChannel_);
+}
+
+/*
+ * 新进程的通知：收到就绪字节时停止等待交接并开始排空
+ * 连接关闭而未收到通知说明新进程启动失败，旧进程继续服务并等待下一次交接
+ *
+ */
+void ServerLifecycle::OnHandoffReady()
+{
+    char ready = 0;
+    ssize_t n = read(handoffConn_, &ready, 1);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+    CloseHandoff();
+    if (1 != n || 'R' != ready)
+    {
+        LOG(LoggerLevel::ERROR, "%s\n", "新进程未就绪即断开，继续服务");
+        std::cout << "ServerLifecycle::OnHandoffReady 新进程未就绪即断开，继续服务" << std::endl;
+        return;
+    }
+    LOG(LoggerLevel::INFO, "%s\n", "新进程已就绪，开始排空连接");
+    std::cout << "ServerLifecycle::OnHandoffReady 新进程已就绪，开始排空连接" << std::endl;
+    // 交接路径已由新进程重新绑定，旧进程只关闭自己的套接字，不删除路径
+    loop_->RemoveChannelToPoller(&handoffListenChannel_);
+    close(handoffListenFd_);
+    handoffListenFd_ = -1;
+    BeginDrain();
+}
+
+void ServerLifecycle::CloseHandoff()
+{
+    loop_->RemoveChannelToPoller(&handoffConnChannel_);
+    close(handoffConn_);
+    handoffConn_ = -1;
+}
+
+/*
+ * 所有TcpServer停止accept并排空连接，周期检查剩余连接数
+ *
+ */
+void ServerLifecycle::BeginDrain()
+{
+    if (draining_ || !loop_)
+        return;
+    draining_ = true;
+    std::vector<TcpServer *> servers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        servers = servers_;
+    }
+    for (TcpServer *server : servers)
+        server->Drain();
+    deadline_ = NowMs() + ServerConfig::GetInstance()->DrainTimeoutMs();
+    drainTimer_ = loop_->RunEvery(DRAIN_CHECK_MS, std::bind(&ServerLifecycle::CheckDrained, this));
+    CheckDrained();
+}
+
+/*
+ * 连接全部关闭后退出主loop；超过期限时强制关闭剩余连接，再等待至多ABORT_GRACE_MS毫秒
+ *
+ */
+void ServerLifecycle::CheckDrained()
+{
+    size_t connections = 0;
+    std::vector<TcpServer *> servers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        servers = servers_;
+    }
+    for (TcpServer *server : servers)
+        connections += server->ConnectionCount();
+    int64_t now = NowMs();
+    if (connections && now < deadline_)
+        return;
+    if (connections && !aborted_)
+    {
+        LOG(LoggerLevel::ERROR, "排空超过期限，强制关闭剩余的%d个连接\n", (int)connections);
+        std::cout << "ServerLifecycle::CheckDrained 排空超过期限，强制关闭剩余的" << connections << "个连接" << std::endl;
+        aborted_ = true;
+        deadline_ = now + ABORT_GRACE_MS;
+        for (TcpServer *server : servers)
+            server->Abort();
+        return;
+    }
+    LOG(LoggerLevel::INFO, "排空结束，剩余连接数：%d，退出主loop\n", (int)connections);
+    std::cout << "ServerLifecycle::CheckDrained 排空结束，退出主loop" << std::endl;
+    if (drainTimer_)
+    {
+        loop_->CancelTimer(drainTimer_);
+        drainTimer_ = 0;
+    }
+    loop_->Quit();
+}
+
+int64_t ServerLifecycle::NowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -24,20 +24,35 @@ private:
 
 public:
     Socket();
+    explicit Socket(int fd);    // 接管已有的套接字描述符，fd小于0时创建新的套接字
     ~Socket();
     int fd() const { return _socketFd; } // 获取套接字描述符
     void SetReuseAddr();    // 地址重用
     void SetNonblocking();  // 非阻塞IO
     bool BindAddress(int serverport);   // 绑定监听IP:端口
     bool Listen();  // 监听启动
+    bool IsListening() const;   // 是否已处于监听状态，如热重启时从旧进程继承的监听套接字
     int Accept(struct sockaddr_in &clientaddr); // 响应连接
     bool Close(); // 关闭套接字连接
 
 };
 
 Socket::Socket()
+    : Socket(-1)
+{
+}
+
+/*
+ * 接管已有的套接字描述符
+ * 热重启时新进程接管旧进程交接的监听套接字，fd小于0表示没有可接管的套接字，创建新的套接字
+ *
+ */
+Socket::Socket(int fd)
+    : _socketFd(fd)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", _socketFd);
+    if (_socketFd >= 0)
+        return;
     _socketFd = socket(AF_INET, SOCK_STREAM, 0);
     if (-1 == _socketFd)
     {
@@ -134,6 +149,17 @@ bool Socket::Listen()
     return true;
 }
 
+/*
+ * 是否已处于监听状态
+ * 
+ */
+bool Socket::IsListening() const
+{
+    int listening = 0;
+    socklen_t length = sizeof(listening);
+    return getsockopt(_socketFd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &length) == 0 && listening;
+}
+
 /*
  * 套接字响应IP连接
  * 
@@ -6,31 +6,52 @@
 //  该类的上述四个函数不同于高级服务的四个函数，高级服务的四个函数会注册到TcpServer内待绑定
 //  该类会根据请求的url映射绑定高级服务函数到messageCallback_、sendcompleteCallback_、error、close等函数指针
 //  即高级服务的待绑定函数只能由该类调用，该类的被绑定函数只能由内置Channel调用
+//  连接状态不加锁，同一时刻只由一个线程持有：加入loop前为创建线程，之后为loop所在线程
+//  交给线程池处理时以SetAsyncProcessing(true)借给工作线程，期间loop不读取新请求；工作线程的响应写入独立的暂存区，
+//  SendBufferOut将暂存区移交给loop任务后由loop写入发送队列，工作线程不触碰loop正在发送的bufferOut_与fileOut_，
+//  之后以SetAsyncProcessing(false)归还；其他线程只能调用标注可跨线程调用的函数，经loop任务队列投递
+//  HTTP/1.x连接在上一个响应发送完毕之前也不读取新请求，流水线请求依次处理
+//  h2c连接的每个流由一个流连接承载：流连接与父连接共用loop与套接字，持有独立的请求、响应缓冲与借出标志，
+//  各流同时分发给服务函数，响应转换为帧后经父连接的HTTP/2会话发送，流连接随即关闭
+//  加入loop时连接持有一个指向自身的智能指针self_，代表loop对连接的所有权，HandleClose后由清理任务释放
+//  loop所在线程内的事件处理与服务回调借用self_，不再每次事件复制shared_ptr，原子引用计数只在跨线程投递任务时增减
+//  Channel请求recv完成模式：io_uring下由Poller接收数据，recvn直接取走暂存的数据；epoll下照常read
 
 #pragma once
 
 #include <iostream>
 #include <map>
-#include <mutex>
 #include <string>
 #include <thread>
 #include <memory>
+#include <atomic>
+#include <cassert>
 #include <cerrno>
 #include <cstdlib>
 #include <fstream>
 #include <sstream>
+#include <deque>
 #include <functional>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "Timer.hpp"
 #include "Channel.hpp"
 #include "EventLoop.hpp"
 #include "LogServer.hpp"
+#include "ServerConfig.hpp"
 #include "TypeIdentify.hpp"
+#include "Http2Session.hpp"
+#include "WebSocket.hpp"
+#include "Codec.hpp"
+#include "Metrics.hpp"
 
-#define BUFSIZE 4096
+#define READ_BUDGET (64 * 1024) // 每次读事件最多读取的字节数，超出后排入EventLoop就绪列表下一轮再读，避免单个连接独占loop线程
+#define READ_WAIT_MAX (16 * 1024 * 1024) // recv完成模式下等待完整HTTP/1.x请求时暂存的字节数上限
+// 每次read的字节数、空闲超时与输出队列水位的默认值见ServerConfig.hpp，可由配置文件修改
 
 // http请求信息结构
 typedef struct _HttpRequestContext
@@ -45,6 +66,15 @@ typedef struct _HttpRequestContext
     std::string body;
 } HttpRequestContext;
 
+// 待发送文件段，先发送head，再从文件的offset处发送length字节，文件内容经sendfile直接发送不经过用户态缓冲区
+typedef struct _FileSegment
+{
+    std::string head;            // 文件内容之前需要发送的数据，例如multipart分段头
+    std::shared_ptr<int> fileFd; // 文件描述符，所有引用释放时关闭，为空表示仅发送head
+    off_t offset;                // 文件发送偏移
+    size_t length;               // 剩余待发送的文件字节数
+} FileSegment;
+
 // http响应信息结构
 typedef struct _HttpResponseContext
 {
@@ -61,12 +91,19 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection>
 public:
     typedef std::shared_ptr<TcpConnection> spTcpConnection;  // 指向TcpConnection的智能指针
     typedef std::function<void(spTcpConnection &)> Callback; // 回调函数
+    typedef std::function<void(spTcpConnection &, WebSocket::Opcode, std::string &)> WebSocketCallback; // WebSocket完整消息回调
+    typedef std::function<bool(spTcpConnection &, std::string &)> StreamCallback; // 自定义协议字节流回调，取走缓冲区内完整的帧，返回false关闭连接
+    typedef std::function<void(spTcpConnection &, const char *, size_t)> CodecCallback; // 编解码器切分出的完整消息回调，消息指向接收缓冲区，仅在回调内有效
+    typedef std::function<void(spTcpConnection &, bool)> WatermarkCallback; // 输出队列越过高水位（true）或回落到低水位（false）时回调，在loop所在线程执行
     TcpConnection(EventLoop *loop, int fd, const struct sockaddr_in &clientaddr);
+    TcpConnection(const spTcpConnection &parent, uint32_t streamId, HttpRequestContext &request); // h2c连接上承载一个流的流连接
     ~TcpConnection();
     int fd() const { return fd_; }               // 获取套接字描述符
     EventLoop *GetLoop() const { return loop_; } // 获取事件池指针
-    Channel *GetChannel() { return spChannel_.get(); } // 获取内置Channel的指针
+    Channel *GetChannel() { return &channel_; }  // 获取内置Channel的指针
     int recvn(int fd, std::string &recvMsg);     // 从客户端fd接收数据
+    int TakeReceived(std::string &recvMsg);      // recv完成模式下取走Poller已接收的数据
+    void ResumeReceive();                        // 恢复Poller因暂存数据达到上限而暂停的recv
     int sendn(int fd, std::string &sendMsg);     // 发送数据到客户端fd
     void requestToOut();                         // 从HttpResponseContext重构请求信息到bufferOut_
     void Send(const std::string &s);             // 发送信息函数，指定EventLoop执行
@@ -77,6 +114,8 @@ public:
     void SendInLoop();                           // 发送信息函数，由EventLoop执行
     void AddChannelToLoop();                     // EventLoop添加监听Channel
     void Shutdown();                             // 关闭当前连接，指定EventLoop执行HandleClose函数
+    void Drain();                                // 优雅关闭：空闲时立即关闭，处理中的请求响应发送完毕后关闭，可跨线程调用
+    void Abort();                                // 强制关闭：终止收发，借给工作线程的连接随之结束，可跨线程调用
     void HandleRead();                           // 由TcpConnection的Channel调用，接收客户端发送的数据，再调用绑定的messageCallback_函数
     void HandleWrite();                          // 由TcpConnection的Channel调用，向客户端发送数据，再调用绑定的sendcompleteCallback_函数
     void HandleError();                          // 由TcpConnection的Channel调用，处理连接错误，再调用绑定的errorCallback_函数及HandleClose函数
@@ -88,6 +127,7 @@ public:
     Timer *GetTimer();                           // 获取定时器指针
     void StartTimer();                           // 启动定时器
     bool IsDisconnected();                       // 判断连接是否已关闭
+    const struct sockaddr_in &GetClientAddr() const { return clientAddr_; } // 获取对端地址
     bool WillKeepAlive();                        // 获取长连接标志
     void SetKeepAlive(bool keepalive);           // 设置长连接标志
     HttpRequestContext &GetReqestBuffer();       // 获取请求解析结构体的引用
@@ -103,7 +143,14 @@ public:
     void SetBindedHandler(const bool BindedHandler);     // 设置处理函数绑定状态
     bool GetBindedHandler(const bool BindedHandler);     // 获取处理函数绑定状态
     int  SetSendMessage(const std::string &newMsg);      // 截断并设置bufferOut_的内容
-    int  AddSendMessage(const std::string &newMsg);      // 添加新数据到bufferOut_
+    int  AddSendMessage(const std::string &newMsg);      // 添加新数据到bufferOut_，超过输出队列上限时丢弃并关闭连接，返回-1
+    // 设置输出队列的低水位、高水位与硬上限，字节数；文件段只计入head，文件内容经sendfile发送不占用内存
+    void SetOutputWatermarks(size_t lowWaterMark, size_t highWaterMark, size_t outputLimit);
+    void SetWatermarkCallback(const WatermarkCallback &cb); // 设置输出队列越过高水位与回落到低水位时的回调，生产者据此暂停与恢复
+    bool IsOutputPaused() const { return outputPaused_.load(std::memory_order_relaxed); } // 输出队列是否处于高水位，可跨线程调用
+    // 添加文件段到发送队列，在bufferOut_发送完毕后依次发送，fileFd为空时仅发送head
+    void AddSendFile(const std::shared_ptr<int> &fileFd, off_t offset, size_t length, const std::string &head = "");
+    static std::shared_ptr<int> OpenSendFile(const std::string &filePath); // 只读打开待发送文件，失败返回nullptr
     void SetAsyncProcessing(const bool asyncProcessing); // 设置异步处理标志
     void SetDynamicHandler(const Callback &cb);          // 设置向TcpServer申请动态绑定函数的函数
     void SetMessaeCallback(const Callback &cb);          // 设置连接处理函数
@@ -111,23 +158,97 @@ public:
     void SetCloseCallback(const Callback &cb);           // 设置关闭处理函数
     void SetErrorCallback(const Callback &cb);           // 设置出错处理函数
     void SetConnectionCleanUp(const Callback &cb);       // 设置连接清空函数，此函数独属于TcpServer
+    // 校验当前请求并升级为WebSocket连接，在loop所在线程调用，之后收到的完整消息回调cb；pingIntervalMs为0时不发送ping
+    bool UpgradeWebSocket(const WebSocketCallback &cb, int pingIntervalMs = WEBSOCKET_PING_INTERVAL);
+    bool IsWebSocket() const { return websocket_ != nullptr; } // 是否已升级为WebSocket连接
+    void SendWebSocketFrame(WebSocket::Opcode opcode, const std::string &payload); // 发送一条文本或二进制消息，可跨线程调用
+    void SendWebSocketFrame(const std::shared_ptr<const std::string> &frame);     // 发送已编码的帧，广播时多个连接共享同一份编码结果，可跨线程调用
+    void CloseWebSocket(uint16_t code, const std::string &reason = "");          // 发起WebSocket关闭握手，可跨线程调用
+    // 响应101并将连接切换为protocol协议的字节流，在loop所在线程调用，之后收到的数据回调cb，不再经过http解析
+    bool UpgradeStream(const std::string &protocol, const StreamCallback &cb);
+    bool IsStream() const { return static_cast<bool>(streamCallback_); }        // 是否已切换为自定义协议字节流
+    void SendStream(const std::shared_ptr<const std::string> &data);            // 发送已编码的自定义协议数据，可跨线程调用
+    // 连接从建立起即以codec切分消息，不经过http解析，在连接加入loop之前由TcpServer调用
+    void StartCodec(const std::shared_ptr<Codec> &codec, const CodecCallback &cb);
+    void SendMessage(const char *message, size_t length); // 以连接的编解码器编码并发送一条消息，可跨线程调用
+    void SendMessage(const std::string &message);
+    // 记录本次请求到达stage阶段的时间，仅在请求被采样追踪时生效，每个阶段只记录首次到达
+    void Trace(TraceStage stage)
+    {
+        if (trace_ && !trace_->stamps[stage].load(std::memory_order_relaxed))
+            trace_->stamps[stage].store(RequestTracer::Now(), std::memory_order_relaxed);
+    }
+
+private:
+    int SendFileOut();                                   // 发送fileOut_队列内的文件段，出错返回-1
+    void DispatchRequest();                              // 动态绑定并回调高级服务处理httpRequestContext_
+    void IdleTimeout();                                  // 空闲定时器触发函数，在时间轮工作线程执行，投递HandleIdle到loop
+    void HandleIdle();                                   // 空闲超时，在loop所在线程执行：仍在处理或发送时重新计时，否则关闭连接
+    bool IsHttp2Preface();                               // bufferIn_是否以HTTP/2连接序言开头
+    void StartHttp2();                                   // 连接切换为h2c，创建HTTP/2会话
+    void OnHttp2Request(uint32_t streamId, HpackHeaderList &headers, std::string &body); // HTTP/2请求接收完整，映射为HttpRequestContext排队
+    void OnHttp2Output(std::string &data, const std::shared_ptr<int> &fileFd, off_t offset, size_t length); // HTTP/2会话输出加入fileOut_
+    void DispatchHttp2();                                // 为每个等待的HTTP/2请求创建流连接并交给服务函数
+    void SendHttp2Response();                            // 流连接：将服务函数写入bufferOut_的响应转换为本流的HEADERS与DATA帧
+    void FeedWebSocket(const std::string &data);         // 输入交给WebSocket会话解析
+    void OnWebSocketMessage(WebSocket::Opcode opcode, std::string &message); // WebSocket完整消息回调服务函数
+    void OnWebSocketOutput(std::string &frame);          // WebSocket会话输出加入bufferOut_
+    void FlushWebSocket(bool healthy);                   // 发送bufferOut_内的帧，会话结束时发送完毕后关闭连接
+    void PingWebSocket();                                // 周期任务：发送ping，上一次ping后未收到任何数据则关闭连接
+    void FeedStream();                                   // bufferIn_交给自定义协议字节流回调
+    bool FeedCodec(spTcpConnection &sptcpconn, std::string &bufferIn); // 以编解码器切分bufferIn内的完整消息并回调服务函数
+    void StartTrace();                                   // 按采样率开始追踪新读取的请求
+    void FinishTrace();                                  // 响应发送完毕，结束追踪并交给RequestTracer
+    bool BuffersInput() const { return websocket_ || streamCallback_ || http2_ || codec_; } // 协议自行缓存未成帧的输入
+    bool ReadBoundary(const std::string &buffer);        // 已读数据达到预算时能否在此停止读取
+    void QueueResumeRead();                              // 排入EventLoop就绪列表，下一轮继续读取
+    void ResumeRead();                                   // 就绪列表回调，继续读取上次因预算停止的数据
+    bool AppendOutput(const std::string &data);          // 追加数据到bufferOut_，超过输出队列上限时丢弃并关闭连接
+    void CheckOutput();                                  // 发送后检查输出队列水位，越过高水位暂停读取，回落到低水位恢复
+    void CommitResponse(std::string &out, std::deque<FileSegment> &files); // 工作线程提交的响应写入发送队列并发送，在loop所在线程执行
+    void ReturnFromWorker();                             // 工作线程归还连接后，在loop所在线程补做借出期间推迟的关闭、分发与续读
+    void DrainInLoop();                                  // Drain在loop所在线程的实现
+    void ReleaseSelf();                                  // 清理任务：释放loop持有的自身引用并交给TcpServer清理
+    // loop所在线程借用的自身引用，未经AddChannelToLoop的连接在首次借用时建立
+    // 关闭后self_由清理任务释放，此后的事件入口均先检查disConnected_，不得再借用，重新建立会使连接循环引用自身而泄漏
+    spTcpConnection &Self()
+    {
+        assert(self_ || !disConnected_);
+        if (!self_ && !disConnected_)
+            self_ = shared_from_this();
+        return self_;
+    }
+    // 当前线程是否为借用连接的工作线程，是则服务函数的输出写入工作线程暂存区
+    bool OnWorker() const
+    {
+        return asyncProcessing_.load(std::memory_order_acquire) && loop_->GetThreadId() != std::this_thread::get_id();
+    }
+    // 服务函数写入响应的缓冲区：工作线程为workerOut_，其余为bufferOut_
+    std::string &OutputBuffer() { return OnWorker() ? workerOut_ : bufferOut_; }
+    // 连接状态只由持有线程访问：加入loop前为创建线程，之后为loop所在线程，asyncProcessing_置位期间借给工作线程
+    void AssertOwner() const
+    {
+        assert(!ChannelAdded_ || loop_->GetThreadId() == std::this_thread::get_id() || asyncProcessing_.load(std::memory_order_acquire));
+    }
 
 private:
-    std::mutex mutex_;                        // 锁
     EventLoop *loop_;                         // 处理当前TcpConnection的事件池指针
     int fd_;                                  // 客户端连接套接字描述符
-    bool ChannelAdded_;                       // 当前spChannel_是否已添加到TcpServer->Channel->Poller下进行监听
+    bool ChannelAdded_;                       // 当前channel_是否已添加到TcpServer->Channel->Poller下进行监听
     struct sockaddr_in clientAddr_;           // 连接信息结构体
-    bool disConnected_;                       // 连接断开标志位
+    std::atomic<bool> disConnected_;          // 连接断开标志位，工作线程可查询
     bool halfClose_;                          // 半关闭标志位
-    bool asyncProcessing_;                    // 异步调用标志位，当工作任务交给线程池时，置为true，任务完成回调时置为false
+    std::atomic<bool> asyncProcessing_;       // 异步调用标志位，连接借给线程池时置为true，工作线程处理完毕后置为false归还
     bool keepalive_;                          // 长连接标志，一般用于HttpServer服务
     bool reqHealthy_;                         // 请求解析结果，代表解析是否正常
-    Timer *timer_;                            // 定时器
+    Timer timer_;                             // 定时器，与连接位于同一块内存
     std::string bufferIn_;                    // 接收数据缓冲区
     std::string bufferOut_;                   // 发送数据缓冲区
+    std::deque<FileSegment> fileOut_;         // 发送文件段队列，bufferOut_发送完毕后发送
+    std::string workerOut_;                   // 工作线程写入的响应暂存区，SendBufferOut时移交给loop，只由借用连接的工作线程访问
+    std::deque<FileSegment> workerFileOut_;   // 工作线程添加的文件段暂存区，与workerOut_一同移交
     bool BindedHandler_;                      // 处理函数绑定标志
-    std::unique_ptr<Channel> spChannel_;      // 连接Channel实例
+    Channel channel_;                         // 连接Channel实例，与连接位于同一块内存
     HttpRequestContext httpRequestContext_;   // 请求解析结构
     HttpResponseContext httpResponseContext_; // 响应结构
     Callback messageCallback_;                // 请求响应函数，每次请求都会重置
@@ -137,16 +258,38 @@ private:
     Callback reqHandler_;                     // 本次连接事件请求的处理函数，每次请求都会重置
     Callback BindDynamicHandler_;             // 向TcpServer申请动态绑定函数，此函数独属于TcpServer
     Callback connectioncleanup_;              // 连接清理函数，此函数独属于TcpServer
+    std::unique_ptr<Http2Session> http2_;     // HTTP/2会话，连接切换为h2c后创建，之后所有输出均经fileOut_发送
+    uint32_t http2Stream_;                    // 流连接承载的HTTP/2流，父连接为0
+    spTcpConnection http2Parent_;             // 流连接所属的h2c连接，普通连接为空
+    std::deque<std::pair<uint32_t, HttpRequestContext>> http2Requests_; // 会话解析出的完整请求，Feed返回后统一分发，避免在会话回调内重入
+    std::map<uint32_t, spTcpConnection> http2Streams_; // 已分发、尚未提交响应的流连接
+    std::unique_ptr<WebSocketSession> websocket_; // WebSocket会话，升级后创建，之后bufferOut_仅在loop所在线程写入
+    WebSocketCallback websocketCallback_;     // WebSocket完整消息回调
+    EventLoop::TimerId websocketPingTimer_;   // WebSocket ping周期任务id，0表示无
+    StreamCallback streamCallback_;           // 自定义协议字节流回调，切换后设置
+    std::string streamPending_;               // 自定义协议未成帧的剩余数据，recvn每次读取前会清空bufferIn_
+    std::unique_ptr<RequestTrace> trace_;     // 正在追踪的请求，处理函数提交响应前工作线程会写入其时间戳
+    std::shared_ptr<Codec> codec_;            // 连接的编解码器，为空时使用内置的http解析
+    CodecCallback codecCallback_;             // 编解码器切分出的完整消息回调
+    bool readAgain_;                          // 上次读取因预算用尽而停止，socket内可能仍有数据
+    bool readQueued_;                         // 续读任务已在EventLoop就绪列表中
+    bool writeWaiting_;                       // 系统发送缓冲区已满，正在等待可写事件
+    size_t lowWaterMark_;                     // 输出队列低水位
+    size_t highWaterMark_;                    // 输出队列高水位
+    size_t outputLimit_;                      // 输出队列硬上限
+    size_t fileHeadBytes_;                    // fileOut_内各文件段head的字节数，计入输出队列
+    std::atomic<bool> outputPaused_;          // 输出队列越过高水位且尚未回落到低水位，期间暂停读取本连接
+    WatermarkCallback watermarkCallback_;     // 越过高水位与回落到低水位时的回调
+    spTcpConnection self_;                    // loop持有的指向自身的智能指针，加入loop时建立，HandleClose后由清理任务释放
     
 };
 
 TcpConnection::TcpConnection(EventLoop *loop, int fd, const struct sockaddr_in &clientaddr)
     : loop_(loop),
-      mutex_(),
-      spChannel_(new Channel()),
+      channel_(),
       ChannelAdded_(false),
       fd_(fd),
-      timer_(NULL),
+      timer_(ServerConfig::GetInstance()->IdleTimeoutMs(), Timer::TimerType::TIMER_ONCE, nullptr),
       clientAddr_(clientaddr),
       halfClose_(false),
       disConnected_(false),
@@ -155,25 +298,55 @@ TcpConnection::TcpConnection(EventLoop *loop, int fd, const struct sockaddr_in &
       bufferOut_(),
       keepalive_(true),
       reqHealthy_(false),
-      BindedHandler_(false)
+      BindedHandler_(false),
+      http2Stream_(0),
+      websocketPingTimer_(0),
+      readAgain_(false),
+      readQueued_(false),
+      writeWaiting_(false),
+      lowWaterMark_(ServerConfig::GetInstance()->OutputLowWaterMark()),
+      highWaterMark_(ServerConfig::GetInstance()->OutputHighWaterMark()),
+      outputLimit_(ServerConfig::GetInstance()->OutputLimit()),
+      fileHeadBytes_(0),
+      outputPaused_(false)
 {
     // 基于Channel设置TcpConnection的服务函数，在Channel内触发调用TcpConnection的成员函数，类似于信号槽机制
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    spChannel_->SetFd(fd_);
-    spChannel_->SetEvents(EPOLLIN | EPOLLET);   // 初始化时，设置为有数据可读事件、边缘触发模式
-    spChannel_->SetReadHandle(std::bind(&TcpConnection::HandleRead, this));
-    spChannel_->SetWriteHandle(std::bind(&TcpConnection::HandleWrite, this));
-    spChannel_->SetCloseHandle(std::bind(&TcpConnection::HandleClose, this));
-    spChannel_->SetErrorHandle(std::bind(&TcpConnection::HandleError, this));
+    channel_.SetFd(fd_);
+    channel_.SetEvents(EPOLLIN | EPOLLET);   // 初始化时，设置为有数据可读事件、边缘触发模式
+    channel_.SetCompletion(Channel::COMPLETION_RECV);
+    channel_.SetReadHandle(std::bind(&TcpConnection::HandleRead, this));
+    channel_.SetWriteHandle(std::bind(&TcpConnection::HandleWrite, this));
+    channel_.SetCloseHandle(std::bind(&TcpConnection::HandleClose, this));
+    channel_.SetErrorHandle(std::bind(&TcpConnection::HandleError, this));
+}
+
+/*
+ * 创建h2c连接上承载一个流的流连接
+ * 共用父连接的loop与套接字，不加入Poller；视为已加入loop，状态只由loop所在线程或借用的工作线程访问
+ *
+ */
+TcpConnection::TcpConnection(const spTcpConnection &parent, uint32_t streamId, HttpRequestContext &request)
+    : TcpConnection(parent->loop_, parent->fd_, parent->clientAddr_)
+{
+    ChannelAdded_ = true;
+    reqHealthy_ = true;
+    http2Stream_ = streamId;
+    http2Parent_ = parent;
+    httpRequestContext_ = std::move(request);
+    BindDynamicHandler_ = parent->BindDynamicHandler_;
 }
 
 TcpConnection::~TcpConnection()
 {
     // 移除事件，析构成员变量
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发，一个tcp连接开始析构", fd_);
-    loop_->RemoveChannelToPoller(spChannel_.get());
-    close(fd_);
-    delete timer_;
+    // 流连接不拥有套接字，由父连接移除事件并关闭
+    if (!http2Parent_)
+    {
+        loop_->RemoveChannelToPoller(&channel_);
+        close(fd_);
+    }
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发，一个tcp连接已被废弃", fd_);
     std::cout << "TcpConnection::~TcpConnection 一个TcpConnection连接已被废弃，析构即将结束, 连接sockfd：" << fd_ << std::endl;
 }
@@ -186,54 +359,114 @@ TcpConnection::~TcpConnection()
 void TcpConnection::HandleRead()
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    // 输出队列处于高水位，对端读得比写得慢，暂不读取新的请求，回落到低水位后续读
+    if (outputPaused_.load(std::memory_order_relaxed))
+    {
+        readAgain_ = true;
+        return;
+    }
+    // 连接借给工作线程期间不读取新的请求，避免与工作线程同时访问缓冲区，归还后续读
+    // 上一个响应尚未发完时也不读取，流水线请求在响应发送完毕后依次交给服务函数
+    if ((asyncProcessing_.load(std::memory_order_acquire) || writeWaiting_) && !BuffersInput())
+    {
+        readAgain_ = true;
+        return;
+    }
+    StartTrace();
     // 接收数据，写入缓冲区bufferIn_
     int result = recvn(fd_, bufferIn_);
+    // recv完成模式下暂无可交给服务函数的数据
+    if (result < 0 && EAGAIN == errno)
+        return;
+    Trace(TRACE_RECV);
+    // 读预算用尽，边缘触发下剩余数据不会再产生事件，需主动续读
+    // HTTP/1.x连接在本次请求的响应发完后续读，避免同一连接上的多个请求同时交给服务函数
+    if (readAgain_ && BuffersInput())
+        QueueResumeRead();
     if (result > 0)
     {
+        Metrics::Server().bytesIn->Add(result);
         if (disConnected_)
         {
             LOG(LoggerLevel::INFO, "连接已关闭，不再处理该连接的请求，sockfd：%d\n", fd_);
             return;
         }
-        if (reqHealthy_ = ParseHttpRequest())
+        if (websocket_)
+        {
+            // WebSocket连接：输入交给会话解析，完整消息在loop所在线程回调服务函数
+            FeedWebSocket(bufferIn_);
+            bufferIn_.clear();
+        }
+        else if (streamCallback_)
+        {
+            // 自定义协议连接：未成帧的剩余数据保留在bufferIn_，等待后续数据
+            FeedStream();
+        }
+        else if (http2_ || IsHttp2Preface())
         {
-            spTcpConnection sptcpconn = shared_from_this();
-            bool preBindedHandler_ = BindedHandler_;
-            // 在此向TcpServer请求函数绑定，需要先重置BindedHandler_为false以免复用连接时错误
-            BindedHandler_ = false;
-            BindDynamicHandler_(sptcpconn);
-            if (!BindedHandler_)
+            // h2c连接：输入交给HTTP/2会话，接收完整的请求各自创建流连接分发
+            if (!http2_)
             {
-                LOG(LoggerLevel::INFO, "动态绑定函数失败，处理错误，sockfd：%d\n", fd_);
-                if (preBindedHandler_)
-                {
-                    errorCallback_(sptcpconn);
-                    closeCallback_(sptcpconn);
-                }
-                HandleError();
+                LOG(LoggerLevel::INFO, "收到HTTP/2连接序言，切换为h2c，sockfd：%d\n", fd_);
+                StartHttp2();
+                http2_->Start();
             }
-            else
+            bool healthy = http2_->Feed(bufferIn_.data(), bufferIn_.size());
+            bufferIn_.clear();
+            if (!fileOut_.empty())
+                SendInLoop();
+            if (!healthy)
+            {
+                Metrics::Server().parseErrors->Add();
+                LOG(LoggerLevel::INFO, "HTTP/2协议错误，关闭连接，sockfd：%d\n", fd_);
+                HandleClose();
+                return;
+            }
+            DispatchHttp2();
+        }
+        else if (reqHealthy_ = ParseHttpRequest())
+        {
+            Trace(TRACE_PARSE);
+            // 请求头名称与Upgrade的取值均不区分大小写，Upgrade可为逗号分隔的多个协议
+            const std::string *upgrade = WebSocket::FindHeader(httpRequestContext_.header, "Upgrade");
+            const std::string *settings = WebSocket::FindHeader(httpRequestContext_.header, "HTTP2-Settings");
+            if (upgrade && WebSocket::HasToken(*upgrade, "h2c") && settings && httpRequestContext_.body.empty())
             {
-                LOG(LoggerLevel::INFO, "动态绑定函数完毕，调整定时关闭并回调高级服务处理，sockfd：%d\n", fd_);
-                if (!timer_)
+                // HTTP/1.1升级为h2c：响应101后发送SETTINGS，升级请求作为流1分发，其响应以HTTP/2帧发送
+                LOG(LoggerLevel::INFO, "HTTP/1.1请求升级为h2c，sockfd：%d\n", fd_);
+                AddSendFile(nullptr, 0, 0, "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n");
+                StartHttp2();
+                bool healthy = http2_->StartUpgrade(*settings);
+                if (!healthy)
+                    http2_->GoAway(Http2Session::PROTOCOL_ERROR);
+                SendInLoop();
+                if (!healthy)
                 {
-                    timer_ = new Timer(5000, Timer::TimerType::TIMER_ONCE, std::bind(&TcpConnection::Shutdown, shared_from_this()));
-                    timer_->Start();
+                    HandleClose();
+                    return;
                 }
-                else
+                for (std::map<std::string, std::string>::iterator iter = httpRequestContext_.header.begin(); iter != httpRequestContext_.header.end();)
                 {
-                    timer_->Adjust(5000, Timer::TimerType::TIMER_ONCE, std::bind(&TcpConnection::Shutdown, shared_from_this()));
+                    if (&iter->second == upgrade || &iter->second == settings)
+                        iter = httpRequestContext_.header.erase(iter);
+                    else
+                        ++iter;
                 }
-                // std::cout << "TcpConnection::HandleRead 回调高级服务处理，sockfd：" << fd_ << std::endl;
-                LOG(LoggerLevel::INFO, "回调高级服务处理，sockfd：%d\n", fd_);
-                // 执行动态绑定的上层处理函数messageCallback_处理读取到的缓冲区数据bufferIn_
-                messageCallback_(sptcpconn);
+                httpRequestContext_.version = "HTTP/2.0";
+                http2Requests_.emplace_back(1, std::move(httpRequestContext_));
+                httpRequestContext_ = HttpRequestContext();
+                DispatchHttp2();
+            }
+            else
+            {
+                DispatchRequest();
             }
         }
         else
         {
             // std::cout << "TcpConnection::HandleRead 解析请求失败，处理错误，sockfd：" << fd_ << std::endl;
             LOG(LoggerLevel::INFO, "解析请求失败，调用错误处理函数，sockfd：%d\n", fd_);
+            Metrics::Server().parseErrors->Add();
             HandleError();
         }
     }
@@ -251,6 +484,79 @@ void TcpConnection::HandleRead()
     }
 }
 
+/*
+ * 向TcpServer申请动态绑定处理函数，绑定成功则回调高级服务处理httpRequestContext_
+ * HTTP/1.x请求解析完成后及HTTP/2流分发时调用
+ *
+ */
+void TcpConnection::DispatchRequest()
+{
+    spTcpConnection &sptcpconn = Self();
+    bool preBindedHandler_ = BindedHandler_;
+    // 在此向TcpServer请求函数绑定，需要先重置BindedHandler_为false以免复用连接时错误
+    BindedHandler_ = false;
+    BindDynamicHandler_(sptcpconn);
+    Trace(TRACE_BIND);
+    if (!BindedHandler_)
+    {
+        LOG(LoggerLevel::INFO, "动态绑定函数失败，处理错误，sockfd：%d\n", fd_);
+        if (preBindedHandler_)
+        {
+            errorCallback_(sptcpconn);
+            closeCallback_(sptcpconn);
+        }
+        HandleError();
+    }
+    else
+    {
+        LOG(LoggerLevel::INFO, "动态绑定函数完毕，调整定时关闭并回调高级服务处理，sockfd：%d\n", fd_);
+        // 定时关闭的回调只在首次请求时绑定，之后的请求只刷新超时时间，不再复制智能指针
+        // 已触发的单次定时器不在时间轮内，Start重新加入；流连接刷新父连接的定时器
+        TcpConnection *owner = http2Parent_ ? http2Parent_.get() : this;
+        if (!owner->timer_.timerCallBack_)
+            owner->timer_.Adjust(ServerConfig::GetInstance()->IdleTimeoutMs(), Timer::TimerType::TIMER_ONCE, std::bind(&TcpConnection::IdleTimeout, owner->shared_from_this()));
+        else
+            owner->timer_.Adjust(ServerConfig::GetInstance()->IdleTimeoutMs(), Timer::TimerType::TIMER_ONCE);
+        owner->timer_.Start();
+        // std::cout << "TcpConnection::HandleRead 回调高级服务处理，sockfd：" << fd_ << std::endl;
+        LOG(LoggerLevel::INFO, "回调高级服务处理，sockfd：%d\n", fd_);
+        // 执行动态绑定的上层处理函数messageCallback_处理读取到的缓冲区数据bufferIn_
+        Trace(TRACE_DISPATCH);
+        messageCallback_(sptcpconn);
+    }
+}
+
+/*
+ * 空闲定时器触发函数，在时间轮工作线程执行
+ * 连接状态只在loop所在线程读写，投递HandleIdle判断是否关闭
+ *
+ */
+void TcpConnection::IdleTimeout()
+{
+    loop_->AddTask(std::bind(&TcpConnection::HandleIdle, shared_from_this()));
+}
+
+/*
+ * 空闲超时，在loop所在线程执行
+ * 借给工作线程、有流正在处理或等待可写的连接不算空闲，重新计时；投递期间新请求已重新计时的不处理
+ * 升级为WebSocket与自定义协议的连接不再受空闲超时约束
+ *
+ */
+void TcpConnection::HandleIdle()
+{
+    if (disConnected_ || timer_.Active())
+        return;
+    if (asyncProcessing_ || writeWaiting_ || !http2Streams_.empty())
+    {
+        timer_.Start();
+        return;
+    }
+    if (websocket_ || streamCallback_)
+        return;
+    LOG(LoggerLevel::INFO, "连接空闲超时，关闭连接，sockfd：%d\n", fd_);
+    HandleClose();
+}
+
 /*
  * EventLoop添加监听Channel
  * 实际由EventLoop下Poller添加新监听连接
@@ -259,7 +565,8 @@ void TcpConnection::AddChannelToLoop()
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
     // std::cout << "TcpConnection::AddChannelToLoop sockfd：" << fd_ << std::endl;
-    loop_->AddTask(std::bind(&EventLoop::AddChannelToPoller, loop_, spChannel_.get()));
+    Self();
+    loop_->AddTask(std::bind(&EventLoop::AddChannelToPoller, loop_, &channel_));
     ChannelAdded_ = true;
 }
 
@@ -289,9 +596,10 @@ void TcpConnection::Send(const char *s, int length)
         // 缺省默认长度为0，只能用strlen函数计算s的长度，这会被第一个'\0'截断
         length = strlen(s);
     }
-    std::lock_guard<std::mutex> lock(mutex_);
-    bufferOut_.clear();
-    bufferOut_.append(s, length);
+    AssertOwner();
+    std::string &out = OutputBuffer();
+    out.clear();
+    out.append(s, length);
     SendBufferOut();
 }
 
@@ -303,22 +611,64 @@ void TcpConnection::SendBufferOut()
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
     // std::cout << "TcpConnection::SendBufferOut sockfd：" << fd_ << std::endl;
+    // 处理函数提交响应之后，工作线程不再访问trace_
+    Trace(TRACE_RESPONSE);
     // 判断当前线程是不是Loop IO所在线程
+    // 流连接上服务函数的响应需先转换为本流的帧
+    void (TcpConnection::*sendFunc)() = http2Parent_ ? &TcpConnection::SendHttp2Response : &TcpConnection::SendInLoop;
     if (loop_->GetThreadId() == std::this_thread::get_id())
     {
-        SendInLoop();
+        (this->*sendFunc)();
     }
     else
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        // 当前线程为新开线程
-        asyncProcessing_ = false;
-        // 跨线程调用,加入IO线程的任务队列，唤醒
+        // 当前线程为借用连接的工作线程，提交后不再访问连接状态，由SetAsyncProcessing(false)归还连接
+        AssertOwner();
+        // 跨线程调用，暂存区整体移交给loop任务，由loop写入发送队列，唤醒
         spTcpConnection sptcpconn = shared_from_this();
-        // std::cout << "TcpConnection::SendBufferOut 向loop_添加TcpConnection::SendInLoop函数，socket：" << fd_ << std::endl;
-        LOG(LoggerLevel::INFO, "向loop_添加TcpConnection::SendInLoop函数，socket：%d\n", fd_);
-        loop_->AddTask(std::bind(&TcpConnection::SendInLoop, sptcpconn));
+        // std::cout << "TcpConnection::SendBufferOut 向loop_添加TcpConnection::CommitResponse函数，socket：" << fd_ << std::endl;
+        LOG(LoggerLevel::INFO, "向loop_添加TcpConnection::CommitResponse函数，socket：%d\n", fd_);
+        loop_->AddTask([sptcpconn, out = std::move(workerOut_), files = std::move(workerFileOut_)]() mutable
+                       { sptcpconn->CommitResponse(out, files); });
+        workerOut_.clear();
+        workerFileOut_.clear();
+    }
+}
+
+/*
+ * 工作线程提交的响应写入发送队列并发送，在loop所在线程执行
+ * 文件段队列非空时out作为只含head的文件段排在其后，保持响应的先后顺序；流连接的响应随后转换为本流的帧
+ *
+ */
+void TcpConnection::CommitResponse(std::string &out, std::deque<FileSegment> &files)
+{
+    if (disConnected_)
+        return;
+    if (!http2Parent_ && !fileOut_.empty())
+    {
+        if (!out.empty())
+        {
+            FileSegment segment;
+            segment.head.swap(out);
+            segment.offset = 0;
+            segment.length = 0;
+            fileHeadBytes_ += segment.head.size();
+            fileOut_.push_back(std::move(segment));
+        }
+    }
+    else if (bufferOut_.empty())
+        bufferOut_.swap(out);
+    else
+        bufferOut_.append(out);
+    for (FileSegment &segment : files)
+    {
+        fileHeadBytes_ += segment.head.size();
+        fileOut_.push_back(std::move(segment));
     }
+    if (http2Parent_)
+        SendHttp2Response();
+    else
+        SendInLoop();
 }
 
 /*
@@ -334,42 +684,58 @@ void TcpConnection::SendInLoop()
         // std::cout << "TcpConnection::SendInLoop 连接已关闭，无法发送任何数据，sockfd：" << fd_ << std::endl;
         return;
     }
-    int result = sendn(fd_, bufferOut_);
-    if (result > 0)
+    Trace(TRACE_SEND);
+    // 已在等待可写事件，新数据留在输出队列尾部，由HandleWrite在可写时按顺序发送
+    if (writeWaiting_)
+    {
+        CheckOutput();
+        return;
+    }
+    // h2c连接的帧全部经fileOut_发送，bufferOut_仅作为服务函数的响应暂存区
+    // 返回0表示系统缓冲区已满，与部分发送一样等待可写事件，不代表连接关闭
+    int result = http2_ ? 0 : sendn(fd_, bufferOut_);
+    if (result >= 0)
     {
-        uint32_t events = spChannel_->GetEvents();
-        if (!bufferOut_.empty())
+        uint32_t events = channel_.GetEvents();
+        if ((http2_ || bufferOut_.empty()) && SendFileOut() < 0)
+        {
+            LOG(LoggerLevel::ERROR, "发送文件失败，错误处理并关闭连接，sockfd：%d\n", fd_);
+            HandleError();
+            return;
+        }
+        CheckOutput();
+        if ((!http2_ && !bufferOut_.empty()) || !fileOut_.empty())
         {
-            // 缓冲区数据没发完，就设置EPOLLOUT事件待触发
-            spChannel_->SetEvents(events | EPOLLOUT);
-            loop_->UpdateChannelToPoller(spChannel_.get());
+            // 缓冲区数据或文件没发完，就设置EPOLLOUT事件待触发
+            writeWaiting_ = true;
+            channel_.SetEvents(events | EPOLLOUT);
+            loop_->UpdateChannelToPoller(&channel_);
         }
         else
         {
             // 数据已发完
-            spChannel_->SetEvents(events & (~EPOLLOUT));
+            writeWaiting_ = false;
+            channel_.SetEvents(events & (~EPOLLOUT));
+            FinishTrace();
             if (BindedHandler_)
             {
-                spTcpConnection sptcpconn = shared_from_this();
+                spTcpConnection &sptcpconn = Self();
                 sendcompleteCallback_(sptcpconn);
             }
             // 已设置半关闭标志，连接即将关闭
             if (halfClose_)
                 HandleClose();
+            // HTTP/1.x上一个请求的响应已发完，继续读取因预算停止的后续请求
+            else if (readAgain_)
+                QueueResumeRead();
         }
     }
-    else if (result < 0)
+    else
     {
         LOG(LoggerLevel::ERROR, "发送数据失败，错误处理并关闭连接，sockfd：%d\n", fd_);
         // std::cout << "TcpConnection::SendInLoop 发送数据失败，错误处理并关闭连接" << std::endl;
         HandleError();
     }
-    else
-    {
-        LOG(LoggerLevel::ERROR, "发送数据量为0，关闭连接，sockfd：%d\n", fd_);
-        // std::cout << "TcpConnection::SendInLoop 发送数据量为0，关闭连接" << std::endl;
-        HandleClose();
-    }
 }
 
 /*
@@ -390,8 +756,56 @@ void TcpConnection::Shutdown()
         spTcpConnection sptcpconn = shared_from_this();
         // std::cout << "TcpConnection::Shutdown 向loop_添加TcpConnection::HandleClose函数" << std::endl;
         LOG(LoggerLevel::INFO, "向loop_添加TcpConnection::HandleClose函数，socket：%d\n", fd_);
-        loop_->AddTask(std::bind(&TcpConnection::HandleClose, sptcpconn));
+        loop_->AddTask(std::bind(&TcpConnection::HandleClose, std::move(sptcpconn)));
+    }
+}
+
+/*
+ * 优雅关闭，服务退出或热重启时由TcpServer对每个连接调用，可跨线程调用
+ *
+ */
+void TcpConnection::Drain()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    loop_->AddTask(std::bind(&TcpConnection::DrainInLoop, shared_from_this()));
+}
+
+/*
+ * 设置半关闭标志，之后的响应发送完毕即关闭连接，没有借给工作线程、没有待发送数据的空闲连接立即关闭
+ * WebSocket连接发送1001关闭帧，关闭握手完成后关闭
+ * h2c连接的流由流量控制分多次发送，无法以发送完毕判断，只发送GOAWAY，由客户端处理完在途的流后关闭，或由排空期限强制关闭
+ *
+ */
+void TcpConnection::DrainInLoop()
+{
+    if (disConnected_)
+        return;
+    if (websocket_)
+    {
+        CloseWebSocket(1001, "Server shutting down");
+        return;
+    }
+    if (http2_)
+    {
+        http2_->GoAway(Http2Session::NO_ERROR);
+        SendInLoop();
+        return;
     }
+    halfClose_ = true;
+    if (!asyncProcessing_ && !writeWaiting_ && bufferOut_.empty() && fileOut_.empty())
+        HandleClose();
+}
+
+/*
+ * 强制关闭，排空超过期限时调用，可跨线程调用
+ * shutdown使阻塞在该连接上的收发立即返回（如原始转发的工作线程），loop随后读到连接关闭；描述符在析构时才关闭，不会被复用
+ *
+ */
+void TcpConnection::Abort()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    ::shutdown(fd_, SHUT_RDWR);
+    Shutdown();
 }
 
 /*
@@ -407,39 +821,51 @@ void TcpConnection::HandleWrite()
         // std::cout << "TcpConnection::HandleWrite 连接已关闭，无法发送任何数据，sockfd：" << fd_ << std::endl;
         return;
     }
-    int result = sendn(fd_, bufferOut_);
-    if (result > 0)
+    // 没有等待发送的数据，可写事件随读事件一同到达
+    if (!writeWaiting_)
+        return;
+    int result = (http2_ || bufferOut_.empty()) ? 0 : sendn(fd_, bufferOut_);
+    if (result >= 0)
     {
-        uint32_t events = spChannel_->GetEvents();
-        if (!bufferOut_.empty())
+        uint32_t events = channel_.GetEvents();
+        if ((http2_ || bufferOut_.empty()) && SendFileOut() < 0)
+        {
+            LOG(LoggerLevel::ERROR, "发送文件失败，调用错误处理函数，socket：%d\n", fd_);
+            HandleError();
+            return;
+        }
+        CheckOutput();
+        if ((!http2_ && !bufferOut_.empty()) || !fileOut_.empty())
         {
-            // 缓冲区满了，数据没发完，就设置EPOLLOUT事件触发
-            spChannel_->SetEvents(events | EPOLLOUT);
-            loop_->UpdateChannelToPoller(spChannel_.get());
+            // 缓冲区满了，数据或文件没发完，就设置EPOLLOUT事件触发
+            channel_.SetEvents(events | EPOLLOUT);
+            loop_->UpdateChannelToPoller(&channel_);
         }
         else
         {
             // 数据已发完
-            spChannel_->SetEvents(events & (~EPOLLOUT));
-            spTcpConnection sptcpconn = shared_from_this();
-            sendcompleteCallback_(sptcpconn);
+            writeWaiting_ = false;
+            channel_.SetEvents(events & (~EPOLLOUT));
+            FinishTrace();
+            if (BindedHandler_)
+            {
+                spTcpConnection &sptcpconn = Self();
+                sendcompleteCallback_(sptcpconn);
+            }
             // 发送完毕，如果是半关闭状态，则可以close了
             if (halfClose_)
                 HandleClose();
+            // HTTP/1.x上一个请求的响应已发完，继续读取因预算停止的后续请求
+            else if (readAgain_)
+                QueueResumeRead();
         }
     }
-    else if (result < 0)
+    else
     {
         // std::cout << "TcpConnection::HandleWrite 数据发送失败，错误处理" << std::endl;
         LOG(LoggerLevel::ERROR, "数据发送失败，调用错误处理函数，socket：%d\n", fd_);
         HandleError();
     }
-    else
-    {
-        // std::cout << "TcpConnection::HandleWrite 数据发送量为0，关闭连接" << std::endl;
-        LOG(LoggerLevel::ERROR, "数据发送量为0，关闭连接，socket：%d\n", fd_);
-        HandleClose();
-    }
 }
 
 /*
@@ -479,7 +905,7 @@ void TcpConnection::HandleError()
         // 连接尚未关闭，调用可调用的errorCallback_，并关闭连接
         // std::cout << "TcpConnection错误处理，socket：" << fd_ << std::endl;
         LOG(LoggerLevel::INFO, "调用绑定的高级服务错误处理函数，socket：%d\n", fd_);
-        spTcpConnection sptcpconn = shared_from_this();
+        spTcpConnection &sptcpconn = Self();
         errorCallback_(sptcpconn);
         HandleClose();
     }
@@ -508,16 +934,30 @@ void TcpConnection::HandleClose()
         // std::cout << "TcpConnection::HandleClose TcpConnection连接未正常处理，半关闭并处理，socket：" << fd_ << std::endl;
         // 有线程正在逻辑处理
         LOG(LoggerLevel::INFO, "TcpConnection连接未正常处理，设置半关闭标志并执行处理，socket：%d\n", fd_);
+        // 工作线程归还连接后由ReturnFromWorker补做关闭，此处不再分发请求，否则同一连接会同时借给两个工作线程
         halfClose_ = true;
-        if (bufferIn_.length() > 0)
-        {
-            spTcpConnection sptcpconn = shared_from_this();
-            messageCallback_(sptcpconn);
-        }
     }
     else
     {
-        spTcpConnection sptcpconn = shared_from_this();
+        spTcpConnection &sptcpconn = Self();
+        // h2c连接关闭时一并关闭尚未提交响应的流连接；流连接提前关闭时放弃其流
+        std::map<uint32_t, spTcpConnection> streams;
+        streams.swap(http2Streams_);
+        for (std::pair<const uint32_t, spTcpConnection> &stream : streams)
+            stream.second->HandleClose();
+        if (http2Parent_ && http2Parent_->http2Streams_.erase(http2Stream_) && !http2Parent_->disConnected_)
+        {
+            http2Parent_->http2_->CancelStream(http2Stream_);
+            http2Parent_->SendInLoop();
+        }
+        if (websocketPingTimer_)
+        {
+            loop_->CancelTimer(websocketPingTimer_);
+            websocketPingTimer_ = 0;
+        }
+        // 定时器回调持有指向本连接的智能指针，不释放则连接与定时器循环引用，连接永远不会析构，套接字也不会关闭
+        timer_.Stop();
+        timer_.Adjust(0, Timer::TimerType::TIMER_ONCE, nullptr);
         if (BindedHandler_)
             closeCallback_(sptcpconn);
         // std::cout << "TcpConnection::HandleClose 向loop_添加TcpConnection::connectioncleanup_函数，sockfd：" << fd_ << std::endl;
@@ -525,11 +965,26 @@ void TcpConnection::HandleClose()
         // connectioncleanup_绑定TcpServer的连接清理函数
         // 在TcpServer内删除指向此TcpConnection的智能指针
         // 当没有指向此的智能指针时此连接将进行析构
-        loop_->AddTask(std::bind(connectioncleanup_, sptcpconn));
+        // 服务回调可能仍以引用持有self_，不能在此释放，由清理任务释放
+        loop_->AddTask(std::bind(&TcpConnection::ReleaseSelf, shared_from_this()));
         disConnected_ = true;
     }
 }
 
+/*
+ * HandleClose投递的清理任务，在loop所在线程执行
+ * self_保证连接存活到此任务执行，取出后调用connectioncleanup_，返回时若无其他线程持有则析构连接
+ *
+ */
+void TcpConnection::ReleaseSelf()
+{
+    spTcpConnection self;
+    self.swap(self_);
+    // 流连接不在TcpServer的连接表内，没有清理函数
+    if (connectioncleanup_)
+        connectioncleanup_(self);
+}
+
 /*
  * 设置向TcpServer申请动态绑定函数的函数
  *
@@ -537,7 +992,7 @@ void TcpConnection::HandleClose()
 void TcpConnection::SetDynamicHandler(const Callback &cb)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     BindDynamicHandler_ = cb;
 }
 
@@ -548,7 +1003,7 @@ void TcpConnection::SetDynamicHandler(const Callback &cb)
 void TcpConnection::SetMessaeCallback(const Callback &cb)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     messageCallback_ = cb;
 }
 
@@ -559,7 +1014,7 @@ void TcpConnection::SetMessaeCallback(const Callback &cb)
 void TcpConnection::SetSendCompleteCallback(const Callback &cb)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     sendcompleteCallback_ = cb;
 }
 
@@ -570,7 +1025,7 @@ void TcpConnection::SetSendCompleteCallback(const Callback &cb)
 void TcpConnection::SetCloseCallback(const Callback &cb)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     closeCallback_ = cb;
 }
 
@@ -581,7 +1036,7 @@ void TcpConnection::SetCloseCallback(const Callback &cb)
 void TcpConnection::SetErrorCallback(const Callback &cb)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     errorCallback_ = cb;
 }
 
@@ -592,7 +1047,7 @@ void TcpConnection::SetErrorCallback(const Callback &cb)
 void TcpConnection::SetConnectionCleanUp(const Callback &cb)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     connectioncleanup_ = cb;
 }
 
@@ -603,7 +1058,7 @@ void TcpConnection::SetConnectionCleanUp(const Callback &cb)
 void TcpConnection::SetReqHandler(const Callback &cb)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     reqHandler_ = cb;
 }
 
@@ -614,7 +1069,7 @@ void TcpConnection::SetReqHandler(const Callback &cb)
 const TcpConnection::Callback &TcpConnection::GetReqHandler()
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     return reqHandler_;
 }
 
@@ -625,7 +1080,7 @@ const TcpConnection::Callback &TcpConnection::GetReqHandler()
 void TcpConnection::SetBindedHandler(const bool BindedHandler)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     BindedHandler_ = BindedHandler;
 }
 
@@ -636,7 +1091,7 @@ void TcpConnection::SetBindedHandler(const bool BindedHandler)
 bool TcpConnection::GetBindedHandler(const bool BindedHandler)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     return BindedHandler_;
 }
 
@@ -647,7 +1102,7 @@ bool TcpConnection::GetBindedHandler(const bool BindedHandler)
 TcpConnection::Callback TcpConnection::GetMessageCallback()
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     return messageCallback_;
 }
 
@@ -658,7 +1113,7 @@ TcpConnection::Callback TcpConnection::GetMessageCallback()
 TcpConnection::Callback TcpConnection::GetSendCompleteCallback()
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     return sendcompleteCallback_;
 }
 
@@ -669,7 +1124,7 @@ TcpConnection::Callback TcpConnection::GetSendCompleteCallback()
 TcpConnection::Callback TcpConnection::GetCloseCallback()
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     return closeCallback_;
 }
 
@@ -680,7 +1135,7 @@ TcpConnection::Callback TcpConnection::GetCloseCallback()
 TcpConnection::Callback TcpConnection::GetErrorCallback()
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     return errorCallback_;
 }
 
@@ -691,7 +1146,7 @@ TcpConnection::Callback TcpConnection::GetErrorCallback()
 TcpConnection::Callback TcpConnection::GetConnectionCleanUp()
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    AssertOwner();
     return connectioncleanup_;
 }
 
@@ -702,8 +1157,24 @@ TcpConnection::Callback TcpConnection::GetConnectionCleanUp()
 void TcpConnection::SetAsyncProcessing(const bool asyncProcessing)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    asyncProcessing_ = asyncProcessing;
+    asyncProcessing_.store(asyncProcessing, std::memory_order_release);
+    if (!asyncProcessing && loop_->GetThreadId() != std::this_thread::get_id())
+        loop_->AddTask(std::bind(&TcpConnection::ReturnFromWorker, shared_from_this()));
+}
+
+/*
+ * 工作线程归还连接后在loop所在线程执行
+ * 借出期间已半关闭且响应已发完的连接在此关闭，否则续读借出期间暂停的请求
+ *
+ */
+void TcpConnection::ReturnFromWorker()
+{
+    if (disConnected_ || asyncProcessing_.load(std::memory_order_acquire))
+        return;
+    if (halfClose_ && !writeWaiting_)
+        HandleClose();
+    else if (readAgain_)
+        QueueResumeRead();
 }
 
 /*
@@ -714,9 +1185,10 @@ void TcpConnection::SetAsyncProcessing(const bool asyncProcessing)
 int TcpConnection::SetSendMessage(const std::string &newMsg)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    bufferOut_.clear();
-    bufferOut_.append(newMsg, 0, newMsg.length());
+    AssertOwner();
+    std::string &out = OutputBuffer();
+    out.clear();
+    out.append(newMsg, 0, newMsg.length());
     return newMsg.length();
 }
 
@@ -728,149 +1200,805 @@ int TcpConnection::SetSendMessage(const std::string &newMsg)
 int TcpConnection::AddSendMessage(const std::string &newMsg)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    bufferOut_.append(newMsg, 0, newMsg.length());
+    if (!AppendOutput(newMsg))
+        return -1;
     return newMsg.length();
 }
 
 /*
- * 获取接收缓冲区的指针
+ * 设置输出队列的低水位、高水位与硬上限，在连接加入loop之前或在loop所在线程调用
+ * TcpServer在连接加入loop之前以服务的配置调用，loop所在线程的服务函数也可为单个连接调整
+ * 借用连接的工作线程不能调用，loop在其借用期间仍会发送已提交的响应并检查水位
  *
  */
-std::string &TcpConnection::GetBufferIn()
+void TcpConnection::SetOutputWatermarks(size_t lowWaterMark, size_t highWaterMark, size_t outputLimit)
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return bufferIn_;
+    assert(!ChannelAdded_ || loop_->GetThreadId() == std::this_thread::get_id());
+    highWaterMark_ = std::max(highWaterMark, (size_t)1);
+    lowWaterMark_ = std::min(lowWaterMark, highWaterMark_ - 1);
+    outputLimit_ = std::max(outputLimit, highWaterMark_);
 }
 
 /*
- * 获取接收缓冲区的指针
+ * 设置输出队列越过高水位与回落到低水位时的回调
+ * 生产者（代理的上游连接、持续生成数据的服务函数）在回调中暂停与恢复，回调在loop所在线程执行
  *
  */
-std::string &TcpConnection::GetBufferOut()
+void TcpConnection::SetWatermarkCallback(const WatermarkCallback &cb)
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return bufferOut_;
+    AssertOwner();
+    watermarkCallback_ = cb;
 }
 
 /*
- * 获取接收到的数据的长度
+ * 追加数据到bufferOut_，由连接的持有线程调用
+ * 输出队列加上data超过硬上限时丢弃data并关闭连接，不读取或读取过慢的对端无法让服务端无限缓存
  *
  */
-int TcpConnection::GetReceiveLength()
+bool TcpConnection::AppendOutput(const std::string &data)
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return bufferIn_.size();
+    AssertOwner();
+    std::string &out = OutputBuffer();
+    if (out.size() + fileHeadBytes_ + data.size() <= outputLimit_)
+    {
+        out.append(data);
+        return true;
+    }
+    LOG(LoggerLevel::ERROR, "输出队列超过上限：%d字节，丢弃数据并关闭连接，sockfd：%d\n", (int)outputLimit_, fd_);
+    Metrics::Server().outputOverflows->Add();
+    Shutdown();
+    return false;
 }
 
 /*
- * 获取接收到的数据的长度
+ * 发送后检查输出队列水位，在loop所在线程调用
+ * 越过高水位时暂停读取本连接并回调watermarkCallback_(true)；回落到低水位时回调watermarkCallback_(false)，
+ * 自定义协议连接随即续读暂停期间到达的数据，HTTP/1.x连接仍在响应发完后续读
  *
  */
-int TcpConnection::GetSendLength()
+void TcpConnection::CheckOutput()
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return bufferOut_.length();
+    bool paused = outputPaused_.load(std::memory_order_relaxed);
+    size_t pending = bufferOut_.size() + fileHeadBytes_;
+    if (paused ? pending > lowWaterMark_ : pending <= highWaterMark_)
+        return;
+    WatermarkCallback callback = watermarkCallback_;
+    outputPaused_.store(!paused, std::memory_order_relaxed);
+    LOG(LoggerLevel::INFO, "输出队列%s，待发送：%d字节，sockfd：%d\n", paused ? "回落到低水位" : "越过高水位", (int)pending, fd_);
+    if (!paused)
+        Metrics::Server().outputPauses->Add();
+    if (callback)
+    {
+        spTcpConnection &sptcpconn = Self();
+        callback(sptcpconn, !paused);
+    }
+    if (paused && readAgain_ && BuffersInput())
+        QueueResumeRead();
 }
 
 /*
- * 判断连接是否已关闭，是则返回true，否则返回false
+ * 添加文件段到发送队列
+ * 文件段在bufferOut_发送完毕后依次发送，可用于断点续传、多段range响应等从指定偏移发送文件的场景
  *
  */
-bool TcpConnection::IsDisconnected()
+void TcpConnection::AddSendFile(const std::shared_ptr<int> &fileFd, off_t offset, size_t length, const std::string &head)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return disConnected_;
+    AssertOwner();
+    FileSegment segment;
+    segment.head = head;
+    segment.fileFd = fileFd;
+    segment.offset = offset;
+    segment.length = fileFd ? length : 0;
+    // 流连接的文件段属于本流的响应体，提交响应时按DATA帧切分
+    if (OnWorker())
+        workerFileOut_.push_back(std::move(segment));
+    else
+    {
+        fileHeadBytes_ += segment.head.size();
+        fileOut_.push_back(std::move(segment));
+    }
 }
 
 /*
- * 获取长连接标志
+ * 只读打开待发送文件，返回的描述符在所有引用释放时关闭
  *
  */
-bool TcpConnection::WillKeepAlive()
+std::shared_ptr<int> TcpConnection::OpenSendFile(const std::string &filePath)
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return keepalive_;
+    int fileFd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fileFd < 0)
+        return nullptr;
+    return std::shared_ptr<int>(new int(fileFd), [](int *pfd)
+                                {
+                                    close(*pfd);
+                                    delete pfd; });
 }
 
 /*
- * 获取连接请求解析结果状态
+ * 发送fileOut_队列内的文件段
+ * 发送至系统缓冲区满（EAGAIN）时返回，未发完的部分留在队列内等待EPOLLOUT事件继续发送
  *
  */
-bool TcpConnection::GetReqHealthy()
+int TcpConnection::SendFileOut()
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return reqHealthy_;
+    AssertOwner();
+    while (!fileOut_.empty())
+    {
+        FileSegment &segment = fileOut_.front();
+        while (!segment.head.empty())
+        {
+            Metrics::Server().ioSyscalls->Add();
+            ssize_t nbyte = send(fd_, segment.head.data(), segment.head.size(), 0);
+            if (nbyte > 0)
+            {
+                Metrics::Server().bytesOut->Add(nbyte);
+                segment.head.erase(0, nbyte);
+                fileHeadBytes_ -= nbyte;
+            }
+            else if (nbyte < 0 && errno == EINTR)
+                continue;
+            else if (nbyte < 0 && errno == EAGAIN)
+                return 0;
+            else
+                return -1;
+        }
+        while (segment.length > 0)
+        {
+            // sendfile自动推进offset，单次最多发送1MB以免长时间占用IO线程
+            Metrics::Server().ioSyscalls->Add();
+            ssize_t nbyte = sendfile(fd_, *segment.fileFd, &segment.offset, std::min(segment.length, (size_t)1 << 20));
+            if (nbyte > 0)
+            {
+                Metrics::Server().bytesOut->Add(nbyte);
+                segment.length -= nbyte;
+            }
+            else if (nbyte < 0 && errno == EINTR)
+                continue;
+            else if (nbyte < 0 && errno == EAGAIN)
+                return 0;
+            else
+            {
+                // 出错或文件在发送期间被截断
+                LOG(LoggerLevel::ERROR, "发送文件段失败，剩余：%d字节，socket：%d\n", (int)segment.length, fd_);
+                return -1;
+            }
+        }
+        fileOut_.pop_front();
+    }
+    return 0;
 }
 
 /*
- * 设置长连接标志
+ * bufferIn_是否以HTTP/2连接序言开头，首次读取不足序言长度时按已读部分判断
  *
  */
-void TcpConnection::SetKeepAlive(bool keepalive)
+bool TcpConnection::IsHttp2Preface()
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    keepalive_ = keepalive;
+    size_t length = std::min(bufferIn_.size(), Http2Session::ConnectionPreface.size());
+    return length >= 3 && 0 == bufferIn_.compare(0, length, Http2Session::ConnectionPreface, 0, length);
 }
 
 /*
- * 启动定时器
+ * 连接切换为h2c，创建HTTP/2会话，会话的回调仅在IO线程内触发
  *
  */
-void TcpConnection::StartTimer()
+void TcpConnection::StartHttp2()
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    timer_->Start();
+    http2_.reset(new Http2Session(std::bind(&TcpConnection::OnHttp2Request, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+                                  std::bind(&TcpConnection::OnHttp2Output, this, std::placeholders::_1, std::placeholders::_2,
+                                            std::placeholders::_3, std::placeholders::_4)));
 }
 
 /*
- * 获取定时器指针
+ * HTTP/2请求接收完整，映射为HttpRequestContext排队等待分发
+ * 伪头部映射为方法、url与Host，其余头部名称还原为首字母大写形式，与HTTP/1.x的服务函数查找方式一致
  *
  */
-Timer *TcpConnection::GetTimer()
+void TcpConnection::OnHttp2Request(uint32_t streamId, HpackHeaderList &headers, std::string &body)
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return timer_;
+    HttpRequestContext context;
+    context.version = "HTTP/2.0";
+    for (HpackHeader &header : headers)
+    {
+        if (":method" == header.first)
+            context.method = header.second;
+        else if (":path" == header.first)
+            context.url = header.second;
+        else if (":authority" == header.first)
+            context.header["Host"] = header.second;
+        else if (!header.first.empty() && ':' != header.first[0])
+        {
+            std::string name = header.first;
+            bool upper = true;
+            for (char &c : name)
+            {
+                if (upper)
+                    c = toupper(c);
+                upper = ('-' == c);
+            }
+            std::string &value = context.header[name];
+            if (value.empty())
+                value = header.second;
+            else
+                value += ("Cookie" == name ? "; " : ", ") + header.second;
+        }
+    }
+    context.body.swap(body);
+    http2Requests_.emplace_back(streamId, std::move(context));
 }
 
 /*
- * 获取请求解析结构体的引用
+ * HTTP/2会话的输出加入fileOut_，data为帧数据，fileFd非空时其后紧跟文件内容
  *
  */
-HttpRequestContext &TcpConnection::GetReqestBuffer()
+void TcpConnection::OnHttp2Output(std::string &data, const std::shared_ptr<int> &fileFd, off_t offset, size_t length)
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return httpRequestContext_;
+    FileSegment segment;
+    fileHeadBytes_ += data.size();
+    segment.head.swap(data);
+    segment.fileFd = fileFd;
+    segment.offset = offset;
+    segment.length = fileFd ? length : 0;
+    fileOut_.push_back(std::move(segment));
 }
 
 /*
- * 获取响应解析结构体的引用
+ * 为每个等待的HTTP/2请求创建流连接并交给服务函数
+ * 各流同时处理，服务函数沿用HTTP/1.x的bufferOut_写法，慢的流借给工作线程时不阻塞同一连接上的其他流
  *
  */
-HttpResponseContext &TcpConnection::GetResonseBuffer()
+void TcpConnection::DispatchHttp2()
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return httpResponseContext_;
+    while (!disConnected_ && !http2Requests_.empty())
+    {
+        uint32_t streamId = http2Requests_.front().first;
+        spTcpConnection stream(new TcpConnection(Self(), streamId, http2Requests_.front().second));
+        http2Requests_.pop_front();
+        http2Streams_[streamId] = stream;
+        LOG(LoggerLevel::INFO, "分发HTTP/2流：%d，url：%s，sockfd：%d\n", (int)streamId, stream->httpRequestContext_.url.c_str(), fd_);
+        stream->DispatchRequest();
+    }
 }
 
 /*
- * 解析http请求信息
+ * 流连接：将服务函数写入bufferOut_的HTTP/1.x响应转换为本流的HEADERS与DATA帧，经父连接的会话发送后关闭流连接
+ * 状态行取状态码，头部名称转为小写并去除连接相关头部，响应体与文件段依次作为DATA帧的数据源
+ * 父连接已关闭或流已被放弃时丢弃响应
  *
  */
-bool TcpConnection::ParseHttpRequest()
+void TcpConnection::SendHttp2Response()
 {
-    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    if (disConnected_)
+        return;
+    int status = 500;
+    HpackHeaderList headers;
+    std::deque<Http2DataSource> sources(1);
+    sources.front().offset = 0;
+    sources.front().length = 0;
+    size_t lineEnd = bufferOut_.find("\r\n");
+    size_t headerEnd = bufferOut_.find("\r\n\r\n");
+    size_t space = bufferOut_.find(' ');
+    if (std::string::npos != headerEnd && space < lineEnd)
+    {
+        status = atoi(bufferOut_.c_str() + space + 1);
+        for (size_t prev = lineEnd + 2; prev < headerEnd + 2;)
+        {
+            size_t next = bufferOut_.find("\r\n", prev);
+            size_t colon = bufferOut_.find(':', prev);
+            if (colon < next)
+            {
+                std::string name = bufferOut_.substr(prev, colon - prev);
+                for (char &c : name)
+                    c = tolower(c);
+                size_t valueBegin = bufferOut_.find_first_not_of(' ', colon + 1);
+                std::string value = valueBegin < next ? bufferOut_.substr(valueBegin, next - valueBegin) : "";
+                if ("connection" != name && "keep-alive" != name && "proxy-connection" != name &&
+                    "transfer-encoding" != name && "upgrade" != name)
+                    headers.emplace_back(std::move(name), std::move(value));
+            }
+            prev = next + 2;
+        }
+        sources.front().data = bufferOut_.substr(headerEnd + 4);
+    }
+    else
+    {
+        LOG(LoggerLevel::ERROR, "无法解析的响应，HTTP/2流：%d，sockfd：%d\n", (int)http2Stream_, fd_);
+        headers.emplace_back("content-length", "0");
+    }
+    for (FileSegment &segment : fileOut_)
+    {
+        Http2DataSource source;
+        source.data.swap(segment.head);
+        source.fileFd = segment.fileFd;
+        source.offset = segment.offset;
+        source.length = segment.length;
+        sources.push_back(std::move(source));
+    }
+    fileOut_.clear();
+    fileHeadBytes_ = 0;
+    bufferOut_.clear();
+    TcpConnection &parent = *http2Parent_;
+    if (!parent.disConnected_ && parent.http2Streams_.erase(http2Stream_))
+    {
+        parent.http2_->SubmitResponse(http2Stream_, status, headers, sources);
+        parent.SendInLoop();
+    }
+    HandleClose();
+}
+
+/*
+ * 校验当前请求并升级为WebSocket连接
+ * 响应101后创建会话，握手请求之后紧跟的帧在服务函数完成升级后再解析
+ *
+ */
+bool TcpConnection::UpgradeWebSocket(const WebSocketCallback &cb, int pingIntervalMs)
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    std::string acceptKey;
+    if (websocket_ || http2_ || http2Parent_ || !WebSocket::CheckHandshake(httpRequestContext_.method, httpRequestContext_.header, acceptKey))
+    {
+        LOG(LoggerLevel::ERROR, "WebSocket升级请求校验失败，url：%s，sockfd：%d\n", httpRequestContext_.url.c_str(), fd_);
+        return false;
+    }
+    websocketCallback_ = cb;
+    timer_.Stop(); // 之后由ping检测连接存活
+    websocket_.reset(new WebSocketSession(std::bind(&TcpConnection::OnWebSocketMessage, this, std::placeholders::_1, std::placeholders::_2),
+                                          std::bind(&TcpConnection::OnWebSocketOutput, this, std::placeholders::_1)));
+    bufferOut_ = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n";
+    bufferOut_ += "Sec-WebSocket-Accept: " + acceptKey + "\r\n\r\n";
+    spTcpConnection sptcpconn = shared_from_this();
+    if (pingIntervalMs > 0)
+    {
+        std::weak_ptr<TcpConnection> wptcpconn = sptcpconn;
+        websocketPingTimer_ = loop_->RunEvery(pingIntervalMs, [wptcpconn]()
+                                              {
+                                                  spTcpConnection sptcpconn = wptcpconn.lock();
+                                                  if (sptcpconn)
+                                                      sptcpconn->PingWebSocket(); });
+    }
+    if (!httpRequestContext_.body.empty())
+    {
+        std::string early;
+        early.swap(httpRequestContext_.body);
+        loop_->AddTask(std::bind(&TcpConnection::FeedWebSocket, sptcpconn, std::move(early)));
+    }
+    LOG(LoggerLevel::INFO, "连接升级为WebSocket，url：%s，sockfd：%d\n", httpRequestContext_.url.c_str(), fd_);
+    SendInLoop();
+    return true;
+}
+
+/*
+ * 输入交给WebSocket会话解析
+ *
+ */
+void TcpConnection::FeedWebSocket(const std::string &data)
+{
+    if (disConnected_ || !websocket_)
+        return;
+    bool healthy = websocket_->Feed(data.data(), data.size());
+    FlushWebSocket(healthy);
+}
+
+/*
+ * WebSocket完整消息回调服务函数
+ * 在loop所在线程执行，耗时的处理应交给线程池，再经SendWebSocketFrame回复
+ *
+ */
+void TcpConnection::OnWebSocketMessage(WebSocket::Opcode opcode, std::string &message)
+{
+    spTcpConnection &sptcpconn = Self();
+    try
+    {
+        websocketCallback_(sptcpconn, opcode, message);
+    }
+    catch (std::bad_function_call)
+    {
+        LOG(LoggerLevel::ERROR, "执行WebSocket消息回调报错：std::bad_function_call，sockfd：%d\n", fd_);
+    }
+}
+
+/*
+ * WebSocket会话输出加入bufferOut_
+ *
+ */
+void TcpConnection::OnWebSocketOutput(std::string &frame)
+{
+    bufferOut_.append(frame);
+}
+
+/*
+ * 发送bufferOut_内的帧
+ * 会话结束（关闭握手完成或协议错误）时设置半关闭标志，关闭帧发送完毕后关闭连接
+ *
+ */
+void TcpConnection::FlushWebSocket(bool healthy)
+{
+    if (!healthy)
+        halfClose_ = true;
+    if (!bufferOut_.empty())
+        SendInLoop();
+    else if (halfClose_)
+        HandleClose();
+}
+
+/*
+ * 周期任务：发送ping
+ * 上一次ping之后未收到任何数据，说明对端已失去响应，直接关闭连接
+ *
+ */
+void TcpConnection::PingWebSocket()
+{
+    if (disConnected_ || !websocket_)
+        return;
+    if (!websocket_->Ping())
+    {
+        LOG(LoggerLevel::INFO, "WebSocket连接ping超时，关闭连接，sockfd：%d\n", fd_);
+        HandleClose();
+        return;
+    }
+    FlushWebSocket(true);
+}
+
+/*
+ * 发送一条文本或二进制消息，可跨线程调用
+ *
+ */
+void TcpConnection::SendWebSocketFrame(WebSocket::Opcode opcode, const std::string &payload)
+{
+    SendWebSocketFrame(std::make_shared<const std::string>(WebSocket::EncodeFrame(opcode, payload.data(), payload.size())));
+}
+
+/*
+ * 发送已编码的帧，可跨线程调用
+ * 跨线程时投递到loop所在线程执行，bufferOut_始终只在loop所在线程写入，同一线程投递的帧按顺序发送
+ * 已发起关闭握手的连接不再发送数据帧
+ *
+ */
+void TcpConnection::SendWebSocketFrame(const std::shared_ptr<const std::string> &frame)
+{
+    spTcpConnection sptcpconn = shared_from_this();
+    if (loop_->GetThreadId() != std::this_thread::get_id())
+    {
+        loop_->AddTask([sptcpconn, frame]()
+                       { sptcpconn->SendWebSocketFrame(frame); });
+        return;
+    }
+    if (disConnected_ || !websocket_ || websocket_->CloseSent())
+        return;
+    if (AppendOutput(*frame))
+        FlushWebSocket(true);
+}
+
+/*
+ * 发起WebSocket关闭握手，可跨线程调用
+ * 对端回复关闭帧后关闭连接，对端不回复时由ping超时关闭
+ *
+ */
+void TcpConnection::CloseWebSocket(uint16_t code, const std::string &reason)
+{
+    spTcpConnection sptcpconn = shared_from_this();
+    if (loop_->GetThreadId() != std::this_thread::get_id())
+    {
+        loop_->AddTask([sptcpconn, code, reason]()
+                       { sptcpconn->CloseWebSocket(code, reason); });
+        return;
+    }
+    if (disConnected_ || !websocket_)
+        return;
+    websocket_->Close(code, reason);
+    FlushWebSocket(true);
+}
+
+/*
+ * 响应101并将连接切换为protocol协议的字节流
+ * 升级请求之后紧跟的数据在服务函数完成升级后再交给回调
+ *
+ */
+bool TcpConnection::UpgradeStream(const std::string &protocol, const StreamCallback &cb)
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    if (websocket_ || http2_ || http2Parent_ || streamCallback_ || !cb)
+    {
+        LOG(LoggerLevel::ERROR, "连接无法切换为%s协议，url：%s，sockfd：%d\n", protocol.c_str(), httpRequestContext_.url.c_str(), fd_);
+        return false;
+    }
+    streamCallback_ = cb;
+    timer_.Stop(); // 自定义协议自行决定连接的生命周期
+    bufferOut_ = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: " + protocol + "\r\nConnection: Upgrade\r\n\r\n";
+    if (!httpRequestContext_.body.empty())
+    {
+        std::string early;
+        early.swap(httpRequestContext_.body);
+        spTcpConnection sptcpconn = shared_from_this();
+        loop_->AddTask([sptcpconn, early = std::move(early)]()
+                       {
+                           sptcpconn->bufferIn_.append(early);
+                           sptcpconn->FeedStream(); });
+    }
+    LOG(LoggerLevel::INFO, "连接切换为%s协议，url：%s，sockfd：%d\n", protocol.c_str(), httpRequestContext_.url.c_str(), fd_);
+    SendInLoop();
+    return true;
+}
+
+/*
+ * bufferIn_交给自定义协议字节流回调，回调返回false时发送完已有数据后关闭连接
+ * 回调未取走的不完整帧暂存到streamPending_，下次读取后拼接在新数据之前
+ *
+ */
+void TcpConnection::FeedStream()
+{
+    if (disConnected_ || !streamCallback_)
+        return;
+    if (!streamPending_.empty())
+    {
+        streamPending_.append(bufferIn_);
+        streamPending_.swap(bufferIn_);
+        streamPending_.clear();
+    }
+    spTcpConnection &sptcpconn = Self();
+    bool healthy = streamCallback_(sptcpconn, bufferIn_);
+    if (!healthy)
+        halfClose_ = true;
+    else if (!bufferIn_.empty())
+        streamPending_.swap(bufferIn_);
+    if (!bufferOut_.empty())
+        SendInLoop();
+    else if (halfClose_)
+        HandleClose();
+}
+
+/*
+ * 发送已编码的自定义协议数据，可跨线程调用
+ * 跨线程时投递到loop所在线程执行，同一线程投递的数据按顺序发送
+ *
+ */
+void TcpConnection::SendStream(const std::shared_ptr<const std::string> &data)
+{
+    spTcpConnection sptcpconn = shared_from_this();
+    if (loop_->GetThreadId() != std::this_thread::get_id())
+    {
+        loop_->AddTask([sptcpconn, data]()
+                       { sptcpconn->SendStream(data); });
+        return;
+    }
+    if (disConnected_ || !streamCallback_ || halfClose_ || data->empty())
+        return;
+    if (AppendOutput(*data))
+        SendInLoop();
+}
+
+/*
+ * 连接从建立起即以codec切分消息，复用自定义协议字节流的收发路径，不响应101
+ * 在连接加入loop之前调用，无需加锁
+ *
+ */
+void TcpConnection::StartCodec(const std::shared_ptr<Codec> &codec, const CodecCallback &cb)
+{
+    codec_ = codec;
+    codecCallback_ = cb;
+    streamCallback_ = std::bind(&TcpConnection::FeedCodec, this, std::placeholders::_1, std::placeholders::_2);
+}
+
+/*
+ * 以编解码器循环切分bufferIn内的完整消息并回调服务函数，剩余的不完整数据留待下次读取
+ * 数据非法时返回false，发送完已有数据后关闭连接
+ *
+ */
+bool TcpConnection::FeedCodec(spTcpConnection &sptcpconn, std::string &bufferIn)
+{
+    size_t offset = 0;
+    while (offset < bufferIn.size() && !disConnected_)
+    {
+        const char *message = nullptr;
+        size_t length = 0;
+        long consumed = codec_->Decode(bufferIn.data() + offset, bufferIn.size() - offset, message, length);
+        if (0 == consumed)
+            break;
+        if (consumed < 0)
+        {
+            LOG(LoggerLevel::ERROR, "无法解析的%s消息，sockfd：%d\n", codec_->Name(), fd_);
+            Metrics::Server().parseErrors->Add();
+            bufferIn.clear();
+            return false;
+        }
+        offset += consumed;
+        codecCallback_(sptcpconn, message, length);
+    }
+    bufferIn.erase(0, offset);
+    return true;
+}
+
+/*
+ * 以连接的编解码器编码并发送一条消息，可跨线程调用
+ *
+ */
+void TcpConnection::SendMessage(const char *message, size_t length)
+{
+    if (!codec_)
+        return;
+    std::shared_ptr<std::string> data = std::make_shared<std::string>();
+    codec_->Encode(message, length, *data);
+    SendStream(data);
+}
+
+void TcpConnection::SendMessage(const std::string &message)
+{
+    SendMessage(message.data(), message.size());
+}
+
+/*
+ * 按采样率开始追踪新读取的请求，仅追踪HTTP/1.1请求
+ * 尚未交给服务的追踪（如上次请求解析失败）直接丢弃；已交给服务但未完成的追踪保留，本次读取不再采样
+ *
+ */
+void TcpConnection::StartTrace()
+{
+    if (trace_ && !trace_->stamps[TRACE_DISPATCH].load(std::memory_order_relaxed))
+        trace_.reset();
+    if (trace_ || websocket_ || streamCallback_ || http2_ || !RequestTracer::GetInstance()->Sample())
+        return;
+    trace_.reset(new RequestTrace());
+    trace_->fd = fd_;
+    trace_->stamps[TRACE_POLL].store(RequestTracer::LastPoll(), std::memory_order_relaxed);
+    trace_->stamps[TRACE_READ].store(RequestTracer::Now(), std::memory_order_relaxed);
+}
+
+/*
+ * 响应发送完毕，结束追踪
+ * 只有处理函数已提交响应的追踪才结束，此时工作线程已不再访问trace_，其余情况（如解析失败的错误响应）继续保留
+ *
+ */
+void TcpConnection::FinishTrace()
+{
+    if (!trace_ || !trace_->stamps[TRACE_RESPONSE].load(std::memory_order_acquire))
+        return;
+    Trace(TRACE_DONE);
+    trace_->method = httpRequestContext_.method;
+    trace_->url = httpRequestContext_.url;
+    trace_->serviceName = httpRequestContext_.serviceName;
+    trace_->handlerName = httpRequestContext_.handlerName;
+    RequestTracer::GetInstance()->Finish(trace_);
+}
+
+/*
+ * 获取接收缓冲区的指针
+ *
+ */
+std::string &TcpConnection::GetBufferIn()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    AssertOwner();
+    return bufferIn_;
+}
+
+/*
+ * 获取接收缓冲区的指针
+ *
+ */
+std::string &TcpConnection::GetBufferOut()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    AssertOwner();
+    return OutputBuffer();
+}
+
+/*
+ * 获取接收到的数据的长度
+ *
+ */
+int TcpConnection::GetReceiveLength()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    AssertOwner();
+    return bufferIn_.size();
+}
+
+/*
+ * 获取接收到的数据的长度
+ *
+ */
+int TcpConnection::GetSendLength()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    AssertOwner();
+    return OutputBuffer().length();
+}
+
+/*
+ * 判断连接是否已关闭，是则返回true，否则返回false
+ * 流连接所属的h2c连接关闭后也视为已关闭
+ *
+ */
+bool TcpConnection::IsDisconnected()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    return disConnected_.load(std::memory_order_acquire) || (http2Parent_ && http2Parent_->disConnected_.load(std::memory_order_acquire));
+}
+
+/*
+ * 获取长连接标志
+ *
+ */
+bool TcpConnection::WillKeepAlive()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    AssertOwner();
+    return keepalive_;
+}
+
+/*
+ * 获取连接请求解析结果状态
+ *
+ */
+bool TcpConnection::GetReqHealthy()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    AssertOwner();
+    return reqHealthy_;
+}
+
+/*
+ * 设置长连接标志
+ *
+ */
+void TcpConnection::SetKeepAlive(bool keepalive)
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    AssertOwner();
+    keepalive_ = keepalive;
+}
+
+/*
+ * 启动定时器
+ *
+ */
+void TcpConnection::StartTimer()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    timer_.Start();
+}
+
+/*
+ * 获取定时器指针，流连接返回所属h2c连接的空闲定时器
+ *
+ */
+Timer *TcpConnection::GetTimer()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    AssertOwner();
+    return http2Parent_ ? &http2Parent_->timer_ : &timer_;
+}
+
+/*
+ * 获取请求解析结构体的引用
+ *
+ */
+HttpRequestContext &TcpConnection::GetReqestBuffer()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    AssertOwner();
+    return httpRequestContext_;
+}
+
+/*
+ * 获取响应解析结构体的引用
+ *
+ */
+HttpResponseContext &TcpConnection::GetResonseBuffer()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
+    AssertOwner();
+    return httpResponseContext_;
+}
+
+/*
+ * 解析http请求信息
+ *
+ */
+bool TcpConnection::ParseHttpRequest()
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
     // std::cout << "TcpConnection::ParseHttpRequest sockfd：" << fd_ << std::endl;
     std::string crlf("\r\n"), crlfcrlf("\r\n\r\n");
     size_t prev = 0, next = 0, pos_colon;
@@ -1006,18 +2134,19 @@ bool TcpConnection::ParseHttpRequest()
 void TcpConnection::HttpError(const int err_num, const std::string &short_msg)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    bufferOut_.clear();
+    std::string &out = OutputBuffer();
+    out.clear();
     if (httpRequestContext_.version.empty())
     {
-        bufferOut_ += "HTTP/1.1 " + std::to_string(err_num) + " " + short_msg + "\r\n";
+        out += "HTTP/1.1 " + std::to_string(err_num) + " " + short_msg + "\r\n";
     }
     else
     {
-        bufferOut_ += httpRequestContext_.version + " " + std::to_string(err_num) + " " + short_msg + "\r\n";
+        out += httpRequestContext_.version + " " + std::to_string(err_num) + " " + short_msg + "\r\n";
     }
-    bufferOut_ += "Server: Qiu Hai's NetServer/0.1\r\n";
-    bufferOut_ += "Content-Type: text/html\r\n";
-    bufferOut_ += "Connection: Keep-Alive\r\n";
+    out += "Server: Qiu Hai's NetServer/0.1\r\n";
+    out += "Content-Type: text/html\r\n";
+    out += "Connection: Keep-Alive\r\n";
     std::string responsebody;
     responsebody += "<html><title>出错了</title>";
     responsebody += "<head><meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\"></head>";
@@ -1025,9 +2154,9 @@ void TcpConnection::HttpError(const int err_num, const std::string &short_msg)
     responsebody += "<body bgcolor=\"ffffff\"><h1>";
     responsebody += std::to_string(err_num) + " " + short_msg;
     responsebody += "</h1><hr><em> Qiu Hai's NetServer</em>\n</body></html>";
-    bufferOut_ += "Content-Length: " + std::to_string(responsebody.size()) + "\r\n";
-    bufferOut_ += "\r\n";
-    bufferOut_.append(responsebody, 0, responsebody.length());
+    out += "Content-Length: " + std::to_string(responsebody.size()) + "\r\n";
+    out += "\r\n";
+    out.append(responsebody, 0, responsebody.length());
     SendBufferOut();
 }
 
@@ -1038,35 +2167,105 @@ void TcpConnection::HttpError(const int err_num, const std::string &short_msg)
 void TcpConnection::requestToOut()
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    bufferOut_.clear();
-    bufferOut_ += httpRequestContext_.method + " " + httpRequestContext_.url + " " + httpRequestContext_.version + "\r\n";
+    std::string &out = OutputBuffer();
+    out.clear();
+    out += httpRequestContext_.method + " " + httpRequestContext_.url + " " + httpRequestContext_.version + "\r\n";
     std::string key, value;
     for(auto i : httpRequestContext_.header)
     {
         std::tie(key, value) = i;
-        bufferOut_ += key + ": " + value + "\r\n";
+        out += key + ": " + value + "\r\n";
     }
-    bufferOut_ += "\r\n" + httpRequestContext_.body;
+    out += "\r\n" + httpRequestContext_.body;
 }
 
 /*
- * 读取客户端数据
+ * 排入EventLoop就绪列表，在下一轮与其他连接的新事件轮流读取
+ * 只持有weak_ptr，连接在此期间关闭时不再续读
+ *
+ */
+void TcpConnection::QueueResumeRead()
+{
+    if (readQueued_ || disConnected_)
+        return;
+    Metrics::Server().readRequeues->Add();
+    readQueued_ = true;
+    std::weak_ptr<TcpConnection> weakconn = shared_from_this();
+    loop_->QueueReady([weakconn]()
+                      {
+                          spTcpConnection sptcpconn = weakconn.lock();
+                          if (sptcpconn)
+                              sptcpconn->ResumeRead(); });
+}
+
+/*
+ * 就绪列表回调，继续读取上次因预算停止的数据
+ * 本轮事件已将数据读完时readAgain_已被清除，不再读取
+ *
+ */
+void TcpConnection::ResumeRead()
+{
+    readQueued_ = false;
+    if (readAgain_ && !disConnected_)
+        HandleRead();
+}
+
+/*
+ * 已读数据达到预算时能否在此停止读取
+ * WebSocket、自定义协议、h2c与编解码器连接均缓存未成帧的数据，任意位置都可停止
+ * HTTP/1.x的内置解析要求一次读取包含完整请求，需已收到请求头及Content-Length长度的请求体
+ *
+ */
+bool TcpConnection::ReadBoundary(const std::string &buffer)
+{
+    if (BuffersInput())
+        return true;
+    size_t headerEnd = buffer.find("\r\n\r\n");
+    if (std::string::npos == headerEnd)
+        return false;
+    size_t contentLength = buffer.find("Content-Length: ");
+    if (std::string::npos == contentLength || contentLength > headerEnd)
+        return true;
+    return buffer.size() >= headerEnd + 4 + strtoul(buffer.c_str() + contentLength + 16, nullptr, 10);
+}
+
+/*
+ * 读取客户端数据，每次read的字节数为配置的readBufferSize
+ * 读满则继续读，直到读到的数据不足readBufferSize或EAGAIN
+ * 读取不足说明读取时内核缓冲区已空，之后到达的数据会产生新的边缘触发事件，无需再读一次确认EAGAIN
+ * 累计达到READ_BUDGET且ReadBoundary允许时停止并设置readAgain_，由HandleRead排入就绪列表
+ * recv完成模式下不调用read，见TakeReceived
  *
  */
 int TcpConnection::recvn(int fd, std::string &recvMsg)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
+    if (channel_.CompletionActive())
+        return TakeReceived(recvMsg);
     recvMsg.clear();
+    readAgain_ = false;
+    size_t budget = READ_BUDGET; // 每读满一个预算检查一次能否停止，避免对大请求反复查找请求头
     int nbyte = 0;
-    char buffer[BUFSIZE];
+    const int bufsize = (int)ServerConfig::GetInstance()->ReadBufferSize();
+    char buffer[READ_BUFSIZE_MAX];
     for (;;)
     {
-        nbyte = read(fd, buffer, BUFSIZE);
+        Metrics::Server().ioSyscalls->Add();
+        nbyte = read(fd, buffer, bufsize);
         if (nbyte > 0)
         {
             recvMsg.append(buffer, nbyte);
-            if (nbyte < BUFSIZE)
+            if (nbyte == bufsize && recvMsg.size() >= budget)
+            {
+                if (ReadBoundary(recvMsg))
+                {
+                    LOG(LoggerLevel::INFO, "读取达到预算，剩余数据下一轮读取，socket：%d\n", fd_);
+                    readAgain_ = true;
+                    return recvMsg.length();
+                }
+                budget += READ_BUDGET;
+            }
+            if (nbyte < bufsize)
             {
                 LOG(LoggerLevel::ERROR, "接收的请求信息：%s\n，socket：%d\n\n", recvMsg.c_str(), fd_);
                 // std::cout << std::endl << "TcpConnection::recvn 接收到请求信息：" << std::endl << recvMsg << std::endl << std::endl;
@@ -1105,61 +2304,108 @@ int TcpConnection::recvn(int fd, std::string &recvMsg)
 }
 
 /*
- * 发送数据到客户端
+ * recv完成模式下取走Poller已接收的数据，每次全部取走
+ * 单次数量由Poller的暂存上限限制，取消recv生效前内核已接收的数据仍会交付，最多为一个缓冲区环的容量
+ * HTTP/1.x的内置解析要求一次取得完整请求：请求头或Content-Length长度的请求体未收齐时继续等待并调大暂存上限，
+ * 请求头超过READ_BUDGET仍不完整或暂存超过READ_WAIT_MAX时不再等待，交给解析处理
+ * 暂无数据时返回-1且errno为EAGAIN；数据取完后报告recv的结束状态：对端关闭返回0，出错返回-1
+ *
+ */
+int TcpConnection::TakeReceived(std::string &recvMsg)
+{
+    std::string &received = channel_.Received();
+    int status = channel_.RecvStatus();
+    recvMsg.clear();
+    readAgain_ = false;
+    if (!received.empty() && 0 == status && received.size() < READ_WAIT_MAX && !ReadBoundary(received) &&
+        (received.size() < READ_BUDGET || std::string::npos != received.find("\r\n\r\n")))
+    {
+        LOG(LoggerLevel::INFO, "请求尚未收齐，已接收%d字节，继续等待，socket：%d\n", (int)received.size(), fd_);
+        channel_.SetRecvLimit(received.size() + READ_BUDGET);
+        if (channel_.RecvPaused())
+            ResumeReceive();
+        errno = EAGAIN;
+        return -1;
+    }
+    if (!received.empty())
+    {
+        recvMsg.swap(received);
+        channel_.SetRecvLimit(0);
+        // 结束状态在数据处理后的下一次读取报告
+        if (status)
+            readAgain_ = true;
+        if (channel_.RecvPaused())
+            ResumeReceive();
+        return recvMsg.length();
+    }
+    if (Channel::RECV_CLOSED == status)
+    {
+        LOG(LoggerLevel::INFO, "接收数据错误，客户端已关闭连接，socket：%d\n", fd_);
+        return 0;
+    }
+    errno = status < 0 ? -status : EAGAIN;
+    return -1;
+}
+
+/*
+ * 恢复Poller因暂存数据达到上限而暂停的recv
+ * Channel的events_已被本轮返回的事件覆盖，按writeWaiting_还原是否监听可写，避免更新时撤销等待中的EPOLLOUT
+ *
+ */
+void TcpConnection::ResumeReceive()
+{
+    uint32_t events = channel_.GetEvents();
+    channel_.SetEvents(writeWaiting_ ? events | EPOLLOUT : events & ~EPOLLOUT);
+    loop_->UpdateChannelToPoller(&channel_);
+}
+
+/*
+ * 发送数据到fd，直至全部发完或系统缓冲区满（EAGAIN）
+ * 每次send提交剩余的全部数据，由内核切分；已发送的部分在返回前一次性从sendMsg头部移除
+ * 返回本次发送的字节数，系统缓冲区满以致未发送任何数据时返回0，调用方应等待可写事件；出错返回-1
  *
  */
 int TcpConnection::sendn(int fd, std::string &sendMsg)
 {
     LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", fd_);
-    std::lock_guard<std::mutex> lock(mutex_);
-    ssize_t nbyte = 0;
-    int sendsum = 0;
-    size_t length = sendMsg.length() > BUFSIZE ? BUFSIZE : sendMsg.size();
-    for (;;)
+    size_t sendsum = 0;
+    int result = 0;
+    while (sendsum < sendMsg.size())
     {
-        nbyte = send(fd, sendMsg.data(), length, 0);
-        sleep(0.1); // 防止毡包 TODO 设计更好的防护
+        Metrics::Server().ioSyscalls->Add();
+        ssize_t nbyte = send(fd, sendMsg.data() + sendsum, sendMsg.size() - sendsum, 0);
         if (nbyte > 0)
         {
             sendsum += nbyte;
-            sendMsg.erase(0, nbyte);
-            length = sendMsg.length() > BUFSIZE ? BUFSIZE : sendMsg.size();
-            if (!length)
-                break;
         }
-        else if (nbyte < 0) // 异常
+        else if (nbyte < 0 && errno == EINTR)
         {
-            if (errno == EAGAIN) // 系统缓冲区满，非阻塞返回
-            {
-                LOG(LoggerLevel::ERROR, "发送数据错误，系统缓冲区满，socket：%d\n", fd_);
-                return sendsum;
-            }
-            else if (errno == EINTR)
-            {
-                continue;
-            }
-            else if (errno == EPIPE)
-            {
-                // 客户端已经close，并发了RST，继续wirte会报EPIPE，返回0，表示close
-                LOG(LoggerLevel::ERROR, "发送数据错误，客户端发送RST，socket：%d\n", fd_);
-                perror("发送数据错误");
-                // std::cout << "TcpConnection::sendn 发送数据错误，sockfd：" << fd_ << std::endl;
-                return -1;
-            }
-            else
-            {
-                LOG(LoggerLevel::ERROR, "发送数据错误，发送数据错误，socket：%d\n", fd_);
-                perror("发送数据错误");
-                // std::cout << "TcpConnection::sendn 发送数据错误，sockfd：" << fd_ << std::endl;
-                return -1;
-            }
+            continue;
         }
-        else // 返回0，客户端关闭socket，FIN
+        else if (nbyte < 0 && errno == EAGAIN)
         {
-            LOG(LoggerLevel::INFO, "发送数据错误，客户端已关闭连接，socket：%d\n", fd_);
-            // std::cout << "TcpConnection::sendn 发送数据错误，客户端已关闭连接，socket：" << fd_ << std::endl;
-            return 0;
+            // 系统缓冲区满，非阻塞返回，剩余数据等待可写事件
+            LOG(LoggerLevel::INFO, "系统缓冲区满，等待可写事件，socket：%d\n", fd_);
+            break;
+        }
+        else if (nbyte < 0 && errno == EPIPE)
+        {
+            // 客户端已经close，并发了RST，继续write会报EPIPE
+            LOG(LoggerLevel::ERROR, "发送数据错误，客户端发送RST，socket：%d\n", fd_);
+            result = -1;
+            break;
         }
+        else
+        {
+            LOG(LoggerLevel::ERROR, "发送数据错误，socket：%d，errno：%d\n", fd_, errno);
+            result = -1;
+            break;
+        }
+    }
+    if (sendsum > 0)
+    {
+        Metrics::Server().bytesOut->Add(sendsum);
+        sendMsg.erase(0, sendsum);
     }
-    return sendsum;
+    return result < 0 ? result : (int)sendsum;
 }
@@ -3,6 +3,8 @@
 //  实现基于socket的网络服务，管理所有的tcp连接实例TcpConnection
 //  是其他一切网络服务的基础服务提供类
 //  tcpServer内部生成一个Channel实例用于监听客户端连接
+//  构造时登记到ServerLifecycle，热重启时接管从旧进程继承的同端口监听套接字；退出与交接时由ServerLifecycle调用Drain排空
+//  监听Channel请求accept完成模式：io_uring下由Poller接受新连接，OnNewConnection取走，epoll下照常accept
 
 #pragma once
 
@@ -10,10 +12,12 @@
 #include <string>
 #include <map>
 #include <mutex>
+#include <vector>
 #include <iostream>
 #include <cstdio>
 #include <memory>
 #include <cstdlib>
+#include <cstring>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/epoll.h>
@@ -24,8 +28,8 @@
 #include "EventLoop.hpp"
 #include "TcpConnection.hpp"
 #include "EventLoopThreadPool.hpp"
-
-#define MAXCONNECTION 20000
+#include "ObjectPool.hpp"
+#include "ServerConfig.hpp"
 
 class TcpServer
 {
@@ -42,29 +46,63 @@ public:
     static const std::string HttpHandler;
     static const std::string CoverServiceName;
     static const std::string CoverHandler;
+    static const std::string MetricsServiceName;
+    static const std::string MetricsHandler;
+    static const std::string TraceServiceName;
+    static const std::string TraceHandler;
     // 高层服务向tcpServer注册传递给底层connection->channel的处理函数，
     // coverAllService_参数默认为false，若为true则此TcpServer仅提供一种服务的各个处理函数，其他服务在此处无法绑定
     void RegisterHandler(std::string serviceName, const std::string handlerType, 
                             const Callback &handlerFunc, bool coverAllService = false);
     void BindDynamicHandler(spTcpConnection &sptcpconnection); // 动态绑定sptcpconnection的事件处理函数
+    // 设置连接的编解码器，之后接受的连接不再经过http解析与函数绑定，每条完整消息回调onMessage，连接关闭时回调onClose
+    // 需在服务启动前调用，codec为空时恢复内置的HTTP/1.1解析
+    void SetCodec(const std::shared_ptr<Codec> &codec, const TcpConnection::CodecCallback &onMessage,
+                  const Callback &onClose = nullptr);
+    // 设置之后接受的连接的输出队列低水位、高水位与硬上限，onWatermark在连接越过高水位与回落到低水位时回调
+    void SetOutputWatermarks(size_t lowWaterMark, size_t highWaterMark, size_t outputLimit,
+                             const TcpConnection::WatermarkCallback &onWatermark = nullptr);
+    void Drain();                  // 停止accept并排空全部连接，在主loop所在线程调用
+    void Abort();                  // 强制关闭全部连接
+    size_t ConnectionCount();      // 当前连接数
+    int ListenFd() const { return tcpServerSocket_.fd(); } // 监听套接字，热重启时交给新进程
 
 private:
     std::mutex mutex_;
     Socket tcpServerSocket_;                    // 服务监听套接字描述符
     Channel tcpServerChannel_;                  // TcpSeve内置连接Channel实例，用于监听客户端连接事件
     EventLoop *mainLoop_;                       // 事件池主逻辑控制实例
+    bool accepting_;                            // 监听Channel是否在主事件池内，Drain后为false
     int connCount_;                             // 连接计数
     EventLoopThreadPool eventLoopThreadPool;    // 多线程事件池
     bool coverAllService_;                      // 是否启动覆盖服务绑定模式，该模式下本TcpServer仅可绑定一类服务
     std::map<int, spTcpConnection> tcpConnList_;                             // 套接字描述符->连接抽象类实例
     std::map<std::string, std::map<std::string, Callback>> serviceHandlers_; // 不同服务根据服务名及操作名注册的操作函数
+    std::shared_ptr<Codec> codec_;              // 连接的编解码器，为空时使用内置的HTTP/1.1解析
+    TcpConnection::CodecCallback codecMessageCallback_; // 编解码器模式下的完整消息回调
+    Callback codecCloseCallback_;               // 编解码器模式下的连接关闭回调
+    size_t lowWaterMark_;                       // 连接输出队列低水位
+    size_t highWaterMark_;                      // 连接输出队列高水位
+    size_t outputLimit_;                        // 连接输出队列硬上限，为0时未调用SetOutputWatermarks，连接使用ServerConfig的配置
+    TcpConnection::WatermarkCallback watermarkCallback_; // 连接输出队列水位回调
     void Setnonblocking(int fd);
     void OnNewConnection();                                  // 处理新连接
+    int AcceptConnection(struct sockaddr_in &clientaddr);    // 取得一个新连接，没有时返回0
     void OnConnectionError();                                // 处理连接错误，关闭套接字
     void RemoveConnection(spTcpConnection &sptcpconnection); // 连接清理，这里应该由EventLoop来执行，投递回主线程删除 OR 多线程加锁删除
+    void BindService(spTcpConnection &sptcpconnection, const std::string &serviceName, const std::string &handlerName); // 绑定服务的各事件处理函数
+    void HandleBuiltinMessage(spTcpConnection &sptcpconnection); // 内置服务：在loop所在线程直接执行处理函数
+    void HandleBuiltinEvent(spTcpConnection &sptcpconnection);   // 内置服务：发送完毕、关闭与出错均无需处理
+    void MetricsProcess(spTcpConnection &sptcpconnection);       // 内置指标服务：以Prometheus文本格式响应全部指标
+    void TraceProcess(spTcpConnection &sptcpconnection);         // 内置追踪服务：调整采样率并导出最慢请求的Chrome trace-event JSON
+    void SendBuiltinResponse(spTcpConnection &sptcpconnection, const char *contentType, const std::string &body); // 内置服务的200响应
+    static bool MatchBuiltinUrl(const std::string &url, const std::string &path); // url的路径部分是否为path
+    static bool BuiltinAllowed(const spTcpConnection &sptcpconnection);           // 对端能否访问内置的指标与追踪服务
 
 };
 
+#include "ServerLifecycle.hpp"
+
 const std::string TcpServer::ReadMessageHandler = "ReadMessageHandler";
 const std::string TcpServer::SendOverHandler = "SendOverHandler";
 const std::string TcpServer::CloseConnHandler = "CloseConnHandler";
@@ -73,35 +111,128 @@ const std::string TcpServer::HttpServiceName = "HttpService";
 const std::string TcpServer::HttpHandler = "HttpHandler";
 const std::string TcpServer::CoverServiceName = "CoverService";
 const std::string TcpServer::CoverHandler = "CoverHandler";
+const std::string TcpServer::MetricsServiceName = "MetricsService";
+const std::string TcpServer::MetricsHandler = "Prometheus";
+const std::string TcpServer::TraceServiceName = "TraceService";
+const std::string TcpServer::TraceHandler = "Chrome";
 
 TcpServer::TcpServer(EventLoop *loop, const int port, const int threadnum, bool coverAllService)
-    : tcpServerSocket_(),
+    : tcpServerSocket_(ServerLifecycle::GetInstance()->TakeListener(port)),
       mainLoop_(loop),
+      accepting_(true),
       tcpServerChannel_(),
       connCount_(0),
       eventLoopThreadPool(loop, threadnum),
-      coverAllService_(coverAllService)
+      coverAllService_(coverAllService),
+      lowWaterMark_(0),
+      highWaterMark_(0),
+      outputLimit_(0)
 {
     LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
     LOG(LoggerLevel::INFO, "创建一个监听端口：%d，io线程数：%d，服务sockfd：%d\n", port, threadnum, tcpServerSocket_.fd());
     std::cout << "TcpServer::TcpServer 创建一个监听端口为：" << port << "、io线程数为：" << threadnum << " 的TcpServer监听" << std::endl;
-    tcpServerSocket_.SetReuseAddr();
-    tcpServerSocket_.BindAddress(port);
-    tcpServerSocket_.Listen();
+    if (!tcpServerSocket_.IsListening())
+    {
+        tcpServerSocket_.SetReuseAddr();
+        tcpServerSocket_.BindAddress(port);
+        tcpServerSocket_.Listen();
+    }
+    else
+    {
+        LOG(LoggerLevel::INFO, "接管从旧进程继承的监听套接字，端口：%d，服务sockfd：%d\n", port, tcpServerSocket_.fd());
+        std::cout << "TcpServer::TcpServer 接管从旧进程继承的监听套接字，端口：" << port << std::endl;
+    }
     tcpServerSocket_.SetNonblocking();
     // 为内置tcpServerChannel_绑定连接处理函数，用于处理客户端连接事件
     tcpServerChannel_.SetFd(tcpServerSocket_.fd()); // TcpServer服务Channel绑定服务套接字tcpServerSocket_
     tcpServerChannel_.SetReadHandle(std::bind(&TcpServer::OnNewConnection, this));
     tcpServerChannel_.SetErrorHandle(std::bind(&TcpServer::OnConnectionError, this));
     tcpServerChannel_.SetEvents(EPOLLIN | EPOLLET); // 设置当前连接的监听事件
+    tcpServerChannel_.SetCompletion(Channel::COMPLETION_ACCEPT);
     LOG(LoggerLevel::INFO, "服务套接字添加到MainEventLoop的epoll内进行监听，服务sockfd：%d\n", tcpServerSocket_.fd());
     std::cout << "TcpServer::TcpServer 服务套接字添加到MainEventLoop的epoll内进行监听，sockfd：" << tcpServerSocket_.fd() << std::endl;
     mainLoop_->AddChannelToPoller(&tcpServerChannel_); // 主事件池添加当前内置Channel为监听对象，监听客户端连接事件
+    // 内置指标服务，/metrics或/MetricsService/Prometheus，覆盖服务绑定模式下不提供，默认仅对本机地址提供（见BuiltinAllowed）
+    RegisterHandler(TcpServer::MetricsServiceName, TcpServer::ReadMessageHandler, std::bind(&TcpServer::HandleBuiltinMessage, this, std::placeholders::_1));
+    RegisterHandler(TcpServer::MetricsServiceName, TcpServer::SendOverHandler, std::bind(&TcpServer::HandleBuiltinEvent, this, std::placeholders::_1));
+    RegisterHandler(TcpServer::MetricsServiceName, TcpServer::CloseConnHandler, std::bind(&TcpServer::HandleBuiltinEvent, this, std::placeholders::_1));
+    RegisterHandler(TcpServer::MetricsServiceName, TcpServer::ErrorConnHandler, std::bind(&TcpServer::HandleBuiltinEvent, this, std::placeholders::_1));
+    RegisterHandler(TcpServer::MetricsServiceName, TcpServer::MetricsHandler, std::bind(&TcpServer::MetricsProcess, this, std::placeholders::_1));
+    // 内置请求追踪服务，/trace或/TraceService/Chrome，参数sample设置采样率，reset=1导出后清空，访问限制同指标服务
+    RegisterHandler(TcpServer::TraceServiceName, TcpServer::ReadMessageHandler, std::bind(&TcpServer::HandleBuiltinMessage, this, std::placeholders::_1));
+    RegisterHandler(TcpServer::TraceServiceName, TcpServer::SendOverHandler, std::bind(&TcpServer::HandleBuiltinEvent, this, std::placeholders::_1));
+    RegisterHandler(TcpServer::TraceServiceName, TcpServer::CloseConnHandler, std::bind(&TcpServer::HandleBuiltinEvent, this, std::placeholders::_1));
+    RegisterHandler(TcpServer::TraceServiceName, TcpServer::ErrorConnHandler, std::bind(&TcpServer::HandleBuiltinEvent, this, std::placeholders::_1));
+    RegisterHandler(TcpServer::TraceServiceName, TcpServer::TraceHandler, std::bind(&TcpServer::TraceProcess, this, std::placeholders::_1));
+    ServerLifecycle::GetInstance()->Register(this);
 }
 
+/*
+ * 注销并停止accept，退出并回收事件池线程
+ * 连接应已由ServerLifecycle排空；仍未关闭的连接持有自身引用，随事件池线程一起废弃，不在析构中跨线程销毁
+ *
+ */
 TcpServer::~TcpServer()
 {
     LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
+    ServerLifecycle::GetInstance()->Unregister(this);
+    if (accepting_)
+    {
+        mainLoop_->RemoveChannelToPoller(&tcpServerChannel_);
+        accepting_ = false;
+    }
+    int clientfd;
+    while (tcpServerChannel_.TakeAccepted(clientfd))
+        close(clientfd);
+    eventLoopThreadPool.Stop();
+    std::lock_guard<std::mutex> lock(mutex_);
+    tcpConnList_.clear();
+}
+
+/*
+ * 停止accept并排空全部连接
+ * 监听套接字只移出主事件池而不关闭，热重启时新进程仍通过它accept，backlog中的连接不会丢失
+ * io_uring下移出时Poller已同步取消accept，已接受而未取走的连接在此接管，随其他连接一起排空
+ * 连接的排空见TcpConnection::Drain
+ *
+ */
+void TcpServer::Drain()
+{
+    LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
+    if (accepting_)
+    {
+        mainLoop_->RemoveChannelToPoller(&tcpServerChannel_);
+        accepting_ = false;
+        if (tcpServerChannel_.CompletionActive())
+            OnNewConnection();
+    }
+    std::vector<spTcpConnection> connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::map<int, spTcpConnection>::iterator iter = tcpConnList_.begin(); iter != tcpConnList_.end(); ++iter)
+            connections.push_back(iter->second);
+    }
+    for (spTcpConnection &sptcpconnection : connections)
+        sptcpconnection->Drain();
+}
+
+void TcpServer::Abort()
+{
+    LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
+    std::vector<spTcpConnection> connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::map<int, spTcpConnection>::iterator iter = tcpConnList_.begin(); iter != tcpConnList_.end(); ++iter)
+            connections.push_back(iter->second);
+    }
+    for (spTcpConnection &sptcpconnection : connections)
+        sptcpconnection->Abort();
+}
+
+size_t TcpServer::ConnectionCount()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tcpConnList_.size();
 }
 
 /*
@@ -112,6 +243,7 @@ TcpServer::~TcpServer()
  * 不论在哪里置为true，若在未定义默认服务时有请求接入则会不安全
  * 若在此函数置为true，在置为true且尚未定义默认服务函数时有请求接入也会不安全
  * 后续注册函数时也必须填入coverAllService=true参数，否则不予注册
+ * 请求处理函数注册时包装一层耗时统计，按服务名、函数名记录到处理延迟直方图，直方图的计数即请求数，同时记录追踪的处理函数开始时间
  *
  */
 void TcpServer::RegisterHandler(std::string serviceName, const std::string handlerType, const Callback &handlerFunc, bool coverAllService)
@@ -131,7 +263,21 @@ void TcpServer::RegisterHandler(std::string serviceName, const std::string handl
         std::map<std::string, Callback> serviceHandlers;
         serviceHandlers_[serviceName] = std::move(serviceHandlers);
     }
-    serviceHandlers_[serviceName][handlerType] = handlerFunc;
+    if (TcpServer::ReadMessageHandler == handlerType || TcpServer::SendOverHandler == handlerType ||
+        TcpServer::CloseConnHandler == handlerType || TcpServer::ErrorConnHandler == handlerType || !handlerFunc)
+    {
+        serviceHandlers_[serviceName][handlerType] = handlerFunc;
+        return;
+    }
+    MetricsHistogram *latency = Metrics::GetInstance()->Histogram("netserver_handler_latency_seconds", "Time spent in request handlers.",
+                                                                  "service=\"" + serviceName + "\",handler=\"" + handlerType + "\"");
+    serviceHandlers_[serviceName][handlerType] = [handlerFunc, latency](spTcpConnection &sptcpconnection)
+    {
+        sptcpconnection->Trace(TRACE_HANDLER);
+        int64_t start = Metrics::NowNs();
+        handlerFunc(sptcpconnection);
+        latency->Record(Metrics::NowNs() - start);
+    };
 }
 
 /*
@@ -147,6 +293,21 @@ void TcpServer::BindDynamicHandler(spTcpConnection &sptcpconnection)
     std::string serviceName, handlerName, resourceUrl;
     LOG(LoggerLevel::INFO, "开始解析服务url：%s，服务sockfd：%d\n", url.data(), tcpServerSocket_.fd());
     // std::cout << "TcpServer::BindDynamicHandler 开始解析服务url：" << url << std::endl;
+    if (!coverAllService_ && MatchBuiltinUrl(url, "/metrics") && BuiltinAllowed(sptcpconnection))
+    {
+        // Prometheus默认的抓取路径，绑定内置指标服务
+        httpRequestContext.serviceName = TcpServer::MetricsServiceName;
+        httpRequestContext.handlerName = TcpServer::MetricsHandler;
+        BindService(sptcpconnection, TcpServer::MetricsServiceName, TcpServer::MetricsHandler);
+        return;
+    }
+    if (!coverAllService_ && MatchBuiltinUrl(url, "/trace") && BuiltinAllowed(sptcpconnection))
+    {
+        httpRequestContext.serviceName = TcpServer::TraceServiceName;
+        httpRequestContext.handlerName = TcpServer::TraceHandler;
+        BindService(sptcpconnection, TcpServer::TraceServiceName, TcpServer::TraceHandler);
+        return;
+    }
     // 解析请求的服务，绑定注册的各类服务提供函数
     size_t nextFind = url.find('/', 1);
     if (std::string::npos != nextFind)
@@ -238,6 +399,15 @@ void TcpServer::BindDynamicHandler(spTcpConnection &sptcpconnection)
     }
     LOG(LoggerLevel::INFO, "解析出请求的函数：%s，服务sockfd：%d\n", handlerName.c_str(), tcpServerSocket_.fd());
     std::cout << "TcpServer::BindDynamicHandler 解析出请求的函数：" << handlerName << "，sockfd：" << sptcpconnection->fd() << std::endl;
+    BindService(sptcpconnection, serviceName, handlerName);
+}
+
+/*
+ * 绑定服务的各事件处理函数
+ *
+ */
+void TcpServer::BindService(spTcpConnection &sptcpconnection, const std::string &serviceName, const std::string &handlerName)
+{
     sptcpconnection->SetMessaeCallback(serviceHandlers_[serviceName][TcpServer::ReadMessageHandler]);
     sptcpconnection->SetSendCompleteCallback(serviceHandlers_[serviceName][TcpServer::SendOverHandler]);
     sptcpconnection->SetCloseCallback(serviceHandlers_[serviceName][TcpServer::CloseConnHandler]);
@@ -257,37 +427,201 @@ void TcpServer::OnNewConnection()
     LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
     struct sockaddr_in clientaddr;
     int clientfd;
-    while ((clientfd = tcpServerSocket_.Accept(clientaddr)) > 0)
+    while ((clientfd = AcceptConnection(clientaddr)) > 0)
     {
         // 新连接进入处理
+        Metrics::Server().accepts->Add();
         LOG(LoggerLevel::INFO, "TceServer接受来自%s:%d的新连接sockfd:%d,，服务sockfd：%d\n", inet_ntoa(clientaddr.sin_addr), ntohs(clientaddr.sin_port), clientfd, tcpServerSocket_.fd());
         std::cout << "TcpServer::OnNewConnection TceServer接受来自" << inet_ntoa(clientaddr.sin_addr)
                   << ":" << ntohs(clientaddr.sin_port)
                   << " 的新连接，sockfd：" << clientfd << std::endl;
-        if (++connCount_ >= MAXCONNECTION)
+        if (++connCount_ >= ServerConfig::GetInstance()->MaxConnections())
         {
             // TODO 连接超量 connCount_需要-1 线程安全？
             close(clientfd);
             continue;
         }
-        Setnonblocking(clientfd);
+        // accept完成模式下新连接已为非阻塞
+        if (!tcpServerChannel_.CompletionActive())
+            Setnonblocking(clientfd);
         // 从多线程事件池获取一个事件池索引，该事件池可能是主事件池线程，也可能是事件池工作线程
         // 无论是哪一种，在运行期间都会循环调用loop的poll监听直至服务关闭
         EventLoop *loop = eventLoopThreadPool.GetNextLoop();
         // 创建连接抽象类实例TcpConnection
         // 该对象是客户端连接的抽象表示，能在其中对连接进行业务逻辑操作
-        spTcpConnection sptcpconnection = std::make_shared<TcpConnection>(loop, clientfd, clientaddr);
+        // 连接连同内置的Channel、定时器与shared_ptr控制块从accept线程的slab池分配，短连接频繁建立关闭时不经过malloc
+        spTcpConnection sptcpconnection = std::allocate_shared<TcpConnection>(PoolAllocator<TcpConnection>(), loop, clientfd, clientaddr);
         sptcpconnection->SetDynamicHandler(std::bind(&TcpServer::BindDynamicHandler, this, std::placeholders::_1));
         sptcpconnection->SetConnectionCleanUp(std::bind(&TcpServer::RemoveConnection, this, std::placeholders::_1));
+        if (outputLimit_)
+            sptcpconnection->SetOutputWatermarks(lowWaterMark_, highWaterMark_, outputLimit_);
+        if (watermarkCallback_)
+            sptcpconnection->SetWatermarkCallback(watermarkCallback_);
+        if (codec_)
+        {
+            // 编解码器模式：连接建立即完成绑定，收到的数据由编解码器切分后直接回调服务函数
+            Callback ignore = [](spTcpConnection &) {};
+            sptcpconnection->SetMessaeCallback(ignore);
+            sptcpconnection->SetSendCompleteCallback(ignore);
+            sptcpconnection->SetErrorCallback(ignore);
+            sptcpconnection->SetCloseCallback(codecCloseCallback_ ? codecCloseCallback_ : ignore);
+            sptcpconnection->SetBindedHandler(true);
+            sptcpconnection->StartCodec(codec_, codecMessageCallback_);
+        }
         {
             // 无名作用域
             std::lock_guard<std::mutex> lock(mutex_);
             tcpConnList_[clientfd] = sptcpconnection;
         }
+        Metrics::Server().activeConnections->Add(1);
         sptcpconnection->AddChannelToLoop();
     }
 }
 
+/*
+ * 取得一个新连接，没有时返回0
+ * accept完成模式下取走Poller已接受的连接并以getpeername补全客户端地址，Poller已退回就绪通知时再自行accept
+ *
+ */
+int TcpServer::AcceptConnection(struct sockaddr_in &clientaddr)
+{
+    int clientfd;
+    if (tcpServerChannel_.TakeAccepted(clientfd))
+    {
+        socklen_t length = sizeof(clientaddr);
+        Metrics::Server().ioSyscalls->Add();
+        if (getpeername(clientfd, (struct sockaddr *)&clientaddr, &length) < 0)
+            memset(&clientaddr, 0, sizeof(clientaddr));
+        return clientfd;
+    }
+    if (tcpServerChannel_.CompletionActive())
+        return 0;
+    Metrics::Server().ioSyscalls->Add();
+    return tcpServerSocket_.Accept(clientaddr);
+}
+
+/*
+ * 设置连接的编解码器，只影响之后接受的连接
+ * 编解码器模式下连接不发送http错误响应，出错或协议非法时直接关闭
+ *
+ */
+void TcpServer::SetCodec(const std::shared_ptr<Codec> &codec, const TcpConnection::CodecCallback &onMessage, const Callback &onClose)
+{
+    LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
+    std::lock_guard<std::mutex> lock(mutex_);
+    codec_ = onMessage ? codec : nullptr;
+    codecMessageCallback_ = onMessage;
+    codecCloseCallback_ = onClose;
+    if (codec_)
+        LOG(LoggerLevel::INFO, "TcpServer使用%s编解码器，服务sockfd：%d\n", codec_->Name(), tcpServerSocket_.fd());
+}
+
+/*
+ * 设置连接输出队列的水位与硬上限，只影响之后接受的连接
+ * 慢速读取的客户端使输出队列越过高水位时暂停读取该连接，超过硬上限时关闭，服务端的内存占用不随慢速客户端增长
+ *
+ */
+void TcpServer::SetOutputWatermarks(size_t lowWaterMark, size_t highWaterMark, size_t outputLimit,
+                                    const TcpConnection::WatermarkCallback &onWatermark)
+{
+    LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
+    std::lock_guard<std::mutex> lock(mutex_);
+    lowWaterMark_ = lowWaterMark;
+    highWaterMark_ = highWaterMark;
+    outputLimit_ = outputLimit;
+    watermarkCallback_ = onWatermark;
+}
+
+/*
+ * url的路径部分是否为path，忽略查询参数
+ *
+ */
+bool TcpServer::MatchBuiltinUrl(const std::string &url, const std::string &path)
+{
+    return 0 == url.compare(0, path.size(), path) && (path.size() == url.size() || '?' == url[path.size()]);
+}
+
+/*
+ * 对端能否访问内置的指标与追踪服务
+ * 追踪服务可修改全局采样率并清空已保留的请求，默认只对127.0.0.0/8的对端提供，其余对端按普通url处理
+ * 配置adminRemoteAccess为1时对所有对端开放，应仅在管理端口不对公网暴露时使用
+ *
+ */
+bool TcpServer::BuiltinAllowed(const spTcpConnection &sptcpconnection)
+{
+    if (ServerConfig::GetInstance()->AdminRemoteAccess())
+        return true;
+    return 127 == (ntohl(sptcpconnection->GetClientAddr().sin_addr.s_addr) >> 24);
+}
+
+/*
+ * 内置服务：指标与追踪的读取无阻塞操作，在loop所在线程直接执行处理函数
+ *
+ */
+void TcpServer::HandleBuiltinMessage(spTcpConnection &sptcpconnection)
+{
+    LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
+    sptcpconnection->GetReqHandler()(sptcpconnection);
+}
+
+void TcpServer::HandleBuiltinEvent(spTcpConnection &sptcpconnection)
+{
+    LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
+}
+
+/*
+ * 内置指标服务：以Prometheus文本格式响应全部指标
+ *
+ */
+void TcpServer::MetricsProcess(spTcpConnection &sptcpconnection)
+{
+    LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
+    std::string body;
+    Metrics::GetInstance()->ExportPrometheus(body);
+    SendBuiltinResponse(sptcpconnection, "text/plain; version=0.0.4; charset=utf-8", body);
+}
+
+/*
+ * 内置追踪服务：sample参数设置采样率（0~1），导出已保留的最慢请求，reset=1时导出后清空
+ *
+ */
+void TcpServer::TraceProcess(spTcpConnection &sptcpconnection)
+{
+    LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
+    const std::string &url = sptcpconnection->GetReqestBuffer().url;
+    RequestTracer *tracer = RequestTracer::GetInstance();
+    size_t pos = url.find("sample=");
+    if (std::string::npos != pos)
+    {
+        tracer->SetSampleRate(atof(url.c_str() + pos + 7));
+        LOG(LoggerLevel::INFO, "请求追踪采样率设置为：%f，服务sockfd：%d\n", tracer->GetSampleRate(), tcpServerSocket_.fd());
+    }
+    std::string body;
+    tracer->ExportChromeTrace(body);
+    if (std::string::npos != url.find("reset=1"))
+        tracer->Reset();
+    SendBuiltinResponse(sptcpconnection, "application/json", body);
+}
+
+/*
+ * 内置服务的200响应，按请求的Connection字段回复
+ *
+ */
+void TcpServer::SendBuiltinResponse(spTcpConnection &sptcpconnection, const char *contentType, const std::string &body)
+{
+    HttpRequestContext &httpRequestContext = sptcpconnection->GetReqestBuffer();
+    std::string &responsecontext = sptcpconnection->GetBufferOut();
+    responsecontext += "HTTP/1.1 200 OK\r\n";
+    responsecontext += "Server: Qiu Hai's NetServer\r\n";
+    responsecontext += "Content-Type: " + std::string(contentType) + "\r\n";
+    std::map<std::string, std::string>::const_iterator iter = httpRequestContext.header.find("Connection");
+    if (iter != httpRequestContext.header.end())
+        responsecontext += "Connection: " + iter->second + "\r\n";
+    responsecontext += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    responsecontext += body;
+    sptcpconnection->SendBufferOut();
+}
+
 /*
  * 处理连接错误，关闭套接字
  *
@@ -314,6 +648,7 @@ void TcpServer::RemoveConnection(spTcpConnection &sptcpconnection)
         --connCount_;
         tcpConnList_.erase(sptcpconnection->fd());
     }
+    Metrics::Server().activeConnections->Add(-1);
     std::cout << "TcpServer::RemoveConnection sockfd为" << sptcpconnection->fd() << "的客户端的连接use_count为：" << sptcpconnection.use_count() << std::endl;
 }
 
@@ -324,6 +659,7 @@ void TcpServer::RemoveConnection(spTcpConnection &sptcpconnection)
 void TcpServer::Setnonblocking(int fd)
 {
     LOG(LoggerLevel::INFO, "%s，服务sockfd：%d\n", "函数触发", tcpServerSocket_.fd());
+    Metrics::Server().ioSyscalls->Add(2);
     int opts = fcntl(fd, F_GETFL);
     if (opts < 0)
     {
@@ -26,30 +26,34 @@
 #include <sstream>
 #include <queue>
 #include <mutex>
+#include <atomic>
 #include <thread>
 #include <condition_variable>
 #include <functional>
 #include <deque>
+#include "Metrics.hpp"
+#include "UniqueFunction.hpp"
+#include "CpuAffinity.hpp"
 
 class ThreadPool
 {
 public:
-    typedef std::function<void()> Task;
+    typedef UniqueFunction<void()> Task; // 任务函数，只可移动，入队出队不复制捕获对象
     ThreadPool(int threadnum = 0);
     ~ThreadPool();
     void Start();            // 标志为运行状态，创建threadNum_个子线程作为工作线程并启动线程
-    void Stop();             // 标志为停止运行状态，唤醒所有线程，线程分离异步运行，清空线程池
+    void Stop();             // 标志为停止运行状态，唤醒所有线程，等待正在执行的任务结束后回收线程
     void AddTask(Task task); // 添加一个任务到任务列表taskQueue_，随机唤醒一个工作线程执行一个任务
     void ThreadFunc();       // 线程回调函数，单次遍历，加锁取出taskQueue_的一个任务并执行
     int GetThreadNum();      // 获取工作线程数量
 
 private:
-    bool started_;  // 线程池运行状态
+    std::atomic<bool> started_; // 线程池运行状态，工作线程在锁外读取
     int threadNum_; // 线程池控制工作线程数量
     std::mutex mutex_;
     std::condition_variable condition_;
     std::vector<std::thread *> threadList_; // 工作线程列表
-    std::queue<Task> taskQueue_;            // 任务队列，由线程池及其子工作线程间共享，线程池负责添加，工作线程执行
+    std::queue<std::pair<Task, int64_t>> taskQueue_; // 任务队列及入队时间，由线程池及其子工作线程间共享，线程池负责添加，工作线程执行
 
 };
 
@@ -68,15 +72,6 @@ ThreadPool::~ThreadPool()
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     Stop();
-    for (int i = 0; i < threadNum_; ++i)
-    {
-        threadList_[i]->join();
-    }
-    for (int i = 0; i < threadNum_; ++i)
-    {
-        delete threadList_[i];
-    }
-    threadList_.clear();
 }
 
 /*
@@ -99,21 +94,29 @@ void ThreadPool::Start()
 }
 
 /*
- * 标志为停止运行状态，唤醒所有线程，线程分离异步运行，清空线程池
+ * 标志为停止运行状态，唤醒所有线程，等待正在执行的任务结束后回收线程，清空线程池
+ * 队列内尚未执行的任务被丢弃；线程不再分离，析构后不会有工作线程访问已释放的线程池与任务引用的对象
+ * 可重复调用，析构时调用
  *
  */
 void ThreadPool::Stop()
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
-    started_ = false;
+    {
+        // 与工作线程的等待条件同步，避免置位发生在其检查之后、进入等待之前而错过唤醒
+        std::lock_guard<std::mutex> lock(mutex_);
+        started_ = false;
+    }
     condition_.notify_all();
     for (auto i : threadList_)
     {
-        LOG(LoggerLevel::INFO, "启动并分离线程：%d\n", i);
-        // 线程分离，异步线程
-        i->detach();
+        LOG(LoggerLevel::INFO, "回收线程：%d\n", i);
+        if (i->get_id() != std::this_thread::get_id())
+            i->join();
+        else
+            i->detach();
+        delete i;
     }
-    // 子线程分离后不再管理子线程句柄，由started_控制子线程停止
     threadList_.clear();
 }
 
@@ -127,7 +130,7 @@ void ThreadPool::AddTask(Task task)
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        taskQueue_.push(task);
+        taskQueue_.emplace(std::move(task), Metrics::NowNs());
     }
     condition_.notify_one();
 }
@@ -140,6 +143,8 @@ void ThreadPool::AddTask(Task task)
 void ThreadPool::ThreadFunc()
 {
     LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    // 命名为worker-N，并按配置绑定到loop线程以外的CPU
+    CpuAffinity::GetInstance()->BindThread(CpuAffinity::WORKER);
     std::thread::id tid = std::this_thread::get_id();
     std::stringstream sin;
     sin << tid;
@@ -148,7 +153,7 @@ void ThreadPool::ThreadFunc()
     Task task;
     while (started_)
     {
-        task = NULL;
+        task = nullptr;
         {
             // 无名作用域
             std::unique_lock<std::mutex> lock(mutex_);
@@ -165,7 +170,8 @@ void ThreadPool::ThreadFunc()
             LOG(LoggerLevel::INFO, "线程池工作线程：%d已唤醒，现有待处理任务数量：%d\n", tid, taskQueue_.size());
             // std::cout << "ThreadPool::ThreadFunc 线程池工作线程: " << tid << " 已唤醒，现有待处理任务数量: " << taskQueue_.size() << std::endl;
             // 取出队头待处理任务
-            task = taskQueue_.front();
+            task = std::move(taskQueue_.front().first);
+            Metrics::Server().queueWait->Record(Metrics::NowNs() - taskQueue_.front().second);
             taskQueue_.pop();
         }
         if (task)
@@ -1,6 +1,7 @@
 
 // Timer类
 //  定时器，生命周期由用户自行管理
+//  启动、停止与调整经TimerManager加锁完成，定义在TimerManager.hpp，首次启动时创建时间轮工作线程
 
 #pragma once
 
@@ -25,9 +26,11 @@ public:
     int timeSlot;   // 
     Timer *prev;    // 
     Timer *next;    // 
-    void Start();   // 
-    void Stop();    // 
+    void Start();   // 按当前超时时间加入时间轮，已在时间轮内则重新计时，可跨线程调用
+    void Stop();    // 从时间轮移除，可跨线程调用
+    bool Active();  // 是否在时间轮内等待触发
     void Adjust(int timeout, Timer::TimerType timertype, const CallBack &timerCallBack);    // 重新设置定时器
+    void Adjust(int timeout, Timer::TimerType timertype);   // 重新设置超时时间与类型，保留触发函数
 
 };
 
@@ -49,30 +52,4 @@ Timer::~Timer()
     Stop();
 }
 
-/*
- * 启动定时器
- * 
- */
-void Timer::Start()
-{
-}
-
-/*
- * 停止定时器
- * 
- */
-void Timer::Stop()
-{
-}
-
-/*
- * 更新定时器信息
- * 超时时间、定时器类型、触发函数
- * 
- */
-void Timer::Adjust(int timeOut, Timer::TimerType timerType, const CallBack &timerCallBack)
-{
-    timeOut_ = timeOut;
-    timerType_ = timerType;
-    timerCallBack_ = timerCallBack;
-}
+#include "TimerManager.hpp"
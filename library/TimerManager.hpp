@@ -1,6 +1,7 @@
 
 // TimerManager类
 //  定时器管理类，基于时间轮实现，增加删除O(1)，执行可能复杂度高些，slot多的话可以降低链表长度
+//  到期的触发函数在锁外执行，触发函数内可以启动、停止或调整定时器
 
 #pragma once
 
@@ -10,6 +11,7 @@
 #include <condition_variable>
 #include <vector>
 #include <thread>
+#include <atomic>
 #include <ctime>
 #include <ratio>
 #include <chrono>
@@ -25,7 +27,9 @@ public:
     void AddTimer(Timer *ptimer);       // 添加一个定时器任务到定时器列表timeWheel（时间轮）
     void RemoveTimer(Timer *ptimer);    // 从定时器列表timeWheel删除一个定时任务
     void AdjustTimer(Timer *ptimer);    // 修改定时器列表timeWheel内一个定时任务的信息
-    void Start();   // 标志为运行状态，创建子线程
+    void ResetTimer(Timer *ptimer, int timeout, Timer::TimerType timertype, CallBack *timerCallBack); // 加锁更新超时时间与类型，timerCallBack非空时与原触发函数交换，已在时间轮内的重新计时
+    bool IsTimerActive(Timer *ptimer);  // 定时器是否在时间轮内等待触发
+    void Start();   // 标志为运行状态，创建子线程，已在运行时直接返回
     void Stop();    // 标志为停止运行状态，同步启动线程
     class GC        // 全局静态初始化一个GC类，GC析构时析构单例TimerManager
     {
@@ -45,7 +49,7 @@ private:
     static GC gc;       // 静态成员对象GC，其析构函数调用TimerManager的析构函数
     static TimerManager *timerManager_; // 静态指针成员，其指向生成的单例模式TimerManager实例
     std::vector<Timer *> timeWheel;     // 时间轮列表，存储了所有的定时器指针
-    bool running_;      // 运行状态
+    std::atomic<bool> running_; // 运行状态
     int currentSlot;    // 当前时间轮的槽位标志
     static const int slotInterval;  // 
     static const int slotNum;       // 时间轮定时器最大数量
@@ -56,6 +60,7 @@ private:
     void AddTimerToTimeWheel(Timer *ptimer);    // 添加一个定时器任务到定时器列表timeWheel（时间轮）
     void AdjustTimerToWheel(Timer *ptimer);     // 修改定时器列表timeWheel内一个定时任务的信息
     void RemoveTimerFromTimeWheel(Timer *ptimer);   // 从定时器列表timeWheel删除一个定时任务
+    bool InTimeWheel(Timer *ptimer);    // 定时器是否在时间轮的链表中，需持有timeWheelMutex_
 
 };
 
@@ -197,6 +202,45 @@ void TimerManager::AdjustTimerToWheel(Timer *ptimer)
     AddTimerToTimeWheel(ptimer);
 }
 
+/*
+ * 加锁更新定时器的超时时间与类型，已在时间轮内的按新超时时间重新计时
+ * timerCallBack非空时与原触发函数交换，原触发函数由调用者在锁外析构，其持有的可能是定时器所属对象的最后一个引用
+ * 
+ */
+void TimerManager::ResetTimer(Timer *ptimer, int timeout, Timer::TimerType timertype, CallBack *timerCallBack)
+{
+    if (ptimer == nullptr)
+        return;
+    std::lock_guard<std::mutex> lock(timeWheelMutex_);
+    ptimer->timeOut_ = timeout;
+    ptimer->timerType_ = timertype;
+    if (timerCallBack != nullptr)
+        ptimer->timerCallBack_.swap(*timerCallBack);
+    if (InTimeWheel(ptimer))
+        AdjustTimerToWheel(ptimer);
+}
+
+/*
+ * 定时器是否在时间轮内等待触发
+ * 
+ */
+bool TimerManager::IsTimerActive(Timer *ptimer)
+{
+    if (ptimer == nullptr)
+        return false;
+    std::lock_guard<std::mutex> lock(timeWheelMutex_);
+    return InTimeWheel(ptimer);
+}
+
+/*
+ * 定时器是否在时间轮的链表中：位于槽位链表头，或有前驱
+ * 
+ */
+bool TimerManager::InTimeWheel(Timer *ptimer)
+{
+    return ptimer->prev != nullptr || timeWheel[ptimer->timeSlot] == ptimer;
+}
+
 /*
  * 计算定时器参数timeSlot、rotation
  * 
@@ -226,40 +270,46 @@ void TimerManager::CalculateTimer(Timer *ptimer)
  */
 void TimerManager::CheckTimer()
 {
-    std::lock_guard<std::mutex> lock(timeWheelMutex_);
-    Timer *ptimer = timeWheel[currentSlot];
-    while (ptimer != nullptr)
+    // 先移除或重新计时再执行任务：触发函数复制出来在锁外执行，任务里可以调整或清理定时器自身
+    std::vector<CallBack> expired;
     {
-        if (ptimer->rotation > 0)
+        std::lock_guard<std::mutex> lock(timeWheelMutex_);
+        Timer *ptimer = timeWheel[currentSlot];
+        while (ptimer != nullptr)
         {
-            --ptimer->rotation;
-            ptimer = ptimer->next;
-        }
-        else
-        {
-            // 可执行定时器任务
-            // 注意：任务里不能把定时器自身给清理掉！！！我认为应该先移除再执行任务
-            ptimer->timerCallBack_();
-            if (ptimer->timerType_ == Timer::TimerType::TIMER_ONCE)
+            if (ptimer->rotation > 0)
             {
-                Timer *ptemptimer = ptimer;
+                --ptimer->rotation;
                 ptimer = ptimer->next;
-                RemoveTimerFromTimeWheel(ptemptimer);
             }
             else
             {
-                Timer *ptemptimer = ptimer;
-                ptimer = ptimer->next;
-                AdjustTimerToWheel(ptemptimer);
-                if (currentSlot == ptemptimer->timeSlot && ptemptimer->rotation > 0)
+                // 可执行定时器任务
+                if (ptimer->timerCallBack_)
+                    expired.push_back(ptimer->timerCallBack_);
+                if (ptimer->timerType_ == Timer::TimerType::TIMER_ONCE)
                 {
-                    // 每经历一轮，需等待轮数-1
-                    --ptemptimer->rotation;
+                    Timer *ptemptimer = ptimer;
+                    ptimer = ptimer->next;
+                    RemoveTimerFromTimeWheel(ptemptimer);
+                }
+                else
+                {
+                    Timer *ptemptimer = ptimer;
+                    ptimer = ptimer->next;
+                    AdjustTimerToWheel(ptemptimer);
+                    if (currentSlot == ptemptimer->timeSlot && ptemptimer->rotation > 0)
+                    {
+                        // 每经历一轮，需等待轮数-1
+                        --ptemptimer->rotation;
+                    }
                 }
             }
         }
+        currentSlot = (currentSlot + 1) % TimerManager::slotNum; // 移动至下一个时间槽
     }
-    currentSlot = (++currentSlot) % TimerManager::slotNum; // 移动至下一个时间槽
+    for (CallBack &callback : expired)
+        callback();
 }
 
 /*
@@ -304,6 +354,11 @@ void TimerManager::CheckTick()
  */
 void TimerManager::Start()
 {
+    if (running_)
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_)
+        return;
     running_ = true;
     th_ = std::thread(&TimerManager::CheckTick, this);
 }
@@ -318,3 +373,55 @@ void TimerManager::Stop()
     if (th_.joinable())
         th_.join();
 }
+
+/*
+ * 启动定时器
+ * 首次启动时创建时间轮工作线程，已在时间轮内则按当前超时时间重新计时
+ * 
+ */
+void Timer::Start()
+{
+    TimerManager *timerManager = TimerManager::GetTimerManagerInstance();
+    timerManager->Start();
+    timerManager->AdjustTimer(this);
+}
+
+/*
+ * 停止定时器
+ * 
+ */
+void Timer::Stop()
+{
+    TimerManager::GetTimerManagerInstance()->RemoveTimer(this);
+}
+
+/*
+ * 定时器是否在时间轮内等待触发
+ * 
+ */
+bool Timer::Active()
+{
+    return TimerManager::GetTimerManagerInstance()->IsTimerActive(this);
+}
+
+/*
+ * 更新定时器信息
+ * 超时时间、定时器类型、触发函数，已在时间轮内的重新计时
+ * 被替换的触发函数在锁外析构
+ * 
+ */
+void Timer::Adjust(int timeOut, Timer::TimerType timerType, const CallBack &timerCallBack)
+{
+    CallBack callback(timerCallBack);
+    TimerManager::GetTimerManagerInstance()->ResetTimer(this, timeOut, timerType, &callback);
+}
+
+/*
+ * 更新定时器信息，保留已设置的触发函数，已在时间轮内的重新计时
+ * 用于长连接每次请求刷新超时，避免重复构造持有连接智能指针的触发函数
+ * 
+ */
+void Timer::Adjust(int timeOut, Timer::TimerType timerType)
+{
+    TimerManager::GetTimerManagerInstance()->ResetTimer(this, timeOut, timerType, nullptr);
+}
@@ -1,773 +1,845 @@
+// TypeIdentify类：
+//  按资源后缀（".xx"）查询Content-Type，后缀大小写不敏感
+//  后缀表在编译期生成两级完美哈希：先按后缀散列到桶，再为每个桶选取一个种子，使桶内所有后缀经二次散列后落在互不相同的空槽
+//  查询只需计算两次散列并比较一次字符串，不加锁、不分配内存、无启动开销，返回指向静态存储的string_view
+
 #pragma once
 
-#include <map>
 #include <string>
-#include <mutex>
-
+#include <cstdint>
+#include <string_view>
 
-// 根据后缀格式“.xx”获取对应文本类型
+#define MIME_HASH_BUCKETS 256    // 一级散列的桶数
+#define MIME_HASH_SLOTS 1024     // 二级散列的槽数，须为2的幂且不小于后缀数量
+#define MIME_HASH_BUCKET_MAX 16  // 单个桶内的后缀数量上限
 
+// 后缀（小写）与对应的文本类型
+struct MimeType
+{
+    std::string_view suffix;
+    std::string_view type;
+};
 
-const std::pair<std::string, std::string> pairArray[] =
+constexpr MimeType mimeTypes[] =
 {
-    std::make_pair(".load", "text/html"),
-    std::make_pair(".123", "application/vnd.lotus-1-2-3"),
-    std::make_pair(".3ds", "image/x-3ds"),
-    std::make_pair(".3g2", "video/3gpp"),
-    std::make_pair(".3ga", "video/3gpp"),
-    std::make_pair(".3gp", "video/3gpp"),
-    std::make_pair(".3gpp", "video/3gpp"),
-    std::make_pair(".602", "application/x-t602"),
-    std::make_pair(".669", "audio/x-mod"),
-    std::make_pair(".7z", "application/x-7z-compressed"),
-    std::make_pair(".a", "application/x-archive"),
-    std::make_pair(".aac", "audio/mp4"),
-    std::make_pair(".abw", "application/x-abiword"),
-    std::make_pair(".abw.crashed", "application/x-abiword"),
-    std::make_pair(".abw.gz", "application/x-abiword"),
-    std::make_pair(".ac3", "audio/ac3"),
-    std::make_pair(".ace", "application/x-ace"),
-    std::make_pair(".adb", "text/x-adasrc"),
-    std::make_pair(".ads", "text/x-adasrc"),
-    std::make_pair(".afm", "application/x-font-afm"),
-    std::make_pair(".ag", "image/x-applix-graphics"),
-    std::make_pair(".ai", "application/illustrator"),
-    std::make_pair(".aif", "audio/x-aiff"),
-    std::make_pair(".aifc", "audio/x-aiff"),
-    std::make_pair(".aiff", "audio/x-aiff"),
-    std::make_pair(".al", "application/x-perl"),
-    std::make_pair(".alz", "application/x-alz"),
-    std::make_pair(".amr", "audio/amr"),
-    std::make_pair(".ani", "application/x-navi-animation"),
-    std::make_pair(".anim[1-9j]", "video/x-anim"),
-    std::make_pair(".anx", "application/annodex"),
-    std::make_pair(".ape", "audio/x-ape"),
-    std::make_pair(".arj", "application/x-arj"),
-    std::make_pair(".arw", "image/x-sony-arw"),
-    std::make_pair(".as", "application/x-applix-spreadsheet"),
-    std::make_pair(".asc", "text/plain"),
-    std::make_pair(".asf", "video/x-ms-asf"),
-    std::make_pair(".asp", "application/x-asp"),
-    std::make_pair(".ass", "text/x-ssa"),
-    std::make_pair(".asx", "audio/x-ms-asx"),
-    std::make_pair(".atom", "application/atom+xml"),
-    std::make_pair(".au", "audio/basic"),
-    std::make_pair(".avi", "video/x-msvideo"),
-    std::make_pair(".aw", "application/x-applix-word"),
-    std::make_pair(".awb", "audio/amr-wb"),
-    std::make_pair(".awk", "application/x-awk"),
-    std::make_pair(".axa", "audio/annodex"),
-    std::make_pair(".axv", "video/annodex"),
-    std::make_pair(".bak", "application/x-trash"),
-    std::make_pair(".bcpio", "application/x-bcpio"),
-    std::make_pair(".bdf", "application/x-font-bdf"),
-    std::make_pair(".bib", "text/x-bibtex"),
-    std::make_pair(".bin", "application/octet-stream"),
-    std::make_pair(".blend", "application/x-blender"),
-    std::make_pair(".blender", "application/x-blender"),
-    std::make_pair(".bmp", "image/bmp"),
-    std::make_pair(".bz", "application/x-bzip"),
-    std::make_pair(".bz2", "application/x-bzip"),
-    std::make_pair(".c", "text/x-csrc"),
-    std::make_pair(".c++", "text/x-c++src"),
-    std::make_pair(".cab", "application/vnd.ms-cab-compressed"),
-    std::make_pair(".cb7", "application/x-cb7"),
-    std::make_pair(".cbr", "application/x-cbr"),
-    std::make_pair(".cbt", "application/x-cbt"),
-    std::make_pair(".cbz", "application/x-cbz"),
-    std::make_pair(".cc", "text/x-c++src"),
-    std::make_pair(".cdf", "application/x-netcdf"),
-    std::make_pair(".cdr", "application/vnd.corel-draw"),
-    std::make_pair(".cer", "application/x-x509-ca-cert"),
-    std::make_pair(".cert", "application/x-x509-ca-cert"),
-    std::make_pair(".cgm", "image/cgm"),
-    std::make_pair(".chm", "application/x-chm"),
-    std::make_pair(".chrt", "application/x-kchart"),
-    std::make_pair(".class", "application/x-java"),
-    std::make_pair(".cls", "text/x-tex"),
-    std::make_pair(".cmake", "text/x-cmake"),
-    std::make_pair(".cpio", "application/x-cpio"),
-    std::make_pair(".cpio.gz", "application/x-cpio-compressed"),
-    std::make_pair(".cpp", "text/x-c++src"),
-    std::make_pair(".cr2", "image/x-canon-cr2"),
-    std::make_pair(".crt", "application/x-x509-ca-cert"),
-    std::make_pair(".crw", "image/x-canon-crw"),
-    std::make_pair(".cs", "text/x-csharp"),
-    std::make_pair(".csh", "application/x-csh"),
-    std::make_pair(".css", "text/css"),
-    std::make_pair(".cssl", "text/css"),
-    std::make_pair(".csv", "text/csv"),
-    std::make_pair(".cue", "application/x-cue"),
-    std::make_pair(".cur", "image/x-win-bitmap"),
-    std::make_pair(".cxx", "text/x-c++src"),
-    std::make_pair(".d", "text/x-dsrc"),
-    std::make_pair(".dar", "application/x-dar"),
-    std::make_pair(".dbf", "application/x-dbf"),
-    std::make_pair(".dc", "application/x-dc-rom"),
-    std::make_pair(".dcl", "text/x-dcl"),
-    std::make_pair(".dcm", "application/dicom"),
-    std::make_pair(".dcr", "image/x-kodak-dcr"),
-    std::make_pair(".dds", "image/x-dds"),
-    std::make_pair(".deb", "application/x-deb"),
-    std::make_pair(".der", "application/x-x509-ca-cert"),
-    std::make_pair(".desktop", "application/x-desktop"),
-    std::make_pair(".dia", "application/x-dia-diagram"),
-    std::make_pair(".diff", "text/x-patch"),
-    std::make_pair(".divx", "video/x-msvideo"),
-    std::make_pair(".djv", "image/vnd.djvu"),
-    std::make_pair(".djvu", "image/vnd.djvu"),
-    std::make_pair(".dng", "image/x-adobe-dng"),
-    std::make_pair(".doc", "application/msword"),
-    std::make_pair(".docbook", "application/docbook+xml"),
-    std::make_pair(".docm", "application/vnd.openxmlformats-officedocument.wordprocessingml.document"),
-    std::make_pair(".docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document"),
-    std::make_pair(".dot", "text/vnd.graphviz"),
-    std::make_pair(".dsl", "text/x-dsl"),
-    std::make_pair(".dtd", "application/xml-dtd"),
-    std::make_pair(".dtx", "text/x-tex"),
-    std::make_pair(".dv", "video/dv"),
-    std::make_pair(".dvi", "application/x-dvi"),
-    std::make_pair(".dvi.bz2", "application/x-bzdvi"),
-    std::make_pair(".dvi.gz", "application/x-gzdvi"),
-    std::make_pair(".dwg", "image/vnd.dwg"),
-    std::make_pair(".dxf", "image/vnd.dxf"),
-    std::make_pair(".e", "text/x-eiffel"),
-    std::make_pair(".egon", "application/x-egon"),
-    std::make_pair(".eif", "text/x-eiffel"),
-    std::make_pair(".el", "text/x-emacs-lisp"),
-    std::make_pair(".emf", "image/x-emf"),
-    std::make_pair(".emp", "application/vnd.emusic-emusic_package"),
-    std::make_pair(".ent", "application/xml-external-parsed-entity"),
-    std::make_pair(".eps", "image/x-eps"),
-    std::make_pair(".eps.bz2", "image/x-bzeps"),
-    std::make_pair(".eps.gz", "image/x-gzeps"),
-    std::make_pair(".epsf", "image/x-eps"),
-    std::make_pair(".epsf.bz2", "image/x-bzeps"),
-    std::make_pair(".epsf.gz", "image/x-gzeps"),
-    std::make_pair(".epsi", "image/x-eps"),
-    std::make_pair(".epsi.bz2", "image/x-bzeps"),
-    std::make_pair(".epsi.gz", "image/x-gzeps"),
-    std::make_pair(".epub", "application/epub+zip"),
-    std::make_pair(".erl", "text/x-erlang"),
-    std::make_pair(".es", "application/ecmascript"),
-    std::make_pair(".etheme", "application/x-e-theme"),
-    std::make_pair(".etx", "text/x-setext"),
-    std::make_pair(".exe", "application/x-ms-dos-executable"),
-    std::make_pair(".exr", "image/x-exr"),
-    std::make_pair(".ez", "application/andrew-inset"),
-    std::make_pair(".f", "text/x-fortran"),
-    std::make_pair(".f90", "text/x-fortran"),
-    std::make_pair(".f95", "text/x-fortran"),
-    std::make_pair(".fb2", "application/x-fictionbook+xml"),
-    std::make_pair(".fig", "image/x-xfig"),
-    std::make_pair(".fits", "image/fits"),
-    std::make_pair(".fl", "application/x-fluid"),
-    std::make_pair(".flac", "audio/x-flac"),
-    std::make_pair(".flc", "video/x-flic"),
-    std::make_pair(".fli", "video/x-flic"),
-    std::make_pair(".flv", "video/x-flv"),
-    std::make_pair(".flw", "application/x-kivio"),
-    std::make_pair(".fo", "text/x-xslfo"),
-    std::make_pair(".for", "text/x-fortran"),
-    std::make_pair(".g3", "image/fax-g3"),
-    std::make_pair(".gb", "application/x-gameboy-rom"),
-    std::make_pair(".gba", "application/x-gba-rom"),
-    std::make_pair(".gcrd", "text/directory"),
-    std::make_pair(".ged", "application/x-gedcom"),
-    std::make_pair(".gedcom", "application/x-gedcom"),
-    std::make_pair(".gen", "application/x-genesis-rom"),
-    std::make_pair(".gf", "application/x-tex-gf"),
-    std::make_pair(".gg", "application/x-sms-rom"),
-    std::make_pair(".gif", "image/gif"),
-    std::make_pair(".glade", "application/x-glade"),
-    std::make_pair(".gmo", "application/x-gettext-translation"),
-    std::make_pair(".gnc", "application/x-gnucash"),
-    std::make_pair(".gnd", "application/gnunet-directory"),
-    std::make_pair(".gnucash", "application/x-gnucash"),
-    std::make_pair(".gnumeric", "application/x-gnumeric"),
-    std::make_pair(".gnuplot", "application/x-gnuplot"),
-    std::make_pair(".gp", "application/x-gnuplot"),
-    std::make_pair(".gpg", "application/pgp-encrypted"),
-    std::make_pair(".gplt", "application/x-gnuplot"),
-    std::make_pair(".gra", "application/x-graphite"),
-    std::make_pair(".gsf", "application/x-font-type1"),
-    std::make_pair(".gsm", "audio/x-gsm"),
-    std::make_pair(".gtar", "application/x-tar"),
-    std::make_pair(".gv", "text/vnd.graphviz"),
-    std::make_pair(".gvp", "text/x-google-video-pointer"),
-    std::make_pair(".gz", "application/x-gzip"),
-    std::make_pair(".h", "text/x-chdr"),
-    std::make_pair(".h++", "text/x-c++hdr"),
-    std::make_pair(".hdf", "application/x-hdf"),
-    std::make_pair(".hh", "text/x-c++hdr"),
-    std::make_pair(".hp", "text/x-c++hdr"),
-    std::make_pair(".hpgl", "application/vnd.hp-hpgl"),
-    std::make_pair(".hpp", "text/x-c++hdr"),
-    std::make_pair(".hs", "text/x-haskell"),
-    std::make_pair(".htm", "text/html"),
-    std::make_pair(".html", "text/html"),
-    std::make_pair(".hwp", "application/x-hwp"),
-    std::make_pair(".hwt", "application/x-hwt"),
-    std::make_pair(".hxx", "text/x-c++hdr"),
-    std::make_pair(".ica", "application/x-ica"),
-    std::make_pair(".icb", "image/x-tga"),
-    std::make_pair(".icns", "image/x-icns"),
-    std::make_pair(".ico", "image/vnd.microsoft.icon"),
-    std::make_pair(".ics", "text/calendar"),
-    std::make_pair(".idl", "text/x-idl"),
-    std::make_pair(".ief", "image/ief"),
-    std::make_pair(".iff", "image/x-iff"),
-    std::make_pair(".ilbm", "image/x-ilbm"),
-    std::make_pair(".ime", "text/x-imelody"),
-    std::make_pair(".imy", "text/x-imelody"),
-    std::make_pair(".ins", "text/x-tex"),
-    std::make_pair(".iptables", "text/x-iptables"),
-    std::make_pair(".iso", "application/x-cd-image"),
-    std::make_pair(".iso9660", "application/x-cd-image"),
-    std::make_pair(".it", "audio/x-it"),
-    std::make_pair(".j2k", "image/jp2"),
-    std::make_pair(".jad", "text/vnd.sun.j2me.app-descriptor"),
-    std::make_pair(".jar", "application/x-java-archive"),
-    std::make_pair(".java", "text/x-java"),
-    std::make_pair(".jng", "image/x-jng"),
-    std::make_pair(".jnlp", "application/x-java-jnlp-file"),
-    std::make_pair(".jp2", "image/jp2"),
-    std::make_pair(".jpc", "image/jp2"),
-    std::make_pair(".jpe", "image/jpeg"),
-    std::make_pair(".jpeg", "image/jpeg"),
-    std::make_pair(".jpf", "image/jp2"),
-    std::make_pair(".jpg", "image/jpeg"),
-    std::make_pair(".jpr", "application/x-jbuilder-project"),
-    std::make_pair(".jpx", "image/jp2"),
-    std::make_pair(".js", "application/javascript"),
-    std::make_pair(".json", "application/json"),
-    std::make_pair(".jsonp", "application/jsonp"),
-    std::make_pair(".k25", "image/x-kodak-k25"),
-    std::make_pair(".kar", "audio/midi"),
-    std::make_pair(".karbon", "application/x-karbon"),
-    std::make_pair(".kdc", "image/x-kodak-kdc"),
-    std::make_pair(".kdelnk", "application/x-desktop"),
-    std::make_pair(".kexi", "application/x-kexiproject-sqlite3"),
-    std::make_pair(".kexic", "application/x-kexi-connectiondata"),
-    std::make_pair(".kexis", "application/x-kexiproject-shortcut"),
-    std::make_pair(".kfo", "application/x-kformula"),
-    std::make_pair(".kil", "application/x-killustrator"),
-    std::make_pair(".kino", "application/smil"),
-    std::make_pair(".kml", "application/vnd.google-earth.kml+xml"),
-    std::make_pair(".kmz", "application/vnd.google-earth.kmz"),
-    std::make_pair(".kon", "application/x-kontour"),
-    std::make_pair(".kpm", "application/x-kpovmodeler"),
-    std::make_pair(".kpr", "application/x-kpresenter"),
-    std::make_pair(".kpt", "application/x-kpresenter"),
-    std::make_pair(".kra", "application/x-krita"),
-    std::make_pair(".ksp", "application/x-kspread"),
-    std::make_pair(".kud", "application/x-kugar"),
-    std::make_pair(".kwd", "application/x-kword"),
-    std::make_pair(".kwt", "application/x-kword"),
-    std::make_pair(".la", "application/x-shared-library-la"),
-    std::make_pair(".latex", "text/x-tex"),
-    std::make_pair(".ldif", "text/x-ldif"),
-    std::make_pair(".lha", "application/x-lha"),
-    std::make_pair(".lhs", "text/x-literate-haskell"),
-    std::make_pair(".lhz", "application/x-lhz"),
-    std::make_pair(".log", "text/x-log"),
-    std::make_pair(".ltx", "text/x-tex"),
-    std::make_pair(".lua", "text/x-lua"),
-    std::make_pair(".lwo", "image/x-lwo"),
-    std::make_pair(".lwob", "image/x-lwo"),
-    std::make_pair(".lws", "image/x-lws"),
-    std::make_pair(".ly", "text/x-lilypond"),
-    std::make_pair(".lyx", "application/x-lyx"),
-    std::make_pair(".lz", "application/x-lzip"),
-    std::make_pair(".lzh", "application/x-lha"),
-    std::make_pair(".lzma", "application/x-lzma"),
-    std::make_pair(".lzo", "application/x-lzop"),
-    std::make_pair(".m", "text/x-matlab"),
-    std::make_pair(".m15", "audio/x-mod"),
-    std::make_pair(".m2t", "video/mpeg"),
-    std::make_pair(".m3u", "audio/x-mpegurl"),
-    std::make_pair(".m3u8", "audio/x-mpegurl"),
-    std::make_pair(".m4", "application/x-m4"),
-    std::make_pair(".m4a", "audio/mp4"),
-    std::make_pair(".m4b", "audio/x-m4b"),
-    std::make_pair(".m4v", "video/mp4"),
-    std::make_pair(".mab", "application/x-markaby"),
-    std::make_pair(".man", "application/x-troff-man"),
-    std::make_pair(".mbox", "application/mbox"),
-    std::make_pair(".md", "application/x-genesis-rom"),
-    std::make_pair(".mdb", "application/vnd.ms-access"),
-    std::make_pair(".mdi", "image/vnd.ms-modi"),
-    std::make_pair(".me", "text/x-troff-me"),
-    std::make_pair(".med", "audio/x-mod"),
-    std::make_pair(".metalink", "application/metalink+xml"),
-    std::make_pair(".mgp", "application/x-magicpoint"),
-    std::make_pair(".mid", "audio/midi"),
-    std::make_pair(".midi", "audio/midi"),
-    std::make_pair(".mif", "application/x-mif"),
-    std::make_pair(".minipsf", "audio/x-minipsf"),
-    std::make_pair(".mka", "audio/x-matroska"),
-    std::make_pair(".mkv", "video/x-matroska"),
-    std::make_pair(".ml", "text/x-ocaml"),
-    std::make_pair(".mli", "text/x-ocaml"),
-    std::make_pair(".mm", "text/x-troff-mm"),
-    std::make_pair(".mmf", "application/x-smaf"),
-    std::make_pair(".mml", "text/mathml"),
-    std::make_pair(".mng", "video/x-mng"),
-    std::make_pair(".mo", "application/x-gettext-translation"),
-    std::make_pair(".mo3", "audio/x-mo3"),
-    std::make_pair(".moc", "text/x-moc"),
-    std::make_pair(".mod", "audio/x-mod"),
-    std::make_pair(".mof", "text/x-mof"),
-    std::make_pair(".moov", "video/quicktime"),
-    std::make_pair(".mov", "video/quicktime"),
-    std::make_pair(".movie", "video/x-sgi-movie"),
-    std::make_pair(".mp+", "audio/x-musepack"),
-    std::make_pair(".mp2", "video/mpeg"),
-    std::make_pair(".mp3", "audio/mpeg"),
-    std::make_pair(".mp4", "video/mp4"),
-    std::make_pair(".mpc", "audio/x-musepack"),
-    std::make_pair(".mpe", "video/mpeg"),
-    std::make_pair(".mpeg", "video/mpeg"),
-    std::make_pair(".mpg", "video/mpeg"),
-    std::make_pair(".mpga", "audio/mpeg"),
-    std::make_pair(".mpp", "audio/x-musepack"),
-    std::make_pair(".mrl", "text/x-mrml"),
-    std::make_pair(".mrml", "text/x-mrml"),
-    std::make_pair(".mrw", "image/x-minolta-mrw"),
-    std::make_pair(".ms", "text/x-troff-ms"),
-    std::make_pair(".msi", "application/x-msi"),
-    std::make_pair(".msod", "image/x-msod"),
-    std::make_pair(".msx", "application/x-msx-rom"),
-    std::make_pair(".mtm", "audio/x-mod"),
-    std::make_pair(".mup", "text/x-mup"),
-    std::make_pair(".mxf", "application/mxf"),
-    std::make_pair(".n64", "application/x-n64-rom"),
-    std::make_pair(".nb", "application/mathematica"),
-    std::make_pair(".nc", "application/x-netcdf"),
-    std::make_pair(".nds", "application/x-nintendo-ds-rom"),
-    std::make_pair(".nef", "image/x-nikon-nef"),
-    std::make_pair(".nes", "application/x-nes-rom"),
-    std::make_pair(".nfo", "text/x-nfo"),
-    std::make_pair(".not", "text/x-mup"),
-    std::make_pair(".nsc", "application/x-netshow-channel"),
-    std::make_pair(".nsv", "video/x-nsv"),
-    std::make_pair(".o", "application/x-object"),
-    std::make_pair(".obj", "application/x-tgif"),
-    std::make_pair(".ocl", "text/x-ocl"),
-    std::make_pair(".oda", "application/oda"),
-    std::make_pair(".odb", "application/vnd.oasis.opendocument.database"),
-    std::make_pair(".odc", "application/vnd.oasis.opendocument.chart"),
-    std::make_pair(".odf", "application/vnd.oasis.opendocument.formula"),
-    std::make_pair(".odg", "application/vnd.oasis.opendocument.graphics"),
-    std::make_pair(".odi", "application/vnd.oasis.opendocument.image"),
-    std::make_pair(".odm", "application/vnd.oasis.opendocument.text-master"),
-    std::make_pair(".odp", "application/vnd.oasis.opendocument.presentation"),
-    std::make_pair(".ods", "application/vnd.oasis.opendocument.spreadsheet"),
-    std::make_pair(".odt", "application/vnd.oasis.opendocument.text"),
-    std::make_pair(".oga", "audio/ogg"),
-    std::make_pair(".ogg", "video/x-theora+ogg"),
-    std::make_pair(".ogm", "video/x-ogm+ogg"),
-    std::make_pair(".ogv", "video/ogg"),
-    std::make_pair(".ogx", "application/ogg"),
-    std::make_pair(".old", "application/x-trash"),
-    std::make_pair(".oleo", "application/x-oleo"),
-    std::make_pair(".opml", "text/x-opml+xml"),
-    std::make_pair(".ora", "image/openraster"),
-    std::make_pair(".orf", "image/x-olympus-orf"),
-    std::make_pair(".otc", "application/vnd.oasis.opendocument.chart-template"),
-    std::make_pair(".otf", "application/x-font-otf"),
-    std::make_pair(".otg", "application/vnd.oasis.opendocument.graphics-template"),
-    std::make_pair(".oth", "application/vnd.oasis.opendocument.text-web"),
-    std::make_pair(".otp", "application/vnd.oasis.opendocument.presentation-template"),
-    std::make_pair(".ots", "application/vnd.oasis.opendocument.spreadsheet-template"),
-    std::make_pair(".ott", "application/vnd.oasis.opendocument.text-template"),
-    std::make_pair(".owl", "application/rdf+xml"),
-    std::make_pair(".oxt", "application/vnd.openofficeorg.extension"),
-    std::make_pair(".p", "text/x-pascal"),
-    std::make_pair(".p10", "application/pkcs10"),
-    std::make_pair(".p12", "application/x-pkcs12"),
-    std::make_pair(".p7b", "application/x-pkcs7-certificates"),
-    std::make_pair(".p7s", "application/pkcs7-signature"),
-    std::make_pair(".pack", "application/x-java-pack200"),
-    std::make_pair(".pak", "application/x-pak"),
-    std::make_pair(".par2", "application/x-par2"),
-    std::make_pair(".pas", "text/x-pascal"),
-    std::make_pair(".patch", "text/x-patch"),
-    std::make_pair(".pbm", "image/x-portable-bitmap"),
-    std::make_pair(".pcd", "image/x-photo-cd"),
-    std::make_pair(".pcf", "application/x-cisco-vpn-settings"),
-    std::make_pair(".pcf.gz", "application/x-font-pcf"),
-    std::make_pair(".pcf.z", "application/x-font-pcf"),
-    std::make_pair(".pcl", "application/vnd.hp-pcl"),
-    std::make_pair(".pcx", "image/x-pcx"),
-    std::make_pair(".pdb", "chemical/x-pdb"),
-    std::make_pair(".pdc", "application/x-aportisdoc"),
-    std::make_pair(".pdf", "application/pdf"),
-    std::make_pair(".pdf.bz2", "application/x-bzpdf"),
-    std::make_pair(".pdf.gz", "application/x-gzpdf"),
-    std::make_pair(".pef", "image/x-pentax-pef"),
-    std::make_pair(".pem", "application/x-x509-ca-cert"),
-    std::make_pair(".perl", "application/x-perl"),
-    std::make_pair(".pfa", "application/x-font-type1"),
-    std::make_pair(".pfb", "application/x-font-type1"),
-    std::make_pair(".pfx", "application/x-pkcs12"),
-    std::make_pair(".pgm", "image/x-portable-graymap"),
-    std::make_pair(".pgn", "application/x-chess-pgn"),
-    std::make_pair(".pgp", "application/pgp-encrypted"),
-    std::make_pair(".php", "application/x-php"),
-    std::make_pair(".php3", "application/x-php"),
-    std::make_pair(".php4", "application/x-php"),
-    std::make_pair(".pict", "image/x-pict"),
-    std::make_pair(".pict1", "image/x-pict"),
-    std::make_pair(".pict2", "image/x-pict"),
-    std::make_pair(".pickle", "application/python-pickle"),
-    std::make_pair(".pk", "application/x-tex-pk"),
-    std::make_pair(".pkipath", "application/pkix-pkipath"),
-    std::make_pair(".pkr", "application/pgp-keys"),
-    std::make_pair(".pl", "application/x-perl"),
-    std::make_pair(".pla", "audio/x-iriver-pla"),
-    std::make_pair(".pln", "application/x-planperfect"),
-    std::make_pair(".pls", "audio/x-scpls"),
-    std::make_pair(".pm", "application/x-perl"),
-    std::make_pair(".png", "image/png"),
-    std::make_pair(".pnm", "image/x-portable-anymap"),
-    std::make_pair(".pntg", "image/x-macpaint"),
-    std::make_pair(".po", "text/x-gettext-translation"),
-    std::make_pair(".por", "application/x-spss-por"),
-    std::make_pair(".pot", "text/x-gettext-translation-template"),
-    std::make_pair(".ppm", "image/x-portable-pixmap"),
-    std::make_pair(".pps", "application/vnd.ms-powerpoint"),
-    std::make_pair(".ppt", "application/vnd.ms-powerpoint"),
-    std::make_pair(".pptm", "application/vnd.openxmlformats-officedocument.presentationml.presentation"),
-    std::make_pair(".pptx", "application/vnd.openxmlformats-officedocument.presentationml.presentation"),
-    std::make_pair(".ppz", "application/vnd.ms-powerpoint"),
-    std::make_pair(".prc", "application/x-palm-database"),
-    std::make_pair(".ps", "application/postscript"),
-    std::make_pair(".ps.bz2", "application/x-bzpostscript"),
-    std::make_pair(".ps.gz", "application/x-gzpostscript"),
-    std::make_pair(".psd", "image/vnd.adobe.photoshop"),
-    std::make_pair(".psf", "audio/x-psf"),
-    std::make_pair(".psf.gz", "application/x-gz-font-linux-psf"),
-    std::make_pair(".psflib", "audio/x-psflib"),
-    std::make_pair(".psid", "audio/prs.sid"),
-    std::make_pair(".psw", "application/x-pocket-word"),
-    std::make_pair(".pw", "application/x-pw"),
-    std::make_pair(".py", "text/x-python"),
-    std::make_pair(".pyc", "application/x-python-bytecode"),
-    std::make_pair(".pyo", "application/x-python-bytecode"),
-    std::make_pair(".qif", "image/x-quicktime"),
-    std::make_pair(".qt", "video/quicktime"),
-    std::make_pair(".qtif", "image/x-quicktime"),
-    std::make_pair(".qtl", "application/x-quicktime-media-link"),
-    std::make_pair(".qtvr", "video/quicktime"),
-    std::make_pair(".ra", "audio/vnd.rn-realaudio"),
-    std::make_pair(".raf", "image/x-fuji-raf"),
-    std::make_pair(".ram", "application/ram"),
-    std::make_pair(".rar", "application/x-rar"),
-    std::make_pair(".ras", "image/x-cmu-raster"),
-    std::make_pair(".raw", "image/x-panasonic-raw"),
-    std::make_pair(".rax", "audio/vnd.rn-realaudio"),
-    std::make_pair(".rb", "application/x-ruby"),
-    std::make_pair(".rdf", "application/rdf+xml"),
-    std::make_pair(".rdfs", "application/rdf+xml"),
-    std::make_pair(".reg", "text/x-ms-regedit"),
-    std::make_pair(".rej", "application/x-reject"),
-    std::make_pair(".rgb", "image/x-rgb"),
-    std::make_pair(".rle", "image/rle"),
-    std::make_pair(".rm", "application/vnd.rn-realmedia"),
-    std::make_pair(".rmj", "application/vnd.rn-realmedia"),
-    std::make_pair(".rmm", "application/vnd.rn-realmedia"),
-    std::make_pair(".rms", "application/vnd.rn-realmedia"),
-    std::make_pair(".rmvb", "application/vnd.rn-realmedia"),
-    std::make_pair(".rmx", "application/vnd.rn-realmedia"),
-    std::make_pair(".roff", "text/troff"),
-    std::make_pair(".rp", "image/vnd.rn-realpix"),
-    std::make_pair(".rpm", "application/x-rpm"),
-    std::make_pair(".rss", "application/rss+xml"),
-    std::make_pair(".rt", "text/vnd.rn-realtext"),
-    std::make_pair(".rtf", "application/rtf"),
-    std::make_pair(".rtx", "text/richtext"),
-    std::make_pair(".rv", "video/vnd.rn-realvideo"),
-    std::make_pair(".rvx", "video/vnd.rn-realvideo"),
-    std::make_pair(".s3m", "audio/x-s3m"),
-    std::make_pair(".sam", "application/x-amipro"),
-    std::make_pair(".sami", "application/x-sami"),
-    std::make_pair(".sav", "application/x-spss-sav"),
-    std::make_pair(".scm", "text/x-scheme"),
-    std::make_pair(".sda", "application/vnd.stardivision.draw"),
-    std::make_pair(".sdc", "application/vnd.stardivision.calc"),
-    std::make_pair(".sdd", "application/vnd.stardivision.impress"),
-    std::make_pair(".sdp", "application/sdp"),
-    std::make_pair(".sds", "application/vnd.stardivision.chart"),
-    std::make_pair(".sdw", "application/vnd.stardivision.writer"),
-    std::make_pair(".sgf", "application/x-go-sgf"),
-    std::make_pair(".sgi", "image/x-sgi"),
-    std::make_pair(".sgl", "application/vnd.stardivision.writer"),
-    std::make_pair(".sgm", "text/sgml"),
-    std::make_pair(".sgml", "text/sgml"),
-    std::make_pair(".sh", "application/x-shellscript"),
-    std::make_pair(".shar", "application/x-shar"),
-    std::make_pair(".shn", "application/x-shorten"),
-    std::make_pair(".siag", "application/x-siag"),
-    std::make_pair(".sid", "audio/prs.sid"),
-    std::make_pair(".sik", "application/x-trash"),
-    std::make_pair(".sis", "application/vnd.symbian.install"),
-    std::make_pair(".sisx", "x-epoc/x-sisx-app"),
-    std::make_pair(".sit", "application/x-stuffit"),
-    std::make_pair(".siv", "application/sieve"),
-    std::make_pair(".sk", "image/x-skencil"),
-    std::make_pair(".sk1", "image/x-skencil"),
-    std::make_pair(".skr", "application/pgp-keys"),
-    std::make_pair(".slk", "text/spreadsheet"),
-    std::make_pair(".smaf", "application/x-smaf"),
-    std::make_pair(".smc", "application/x-snes-rom"),
-    std::make_pair(".smd", "application/vnd.stardivision.mail"),
-    std::make_pair(".smf", "application/vnd.stardivision.math"),
-    std::make_pair(".smi", "application/x-sami"),
-    std::make_pair(".smil", "application/smil"),
-    std::make_pair(".sml", "application/smil"),
-    std::make_pair(".sms", "application/x-sms-rom"),
-    std::make_pair(".snd", "audio/basic"),
-    std::make_pair(".so", "application/x-sharedlib"),
-    std::make_pair(".spc", "application/x-pkcs7-certificates"),
-    std::make_pair(".spd", "application/x-font-speedo"),
-    std::make_pair(".spec", "text/x-rpm-spec"),
-    std::make_pair(".spl", "application/x-shockwave-flash"),
-    std::make_pair(".spx", "audio/x-speex"),
-    std::make_pair(".sql", "text/x-sql"),
-    std::make_pair(".sr2", "image/x-sony-sr2"),
-    std::make_pair(".src", "application/x-wais-source"),
-    std::make_pair(".srf", "image/x-sony-srf"),
-    std::make_pair(".srt", "application/x-subrip"),
-    std::make_pair(".ssa", "text/x-ssa"),
-    std::make_pair(".stc", "application/vnd.sun.xml.calc.template"),
-    std::make_pair(".std", "application/vnd.sun.xml.draw.template"),
-    std::make_pair(".sti", "application/vnd.sun.xml.impress.template"),
-    std::make_pair(".stm", "audio/x-stm"),
-    std::make_pair(".stw", "application/vnd.sun.xml.writer.template"),
-    std::make_pair(".sty", "text/x-tex"),
-    std::make_pair(".sub", "text/x-subviewer"),
-    std::make_pair(".sun", "image/x-sun-raster"),
-    std::make_pair(".sv4cpio", "application/x-sv4cpio"),
-    std::make_pair(".sv4crc", "application/x-sv4crc"),
-    std::make_pair(".svg", "image/svg+xml"),
-    std::make_pair(".svgz", "image/svg+xml-compressed"),
-    std::make_pair(".swf", "application/x-shockwave-flash"),
-    std::make_pair(".sxc", "application/vnd.sun.xml.calc"),
-    std::make_pair(".sxd", "application/vnd.sun.xml.draw"),
-    std::make_pair(".sxg", "application/vnd.sun.xml.writer.global"),
-    std::make_pair(".sxi", "application/vnd.sun.xml.impress"),
-    std::make_pair(".sxm", "application/vnd.sun.xml.math"),
-    std::make_pair(".sxw", "application/vnd.sun.xml.writer"),
-    std::make_pair(".sylk", "text/spreadsheet"),
-    std::make_pair(".t", "text/troff"),
-    std::make_pair(".t2t", "text/x-txt2tags"),
-    std::make_pair(".tar", "application/x-tar"),
-    std::make_pair(".tar.bz", "application/x-bzip-compressed-tar"),
-    std::make_pair(".tar.bz2", "application/x-bzip-compressed-tar"),
-    std::make_pair(".tar.gz", "application/x-compressed-tar"),
-    std::make_pair(".tar.lzma", "application/x-lzma-compressed-tar"),
-    std::make_pair(".tar.lzo", "application/x-tzo"),
-    std::make_pair(".tar.xz", "application/x-xz-compressed-tar"),
-    std::make_pair(".tar.z", "application/x-tarz"),
-    std::make_pair(".tbz", "application/x-bzip-compressed-tar"),
-    std::make_pair(".tbz2", "application/x-bzip-compressed-tar"),
-    std::make_pair(".tcl", "text/x-tcl"),
-    std::make_pair(".tex", "text/x-tex"),
-    std::make_pair(".texi", "text/x-texinfo"),
-    std::make_pair(".texinfo", "text/x-texinfo"),
-    std::make_pair(".tga", "image/x-tga"),
-    std::make_pair(".tgz", "application/x-compressed-tar"),
-    std::make_pair(".theme", "application/x-theme"),
-    std::make_pair(".themepack", "application/x-windows-themepack"),
-    std::make_pair(".tif", "image/tiff"),
-    std::make_pair(".tiff", "image/tiff"),
-    std::make_pair(".tk", "text/x-tcl"),
-    std::make_pair(".tlz", "application/x-lzma-compressed-tar"),
-    std::make_pair(".tnef", "application/vnd.ms-tnef"),
-    std::make_pair(".tnf", "application/vnd.ms-tnef"),
-    std::make_pair(".toc", "application/x-cdrdao-toc"),
-    std::make_pair(".torrent", "application/x-bittorrent"),
-    std::make_pair(".tpic", "image/x-tga"),
-    std::make_pair(".tr", "text/troff"),
-    std::make_pair(".ts", "application/x-linguist"),
-    std::make_pair(".tsv", "text/tab-separated-values"),
-    std::make_pair(".tta", "audio/x-tta"),
-    std::make_pair(".ttc", "application/x-font-ttf"),
-    std::make_pair(".ttf", "application/x-font-ttf"),
-    std::make_pair(".ttx", "application/x-font-ttx"),
-    std::make_pair(".txt", "text/plain"),
-    std::make_pair(".txz", "application/x-xz-compressed-tar"),
-    std::make_pair(".tzo", "application/x-tzo"),
-    std::make_pair(".ufraw", "application/x-ufraw"),
-    std::make_pair(".ui", "application/x-designer"),
-    std::make_pair(".uil", "text/x-uil"),
-    std::make_pair(".ult", "audio/x-mod"),
-    std::make_pair(".uni", "audio/x-mod"),
-    std::make_pair(".uri", "text/x-uri"),
-    std::make_pair(".url", "text/x-uri"),
-    std::make_pair(".ustar", "application/x-ustar"),
-    std::make_pair(".vala", "text/x-vala"),
-    std::make_pair(".vapi", "text/x-vala"),
-    std::make_pair(".vcf", "text/directory"),
-    std::make_pair(".vcs", "text/calendar"),
-    std::make_pair(".vct", "text/directory"),
-    std::make_pair(".vda", "image/x-tga"),
-    std::make_pair(".vhd", "text/x-vhdl"),
-    std::make_pair(".vhdl", "text/x-vhdl"),
-    std::make_pair(".viv", "video/vivo"),
-    std::make_pair(".vivo", "video/vivo"),
-    std::make_pair(".vlc", "audio/x-mpegurl"),
-    std::make_pair(".vob", "video/mpeg"),
-    std::make_pair(".voc", "audio/x-voc"),
-    std::make_pair(".vor", "application/vnd.stardivision.writer"),
-    std::make_pair(".vst", "image/x-tga"),
-    std::make_pair(".wav", "audio/x-wav"),
-    std::make_pair(".wax", "audio/x-ms-asx"),
-    std::make_pair(".wb1", "application/x-quattropro"),
-    std::make_pair(".wb2", "application/x-quattropro"),
-    std::make_pair(".wb3", "application/x-quattropro"),
-    std::make_pair(".wbmp", "image/vnd.wap.wbmp"),
-    std::make_pair(".wcm", "application/vnd.ms-works"),
-    std::make_pair(".wdb", "application/vnd.ms-works"),
-    std::make_pair(".webm", "video/webm"),
-    std::make_pair(".wk1", "application/vnd.lotus-1-2-3"),
-    std::make_pair(".wk3", "application/vnd.lotus-1-2-3"),
-    std::make_pair(".wk4", "application/vnd.lotus-1-2-3"),
-    std::make_pair(".wks", "application/vnd.ms-works"),
-    std::make_pair(".wma", "audio/x-ms-wma"),
-    std::make_pair(".wmf", "image/x-wmf"),
-    std::make_pair(".wml", "text/vnd.wap.wml"),
-    std::make_pair(".wmls", "text/vnd.wap.wmlscript"),
-    std::make_pair(".wmv", "video/x-ms-wmv"),
-    std::make_pair(".wmx", "audio/x-ms-asx"),
-    std::make_pair(".wp", "application/vnd.wordperfect"),
-    std::make_pair(".wp4", "application/vnd.wordperfect"),
-    std::make_pair(".wp5", "application/vnd.wordperfect"),
-    std::make_pair(".wp6", "application/vnd.wordperfect"),
-    std::make_pair(".wpd", "application/vnd.wordperfect"),
-    std::make_pair(".wpg", "application/x-wpg"),
-    std::make_pair(".wpl", "application/vnd.ms-wpl"),
-    std::make_pair(".wpp", "application/vnd.wordperfect"),
-    std::make_pair(".wps", "application/vnd.ms-works"),
-    std::make_pair(".wri", "application/x-mswrite"),
-    std::make_pair(".wrl", "model/vrml"),
-    std::make_pair(".wv", "audio/x-wavpack"),
-    std::make_pair(".wvc", "audio/x-wavpack-correction"),
-    std::make_pair(".wvp", "audio/x-wavpack"),
-    std::make_pair(".wvx", "audio/x-ms-asx"),
-    std::make_pair(".x3f", "image/x-sigma-x3f"),
-    std::make_pair(".xac", "application/x-gnucash"),
-    std::make_pair(".xbel", "application/x-xbel"),
-    std::make_pair(".xbl", "application/xml"),
-    std::make_pair(".xbm", "image/x-xbitmap"),
-    std::make_pair(".xcf", "image/x-xcf"),
-    std::make_pair(".xcf.bz2", "image/x-compressed-xcf"),
-    std::make_pair(".xcf.gz", "image/x-compressed-xcf"),
-    std::make_pair(".xhtml", "application/xhtml+xml"),
-    std::make_pair(".xi", "audio/x-xi"),
-    std::make_pair(".xla", "application/vnd.ms-excel"),
-    std::make_pair(".xlc", "application/vnd.ms-excel"),
-    std::make_pair(".xld", "application/vnd.ms-excel"),
-    std::make_pair(".xlf", "application/x-xliff"),
-    std::make_pair(".xliff", "application/x-xliff"),
-    std::make_pair(".xll", "application/vnd.ms-excel"),
-    std::make_pair(".xlm", "application/vnd.ms-excel"),
-    std::make_pair(".xls", "application/vnd.ms-excel"),
-    std::make_pair(".xlsm", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"),
-    std::make_pair(".xlsx", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"),
-    std::make_pair(".xlt", "application/vnd.ms-excel"),
-    std::make_pair(".xlw", "application/vnd.ms-excel"),
-    std::make_pair(".xm", "audio/x-xm"),
-    std::make_pair(".xmf", "audio/x-xmf"),
-    std::make_pair(".xmi", "text/x-xmi"),
-    std::make_pair(".xml", "application/xml"),
-    std::make_pair(".xpm", "image/x-xpixmap"),
-    std::make_pair(".xps", "application/vnd.ms-xpsdocument"),
-    std::make_pair(".xsl", "application/xml"),
-    std::make_pair(".xslfo", "text/x-xslfo"),
-    std::make_pair(".xslt", "application/xml"),
-    std::make_pair(".xspf", "application/xspf+xml"),
-    std::make_pair(".xul", "application/vnd.mozilla.xul+xml"),
-    std::make_pair(".xwd", "image/x-xwindowdump"),
-    std::make_pair(".xyz", "chemical/x-pdb"),
-    std::make_pair(".xz", "application/x-xz"),
-    std::make_pair(".w2p", "application/w2p"),
-    std::make_pair(".z", "application/x-compress"),
-    std::make_pair(".zabw", "application/x-abiword"),
-    std::make_pair(".zip", "application/zip")
+    {".load", "text/html"},
+    {".123", "application/vnd.lotus-1-2-3"},
+    {".3ds", "image/x-3ds"},
+    {".3g2", "video/3gpp"},
+    {".3ga", "video/3gpp"},
+    {".3gp", "video/3gpp"},
+    {".3gpp", "video/3gpp"},
+    {".602", "application/x-t602"},
+    {".669", "audio/x-mod"},
+    {".7z", "application/x-7z-compressed"},
+    {".a", "application/x-archive"},
+    {".aac", "audio/mp4"},
+    {".abw", "application/x-abiword"},
+    {".abw.crashed", "application/x-abiword"},
+    {".abw.gz", "application/x-abiword"},
+    {".ac3", "audio/ac3"},
+    {".ace", "application/x-ace"},
+    {".adb", "text/x-adasrc"},
+    {".ads", "text/x-adasrc"},
+    {".afm", "application/x-font-afm"},
+    {".ag", "image/x-applix-graphics"},
+    {".ai", "application/illustrator"},
+    {".aif", "audio/x-aiff"},
+    {".aifc", "audio/x-aiff"},
+    {".aiff", "audio/x-aiff"},
+    {".al", "application/x-perl"},
+    {".alz", "application/x-alz"},
+    {".amr", "audio/amr"},
+    {".ani", "application/x-navi-animation"},
+    {".anim[1-9j]", "video/x-anim"},
+    {".anx", "application/annodex"},
+    {".ape", "audio/x-ape"},
+    {".arj", "application/x-arj"},
+    {".arw", "image/x-sony-arw"},
+    {".as", "application/x-applix-spreadsheet"},
+    {".asc", "text/plain"},
+    {".asf", "video/x-ms-asf"},
+    {".asp", "application/x-asp"},
+    {".ass", "text/x-ssa"},
+    {".asx", "audio/x-ms-asx"},
+    {".atom", "application/atom+xml"},
+    {".au", "audio/basic"},
+    {".avi", "video/x-msvideo"},
+    {".aw", "application/x-applix-word"},
+    {".awb", "audio/amr-wb"},
+    {".awk", "application/x-awk"},
+    {".axa", "audio/annodex"},
+    {".axv", "video/annodex"},
+    {".bak", "application/x-trash"},
+    {".bcpio", "application/x-bcpio"},
+    {".bdf", "application/x-font-bdf"},
+    {".bib", "text/x-bibtex"},
+    {".bin", "application/octet-stream"},
+    {".blend", "application/x-blender"},
+    {".blender", "application/x-blender"},
+    {".bmp", "image/bmp"},
+    {".bz", "application/x-bzip"},
+    {".bz2", "application/x-bzip"},
+    {".c", "text/x-csrc"},
+    {".c++", "text/x-c++src"},
+    {".cab", "application/vnd.ms-cab-compressed"},
+    {".cb7", "application/x-cb7"},
+    {".cbr", "application/x-cbr"},
+    {".cbt", "application/x-cbt"},
+    {".cbz", "application/x-cbz"},
+    {".cc", "text/x-c++src"},
+    {".cdf", "application/x-netcdf"},
+    {".cdr", "application/vnd.corel-draw"},
+    {".cer", "application/x-x509-ca-cert"},
+    {".cert", "application/x-x509-ca-cert"},
+    {".cgm", "image/cgm"},
+    {".chm", "application/x-chm"},
+    {".chrt", "application/x-kchart"},
+    {".class", "application/x-java"},
+    {".cls", "text/x-tex"},
+    {".cmake", "text/x-cmake"},
+    {".cpio", "application/x-cpio"},
+    {".cpio.gz", "application/x-cpio-compressed"},
+    {".cpp", "text/x-c++src"},
+    {".cr2", "image/x-canon-cr2"},
+    {".crt", "application/x-x509-ca-cert"},
+    {".crw", "image/x-canon-crw"},
+    {".cs", "text/x-csharp"},
+    {".csh", "application/x-csh"},
+    {".css", "text/css"},
+    {".cssl", "text/css"},
+    {".csv", "text/csv"},
+    {".cue", "application/x-cue"},
+    {".cur", "image/x-win-bitmap"},
+    {".cxx", "text/x-c++src"},
+    {".d", "text/x-dsrc"},
+    {".dar", "application/x-dar"},
+    {".dbf", "application/x-dbf"},
+    {".dc", "application/x-dc-rom"},
+    {".dcl", "text/x-dcl"},
+    {".dcm", "application/dicom"},
+    {".dcr", "image/x-kodak-dcr"},
+    {".dds", "image/x-dds"},
+    {".deb", "application/x-deb"},
+    {".der", "application/x-x509-ca-cert"},
+    {".desktop", "application/x-desktop"},
+    {".dia", "application/x-dia-diagram"},
+    {".diff", "text/x-patch"},
+    {".divx", "video/x-msvideo"},
+    {".djv", "image/vnd.djvu"},
+    {".djvu", "image/vnd.djvu"},
+    {".dng", "image/x-adobe-dng"},
+    {".doc", "application/msword"},
+    {".docbook", "application/docbook+xml"},
+    {".docm", "application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+    {".docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+    {".dot", "text/vnd.graphviz"},
+    {".dsl", "text/x-dsl"},
+    {".dtd", "application/xml-dtd"},
+    {".dtx", "text/x-tex"},
+    {".dv", "video/dv"},
+    {".dvi", "application/x-dvi"},
+    {".dvi.bz2", "application/x-bzdvi"},
+    {".dvi.gz", "application/x-gzdvi"},
+    {".dwg", "image/vnd.dwg"},
+    {".dxf", "image/vnd.dxf"},
+    {".e", "text/x-eiffel"},
+    {".egon", "application/x-egon"},
+    {".eif", "text/x-eiffel"},
+    {".el", "text/x-emacs-lisp"},
+    {".emf", "image/x-emf"},
+    {".emp", "application/vnd.emusic-emusic_package"},
+    {".ent", "application/xml-external-parsed-entity"},
+    {".eps", "image/x-eps"},
+    {".eps.bz2", "image/x-bzeps"},
+    {".eps.gz", "image/x-gzeps"},
+    {".epsf", "image/x-eps"},
+    {".epsf.bz2", "image/x-bzeps"},
+    {".epsf.gz", "image/x-gzeps"},
+    {".epsi", "image/x-eps"},
+    {".epsi.bz2", "image/x-bzeps"},
+    {".epsi.gz", "image/x-gzeps"},
+    {".epub", "application/epub+zip"},
+    {".erl", "text/x-erlang"},
+    {".es", "application/ecmascript"},
+    {".etheme", "application/x-e-theme"},
+    {".etx", "text/x-setext"},
+    {".exe", "application/x-ms-dos-executable"},
+    {".exr", "image/x-exr"},
+    {".ez", "application/andrew-inset"},
+    {".f", "text/x-fortran"},
+    {".f90", "text/x-fortran"},
+    {".f95", "text/x-fortran"},
+    {".fb2", "application/x-fictionbook+xml"},
+    {".fig", "image/x-xfig"},
+    {".fits", "image/fits"},
+    {".fl", "application/x-fluid"},
+    {".flac", "audio/x-flac"},
+    {".flc", "video/x-flic"},
+    {".fli", "video/x-flic"},
+    {".flv", "video/x-flv"},
+    {".flw", "application/x-kivio"},
+    {".fo", "text/x-xslfo"},
+    {".for", "text/x-fortran"},
+    {".g3", "image/fax-g3"},
+    {".gb", "application/x-gameboy-rom"},
+    {".gba", "application/x-gba-rom"},
+    {".gcrd", "text/directory"},
+    {".ged", "application/x-gedcom"},
+    {".gedcom", "application/x-gedcom"},
+    {".gen", "application/x-genesis-rom"},
+    {".gf", "application/x-tex-gf"},
+    {".gg", "application/x-sms-rom"},
+    {".gif", "image/gif"},
+    {".glade", "application/x-glade"},
+    {".gmo", "application/x-gettext-translation"},
+    {".gnc", "application/x-gnucash"},
+    {".gnd", "application/gnunet-directory"},
+    {".gnucash", "application/x-gnucash"},
+    {".gnumeric", "application/x-gnumeric"},
+    {".gnuplot", "application/x-gnuplot"},
+    {".gp", "application/x-gnuplot"},
+    {".gpg", "application/pgp-encrypted"},
+    {".gplt", "application/x-gnuplot"},
+    {".gra", "application/x-graphite"},
+    {".gsf", "application/x-font-type1"},
+    {".gsm", "audio/x-gsm"},
+    {".gtar", "application/x-tar"},
+    {".gv", "text/vnd.graphviz"},
+    {".gvp", "text/x-google-video-pointer"},
+    {".gz", "application/x-gzip"},
+    {".h", "text/x-chdr"},
+    {".h++", "text/x-c++hdr"},
+    {".hdf", "application/x-hdf"},
+    {".hh", "text/x-c++hdr"},
+    {".hp", "text/x-c++hdr"},
+    {".hpgl", "application/vnd.hp-hpgl"},
+    {".hpp", "text/x-c++hdr"},
+    {".hs", "text/x-haskell"},
+    {".htm", "text/html"},
+    {".html", "text/html"},
+    {".hwp", "application/x-hwp"},
+    {".hwt", "application/x-hwt"},
+    {".hxx", "text/x-c++hdr"},
+    {".ica", "application/x-ica"},
+    {".icb", "image/x-tga"},
+    {".icns", "image/x-icns"},
+    {".ico", "image/vnd.microsoft.icon"},
+    {".ics", "text/calendar"},
+    {".idl", "text/x-idl"},
+    {".ief", "image/ief"},
+    {".iff", "image/x-iff"},
+    {".ilbm", "image/x-ilbm"},
+    {".ime", "text/x-imelody"},
+    {".imy", "text/x-imelody"},
+    {".ins", "text/x-tex"},
+    {".iptables", "text/x-iptables"},
+    {".iso", "application/x-cd-image"},
+    {".iso9660", "application/x-cd-image"},
+    {".it", "audio/x-it"},
+    {".j2k", "image/jp2"},
+    {".jad", "text/vnd.sun.j2me.app-descriptor"},
+    {".jar", "application/x-java-archive"},
+    {".java", "text/x-java"},
+    {".jng", "image/x-jng"},
+    {".jnlp", "application/x-java-jnlp-file"},
+    {".jp2", "image/jp2"},
+    {".jpc", "image/jp2"},
+    {".jpe", "image/jpeg"},
+    {".jpeg", "image/jpeg"},
+    {".jpf", "image/jp2"},
+    {".jpg", "image/jpeg"},
+    {".jpr", "application/x-jbuilder-project"},
+    {".jpx", "image/jp2"},
+    {".js", "application/javascript"},
+    {".json", "application/json"},
+    {".jsonp", "application/jsonp"},
+    {".k25", "image/x-kodak-k25"},
+    {".kar", "audio/midi"},
+    {".karbon", "application/x-karbon"},
+    {".kdc", "image/x-kodak-kdc"},
+    {".kdelnk", "application/x-desktop"},
+    {".kexi", "application/x-kexiproject-sqlite3"},
+    {".kexic", "application/x-kexi-connectiondata"},
+    {".kexis", "application/x-kexiproject-shortcut"},
+    {".kfo", "application/x-kformula"},
+    {".kil", "application/x-killustrator"},
+    {".kino", "application/smil"},
+    {".kml", "application/vnd.google-earth.kml+xml"},
+    {".kmz", "application/vnd.google-earth.kmz"},
+    {".kon", "application/x-kontour"},
+    {".kpm", "application/x-kpovmodeler"},
+    {".kpr", "application/x-kpresenter"},
+    {".kpt", "application/x-kpresenter"},
+    {".kra", "application/x-krita"},
+    {".ksp", "application/x-kspread"},
+    {".kud", "application/x-kugar"},
+    {".kwd", "application/x-kword"},
+    {".kwt", "application/x-kword"},
+    {".la", "application/x-shared-library-la"},
+    {".latex", "text/x-tex"},
+    {".ldif", "text/x-ldif"},
+    {".lha", "application/x-lha"},
+    {".lhs", "text/x-literate-haskell"},
+    {".lhz", "application/x-lhz"},
+    {".log", "text/x-log"},
+    {".ltx", "text/x-tex"},
+    {".lua", "text/x-lua"},
+    {".lwo", "image/x-lwo"},
+    {".lwob", "image/x-lwo"},
+    {".lws", "image/x-lws"},
+    {".ly", "text/x-lilypond"},
+    {".lyx", "application/x-lyx"},
+    {".lz", "application/x-lzip"},
+    {".lzh", "application/x-lha"},
+    {".lzma", "application/x-lzma"},
+    {".lzo", "application/x-lzop"},
+    {".m", "text/x-matlab"},
+    {".m15", "audio/x-mod"},
+    {".m2t", "video/mpeg"},
+    {".m3u", "audio/x-mpegurl"},
+    {".m3u8", "audio/x-mpegurl"},
+    {".m4", "application/x-m4"},
+    {".m4a", "audio/mp4"},
+    {".m4b", "audio/x-m4b"},
+    {".m4v", "video/mp4"},
+    {".mab", "application/x-markaby"},
+    {".man", "application/x-troff-man"},
+    {".mbox", "application/mbox"},
+    {".md", "application/x-genesis-rom"},
+    {".mdb", "application/vnd.ms-access"},
+    {".mdi", "image/vnd.ms-modi"},
+    {".me", "text/x-troff-me"},
+    {".med", "audio/x-mod"},
+    {".metalink", "application/metalink+xml"},
+    {".mgp", "application/x-magicpoint"},
+    {".mid", "audio/midi"},
+    {".midi", "audio/midi"},
+    {".mif", "application/x-mif"},
+    {".minipsf", "audio/x-minipsf"},
+    {".mka", "audio/x-matroska"},
+    {".mkv", "video/x-matroska"},
+    {".ml", "text/x-ocaml"},
+    {".mli", "text/x-ocaml"},
+    {".mm", "text/x-troff-mm"},
+    {".mmf", "application/x-smaf"},
+    {".mml", "text/mathml"},
+    {".mng", "video/x-mng"},
+    {".mo", "application/x-gettext-translation"},
+    {".mo3", "audio/x-mo3"},
+    {".moc", "text/x-moc"},
+    {".mod", "audio/x-mod"},
+    {".mof", "text/x-mof"},
+    {".moov", "video/quicktime"},
+    {".mov", "video/quicktime"},
+    {".movie", "video/x-sgi-movie"},
+    {".mp+", "audio/x-musepack"},
+    {".mp2", "video/mpeg"},
+    {".mp3", "audio/mpeg"},
+    {".mp4", "video/mp4"},
+    {".mpc", "audio/x-musepack"},
+    {".mpe", "video/mpeg"},
+    {".mpeg", "video/mpeg"},
+    {".mpg", "video/mpeg"},
+    {".mpga", "audio/mpeg"},
+    {".mpp", "audio/x-musepack"},
+    {".mrl", "text/x-mrml"},
+    {".mrml", "text/x-mrml"},
+    {".mrw", "image/x-minolta-mrw"},
+    {".ms", "text/x-troff-ms"},
+    {".msi", "application/x-msi"},
+    {".msod", "image/x-msod"},
+    {".msx", "application/x-msx-rom"},
+    {".mtm", "audio/x-mod"},
+    {".mup", "text/x-mup"},
+    {".mxf", "application/mxf"},
+    {".n64", "application/x-n64-rom"},
+    {".nb", "application/mathematica"},
+    {".nc", "application/x-netcdf"},
+    {".nds", "application/x-nintendo-ds-rom"},
+    {".nef", "image/x-nikon-nef"},
+    {".nes", "application/x-nes-rom"},
+    {".nfo", "text/x-nfo"},
+    {".not", "text/x-mup"},
+    {".nsc", "application/x-netshow-channel"},
+    {".nsv", "video/x-nsv"},
+    {".o", "application/x-object"},
+    {".obj", "application/x-tgif"},
+    {".ocl", "text/x-ocl"},
+    {".oda", "application/oda"},
+    {".odb", "application/vnd.oasis.opendocument.database"},
+    {".odc", "application/vnd.oasis.opendocument.chart"},
+    {".odf", "application/vnd.oasis.opendocument.formula"},
+    {".odg", "application/vnd.oasis.opendocument.graphics"},
+    {".odi", "application/vnd.oasis.opendocument.image"},
+    {".odm", "application/vnd.oasis.opendocument.text-master"},
+    {".odp", "application/vnd.oasis.opendocument.presentation"},
+    {".ods", "application/vnd.oasis.opendocument.spreadsheet"},
+    {".odt", "application/vnd.oasis.opendocument.text"},
+    {".oga", "audio/ogg"},
+    {".ogg", "video/x-theora+ogg"},
+    {".ogm", "video/x-ogm+ogg"},
+    {".ogv", "video/ogg"},
+    {".ogx", "application/ogg"},
+    {".old", "application/x-trash"},
+    {".oleo", "application/x-oleo"},
+    {".opml", "text/x-opml+xml"},
+    {".ora", "image/openraster"},
+    {".orf", "image/x-olympus-orf"},
+    {".otc", "application/vnd.oasis.opendocument.chart-template"},
+    {".otf", "application/x-font-otf"},
+    {".otg", "application/vnd.oasis.opendocument.graphics-template"},
+    {".oth", "application/vnd.oasis.opendocument.text-web"},
+    {".otp", "application/vnd.oasis.opendocument.presentation-template"},
+    {".ots", "application/vnd.oasis.opendocument.spreadsheet-template"},
+    {".ott", "application/vnd.oasis.opendocument.text-template"},
+    {".owl", "application/rdf+xml"},
+    {".oxt", "application/vnd.openofficeorg.extension"},
+    {".p", "text/x-pascal"},
+    {".p10", "application/pkcs10"},
+    {".p12", "application/x-pkcs12"},
+    {".p7b", "application/x-pkcs7-certificates"},
+    {".p7s", "application/pkcs7-signature"},
+    {".pack", "application/x-java-pack200"},
+    {".pak", "application/x-pak"},
+    {".par2", "application/x-par2"},
+    {".pas", "text/x-pascal"},
+    {".patch", "text/x-patch"},
+    {".pbm", "image/x-portable-bitmap"},
+    {".pcd", "image/x-photo-cd"},
+    {".pcf", "application/x-cisco-vpn-settings"},
+    {".pcf.gz", "application/x-font-pcf"},
+    {".pcf.z", "application/x-font-pcf"},
+    {".pcl", "application/vnd.hp-pcl"},
+    {".pcx", "image/x-pcx"},
+    {".pdb", "chemical/x-pdb"},
+    {".pdc", "application/x-aportisdoc"},
+    {".pdf", "application/pdf"},
+    {".pdf.bz2", "application/x-bzpdf"},
+    {".pdf.gz", "application/x-gzpdf"},
+    {".pef", "image/x-pentax-pef"},
+    {".pem", "application/x-x509-ca-cert"},
+    {".perl", "application/x-perl"},
+    {".pfa", "application/x-font-type1"},
+    {".pfb", "application/x-font-type1"},
+    {".pfx", "application/x-pkcs12"},
+    {".pgm", "image/x-portable-graymap"},
+    {".pgn", "application/x-chess-pgn"},
+    {".pgp", "application/pgp-encrypted"},
+    {".php", "application/x-php"},
+    {".php3", "application/x-php"},
+    {".php4", "application/x-php"},
+    {".pict", "image/x-pict"},
+    {".pict1", "image/x-pict"},
+    {".pict2", "image/x-pict"},
+    {".pickle", "application/python-pickle"},
+    {".pk", "application/x-tex-pk"},
+    {".pkipath", "application/pkix-pkipath"},
+    {".pkr", "application/pgp-keys"},
+    {".pl", "application/x-perl"},
+    {".pla", "audio/x-iriver-pla"},
+    {".pln", "application/x-planperfect"},
+    {".pls", "audio/x-scpls"},
+    {".pm", "application/x-perl"},
+    {".png", "image/png"},
+    {".pnm", "image/x-portable-anymap"},
+    {".pntg", "image/x-macpaint"},
+    {".po", "text/x-gettext-translation"},
+    {".por", "application/x-spss-por"},
+    {".pot", "text/x-gettext-translation-template"},
+    {".ppm", "image/x-portable-pixmap"},
+    {".pps", "application/vnd.ms-powerpoint"},
+    {".ppt", "application/vnd.ms-powerpoint"},
+    {".pptm", "application/vnd.openxmlformats-officedocument.presentationml.presentation"},
+    {".pptx", "application/vnd.openxmlformats-officedocument.presentationml.presentation"},
+    {".ppz", "application/vnd.ms-powerpoint"},
+    {".prc", "application/x-palm-database"},
+    {".ps", "application/postscript"},
+    {".ps.bz2", "application/x-bzpostscript"},
+    {".ps.gz", "application/x-gzpostscript"},
+    {".psd", "image/vnd.adobe.photoshop"},
+    {".psf", "audio/x-psf"},
+    {".psf.gz", "application/x-gz-font-linux-psf"},
+    {".psflib", "audio/x-psflib"},
+    {".psid", "audio/prs.sid"},
+    {".psw", "application/x-pocket-word"},
+    {".pw", "application/x-pw"},
+    {".py", "text/x-python"},
+    {".pyc", "application/x-python-bytecode"},
+    {".pyo", "application/x-python-bytecode"},
+    {".qif", "image/x-quicktime"},
+    {".qt", "video/quicktime"},
+    {".qtif", "image/x-quicktime"},
+    {".qtl", "application/x-quicktime-media-link"},
+    {".qtvr", "video/quicktime"},
+    {".ra", "audio/vnd.rn-realaudio"},
+    {".raf", "image/x-fuji-raf"},
+    {".ram", "application/ram"},
+    {".rar", "application/x-rar"},
+    {".ras", "image/x-cmu-raster"},
+    {".raw", "image/x-panasonic-raw"},
+    {".rax", "audio/vnd.rn-realaudio"},
+    {".rb", "application/x-ruby"},
+    {".rdf", "application/rdf+xml"},
+    {".rdfs", "application/rdf+xml"},
+    {".reg", "text/x-ms-regedit"},
+    {".rej", "application/x-reject"},
+    {".rgb", "image/x-rgb"},
+    {".rle", "image/rle"},
+    {".rm", "application/vnd.rn-realmedia"},
+    {".rmj", "application/vnd.rn-realmedia"},
+    {".rmm", "application/vnd.rn-realmedia"},
+    {".rms", "application/vnd.rn-realmedia"},
+    {".rmvb", "application/vnd.rn-realmedia"},
+    {".rmx", "application/vnd.rn-realmedia"},
+    {".roff", "text/troff"},
+    {".rp", "image/vnd.rn-realpix"},
+    {".rpm", "application/x-rpm"},
+    {".rss", "application/rss+xml"},
+    {".rt", "text/vnd.rn-realtext"},
+    {".rtf", "application/rtf"},
+    {".rtx", "text/richtext"},
+    {".rv", "video/vnd.rn-realvideo"},
+    {".rvx", "video/vnd.rn-realvideo"},
+    {".s3m", "audio/x-s3m"},
+    {".sam", "application/x-amipro"},
+    {".sami", "application/x-sami"},
+    {".sav", "application/x-spss-sav"},
+    {".scm", "text/x-scheme"},
+    {".sda", "application/vnd.stardivision.draw"},
+    {".sdc", "application/vnd.stardivision.calc"},
+    {".sdd", "application/vnd.stardivision.impress"},
+    {".sdp", "application/sdp"},
+    {".sds", "application/vnd.stardivision.chart"},
+    {".sdw", "application/vnd.stardivision.writer"},
+    {".sgf", "application/x-go-sgf"},
+    {".sgi", "image/x-sgi"},
+    {".sgl", "application/vnd.stardivision.writer"},
+    {".sgm", "text/sgml"},
+    {".sgml", "text/sgml"},
+    {".sh", "application/x-shellscript"},
+    {".shar", "application/x-shar"},
+    {".shn", "application/x-shorten"},
+    {".siag", "application/x-siag"},
+    {".sid", "audio/prs.sid"},
+    {".sik", "application/x-trash"},
+    {".sis", "application/vnd.symbian.install"},
+    {".sisx", "x-epoc/x-sisx-app"},
+    {".sit", "application/x-stuffit"},
+    {".siv", "application/sieve"},
+    {".sk", "image/x-skencil"},
+    {".sk1", "image/x-skencil"},
+    {".skr", "application/pgp-keys"},
+    {".slk", "text/spreadsheet"},
+    {".smaf", "application/x-smaf"},
+    {".smc", "application/x-snes-rom"},
+    {".smd", "application/vnd.stardivision.mail"},
+    {".smf", "application/vnd.stardivision.math"},
+    {".smi", "application/x-sami"},
+    {".smil", "application/smil"},
+    {".sml", "application/smil"},
+    {".sms", "application/x-sms-rom"},
+    {".snd", "audio/basic"},
+    {".so", "application/x-sharedlib"},
+    {".spc", "application/x-pkcs7-certificates"},
+    {".spd", "application/x-font-speedo"},
+    {".spec", "text/x-rpm-spec"},
+    {".spl", "application/x-shockwave-flash"},
+    {".spx", "audio/x-speex"},
+    {".sql", "text/x-sql"},
+    {".sr2", "image/x-sony-sr2"},
+    {".src", "application/x-wais-source"},
+    {".srf", "image/x-sony-srf"},
+    {".srt", "application/x-subrip"},
+    {".ssa", "text/x-ssa"},
+    {".stc", "application/vnd.sun.xml.calc.template"},
+    {".std", "application/vnd.sun.xml.draw.template"},
+    {".sti", "application/vnd.sun.xml.impress.template"},
+    {".stm", "audio/x-stm"},
+    {".stw", "application/vnd.sun.xml.writer.template"},
+    {".sty", "text/x-tex"},
+    {".sub", "text/x-subviewer"},
+    {".sun", "image/x-sun-raster"},
+    {".sv4cpio", "application/x-sv4cpio"},
+    {".sv4crc", "application/x-sv4crc"},
+    {".svg", "image/svg+xml"},
+    {".svgz", "image/svg+xml-compressed"},
+    {".swf", "application/x-shockwave-flash"},
+    {".sxc", "application/vnd.sun.xml.calc"},
+    {".sxd", "application/vnd.sun.xml.draw"},
+    {".sxg", "application/vnd.sun.xml.writer.global"},
+    {".sxi", "application/vnd.sun.xml.impress"},
+    {".sxm", "application/vnd.sun.xml.math"},
+    {".sxw", "application/vnd.sun.xml.writer"},
+    {".sylk", "text/spreadsheet"},
+    {".t", "text/troff"},
+    {".t2t", "text/x-txt2tags"},
+    {".tar", "application/x-tar"},
+    {".tar.bz", "application/x-bzip-compressed-tar"},
+    {".tar.bz2", "application/x-bzip-compressed-tar"},
+    {".tar.gz", "application/x-compressed-tar"},
+    {".tar.lzma", "application/x-lzma-compressed-tar"},
+    {".tar.lzo", "application/x-tzo"},
+    {".tar.xz", "application/x-xz-compressed-tar"},
+    {".tar.z", "application/x-tarz"},
+    {".tbz", "application/x-bzip-compressed-tar"},
+    {".tbz2", "application/x-bzip-compressed-tar"},
+    {".tcl", "text/x-tcl"},
+    {".tex", "text/x-tex"},
+    {".texi", "text/x-texinfo"},
+    {".texinfo", "text/x-texinfo"},
+    {".tga", "image/x-tga"},
+    {".tgz", "application/x-compressed-tar"},
+    {".theme", "application/x-theme"},
+    {".themepack", "application/x-windows-themepack"},
+    {".tif", "image/tiff"},
+    {".tiff", "image/tiff"},
+    {".tk", "text/x-tcl"},
+    {".tlz", "application/x-lzma-compressed-tar"},
+    {".tnef", "application/vnd.ms-tnef"},
+    {".tnf", "application/vnd.ms-tnef"},
+    {".toc", "application/x-cdrdao-toc"},
+    {".torrent", "application/x-bittorrent"},
+    {".tpic", "image/x-tga"},
+    {".tr", "text/troff"},
+    {".ts", "application/x-linguist"},
+    {".tsv", "text/tab-separated-values"},
+    {".tta", "audio/x-tta"},
+    {".ttc", "application/x-font-ttf"},
+    {".ttf", "application/x-font-ttf"},
+    {".ttx", "application/x-font-ttx"},
+    {".txt", "text/plain"},
+    {".txz", "application/x-xz-compressed-tar"},
+    {".tzo", "application/x-tzo"},
+    {".ufraw", "application/x-ufraw"},
+    {".ui", "application/x-designer"},
+    {".uil", "text/x-uil"},
+    {".ult", "audio/x-mod"},
+    {".uni", "audio/x-mod"},
+    {".uri", "text/x-uri"},
+    {".url", "text/x-uri"},
+    {".ustar", "application/x-ustar"},
+    {".vala", "text/x-vala"},
+    {".vapi", "text/x-vala"},
+    {".vcf", "text/directory"},
+    {".vcs", "text/calendar"},
+    {".vct", "text/directory"},
+    {".vda", "image/x-tga"},
+    {".vhd", "text/x-vhdl"},
+    {".vhdl", "text/x-vhdl"},
+    {".viv", "video/vivo"},
+    {".vivo", "video/vivo"},
+    {".vlc", "audio/x-mpegurl"},
+    {".vob", "video/mpeg"},
+    {".voc", "audio/x-voc"},
+    {".vor", "application/vnd.stardivision.writer"},
+    {".vst", "image/x-tga"},
+    {".wav", "audio/x-wav"},
+    {".wax", "audio/x-ms-asx"},
+    {".wb1", "application/x-quattropro"},
+    {".wb2", "application/x-quattropro"},
+    {".wb3", "application/x-quattropro"},
+    {".wbmp", "image/vnd.wap.wbmp"},
+    {".wcm", "application/vnd.ms-works"},
+    {".wdb", "application/vnd.ms-works"},
+    {".webm", "video/webm"},
+    {".wk1", "application/vnd.lotus-1-2-3"},
+    {".wk3", "application/vnd.lotus-1-2-3"},
+    {".wk4", "application/vnd.lotus-1-2-3"},
+    {".wks", "application/vnd.ms-works"},
+    {".wma", "audio/x-ms-wma"},
+    {".wmf", "image/x-wmf"},
+    {".wml", "text/vnd.wap.wml"},
+    {".wmls", "text/vnd.wap.wmlscript"},
+    {".wmv", "video/x-ms-wmv"},
+    {".wmx", "audio/x-ms-asx"},
+    {".wp", "application/vnd.wordperfect"},
+    {".wp4", "application/vnd.wordperfect"},
+    {".wp5", "application/vnd.wordperfect"},
+    {".wp6", "application/vnd.wordperfect"},
+    {".wpd", "application/vnd.wordperfect"},
+    {".wpg", "application/x-wpg"},
+    {".wpl", "application/vnd.ms-wpl"},
+    {".wpp", "application/vnd.wordperfect"},
+    {".wps", "application/vnd.ms-works"},
+    {".wri", "application/x-mswrite"},
+    {".wrl", "model/vrml"},
+    {".wv", "audio/x-wavpack"},
+    {".wvc", "audio/x-wavpack-correction"},
+    {".wvp", "audio/x-wavpack"},
+    {".wvx", "audio/x-ms-asx"},
+    {".x3f", "image/x-sigma-x3f"},
+    {".xac", "application/x-gnucash"},
+    {".xbel", "application/x-xbel"},
+    {".xbl", "application/xml"},
+    {".xbm", "image/x-xbitmap"},
+    {".xcf", "image/x-xcf"},
+    {".xcf.bz2", "image/x-compressed-xcf"},
+    {".xcf.gz", "image/x-compressed-xcf"},
+    {".xhtml", "application/xhtml+xml"},
+    {".xi", "audio/x-xi"},
+    {".xla", "application/vnd.ms-excel"},
+    {".xlc", "application/vnd.ms-excel"},
+    {".xld", "application/vnd.ms-excel"},
+    {".xlf", "application/x-xliff"},
+    {".xliff", "application/x-xliff"},
+    {".xll", "application/vnd.ms-excel"},
+    {".xlm", "application/vnd.ms-excel"},
+    {".xls", "application/vnd.ms-excel"},
+    {".xlsm", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+    {".xlsx", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+    {".xlt", "application/vnd.ms-excel"},
+    {".xlw", "application/vnd.ms-excel"},
+    {".xm", "audio/x-xm"},
+    {".xmf", "audio/x-xmf"},
+    {".xmi", "text/x-xmi"},
+    {".xml", "application/xml"},
+    {".xpm", "image/x-xpixmap"},
+    {".xps", "application/vnd.ms-xpsdocument"},
+    {".xsl", "application/xml"},
+    {".xslfo", "text/x-xslfo"},
+    {".xslt", "application/xml"},
+    {".xspf", "application/xspf+xml"},
+    {".xul", "application/vnd.mozilla.xul+xml"},
+    {".xwd", "image/x-xwindowdump"},
+    {".xyz", "chemical/x-pdb"},
+    {".xz", "application/x-xz"},
+    {".w2p", "application/w2p"},
+    {".z", "application/x-compress"},
+    {".zabw", "application/x-abiword"},
+    {".zip", "application/zip"}
 };
 
+constexpr char MimeLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
 
-class TypeIdentify
+/*
+ * 按小写计算FNV-1a并做末尾混合，seed不同时得到相互独立的散列值
+ *
+ */
+constexpr uint32_t MimeHash(std::string_view key, uint32_t seed)
 {
-public:
-    static std::string getContentTypeBySuffix(const std::string &suffix)
-    {
-        LOG(LoggerLevel::INFO, "%s\n", "函数触发");
-        if(getTypeIdentifyInstance()->contentType.end() == getTypeIdentifyInstance()->contentType.find(suffix))
-        {
-            LOG(LoggerLevel::INFO, "未定义后缀类型：%s\n", suffix.c_str());
-            // std::cout << "TypeIdentify::getContentTypeBySuffix 未定义后缀类型：" << suffix << std::endl;
-            return "";
-        }
-        LOG(LoggerLevel::INFO, "成功解析后缀文件类型：%s\n", suffix.c_str());
-        // std::cout << "TypeIdentify::getContentTypeBySuffix 成功解析后缀文件类型：" << suffix << " (" << contentType[suffix] << ")" << std::endl;
-        return contentType[suffix];
-    }
-    
-    static std::string getContentTypeByPath(const std::string &pathName)
+    uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (size_t i = 0; i < key.size(); ++i)
     {
-        LOG(LoggerLevel::INFO, "%s\n", "函数触发");
-        size_t point;
-        std::string suffix;
-        if ((point = pathName.rfind('.')) != std::string::npos)
-        {
-            suffix = pathName.substr(point);
-        }
-        if(suffix.empty())
-        {
-            LOG(LoggerLevel::ERROR, "解析后缀失败，请求资源路径为：%s（%s）\n", pathName.data(), suffix.c_str());
-            // std::cout << "TypeIdentify::getContentTypeByPath 解析后缀失败，请求资源路径为：" << pathName << " (" << suffix << ")" << std::endl;
-            return "";
-        }
-        else
-        {
-            LOG(LoggerLevel::ERROR, "解析后缀成功，请求资源路径为：%s（%s）\n", pathName.data(), suffix.c_str());
-            // std::cout << "TypeIdentify::getContentTypeByPath 成功解析后缀，请求资源路径为：" << pathName << " (" << suffix << ")" << std::endl;
-            return getContentTypeBySuffix(suffix);
-        }
+        hash ^= (uint8_t)MimeLower(key[i]);
+        hash *= 16777619u;
     }
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return hash;
+}
 
-private:
-    TypeIdentify()
+struct MimePerfectHash
+{
+    uint16_t seeds[MIME_HASH_BUCKETS]; // 各桶的二级散列种子
+    uint16_t slots[MIME_HASH_SLOTS];   // 槽位对应的mimeTypes下标加1，0为空槽
+};
+
+/*
+ * 编译期构造完美哈希，后缀重复或参数不合适时无法在编译期求值，编译报错
+ * 从大桶开始放置，大桶在空槽多时更容易找到种子
+ *
+ */
+constexpr MimePerfectHash BuildMimeHash()
+{
+    MimePerfectHash table = {};
+    uint16_t bucketSize[MIME_HASH_BUCKETS] = {};
+    uint16_t members[MIME_HASH_BUCKETS][MIME_HASH_BUCKET_MAX] = {};
+    for (size_t i = 0; i < sizeof(mimeTypes) / sizeof(mimeTypes[0]); ++i)
     {
-        for (auto i : pairArray)
-        {
-            contentType.insert(std::make_pair(i.first, i.second));
-        }
+        uint32_t bucket = MimeHash(mimeTypes[i].suffix, 0) % MIME_HASH_BUCKETS;
+        if (bucketSize[bucket] >= MIME_HASH_BUCKET_MAX)
+            throw "桶内后缀过多，需调大MIME_HASH_BUCKETS";
+        members[bucket][bucketSize[bucket]++] = (uint16_t)i;
     }
-    ~TypeIdentify();
-    static TypeIdentify *getTypeIdentifyInstance()
+    for (int size = MIME_HASH_BUCKET_MAX; size > 0; --size)
     {
-        if(!typeIdentify_)
+        for (int bucket = 0; bucket < MIME_HASH_BUCKETS; ++bucket)
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            if (!typeIdentify_)
+            if (bucketSize[bucket] != size)
+                continue;
+            for (uint32_t seed = 1;; ++seed)
             {
-                typeIdentify_ = new TypeIdentify();
+                if (seed > UINT16_MAX)
+                    throw "找不到可用的种子，后缀重复或需调大MIME_HASH_SLOTS";
+                uint32_t slots[MIME_HASH_BUCKET_MAX] = {};
+                bool placed = true;
+                for (int i = 0; i < size && placed; ++i)
+                {
+                    slots[i] = MimeHash(mimeTypes[members[bucket][i]].suffix, seed) & (MIME_HASH_SLOTS - 1);
+                    placed = !table.slots[slots[i]];
+                    for (int j = 0; j < i && placed; ++j)
+                        placed = slots[j] != slots[i];
+                }
+                if (!placed)
+                    continue;
+                table.seeds[bucket] = (uint16_t)seed;
+                for (int i = 0; i < size; ++i)
+                    table.slots[slots[i]] = members[bucket][i] + 1;
+                break;
             }
         }
-        return typeIdentify_;
     }
+    return table;
+}
 
-    static std::mutex mutex_;
-    static TypeIdentify *typeIdentify_;
-    static std::map<std::string, std::string> contentType;
-    
+constexpr MimePerfectHash mimeHash = BuildMimeHash();
+
+class TypeIdentify
+{
+public:
+    static std::string_view getContentTypeBySuffix(std::string_view suffix);  // 按后缀（含'.'）查询，未知后缀返回空
+    static std::string_view getContentTypeByPath(std::string_view pathName);  // 按路径最后一段的后缀查询，无后缀或未知后缀返回空
+    // 判断文本类型是否值得压缩，文本、脚本、json、xml、svg等压缩收益大，图片、视频、压缩包等已压缩资源不再压缩
+    static bool isCompressibleType(std::string_view contentType);
 };
 
-std::mutex TypeIdentify::mutex_;
-TypeIdentify *TypeIdentify::typeIdentify_;
-std::map<std::string, std::string> TypeIdentify::contentType;
+std::string_view TypeIdentify::getContentTypeBySuffix(std::string_view suffix)
+{
+    uint32_t bucket = MimeHash(suffix, 0) % MIME_HASH_BUCKETS;
+    uint16_t index = mimeHash.slots[MimeHash(suffix, mimeHash.seeds[bucket]) & (MIME_HASH_SLOTS - 1)];
+    if (!index)
+        return std::string_view();
+    const MimeType &mime = mimeTypes[index - 1];
+    if (mime.suffix.size() != suffix.size())
+        return std::string_view();
+    for (size_t i = 0; i < suffix.size(); ++i)
+    {
+        if (mime.suffix[i] != MimeLower(suffix[i]))
+            return std::string_view();
+    }
+    return mime.type;
+}
+
+std::string_view TypeIdentify::getContentTypeByPath(std::string_view pathName)
+{
+    size_t point = pathName.rfind('.');
+    if (std::string_view::npos == point)
+        return std::string_view();
+    size_t slash = pathName.rfind('/');
+    if (std::string_view::npos != slash && slash > point)
+        return std::string_view(); // '.'在目录名中，文件本身没有后缀
+    return getContentTypeBySuffix(pathName.substr(point));
+}
 
+bool TypeIdentify::isCompressibleType(std::string_view contentType)
+{
+    static const char *compressibleTypes[] = {
+        "application/javascript", "application/json", "application/xml", "application/xhtml+xml",
+        "application/atom+xml", "application/rss+xml", "application/x-javascript", "image/svg+xml",
+        "image/x-icon", "image/vnd.microsoft.icon", "application/x-font-ttf", "application/x-font-otf"};
+    if (0 == contentType.compare(0, 5, "text/"))
+        return true;
+    for (const char *type : compressibleTypes)
+    {
+        if (contentType == type)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,169 @@
+// UniqueFunction类：
+//  只可移动的可调用对象包装，用于替代EventLoop任务、ThreadPool任务与Channel回调中的std::function
+//  可调用对象不超过INLINE_SIZE字节且移动不抛异常时直接存放在内置缓冲区内，不分配堆内存
+//  常见的跨线程任务如std::bind(&TcpConnection::SendInLoop, sptcpconn)（成员函数指针+shared_ptr，32字节）均可内置存放
+//  只可移动：任务入队、出队与交换均为移动，shared_ptr等捕获对象不会被复制，也就不会增减原子引用计数
+//  整个对象为64字节，恰好一个缓存行；空对象调用时抛出std::bad_function_call，与std::function一致
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature>
+class UniqueFunction;
+
+template <typename R, typename... Args>
+class UniqueFunction<R(Args...)>
+{
+    // 以Args调用的结果可转换为R，R为void时忽略返回值
+    template <typename Functor, typename = void>
+    struct Callable : std::false_type
+    {
+    };
+    template <typename Functor>
+    struct Callable<Functor, typename std::enable_if<std::is_void<R>::value || std::is_convertible<decltype(std::declval<Functor &>()(std::declval<Args>()...)), R>::value,
+                                                     decltype(void(std::declval<Functor &>()(std::declval<Args>()...)))>::type> : std::true_type
+    {
+    };
+
+public:
+    static constexpr size_t INLINE_SIZE = 56; // 内置缓冲区字节数
+
+    UniqueFunction() noexcept : ops_(nullptr) {}
+    UniqueFunction(std::nullptr_t) noexcept : ops_(nullptr) {}
+    template <typename F,
+              typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, UniqueFunction>::value &&
+                                                 Callable<typename std::decay<F>::type>::value>::type>
+    UniqueFunction(F &&f) : ops_(nullptr)
+    {
+        typedef typename std::decay<F>::type Functor;
+        if (IsNull(f, std::integral_constant<bool, std::is_pointer<typename std::remove_reference<F>::type>::value>()))
+            return;
+        Construct<Functor>(std::forward<F>(f), Inline<Functor>());
+        ops_ = OpsFor<Functor, Inline<Functor>::value>::Get();
+    }
+    UniqueFunction(UniqueFunction &&other) noexcept : ops_(other.ops_)
+    {
+        if (ops_)
+        {
+            ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+    UniqueFunction &operator=(UniqueFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            if (other.ops_)
+            {
+                other.ops_->move(storage_, other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+    UniqueFunction &operator=(std::nullptr_t) noexcept
+    {
+        Reset();
+        return *this;
+    }
+    template <typename F,
+              typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, UniqueFunction>::value>::type>
+    UniqueFunction &operator=(F &&f)
+    {
+        return *this = UniqueFunction(std::forward<F>(f));
+    }
+    UniqueFunction(const UniqueFunction &) = delete;
+    UniqueFunction &operator=(const UniqueFunction &) = delete;
+    ~UniqueFunction() { Reset(); }
+
+    R operator()(Args... args) const
+    {
+        if (!ops_)
+            throw std::bad_function_call();
+        return ops_->invoke(const_cast<unsigned char *>(storage_), std::forward<Args>(args)...);
+    }
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+private:
+    // 按可调用对象类型生成的操作表，空对象为nullptr
+    typedef struct _Ops
+    {
+        R (*invoke)(void *storage, Args &&...args);
+        void (*move)(void *dst, void *src); // 移动到dst并析构src内的对象
+        void (*destroy)(void *storage);
+    } Ops;
+
+    template <typename Functor>
+    struct Inline : std::integral_constant<bool, sizeof(Functor) <= INLINE_SIZE &&
+                                                     alignof(Functor) <= alignof(std::max_align_t) &&
+                                                     std::is_nothrow_move_constructible<Functor>::value>
+    {
+    };
+
+    template <typename Functor, bool isInline>
+    struct OpsFor;
+
+    // 内置存放：对象位于storage_内
+    template <typename Functor>
+    struct OpsFor<Functor, true>
+    {
+        static R Invoke(void *storage, Args &&...args) { return static_cast<R>((*static_cast<Functor *>(storage))(std::forward<Args>(args)...)); }
+        static void Move(void *dst, void *src)
+        {
+            new (dst) Functor(std::move(*static_cast<Functor *>(src)));
+            static_cast<Functor *>(src)->~Functor();
+        }
+        static void Destroy(void *storage) { static_cast<Functor *>(storage)->~Functor(); }
+        static const Ops *Get()
+        {
+            static const Ops ops = {&Invoke, &Move, &Destroy};
+            return &ops;
+        }
+    };
+
+    // 堆上存放：storage_内只存放指针，移动时转移指针
+    template <typename Functor>
+    struct OpsFor<Functor, false>
+    {
+        static R Invoke(void *storage, Args &&...args) { return static_cast<R>((**static_cast<Functor **>(storage))(std::forward<Args>(args)...)); }
+        static void Move(void *dst, void *src) { *static_cast<Functor **>(dst) = *static_cast<Functor **>(src); }
+        static void Destroy(void *storage) { delete *static_cast<Functor **>(storage); }
+        static const Ops *Get()
+        {
+            static const Ops ops = {&Invoke, &Move, &Destroy};
+            return &ops;
+        }
+    };
+
+    template <typename Functor, typename F>
+    void Construct(F &&f, std::true_type) { new (storage_) Functor(std::forward<F>(f)); }
+    template <typename Functor, typename F>
+    void Construct(F &&f, std::false_type) { *reinterpret_cast<Functor **>(storage_) = new Functor(std::forward<F>(f)); }
+
+    // 空的函数指针与空的std::function构造出空对象，与std::function一致
+    template <typename F>
+    static bool IsNull(const F &f, std::true_type) { return f == nullptr; }
+    template <typename F>
+    static bool IsNull(const std::function<F> &f, std::false_type) { return !f; }
+    template <typename F>
+    static bool IsNull(const F &, std::false_type) { return false; }
+
+    void Reset() noexcept
+    {
+        if (ops_)
+        {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+    const Ops *ops_;
+};
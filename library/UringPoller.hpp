@@ -0,0 +1,847 @@
+// UringPoller类：
+//  基于io_uring的Poller实现，直接通过系统调用与内核共享提交/完成队列，不依赖liburing，由Poller.hpp包含
+//  设置了EPOLLET的Channel对应一个多次触发（multishot）的IORING_OP_POLL_ADD，语义即边缘触发，就绪事件以完成队列项返回，无需每轮重新注册
+//  未设置EPOLLET的Channel为水平触发：使用单次poll，每次产生事件后重新添加，提交时若仍就绪则立即再次触发
+//  （IORING_POLL_ADD_LEVEL在较新的内核上已不再支持，因此不使用）
+//  添加、修改、移除监听只写入提交队列，随loop线程下一次io_uring_enter一并提交，等待事件与提交变更合为一次系统调用
+//  修改监听为POLL_REMOVE加新的POLL_ADD，user_data由fd与递增序号组成，已被替换或移除的poll的完成项按序号丢弃
+//  非loop线程调用（如工作线程上析构连接）时持锁立即提交，不等待loop线程下一轮
+//  NETSERVER_URING_SQPOLL=1时开启SQPOLL，由内核线程轮询提交队列，loop线程仅在内核线程休眠后唤醒它
+//  完成模式（见Channel.hpp）：Poller代为完成I/O，不再只通知就绪
+//    监听套接字使用多次触发的IORING_OP_ACCEPT，新连接暂存在Channel内，TcpServer取走，不再调用accept
+//    已连接套接字使用多次触发的IORING_OP_RECV，由内核从注册的提供缓冲区环（IORING_REGISTER_PBUF_RING）选取缓冲区，
+//    数据复制进Channel后缓冲区随即归还；暂存数据达到上限时取消recv（取消生效前已接收的数据仍交付），所有者取走数据后经UpdateChannel恢复
+//    同一轮的新连接与数据合并为一次EPOLLIN；Channel其余的事件（如EPOLLOUT）仍由poll监听
+//    user_data序号的高位标记accept/recv，丢弃的accept完成项关闭新连接，丢弃的recv完成项归还缓冲区
+//    loop线程移除Channel时同步取消并等待recv结束，返回后套接字内的数据不会再被Poller读走，所有者（如端口转发）可接手套接字
+//    内核不支持时（5.19以下无缓冲区环，6.0以下无多次触发的recv）退回就绪通知；NETSERVER_URING_COMPLETION=0时不使用，用于对比
+//  发送仍在可写时由TcpConnection自行send/sendfile，不提交IORING_OP_SEND：待发数据与文件段在连接借给工作线程、输出水位暂停时
+//  均由连接管理，改为异步发送需在完成前固定缓冲区并改写这些机制；空闲超时由时间轮管理，不使用链接的超时请求（LINK_TIMEOUT）
+
+#pragma once
+
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+
+#define URING_SQ_ENTRIES 1024    // 提交队列长度
+#define URING_CQ_ENTRIES 16384   // 完成队列长度，多次触发的poll会持续产生完成项，取提交队列的16倍
+#define URING_SQPOLL_IDLE 2000   // SQPOLL内核线程空闲多少毫秒后休眠
+#define URING_BUF_ENTRIES 256    // 提供缓冲区环的缓冲区数，须为2的幂
+#define URING_BUF_SIZE 8192      // 每个缓冲区的字节数
+#define URING_BUF_GROUP 0        // 缓冲区组号
+#define URING_RECV_PENDING_MAX (256 * 1024) // Channel暂存数据的默认上限，达到后暂停recv
+#define URING_COMPLETION_BIT 0x80000000u    // user_data序号中标记accept/recv请求的位
+#define URING_ACCEPT_BIT 0x40000000u        // user_data序号中标记accept请求的位
+#define URING_SEQUENCE_MASK 0x3fffffffu
+
+class UringPoller : public Poller
+{
+public:
+    static UringPoller *Create(bool sqpoll, bool completion); // 创建io_uring实例，内核不支持时返回nullptr
+    ~UringPoller();
+    void AddChannel(Channel *pchannel) override;        // 添加多次触发的POLL_ADD，完成模式的Channel另提交accept/recv
+    void RemoveChannel(Channel *pchannel) override;     // POLL_REMOVE，取消accept/recv
+    void UpdateChannel(Channel *pchannel) override;     // POLL_REMOVE后重新POLL_ADD，恢复暂停的recv
+    void poll(ChannelList &activeChannelList, int timeoutMs) override; // 提交变更并等待一批次完成项
+
+private:
+    // 一个fd当前生效的poll
+    typedef struct _ArmedPoll
+    {
+        uint64_t userData;       // 该poll的user_data，0为未添加（完成模式下无其余事件）
+        uint32_t events;         // poll监听的事件
+        uint64_t completionData; // 进行中的accept/recv的user_data，0为没有
+        bool removing;           // 正在移除，accept/recv结束后不再重新提交
+        uint64_t round;          // 最近一次产生事件的poll轮次，同一轮的多个完成项合并
+        size_t index;            // 该轮次在readyFds_中的位置
+    } ArmedPoll;
+    int ringFd_;
+    bool sqpoll_;
+    void *ringMem_;                // 提交队列与完成队列共用的映射
+    size_t ringSize_;
+    struct io_uring_sqe *sqes_;    // 提交队列项数组
+    size_t sqesSize_;
+    unsigned *sqHead_;             // 内核消费到的位置
+    unsigned *sqTail_;             // 本进程写入到的位置
+    unsigned *sqFlags_;            // IORING_SQ_NEED_WAKEUP等
+    unsigned *sqArray_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned *cqHead_;             // 本进程消费到的位置
+    unsigned *cqTail_;             // 内核写入到的位置
+    unsigned cqMask_;
+    struct io_uring_cqe *cqes_;
+    bool completion_;              // 使用完成模式，缓冲区环注册失败或内核不支持多次触发的recv时为false
+    struct io_uring_buf_ring *bufRing_; // 提供缓冲区环
+    char *bufMem_;                 // 缓冲区环中各缓冲区的内存
+    uint16_t bufTail_;             // 本进程归还缓冲区写到的位置，Reap结束时发布给内核
+    uint32_t sequence_;            // 请求序号，0保留给无需处理的完成项
+    uint64_t round_;               // poll轮次
+    std::map<int, ArmedPoll> armed_; // fd->当前生效的poll与accept/recv
+    std::thread::id pollThread_;   // 调用poll的线程，其他线程的变更立即提交
+    std::vector<int> readyFds_;    // 本轮产生事件的fd，已移除的置为-1
+    std::vector<uint32_t> revents_; // 本轮各fd合并后的事件
+    UringPoller(int ringFd, bool sqpoll);
+    bool MapRings(const struct io_uring_params &params); // 映射提交队列与完成队列
+    bool Probe();                                        // 确认内核支持多次触发的poll
+    bool SetupBufferRing();                              // 注册提供缓冲区环
+    int Enter(unsigned toSubmit, unsigned minComplete, unsigned flags, void *arg = nullptr, size_t argSize = 0);
+    void Push(const struct io_uring_sqe &sqe);           // 写入一个提交队列项，需持有mutex_
+    unsigned Unsubmitted() const;                        // 已写入但内核尚未消费的提交队列项数
+    unsigned WakeUpFlag() const;                         // SQPOLL内核线程休眠时返回IORING_ENTER_SQ_WAKEUP
+    void Flush();                                        // 立即提交，需持有mutex_
+    void ArmPoll(int fd, uint32_t events);               // 添加poll，需持有mutex_
+    void CancelPoll(int fd);                             // 移除fd当前的poll，需持有mutex_
+    uint32_t PollEvents(Channel *pchannel) const;        // Channel需由poll监听的事件，完成模式下去掉可读事件
+    void ArmCompletion(int fd, Channel *pchannel);       // 提交多次触发的accept或recv，需持有mutex_
+    void CancelCompletion(int fd, uint64_t userData);    // 取消accept或recv，需持有mutex_
+    void FallBack(int fd, Channel *pchannel, int res);   // 内核不支持或accept出错，该Channel退回就绪通知，需持有mutex_
+    void RecycleBuffer(uint16_t bid);                    // 归还缓冲区，Reap结束时发布
+    void MarkReady(int fd, uint32_t events);             // 记录本轮事件，同一fd合并，需持有mutex_
+    void Reap();                                         // 处理完成队列中的全部完成项，只在loop线程调用，需持有mutex_
+    void ReapCompletion(const struct io_uring_cqe &cqe); // 处理accept/recv的完成项
+    uint32_t NextSequence();
+    bool OnLoopThread() const { return pollThread_ == std::this_thread::get_id(); }
+    static uint64_t MakeUserData(int fd, uint32_t sequence) { return ((uint64_t)(uint32_t)fd << 32) | sequence; }
+    static std::mutex sqThreadMutex_;
+    static int sqThreadRing_; // 首个开启SQPOLL的实例，其余实例共用它的内核提交线程
+
+};
+
+std::mutex UringPoller::sqThreadMutex_;
+int UringPoller::sqThreadRing_ = -1;
+
+UringPoller::UringPoller(int ringFd, bool sqpoll)
+    : Poller("io_uring"),
+      ringFd_(ringFd),
+      sqpoll_(sqpoll),
+      ringMem_(MAP_FAILED),
+      ringSize_(0),
+      sqes_((struct io_uring_sqe *)MAP_FAILED),
+      sqesSize_(0),
+      completion_(false),
+      bufRing_((struct io_uring_buf_ring *)MAP_FAILED),
+      bufMem_((char *)MAP_FAILED),
+      bufTail_(0),
+      sequence_(0),
+      round_(1),
+      pollThread_()
+{
+    LOG(LoggerLevel::INFO, "函数触发，ringFd: %d\n", ringFd_);
+}
+
+UringPoller::~UringPoller()
+{
+    LOG(LoggerLevel::INFO, "函数触发，ringFd: %d\n", ringFd_);
+    if (sqes_ != MAP_FAILED)
+        munmap(sqes_, sqesSize_);
+    if (ringMem_ != MAP_FAILED)
+        munmap(ringMem_, ringSize_);
+    {
+        std::lock_guard<std::mutex> lock(sqThreadMutex_);
+        if (sqThreadRing_ == ringFd_)
+            sqThreadRing_ = -1;
+    }
+    close(ringFd_); // 关闭实例时内核取消所有未完成的请求
+    if (bufMem_ != MAP_FAILED)
+        munmap(bufMem_, (size_t)URING_BUF_ENTRIES * URING_BUF_SIZE);
+    if (bufRing_ != MAP_FAILED)
+        munmap(bufRing_, URING_BUF_ENTRIES * sizeof(struct io_uring_buf));
+}
+
+/*
+ * 创建io_uring实例并映射队列
+ * 要求内核支持SINGLE_MMAP、NODROP与EXT_ARG（5.11及以上），以及多次触发的poll（5.13及以上）
+ * 开启SQPOLL时各EventLoop的实例以IORING_SETUP_ATTACH_WQ共用一个内核提交线程，避免每个实例各占一个轮询线程
+ * SQPOLL创建失败（如权限不足）时不开启SQPOLL重试
+ * completion为true时注册提供缓冲区环，失败时只使用就绪通知
+ *
+ */
+UringPoller *UringPoller::Create(bool sqpoll, bool completion)
+{
+    LOG(LoggerLevel::INFO, "函数触发，sqpoll：%d，completion：%d\n", sqpoll, completion);
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_CQ_ENTRIES;
+    std::unique_lock<std::mutex> sqThreadLock(sqThreadMutex_, std::defer_lock);
+    if (sqpoll)
+    {
+        sqThreadLock.lock();
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = URING_SQPOLL_IDLE;
+        if (sqThreadRing_ >= 0)
+        {
+            params.flags |= IORING_SETUP_ATTACH_WQ;
+            params.wq_fd = sqThreadRing_;
+        }
+    }
+    int ringFd = (int)syscall(__NR_io_uring_setup, URING_SQ_ENTRIES, &params);
+    if (ringFd < 0 && (params.flags & IORING_SETUP_ATTACH_WQ))
+    {
+        LOG(LoggerLevel::ERROR, "共用内核提交线程失败，errno：%d，单独创建\n", errno);
+        params.flags &= ~IORING_SETUP_ATTACH_WQ;
+        params.wq_fd = 0;
+        ringFd = (int)syscall(__NR_io_uring_setup, URING_SQ_ENTRIES, &params);
+    }
+    if (ringFd < 0 && sqpoll)
+    {
+        LOG(LoggerLevel::ERROR, "开启SQPOLL创建io_uring实例失败，errno：%d，不开启SQPOLL重试\n", errno);
+        sqpoll = false;
+        params.flags &= ~IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = 0;
+        ringFd = (int)syscall(__NR_io_uring_setup, URING_SQ_ENTRIES, &params);
+    }
+    if (ringFd < 0)
+    {
+        LOG(LoggerLevel::ERROR, "创建io_uring实例失败，errno：%d\n", errno);
+        return nullptr;
+    }
+    const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & required) != required)
+    {
+        LOG(LoggerLevel::ERROR, "内核io_uring缺少所需特性，features：%u\n", params.features);
+        close(ringFd);
+        return nullptr;
+    }
+    UringPoller *poller = new UringPoller(ringFd, sqpoll);
+    if (!poller->MapRings(params) || !poller->Probe())
+    {
+        delete poller;
+        return nullptr;
+    }
+    if (sqpoll && sqThreadRing_ < 0)
+        sqThreadRing_ = ringFd;
+    poller->completion_ = completion && poller->SetupBufferRing();
+    return poller;
+}
+
+/*
+ * 映射提交队列、完成队列与提交队列项数组
+ * 提交队列项按下标顺序使用，sqArray_初始化为恒等映射后不再修改
+ *
+ */
+bool UringPoller::MapRings(const struct io_uring_params &params)
+{
+    ringSize_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                         params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+    ringMem_ = mmap(nullptr, ringSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (ringMem_ == MAP_FAILED)
+    {
+        LOG(LoggerLevel::ERROR, "映射io_uring队列失败，errno：%d\n", errno);
+        return false;
+    }
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = (struct io_uring_sqe *)mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED)
+    {
+        LOG(LoggerLevel::ERROR, "映射io_uring提交队列项失败，errno：%d\n", errno);
+        return false;
+    }
+    char *ring = (char *)ringMem_;
+    sqHead_ = (unsigned *)(ring + params.sq_off.head);
+    sqTail_ = (unsigned *)(ring + params.sq_off.tail);
+    sqFlags_ = (unsigned *)(ring + params.sq_off.flags);
+    sqArray_ = (unsigned *)(ring + params.sq_off.array);
+    sqMask_ = *(unsigned *)(ring + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    cqHead_ = (unsigned *)(ring + params.cq_off.head);
+    cqTail_ = (unsigned *)(ring + params.cq_off.tail);
+    cqMask_ = *(unsigned *)(ring + params.cq_off.ring_mask);
+    cqes_ = (struct io_uring_cqe *)(ring + params.cq_off.cqes);
+    for (unsigned i = 0; i < sqEntries_; ++i)
+        sqArray_[i] = i;
+    return true;
+}
+
+/*
+ * 对一个可读的eventfd添加多次触发的poll，内核不支持时完成项为-EINVAL
+ * 先等到poll的首个完成项再移除，同批提交时移除可能先于就绪事件生效
+ * 仅在创建时调用，此时没有其他线程访问
+ *
+ */
+bool UringPoller::Probe()
+{
+    int probeFd = eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (probeFd < 0)
+        return false;
+    struct io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = probeFd;
+    sqe.poll32_events = EPOLLIN;
+    sqe.len = IORING_POLL_ADD_MULTI;
+    sqe.user_data = MakeUserData(probeFd, 1);
+    Push(sqe);
+    bool supported = false;
+    bool polled = false;
+    bool cancelled = false;
+    bool removed = false;
+    while (!removed && (Enter(Unsubmitted(), 1, IORING_ENTER_GETEVENTS | WakeUpFlag()) >= 0 || EINTR == errno))
+    {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            const struct io_uring_cqe &cqe = cqes_[head & cqMask_];
+            if (MakeUserData(probeFd, 0) == cqe.user_data)
+                removed = true;
+            else if (!polled)
+                supported = cqe.res > 0 && (cqe.flags & IORING_CQE_F_MORE);
+            polled = true;
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        if (!supported)
+            break;
+        if (polled && !cancelled)
+        {
+            cancelled = true;
+            memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_POLL_REMOVE;
+            sqe.addr = MakeUserData(probeFd, 1);
+            sqe.user_data = MakeUserData(probeFd, 0);
+            Push(sqe);
+        }
+    }
+    close(probeFd);
+    if (!supported)
+        LOG(LoggerLevel::ERROR, "%s\n", "内核不支持多次触发的poll");
+    return removed && supported;
+}
+
+/*
+ * io_uring_enter，计入系统调用次数
+ *
+ */
+int UringPoller::Enter(unsigned toSubmit, unsigned minComplete, unsigned flags, void *arg, size_t argSize)
+{
+    syscalls_->Add();
+    return (int)syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, arg, argSize);
+}
+
+/*
+ * 已写入但内核尚未消费的提交队列项数
+ * 以内核的head计算而不是自行计数，多个线程先后提交时各自传入的数量多于剩余项也无妨
+ *
+ */
+unsigned UringPoller::Unsubmitted() const
+{
+    return *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * SQPOLL内核线程空闲超时后休眠并设置IORING_SQ_NEED_WAKEUP，此后写入的提交队列项需在io_uring_enter时唤醒它才会被消费
+ * 读取标志前的全屏障保证内核线程要么已看到新的tail，要么本线程看到休眠标志
+ *
+ */
+unsigned UringPoller::WakeUpFlag() const
+{
+    if (!sqpoll_)
+        return 0;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return (__atomic_load_n(sqFlags_, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) ? IORING_ENTER_SQ_WAKEUP : 0;
+}
+
+/*
+ * 写入一个提交队列项，先写内容再发布tail，SQPOLL的内核线程随时可能读取
+ * 队列已满时先提交
+ *
+ */
+void UringPoller::Push(const struct io_uring_sqe &sqe)
+{
+    while (Unsubmitted() >= sqEntries_)
+    {
+        if (sqpoll_)
+            Enter(0, 0, IORING_ENTER_SQ_WAKEUP | IORING_ENTER_SQ_WAIT);
+        else
+            Flush();
+    }
+    unsigned tail = *sqTail_;
+    sqes_[tail & sqMask_] = sqe;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * 立即提交已写入的提交队列项
+ * SQPOLL模式下只需在内核线程休眠时唤醒
+ *
+ */
+void UringPoller::Flush()
+{
+    if (sqpoll_)
+    {
+        if (WakeUpFlag())
+            Enter(0, 0, IORING_ENTER_SQ_WAKEUP);
+        return;
+    }
+    unsigned toSubmit = Unsubmitted();
+    if (toSubmit && Enter(toSubmit, 0, 0) < 0)
+        LOG(LoggerLevel::ERROR, "提交io_uring请求失败，errno：%d，ringFd: %d\n", errno, ringFd_);
+}
+
+/*
+ * 下一个请求序号，跳过0，不占用标记accept/recv的高位
+ *
+ */
+uint32_t UringPoller::NextSequence()
+{
+    sequence_ = (sequence_ + 1) & URING_SEQUENCE_MASK;
+    if (0 == sequence_)
+        ++sequence_;
+    return sequence_;
+}
+
+/*
+ * 为fd添加poll，poll32_events只保留事件位
+ * 边缘触发为多次触发的poll，水平触发为单次poll，由poll在完成项不带IORING_CQE_F_MORE时重新添加
+ * 没有需监听的事件时（完成模式下只监听可读）只记录，不提交
+ *
+ */
+void UringPoller::ArmPoll(int fd, uint32_t events)
+{
+    ArmedPoll &armed = armed_[fd]; // 重新添加时保留round，本轮已产生的事件仍可合并
+    armed.events = events;
+    armed.userData = 0;
+    uint32_t pollEvents = events & ~(uint32_t)(EPOLLET | EPOLLONESHOT | EPOLLEXCLUSIVE | EPOLLWAKEUP);
+    if (0 == pollEvents)
+        return;
+    struct io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = fd;
+    sqe.poll32_events = pollEvents;
+    sqe.len = (events & EPOLLET) ? IORING_POLL_ADD_MULTI : 0;
+    sqe.user_data = MakeUserData(fd, NextSequence());
+    Push(sqe);
+    armed.userData = sqe.user_data;
+}
+
+/*
+ * 移除fd当前的poll，POLL_REMOVE自身的完成项序号为0，被取消的poll以-ECANCELED结束，两者均被丢弃
+ *
+ */
+void UringPoller::CancelPoll(int fd)
+{
+    std::map<int, ArmedPoll>::iterator iter = armed_.find(fd);
+    if (armed_.end() == iter || 0 == iter->second.userData)
+        return;
+    struct io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_POLL_REMOVE;
+    sqe.addr = iter->second.userData;
+    sqe.user_data = MakeUserData(fd, 0);
+    Push(sqe);
+    iter->second.userData = 0;
+}
+
+/*
+ * Channel需由poll监听的事件，完成模式下可读由accept/recv的完成项通知
+ *
+ */
+uint32_t UringPoller::PollEvents(Channel *pchannel) const
+{
+    uint32_t events = pchannel->GetEvents();
+    if (pchannel->CompletionActive())
+        events &= ~(uint32_t)(EPOLLIN | EPOLLPRI | EPOLLRDNORM);
+    return events;
+}
+
+/*
+ * 提交多次触发的accept或recv
+ * accept直接返回非阻塞的新连接；recv由内核从缓冲区组选取缓冲区，缓冲区用尽时以-ENOBUFS结束，由ReapCompletion重新提交
+ *
+ */
+void UringPoller::ArmCompletion(int fd, Channel *pchannel)
+{
+    uint32_t sequence = NextSequence() | URING_COMPLETION_BIT;
+    struct io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.fd = fd;
+    if (Channel::COMPLETION_ACCEPT == pchannel->GetCompletion())
+    {
+        sequence |= URING_ACCEPT_BIT;
+        sqe.opcode = IORING_OP_ACCEPT;
+        sqe.ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe.accept_flags = SOCK_NONBLOCK;
+    }
+    else
+    {
+        sqe.opcode = IORING_OP_RECV;
+        sqe.ioprio = IORING_RECV_MULTISHOT;
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = URING_BUF_GROUP;
+    }
+    sqe.user_data = MakeUserData(fd, sequence);
+    Push(sqe);
+    armed_[fd].completionData = sqe.user_data;
+}
+
+/*
+ * 取消accept或recv，ASYNC_CANCEL自身的完成项序号为0被丢弃，被取消的请求以-ECANCELED结束
+ *
+ */
+void UringPoller::CancelCompletion(int fd, uint64_t userData)
+{
+    struct io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_ASYNC_CANCEL;
+    sqe.addr = userData;
+    sqe.user_data = MakeUserData(fd, 0);
+    Push(sqe);
+}
+
+/*
+ * 该Channel退回就绪通知，由处理函数自行accept与read
+ * 内核不支持多次触发的recv时之后添加的Channel也不再使用完成模式
+ * 新添加的poll若已就绪会立即产生完成项，无需补发事件
+ *
+ */
+void UringPoller::FallBack(int fd, Channel *pchannel, int res)
+{
+    LOG(LoggerLevel::ERROR, "io_uring %s失败，res：%d，退回就绪通知，sockfd：%d，ringFd: %d\n",
+        Channel::COMPLETION_ACCEPT == pchannel->GetCompletion() ? "accept" : "recv", res, fd, ringFd_);
+    if (-EINVAL == res || -EOPNOTSUPP == res)
+        completion_ = false;
+    pchannel->SetCompletionActive(false);
+    CancelPoll(fd);
+    ArmPoll(fd, PollEvents(pchannel));
+}
+
+/*
+ * 将缓冲区写回缓冲区环，只写addr、len、bid，首项的resv与环的tail重叠
+ * 环按io_uring_buf数组访问：头文件以__DECLARE_FLEX_ARRAY声明的bufs在C++下带有空结构体前缀，偏移不为0
+ *
+ */
+void UringPoller::RecycleBuffer(uint16_t bid)
+{
+    struct io_uring_buf &buf = ((struct io_uring_buf *)bufRing_)[bufTail_ & (URING_BUF_ENTRIES - 1)];
+    buf.addr = (uint64_t)(uintptr_t)(bufMem_ + (size_t)bid * URING_BUF_SIZE);
+    buf.len = URING_BUF_SIZE;
+    buf.bid = bid;
+    ++bufTail_;
+}
+
+/*
+ * 注册提供缓冲区环，要求内核5.19及以上
+ * 仅在创建时调用，此时没有其他线程访问
+ *
+ */
+bool UringPoller::SetupBufferRing()
+{
+    bufRing_ = (struct io_uring_buf_ring *)mmap(nullptr, URING_BUF_ENTRIES * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    bufMem_ = (char *)mmap(nullptr, (size_t)URING_BUF_ENTRIES * URING_BUF_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufRing_ == MAP_FAILED || bufMem_ == MAP_FAILED)
+    {
+        LOG(LoggerLevel::ERROR, "分配io_uring缓冲区环失败，errno：%d\n", errno);
+        return false;
+    }
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)bufRing_;
+    reg.ring_entries = URING_BUF_ENTRIES;
+    reg.bgid = URING_BUF_GROUP;
+    syscalls_->Add();
+    if (syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        LOG(LoggerLevel::ERROR, "注册io_uring缓冲区环失败，errno：%d，只使用就绪通知\n", errno);
+        return false;
+    }
+    for (uint16_t bid = 0; bid < URING_BUF_ENTRIES; ++bid)
+        RecycleBuffer(bid);
+    __atomic_store_n(&bufRing_->tail, bufTail_, __ATOMIC_RELEASE);
+    return true;
+}
+
+/*
+ * 添加Channel对应连接的监听
+ * 请求了完成模式且内核支持时提交accept/recv，poll只监听其余事件
+ *
+ */
+void UringPoller::AddChannel(Channel *pchannel)
+{
+    LOG(LoggerLevel::INFO, "函数触发，ringFd: %d\n", ringFd_);
+    int fd = pchannel->GetFd();
+    std::lock_guard<std::mutex> lock(mutex_);
+    channelMap_[fd] = pchannel;
+    CancelPoll(fd);
+    ArmedPoll &armed = armed_[fd];
+    if (armed.completionData)
+        CancelCompletion(fd, armed.completionData);
+    armed.completionData = 0;
+    armed.removing = false;
+    pchannel->SetCompletionActive(completion_ && Channel::COMPLETION_NONE != pchannel->GetCompletion());
+    if (pchannel->CompletionActive())
+        ArmCompletion(fd, pchannel);
+    ArmPoll(fd, PollEvents(pchannel));
+    if (!OnLoopThread())
+        Flush();
+}
+
+/*
+ * 移除Channel对应连接的监听
+ * loop线程上同步取消accept/recv并等待其结束，期间收到的数据与新连接仍交给该Channel
+ * 其他线程上（如工作线程析构连接）只提交取消，此后的完成项按序号丢弃，取消生效前已接收而尚未处理的数据随之丢弃
+ *
+ */
+void UringPoller::RemoveChannel(Channel *pchannel)
+{
+    LOG(LoggerLevel::INFO, "函数触发，ringFd: %d\n", ringFd_);
+    int fd = pchannel->GetFd();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (channelMap_.end() == channelMap_.find(fd))
+        return;
+    std::map<int, ArmedPoll>::iterator iter = armed_.find(fd);
+    if (armed_.end() != iter)
+    {
+        ArmedPoll &armed = iter->second;
+        armed.removing = true;
+        if (armed.completionData)
+            CancelCompletion(fd, armed.completionData);
+        while (armed.completionData && OnLoopThread())
+        {
+            if (Enter(Unsubmitted(), 1, IORING_ENTER_GETEVENTS | WakeUpFlag()) < 0 && EINTR != errno && EBUSY != errno)
+            {
+                LOG(LoggerLevel::ERROR, "等待取消io_uring请求失败，errno：%d，sockfd：%d，ringFd: %d\n", errno, fd, ringFd_);
+                break;
+            }
+            Reap();
+        }
+        CancelPoll(fd);
+        if (armed.round == round_)
+            readyFds_[armed.index] = -1;
+        armed_.erase(iter);
+    }
+    channelMap_.erase(fd);
+    if (!OnLoopThread())
+        Flush();
+}
+
+/*
+ * 更新Channel对应连接的监听事件，事件未变化时不提交
+ * 所有者取走暂存数据后经此恢复暂停的recv，被取消的recv尚未结束时由其最后的完成项重新提交
+ *
+ */
+void UringPoller::UpdateChannel(Channel *pchannel)
+{
+    LOG(LoggerLevel::INFO, "函数触发，ringFd: %d\n", ringFd_);
+    int fd = pchannel->GetFd();
+    uint32_t events = PollEvents(pchannel);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<int, ArmedPoll>::iterator iter = armed_.find(fd);
+    if (armed_.end() == iter)
+    {
+        LOG(LoggerLevel::ERROR, "io_uring更新未监听的Channel，sockfd：%d，ringFd: %d\n", fd, ringFd_);
+        return;
+    }
+    bool changed = false;
+    size_t limit = pchannel->RecvLimit() ? pchannel->RecvLimit() : URING_RECV_PENDING_MAX;
+    if (pchannel->RecvPaused() && pchannel->Received().size() < limit)
+    {
+        pchannel->SetRecvPaused(false);
+        if (0 == iter->second.completionData && 0 == pchannel->RecvStatus() && pchannel->CompletionActive())
+        {
+            ArmCompletion(fd, pchannel);
+            changed = true;
+        }
+    }
+    if (iter->second.events != events)
+    {
+        CancelPoll(fd);
+        ArmPoll(fd, events);
+        changed = true;
+    }
+    if (changed && !OnLoopThread())
+        Flush();
+}
+
+/*
+ * 记录fd本轮的事件，同一fd在本轮的多个完成项合并为一次事件
+ *
+ */
+void UringPoller::MarkReady(int fd, uint32_t events)
+{
+    ArmedPoll &armed = armed_[fd];
+    if (armed.round == round_)
+    {
+        revents_[armed.index] |= events;
+        return;
+    }
+    armed.round = round_;
+    armed.index = readyFds_.size();
+    readyFds_.push_back(fd);
+    revents_.push_back(events);
+}
+
+/*
+ * 处理accept/recv的完成项
+ * 新连接暂存在Channel并通知EPOLLIN；数据复制进Channel后立即归还缓冲区，暂存达到上限时暂停并取消recv
+ * recv返回0或出错时记录结束状态并通知EPOLLIN，由所有者的读处理函数关闭连接
+ * 请求结束（完成项不带IORING_CQE_F_MORE）且Channel未移除、未暂停、未结束时重新提交
+ *
+ */
+void UringPoller::ReapCompletion(const struct io_uring_cqe &cqe)
+{
+    int fd = (int)(cqe.user_data >> 32);
+    bool accept = (uint32_t)cqe.user_data & URING_ACCEPT_BIT;
+    std::map<int, ArmedPoll>::iterator iter = armed_.find(fd);
+    std::map<int, Channel *>::const_iterator channel = channelMap_.find(fd);
+    if (armed_.end() == iter || iter->second.completionData != cqe.user_data || channelMap_.end() == channel)
+    {
+        // 已取消或已移除的请求
+        if (accept && cqe.res >= 0)
+            close(cqe.res);
+        if (cqe.flags & IORING_CQE_F_BUFFER)
+            RecycleBuffer((uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+        return;
+    }
+    Channel *pchannel = channel->second;
+    if (cqe.flags & IORING_CQE_F_BUFFER)
+    {
+        uint16_t bid = (uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (cqe.res > 0)
+            pchannel->Received().append(bufMem_ + (size_t)bid * URING_BUF_SIZE, cqe.res);
+        RecycleBuffer(bid);
+    }
+    if (accept)
+    {
+        if (cqe.res >= 0)
+        {
+            pchannel->AddAccepted(cqe.res);
+            MarkReady(fd, EPOLLIN);
+        }
+        else if (-ECANCELED != cqe.res)
+            FallBack(fd, pchannel, cqe.res); // 如EMFILE，由TcpServer按就绪通知自行accept处理
+    }
+    else if (cqe.res > 0)
+    {
+        MarkReady(fd, EPOLLIN);
+        size_t limit = pchannel->RecvLimit() ? pchannel->RecvLimit() : URING_RECV_PENDING_MAX;
+        if (!pchannel->RecvPaused() && pchannel->Received().size() >= limit)
+        {
+            pchannel->SetRecvPaused(true);
+            if (cqe.flags & IORING_CQE_F_MORE)
+                CancelCompletion(fd, cqe.user_data);
+        }
+    }
+    else if (0 == cqe.res)
+    {
+        pchannel->SetRecvStatus(Channel::RECV_CLOSED);
+        MarkReady(fd, EPOLLIN);
+    }
+    else if (-EINVAL == cqe.res || -EOPNOTSUPP == cqe.res)
+        FallBack(fd, pchannel, cqe.res);
+    else if (-ENOBUFS != cqe.res && -ECANCELED != cqe.res)
+    {
+        pchannel->SetRecvStatus(cqe.res);
+        MarkReady(fd, EPOLLIN);
+    }
+    if (cqe.flags & IORING_CQE_F_MORE)
+        return;
+    ArmedPoll &armed = iter->second;
+    armed.completionData = 0;
+    if (!armed.removing && pchannel->CompletionActive() && !pchannel->RecvPaused() && 0 == pchannel->RecvStatus())
+        ArmCompletion(fd, pchannel);
+}
+
+/*
+ * 处理完成队列中的全部完成项，结束时发布归还的缓冲区
+ * 完成项不带IORING_CQE_F_MORE时poll已结束（水平触发的单次poll，或多次触发的poll因完成队列溢出而终止），重新添加
+ *
+ */
+void UringPoller::Reap()
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const struct io_uring_cqe &cqe = cqes_[head & cqMask_];
+        // POLL_REMOVE与ASYNC_CANCEL的完成项
+        if (0 == (uint32_t)cqe.user_data)
+            continue;
+        if ((uint32_t)cqe.user_data & URING_COMPLETION_BIT)
+        {
+            ReapCompletion(cqe);
+            continue;
+        }
+        int fd = (int)(cqe.user_data >> 32);
+        std::map<int, ArmedPoll>::iterator iter = armed_.find(fd);
+        // 已被替换、移除的poll
+        if (armed_.end() == iter || iter->second.userData != cqe.user_data || channelMap_.end() == channelMap_.find(fd))
+            continue;
+        if (cqe.res < 0)
+        {
+            // 不再重新添加，交由Channel的错误处理函数关闭连接
+            LOG(LoggerLevel::ERROR, "io_uring poll失败，res：%d，sockfd：%d，ringFd: %d\n", cqe.res, fd, ringFd_);
+            iter->second.userData = 0;
+            MarkReady(fd, EPOLLERR);
+            continue;
+        }
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+            ArmPoll(fd, iter->second.events);
+        MarkReady(fd, (uint32_t)cqe.res);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    if (bufRing_ != MAP_FAILED)
+        __atomic_store_n(&bufRing_->tail, bufTail_, __ATOMIC_RELEASE);
+}
+
+/*
+ * 提交本轮积累的变更并等待完成项，最多等待timeoutMs毫秒，与epoll_wait一致
+ * 完成队列已有未处理项、移除Channel时已处理出本轮事件或timeoutMs为0时不等待
+ *
+ */
+void UringPoller::poll(ChannelList &activeChannelList, int timeoutMs)
+{
+    unsigned toSubmit = 0;
+    unsigned flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pollThread_ = std::this_thread::get_id();
+        if (sqpoll_)
+            flags |= WakeUpFlag();
+        else
+            toSubmit = Unsubmitted();
+        if (!readyFds_.empty())
+            flags &= ~IORING_ENTER_GETEVENTS;
+    }
+    if (timeoutMs <= 0 || *cqHead_ != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE))
+        flags &= ~IORING_ENTER_GETEVENTS;
+    if ((flags & IORING_ENTER_GETEVENTS) || (flags & IORING_ENTER_SQ_WAKEUP) || toSubmit)
+    {
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        if (Enter(toSubmit, 1, flags, &arg, sizeof(arg)) < 0 && ETIME != errno && EINTR != errno && EBUSY != errno)
+            perror("io_uring enter error");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Reap();
+    size_t count = 0;
+    for (size_t i = 0; i < readyFds_.size(); ++i)
+    {
+        std::map<int, Channel *>::const_iterator channel = channelMap_.find(readyFds_[i]);
+        if (readyFds_[i] < 0 || channelMap_.end() == channel)
+            continue;
+        channel->second->SetEvents(revents_[i]);
+        activeChannelList.push_back(channel->second);
+        ++count;
+    }
+    if (count)
+        LOG(LoggerLevel::INFO, "Poller监听到%d个已连接客户端的事件待处理，ringFd: %d\n", (int)count, ringFd_);
+    readyFds_.clear();
+    revents_.clear();
+    ++round_;
+}
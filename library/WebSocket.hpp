@@ -0,0 +1,626 @@
+// WebSocket类：
+//  WebSocket（RFC 6455）协议工具类，负责握手校验与Sec-WebSocket-Accept计算、帧的编码、掩码解除与UTF-8校验
+//  掩码解除在支持SSE2时每次处理16字节，否则按8字节整字异或，剩余字节逐个处理
+// WebSocketSession类：
+//  单个连接的WebSocket会话，负责帧解析、分片消息重组、ping/pong与关闭握手
+//  会话只处理协议本身，不直接读写套接字：输入为TcpConnection收到的字节，输出通过outputCallback_交给TcpConnection发送
+//  完整的文本或二进制消息通过messageCallback_交出，控制帧在会话内部处理
+//  不支持任何扩展（permessage-deflate等），RSV位非0的帧视为协议错误
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <strings.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "LogServer.hpp"
+
+#define WEBSOCKET_MAX_MESSAGE_SIZE (16 * 1024 * 1024) // 单条消息（含全部分片）的大小上限
+#define WEBSOCKET_PING_INTERVAL 30000                 // 缺省ping间隔，毫秒
+
+class WebSocket
+{
+public:
+    // 帧操作码
+    enum Opcode
+    {
+        OPCODE_CONTINUATION = 0x0,
+        OPCODE_TEXT = 0x1,
+        OPCODE_BINARY = 0x2,
+        OPCODE_CLOSE = 0x8,
+        OPCODE_PING = 0x9,
+        OPCODE_PONG = 0xA
+    };
+    // 关闭状态码
+    enum CloseCode
+    {
+        CLOSE_NORMAL = 1000,
+        CLOSE_GOING_AWAY = 1001,
+        CLOSE_PROTOCOL_ERROR = 1002,
+        CLOSE_UNSUPPORTED_DATA = 1003,
+        CLOSE_NO_STATUS = 1005,
+        CLOSE_INVALID_PAYLOAD = 1007,
+        CLOSE_POLICY_VIOLATION = 1008,
+        CLOSE_MESSAGE_TOO_BIG = 1009,
+        CLOSE_INTERNAL_ERROR = 1011
+    };
+    static const std::string Guid; // 握手计算Sec-WebSocket-Accept使用的固定GUID
+    // 校验升级请求，成功时acceptKey为Sec-WebSocket-Accept响应值
+    static bool CheckHandshake(const std::string &method, const std::map<std::string, std::string> &header, std::string &acceptKey);
+    // 编码服务端帧（不加掩码）
+    static std::string EncodeFrame(Opcode opcode, const char *payload, size_t length, bool fin = true);
+    static std::string EncodeClose(uint16_t code, const std::string &reason); // 编码关闭帧
+    static void Unmask(char *data, size_t length, const uint8_t mask[4]);     // 原地解除掩码，data对应掩码偏移0
+    static bool IsValidUtf8(const char *data, size_t length);                 // UTF-8校验，拒绝过长编码、代理区与超出U+10FFFF的码点
+    static std::string Sha1(const std::string &data);                        // SHA-1摘要，返回20字节原始摘要
+    static std::string Base64Encode(const std::string &data);                 // 标准base64编码
+    static const std::string *FindHeader(const std::map<std::string, std::string> &header, const std::string &name); // 请求头名称不区分大小写查找
+    static bool HasToken(const std::string &value, const std::string &token); // 逗号分隔的值中是否含有token，不区分大小写
+
+};
+
+const std::string WebSocket::Guid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+/*
+ * 校验升级请求：GET方法、Upgrade: websocket、Connection含upgrade、版本13、16字节的Sec-WebSocket-Key
+ *
+ */
+bool WebSocket::CheckHandshake(const std::string &method, const std::map<std::string, std::string> &header, std::string &acceptKey)
+{
+    if ("GET" != method)
+        return false;
+    const std::string *upgrade = FindHeader(header, "Upgrade");
+    const std::string *connection = FindHeader(header, "Connection");
+    const std::string *version = FindHeader(header, "Sec-WebSocket-Version");
+    const std::string *key = FindHeader(header, "Sec-WebSocket-Key");
+    if (!upgrade || !HasToken(*upgrade, "websocket") || !connection || !HasToken(*connection, "upgrade"))
+        return false;
+    if (!version || "13" != *version)
+        return false;
+    // 16字节随机数的base64编码固定为24个字符，以"=="结尾
+    if (!key || 24 != key->size() || 0 != key->compare(22, 2, "=="))
+        return false;
+    acceptKey = Base64Encode(Sha1(*key + Guid));
+    return true;
+}
+
+/*
+ * 请求头名称不区分大小写查找
+ *
+ */
+const std::string *WebSocket::FindHeader(const std::map<std::string, std::string> &header, const std::string &name)
+{
+    for (const std::pair<const std::string, std::string> &item : header)
+    {
+        if (item.first.size() == name.size() && 0 == strncasecmp(item.first.c_str(), name.c_str(), name.size()))
+            return &item.second;
+    }
+    return nullptr;
+}
+
+/*
+ * 逗号分隔的值中是否含有token，不区分大小写，例如Connection: keep-alive, Upgrade
+ *
+ */
+bool WebSocket::HasToken(const std::string &value, const std::string &token)
+{
+    size_t prev = 0;
+    while (prev <= value.size())
+    {
+        size_t next = value.find(',', prev);
+        if (std::string::npos == next)
+            next = value.size();
+        size_t begin = value.find_first_not_of(" \t", prev);
+        if (std::string::npos != begin && begin < next)
+        {
+            size_t end = value.find_last_not_of(" \t", next - 1);
+            if (end - begin + 1 == token.size() && 0 == strncasecmp(value.c_str() + begin, token.c_str(), token.size()))
+                return true;
+        }
+        prev = next + 1;
+    }
+    return false;
+}
+
+/*
+ * 编码服务端帧，服务端发送的帧不加掩码
+ * 载荷长度小于126直接写入，不超过65535时以2字节扩展长度写入，否则以8字节扩展长度写入
+ *
+ */
+std::string WebSocket::EncodeFrame(Opcode opcode, const char *payload, size_t length, bool fin)
+{
+    std::string frame;
+    frame.reserve(length + 10);
+    frame.push_back((char)((fin ? 0x80 : 0x00) | opcode));
+    if (length < 126)
+    {
+        frame.push_back((char)length);
+    }
+    else if (length <= 0xffff)
+    {
+        frame.push_back((char)126);
+        frame.push_back((char)(length >> 8));
+        frame.push_back((char)(length & 0xff));
+    }
+    else
+    {
+        frame.push_back((char)127);
+        for (int shift = 56; shift >= 0; shift -= 8)
+            frame.push_back((char)((uint64_t)length >> shift & 0xff));
+    }
+    frame.append(payload, length);
+    return frame;
+}
+
+/*
+ * 编码关闭帧，code为0时不携带状态码
+ *
+ */
+std::string WebSocket::EncodeClose(uint16_t code, const std::string &reason)
+{
+    std::string payload;
+    if (code)
+    {
+        payload.push_back((char)(code >> 8));
+        payload.push_back((char)(code & 0xff));
+        // 控制帧载荷不超过125字节
+        payload.append(reason, 0, 123);
+    }
+    return EncodeFrame(OPCODE_CLOSE, payload.data(), payload.size());
+}
+
+/*
+ * 原地解除掩码
+ * 掩码以4字节为周期，16字节与8字节的整块起点均为4的倍数，因此整块内掩码始终从第0字节开始
+ *
+ */
+void WebSocket::Unmask(char *data, size_t length, const uint8_t mask[4])
+{
+    size_t i = 0;
+    uint32_t key;
+    memcpy(&key, mask, sizeof(key));
+#if defined(__SSE2__)
+    __m128i keyBlock = _mm_set1_epi32((int)key);
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_xor_si128(block, keyBlock));
+    }
+#endif
+    uint64_t key64 = ((uint64_t)key << 32) | key;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t block;
+        memcpy(&block, data + i, sizeof(block));
+        block ^= key64;
+        memcpy(data + i, &block, sizeof(block));
+    }
+    for (; i < length; ++i)
+        data[i] ^= mask[i & 3];
+}
+
+/*
+ * UTF-8校验
+ *
+ */
+bool WebSocket::IsValidUtf8(const char *data, size_t length)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    size_t i = 0;
+    while (i < length)
+    {
+        // ASCII快速路径，8字节一组检查最高位
+        if (i + 8 <= length)
+        {
+            uint64_t block;
+            memcpy(&block, p + i, sizeof(block));
+            if (0 == (block & 0x8080808080808080ULL))
+            {
+                i += 8;
+                continue;
+            }
+        }
+        unsigned char c = p[i];
+        if (c < 0x80)
+        {
+            ++i;
+            continue;
+        }
+        size_t count;
+        uint32_t codePoint, minimum;
+        if (0xC0 == (c & 0xE0))
+        {
+            count = 1;
+            codePoint = c & 0x1F;
+            minimum = 0x80;
+        }
+        else if (0xE0 == (c & 0xF0))
+        {
+            count = 2;
+            codePoint = c & 0x0F;
+            minimum = 0x800;
+        }
+        else if (0xF0 == (c & 0xF8))
+        {
+            count = 3;
+            codePoint = c & 0x07;
+            minimum = 0x10000;
+        }
+        else
+        {
+            return false;
+        }
+        if (i + count >= length)
+            return false;
+        for (size_t j = 1; j <= count; ++j)
+        {
+            if (0x80 != (p[i + j] & 0xC0))
+                return false;
+            codePoint = (codePoint << 6) | (p[i + j] & 0x3F);
+        }
+        if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+            return false;
+        i += count + 1;
+    }
+    return true;
+}
+
+/*
+ * SHA-1摘要（FIPS 180-4），仅用于握手计算Sec-WebSocket-Accept
+ *
+ */
+std::string WebSocket::Sha1(const std::string &data)
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string message = data;
+    uint64_t bitLength = (uint64_t)data.size() * 8;
+    message.push_back((char)0x80);
+    while (56 != message.size() % 64)
+        message.push_back((char)0x00);
+    for (int shift = 56; shift >= 0; shift -= 8)
+        message.push_back((char)(bitLength >> shift & 0xff));
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64)
+    {
+        uint32_t w[80];
+        const unsigned char *p = (const unsigned char *)message.data() + chunk;
+        for (int i = 0; i < 16; ++i)
+            w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 | (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+        for (int i = 16; i < 80; ++i)
+        {
+            uint32_t t = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+            w[i] = t << 1 | t >> 31;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = (a << 5 | a >> 27) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = b << 30 | b >> 2;
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    std::string digest;
+    for (int i = 0; i < 5; ++i)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            digest.push_back((char)(h[i] >> shift & 0xff));
+    }
+    return digest;
+}
+
+/*
+ * 标准base64编码
+ *
+ */
+std::string WebSocket::Base64Encode(const std::string &data)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    const unsigned char *p = (const unsigned char *)data.data();
+    size_t i = 0;
+    for (; i + 3 <= data.size(); i += 3)
+    {
+        uint32_t n = (uint32_t)p[i] << 16 | (uint32_t)p[i + 1] << 8 | p[i + 2];
+        out.push_back(table[n >> 18 & 0x3F]);
+        out.push_back(table[n >> 12 & 0x3F]);
+        out.push_back(table[n >> 6 & 0x3F]);
+        out.push_back(table[n & 0x3F]);
+    }
+    if (i < data.size())
+    {
+        uint32_t n = (uint32_t)p[i] << 16 | (i + 1 < data.size() ? (uint32_t)p[i + 1] << 8 : 0);
+        out.push_back(table[n >> 18 & 0x3F]);
+        out.push_back(table[n >> 12 & 0x3F]);
+        out.push_back(i + 1 < data.size() ? table[n >> 6 & 0x3F] : '=');
+        out.push_back('=');
+    }
+    return out;
+}
+
+class WebSocketSession
+{
+public:
+    // 完整消息回调：操作码（文本或二进制）、消息内容
+    typedef std::function<void(WebSocket::Opcode opcode, std::string &message)> MessageCallback;
+    // 输出回调：编码完成的帧
+    typedef std::function<void(std::string &frame)> OutputCallback;
+
+    WebSocketSession(const MessageCallback &messageCallback, const OutputCallback &outputCallback, size_t maxMessageSize = WEBSOCKET_MAX_MESSAGE_SIZE);
+    bool Feed(const char *data, size_t length);                // 输入收到的字节，连接需要关闭（关闭握手完成或协议错误）时返回false
+    bool Ping();                                               // 发送ping，上一次ping之后未收到任何数据时返回false，表示对端已失去响应
+    void Close(uint16_t code, const std::string &reason = ""); // 发起关闭握手，之后不再发送数据帧
+    bool CloseSent() const { return closeSent_; }              // 是否已发送关闭帧
+
+private:
+    MessageCallback messageCallback_; // 完整消息回调
+    OutputCallback outputCallback_;   // 输出回调
+    size_t maxMessageSize_;           // 单条消息大小上限
+    std::string inBuffer_;            // 未处理完的输入字节
+    std::string message_;             // 正在重组的分片消息
+    WebSocket::Opcode messageOpcode_; // 正在重组的消息的操作码
+    bool fragmented_;                 // 是否正在接收分片消息
+    bool closeSent_;                  // 是否已发送关闭帧
+    bool closeReceived_;              // 是否已收到关闭帧
+    bool awaitingPong_;               // 已发送ping且之后未收到任何数据
+
+    bool ProcessControl(uint8_t opcode, char *payload, size_t length);
+    bool ProcessData(uint8_t opcode, bool fin, char *payload, size_t length);
+    bool Fail(uint16_t code, const char *reason); // 协议错误，发送关闭帧并返回false
+    void Output(std::string frame);
+
+};
+
+WebSocketSession::WebSocketSession(const MessageCallback &messageCallback, const OutputCallback &outputCallback, size_t maxMessageSize)
+    : messageCallback_(messageCallback),
+      outputCallback_(outputCallback),
+      maxMessageSize_(maxMessageSize),
+      messageOpcode_(WebSocket::OPCODE_TEXT),
+      fragmented_(false),
+      closeSent_(false),
+      closeReceived_(false),
+      awaitingPong_(false)
+{
+}
+
+/*
+ * 输入收到的字节，解析所有完整的帧
+ * 帧头接收完整后即校验长度与标志，无需等待超长载荷到达即可拒绝
+ *
+ */
+bool WebSocketSession::Feed(const char *data, size_t length)
+{
+    if (closeReceived_)
+        return false;
+    inBuffer_.append(data, length);
+    size_t pos = 0;
+    bool healthy = true;
+    while (healthy)
+    {
+        size_t available = inBuffer_.size() - pos;
+        if (available < 2)
+            break;
+        const uint8_t *p = (const uint8_t *)inBuffer_.data() + pos;
+        bool fin = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = p[1] & 0x80;
+        uint64_t payloadLength = p[1] & 0x7F;
+        size_t headLength = 2;
+        if (126 == payloadLength)
+        {
+            if (available < 4)
+                break;
+            payloadLength = (uint64_t)p[2] << 8 | p[3];
+            headLength = 4;
+        }
+        else if (127 == payloadLength)
+        {
+            if (available < 10)
+                break;
+            payloadLength = 0;
+            for (int i = 0; i < 8; ++i)
+                payloadLength = payloadLength << 8 | p[2 + i];
+            headLength = 10;
+        }
+        if (p[0] & 0x70)
+        {
+            healthy = Fail(WebSocket::CLOSE_PROTOCOL_ERROR, "RSV位非0");
+            break;
+        }
+        if (!masked)
+        {
+            healthy = Fail(WebSocket::CLOSE_PROTOCOL_ERROR, "客户端帧未加掩码");
+            break;
+        }
+        if (opcode & 0x08)
+        {
+            if (!fin || payloadLength > 125)
+            {
+                healthy = Fail(WebSocket::CLOSE_PROTOCOL_ERROR, "控制帧分片或过长");
+                break;
+            }
+        }
+        else if (payloadLength > maxMessageSize_ || message_.size() + payloadLength > maxMessageSize_)
+        {
+            healthy = Fail(WebSocket::CLOSE_MESSAGE_TOO_BIG, "消息超出大小上限");
+            break;
+        }
+        if (available < headLength + 4 + payloadLength)
+            break;
+        uint8_t mask[4];
+        memcpy(mask, p + headLength, 4);
+        char *payload = &inBuffer_[pos + headLength + 4];
+        WebSocket::Unmask(payload, payloadLength, mask);
+        pos += headLength + 4 + payloadLength;
+        // 收到任何帧都说明对端仍有响应
+        awaitingPong_ = false;
+        if (opcode & 0x08)
+            healthy = ProcessControl(opcode, payload, payloadLength);
+        else
+            healthy = ProcessData(opcode, fin, payload, payloadLength);
+    }
+    inBuffer_.erase(0, pos);
+    return healthy && !closeReceived_;
+}
+
+/*
+ * 处理控制帧：ping回复pong，pong仅刷新存活状态，close回复关闭帧并结束会话
+ *
+ */
+bool WebSocketSession::ProcessControl(uint8_t opcode, char *payload, size_t length)
+{
+    switch (opcode)
+    {
+    case WebSocket::OPCODE_PING:
+        if (!closeSent_)
+            Output(WebSocket::EncodeFrame(WebSocket::OPCODE_PONG, payload, length));
+        return true;
+    case WebSocket::OPCODE_PONG:
+        return true;
+    case WebSocket::OPCODE_CLOSE:
+    {
+        uint16_t code = 0;
+        if (1 == length)
+            return Fail(WebSocket::CLOSE_PROTOCOL_ERROR, "关闭帧载荷长度为1");
+        if (length >= 2)
+        {
+            code = (uint16_t)((uint8_t)payload[0] << 8 | (uint8_t)payload[1]);
+            bool validCode = (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011) || (code >= 3000 && code <= 4999);
+            if (!validCode)
+                return Fail(WebSocket::CLOSE_PROTOCOL_ERROR, "关闭状态码无效");
+            if (!WebSocket::IsValidUtf8(payload + 2, length - 2))
+                return Fail(WebSocket::CLOSE_INVALID_PAYLOAD, "关闭原因不是有效的UTF-8");
+        }
+        LOG(LoggerLevel::INFO, "收到WebSocket关闭帧，状态码：%d\n", (int)code);
+        if (!closeSent_)
+        {
+            closeSent_ = true;
+            Output(WebSocket::EncodeClose(code, ""));
+        }
+        closeReceived_ = true;
+        return false;
+    }
+    default:
+        return Fail(WebSocket::CLOSE_PROTOCOL_ERROR, "未知的控制帧操作码");
+    }
+}
+
+/*
+ * 处理数据帧，重组分片消息
+ * 文本消息在接收完整后整体校验UTF-8
+ *
+ */
+bool WebSocketSession::ProcessData(uint8_t opcode, bool fin, char *payload, size_t length)
+{
+    if (WebSocket::OPCODE_CONTINUATION == opcode)
+    {
+        if (!fragmented_)
+            return Fail(WebSocket::CLOSE_PROTOCOL_ERROR, "没有待续接的分片消息");
+    }
+    else if (WebSocket::OPCODE_TEXT == opcode || WebSocket::OPCODE_BINARY == opcode)
+    {
+        if (fragmented_)
+            return Fail(WebSocket::CLOSE_PROTOCOL_ERROR, "分片消息未结束时收到新消息");
+        messageOpcode_ = (WebSocket::Opcode)opcode;
+    }
+    else
+    {
+        return Fail(WebSocket::CLOSE_PROTOCOL_ERROR, "未知的数据帧操作码");
+    }
+    message_.append(payload, length);
+    if (!fin)
+    {
+        fragmented_ = true;
+        return true;
+    }
+    fragmented_ = false;
+    if (WebSocket::OPCODE_TEXT == messageOpcode_ && !WebSocket::IsValidUtf8(message_.data(), message_.size()))
+        return Fail(WebSocket::CLOSE_INVALID_PAYLOAD, "文本消息不是有效的UTF-8");
+    // 发起关闭握手后收到的数据消息丢弃
+    if (!closeSent_)
+        messageCallback_(messageOpcode_, message_);
+    message_.clear();
+    return true;
+}
+
+/*
+ * 发送ping，上一次ping之后未收到任何数据时返回false
+ *
+ */
+bool WebSocketSession::Ping()
+{
+    if (awaitingPong_)
+        return false;
+    if (!closeSent_)
+    {
+        awaitingPong_ = true;
+        Output(WebSocket::EncodeFrame(WebSocket::OPCODE_PING, "", 0));
+    }
+    return true;
+}
+
+/*
+ * 发起关闭握手，等待对端回复关闭帧后由Feed返回false结束会话
+ *
+ */
+void WebSocketSession::Close(uint16_t code, const std::string &reason)
+{
+    if (closeSent_)
+        return;
+    closeSent_ = true;
+    Output(WebSocket::EncodeClose(code, reason));
+}
+
+/*
+ * 协议错误，发送关闭帧并返回false
+ *
+ */
+bool WebSocketSession::Fail(uint16_t code, const char *reason)
+{
+    LOG(LoggerLevel::ERROR, "WebSocket协议错误：%s，状态码：%d\n", reason, (int)code);
+    if (!closeSent_)
+    {
+        closeSent_ = true;
+        Output(WebSocket::EncodeClose(code, ""));
+    }
+    return false;
+}
+
+void WebSocketSession::Output(std::string frame)
+{
+    outputCallback_(frame);
+}
@@ -0,0 +1,285 @@
+// WebSocketServer类：
+//  WebSocket网络服务类，url格式为"/WebSocketService/函数名"，握手经TcpServer按url动态绑定后在本服务内完成升级
+//  升级后的连接不再经过http解析与函数绑定，收到的完整消息直接在连接所在的EventLoop线程回调注册的消息处理函数
+//  消息处理函数应尽快返回，耗时处理可交给线程池，再经TcpConnection::SendWebSocketFrame回复，该函数可跨线程调用
+//  连接可订阅任意主题，Broadcast向主题的所有订阅者发送消息，消息只编码一次，各连接共享同一份帧数据
+//  连接关闭时自动退订所有主题
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "TcpServer.hpp"
+#include "EventLoop.hpp"
+#include "LogServer.hpp"
+#include "WebSocket.hpp"
+#include "TcpConnection.hpp"
+
+class WebSocketServer
+{
+public:
+    typedef std::shared_ptr<TcpConnection> spTcpConnection;
+    typedef std::function<void(spTcpConnection &)> Callback;
+    typedef TcpConnection::WebSocketCallback MessageCallback; // 完整消息处理函数
+    WebSocketServer(EventLoop *loop, const int loopThreadNum = 0, const int port = 0, TcpServer *shareTcpServer = NULL);
+    ~WebSocketServer();
+    // 注册函数名对应的消息处理函数，onOpen在升级完成后调用，onClose在连接关闭时调用
+    void RegisterHandler(const std::string &handlerName, const MessageCallback &onMessage,
+                         const Callback &onOpen = nullptr, const Callback &onClose = nullptr);
+    void SetPingInterval(int pingIntervalMs);                                  // 设置ping间隔，0表示不发送ping
+    void Subscribe(const std::string &topic, spTcpConnection &sptcpconn);      // 连接订阅主题
+    void Unsubscribe(const std::string &topic, spTcpConnection &sptcpconn);    // 连接退订主题
+    // 向主题的所有订阅者发送消息，返回发送的连接数，可跨线程调用
+    size_t Broadcast(const std::string &topic, const std::string &payload, WebSocket::Opcode opcode = WebSocket::OPCODE_TEXT);
+
+private:
+    typedef struct _WebSocketHandler
+    {
+        MessageCallback onMessage; // 完整消息处理函数
+        Callback onOpen;           // 升级完成处理函数
+        Callback onClose;          // 连接关闭处理函数
+    } WebSocketHandler;
+    std::string serviceName_;
+    int loopThreadNum_;          // 默认为0，若有值则自行管理创建销毁一个TcpServerr对象，该对象也会自行管理eventLoopThreadPool线程池
+    int tcpServerPort_;          // tcpServer的EPOLL的服务端口
+    TcpServer *tcpserver_;       // 基础网络服务TcpServer
+    int pingIntervalMs_;         // ping间隔，毫秒
+    std::mutex mutex_;           // 保护handlers_与topics_
+    std::map<std::string, WebSocketHandler> handlers_;                                       // 函数名->处理函数
+    std::map<std::string, std::map<TcpConnection *, std::weak_ptr<TcpConnection>>> topics_; // 主题->订阅连接
+    void Upgrade(spTcpConnection &sptcpconn, const std::string &handlerName); // 校验握手请求并升级连接
+    void HttpError(spTcpConnection &sptcpconn, const int err_num, const std::string &short_msg);
+    void HandleMessage(spTcpConnection &sptcpconn);      // 处理升级请求
+    void HandleSendComplete(spTcpConnection &sptcpconn); // 数据发送完毕
+    void HandleClose(spTcpConnection &sptcpconn);        // 连接断开，退订所有主题并调用onClose
+    void HandleError(spTcpConnection &sptcpconn);        // 连接出错
+
+};
+
+WebSocketServer::WebSocketServer(EventLoop *loop, const int loopThreadNum, const int port, TcpServer *shareTcpServer)
+    : serviceName_("WebSocketService"),
+      loopThreadNum_(loopThreadNum),
+      tcpServerPort_(port),
+      tcpserver_(shareTcpServer ? shareTcpServer : new TcpServer(loop, tcpServerPort_, loopThreadNum)),
+      pingIntervalMs_(WEBSOCKET_PING_INTERVAL)
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    tcpserver_->RegisterHandler(serviceName_, TcpServer::ReadMessageHandler, std::bind(&WebSocketServer::HandleMessage, this, std::placeholders::_1));
+    tcpserver_->RegisterHandler(serviceName_, TcpServer::SendOverHandler, std::bind(&WebSocketServer::HandleSendComplete, this, std::placeholders::_1));
+    tcpserver_->RegisterHandler(serviceName_, TcpServer::CloseConnHandler, std::bind(&WebSocketServer::HandleClose, this, std::placeholders::_1));
+    tcpserver_->RegisterHandler(serviceName_, TcpServer::ErrorConnHandler, std::bind(&WebSocketServer::HandleError, this, std::placeholders::_1));
+}
+
+WebSocketServer::~WebSocketServer()
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    if (!tcpServerPort_)
+        return;
+    delete tcpserver_;
+}
+
+/*
+ * 注册函数名对应的消息处理函数
+ * 函数名同时注册到TcpServer，使"/WebSocketService/函数名"的握手请求可以绑定到本服务
+ *
+ */
+void WebSocketServer::RegisterHandler(const std::string &handlerName, const MessageCallback &onMessage,
+                                      const Callback &onOpen, const Callback &onClose)
+{
+    LOG(LoggerLevel::INFO, "注册WebSocket处理函数：%s\n", handlerName.c_str());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        WebSocketHandler &handler = handlers_[handlerName];
+        handler.onMessage = onMessage;
+        handler.onOpen = onOpen;
+        handler.onClose = onClose;
+    }
+    tcpserver_->RegisterHandler(serviceName_, handlerName, std::bind(&WebSocketServer::Upgrade, this, std::placeholders::_1, handlerName));
+}
+
+/*
+ * 设置ping间隔，只影响之后升级的连接
+ *
+ */
+void WebSocketServer::SetPingInterval(int pingIntervalMs)
+{
+    pingIntervalMs_ = pingIntervalMs;
+}
+
+/*
+ * 处理升级请求，在连接所在的EventLoop线程执行
+ * 升级后的连接不再回调本函数
+ *
+ */
+void WebSocketServer::HandleMessage(spTcpConnection &sptcpconn)
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    if (false == sptcpconn->GetReqHealthy())
+    {
+        HttpError(sptcpconn, 400, "Bad request");
+        return;
+    }
+    try
+    {
+        sptcpconn->GetReqHandler()(sptcpconn);
+    }
+    catch (std::bad_function_call)
+    {
+        LOG(LoggerLevel::ERROR, "执行sptcpconn的绑定函数报错：std::bad_function_call，连接绑定函数异常，sockfd：%d\n", sptcpconn->fd());
+    }
+}
+
+/*
+ * 校验握手请求并升级连接
+ * 没有Upgrade头部的普通请求返回426，握手头部不完整返回400
+ *
+ */
+void WebSocketServer::Upgrade(spTcpConnection &sptcpconn, const std::string &handlerName)
+{
+    LOG(LoggerLevel::INFO, "函数触发，处理函数：%s，sockfd：%d\n", handlerName.c_str(), sptcpconn->fd());
+    WebSocketHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handler = handlers_[handlerName];
+    }
+    if (!WebSocket::FindHeader(sptcpconn->GetReqestBuffer().header, "Upgrade"))
+    {
+        HttpError(sptcpconn, 426, "Upgrade Required");
+        return;
+    }
+    if (!sptcpconn->UpgradeWebSocket(handler.onMessage, pingIntervalMs_))
+    {
+        HttpError(sptcpconn, 400, "Bad request");
+        return;
+    }
+    if (handler.onOpen)
+        handler.onOpen(sptcpconn);
+}
+
+/*
+ * 连接订阅主题
+ *
+ */
+void WebSocketServer::Subscribe(const std::string &topic, spTcpConnection &sptcpconn)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    topics_[topic][sptcpconn.get()] = sptcpconn;
+}
+
+/*
+ * 连接退订主题
+ *
+ */
+void WebSocketServer::Unsubscribe(const std::string &topic, spTcpConnection &sptcpconn)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, std::map<TcpConnection *, std::weak_ptr<TcpConnection>>>::iterator iter = topics_.find(topic);
+    if (topics_.end() == iter)
+        return;
+    iter->second.erase(sptcpconn.get());
+    if (iter->second.empty())
+        topics_.erase(iter);
+}
+
+/*
+ * 向主题的所有订阅者发送消息
+ * 帧只编码一次，各连接通过shared_ptr共享，订阅列表在锁内复制后再逐个投递到各连接的EventLoop线程
+ *
+ */
+size_t WebSocketServer::Broadcast(const std::string &topic, const std::string &payload, WebSocket::Opcode opcode)
+{
+    std::vector<spTcpConnection> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, std::map<TcpConnection *, std::weak_ptr<TcpConnection>>>::iterator iter = topics_.find(topic);
+        if (topics_.end() == iter)
+            return 0;
+        subscribers.reserve(iter->second.size());
+        for (std::pair<TcpConnection *const, std::weak_ptr<TcpConnection>> &subscriber : iter->second)
+        {
+            spTcpConnection sptcpconn = subscriber.second.lock();
+            if (sptcpconn)
+                subscribers.push_back(sptcpconn);
+        }
+    }
+    if (subscribers.empty())
+        return 0;
+    std::shared_ptr<const std::string> frame = std::make_shared<const std::string>(WebSocket::EncodeFrame(opcode, payload.data(), payload.size()));
+    for (spTcpConnection &sptcpconn : subscribers)
+        sptcpconn->SendWebSocketFrame(frame);
+    LOG(LoggerLevel::INFO, "广播消息，主题：%s，订阅连接数：%d，帧长度：%d\n", topic.c_str(), (int)subscribers.size(), (int)frame->size());
+    return subscribers.size();
+}
+
+/*
+ * 处理错误请求，返回错误描述
+ *
+ */
+void WebSocketServer::HttpError(spTcpConnection &sptcpconn, const int err_num, const std::string &short_msg)
+{
+    LOG(LoggerLevel::INFO, "%s，sockfd：%d\n", "函数触发", sptcpconn->fd());
+    std::string &responsecontext = sptcpconn->GetBufferOut();
+    responsecontext.clear();
+    std::string responsebody = std::to_string(err_num) + " " + short_msg + "\n";
+    responsecontext += "HTTP/1.1 " + std::to_string(err_num) + " " + short_msg + "\r\n";
+    responsecontext += "Server: Qiu Hai's NetServer/WebSocketService\r\n";
+    if (426 == err_num)
+    {
+        responsecontext += "Upgrade: websocket\r\n";
+        responsecontext += "Connection: Upgrade\r\n";
+    }
+    responsecontext += "Sec-WebSocket-Version: 13\r\n";
+    responsecontext += "Content-Type: text/plain\r\n";
+    responsecontext += "Content-Length: " + std::to_string(responsebody.size()) + "\r\n\r\n";
+    responsecontext += responsebody;
+    sptcpconn->SendBufferOut();
+}
+
+/*
+ * WebSocketServer模式数据发送客户端完毕
+ *
+ */
+void WebSocketServer::HandleSendComplete(spTcpConnection &sptcpconn)
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+}
+
+/*
+ * WebSocketServer模式处理连接断开
+ * 退订所有主题，已升级的连接调用对应函数名的onClose
+ *
+ */
+void WebSocketServer::HandleClose(spTcpConnection &sptcpconn)
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+    Callback onClose;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::map<std::string, std::map<TcpConnection *, std::weak_ptr<TcpConnection>>>::iterator iter = topics_.begin(); iter != topics_.end();)
+        {
+            iter->second.erase(sptcpconn.get());
+            if (iter->second.empty())
+                iter = topics_.erase(iter);
+            else
+                ++iter;
+        }
+        std::map<std::string, WebSocketHandler>::iterator handler = handlers_.find(sptcpconn->GetReqestBuffer().handlerName);
+        if (sptcpconn->IsWebSocket() && handlers_.end() != handler)
+            onClose = handler->second.onClose;
+    }
+    if (onClose)
+        onClose(sptcpconn);
+}
+
+/*
+ * WebSocketServer模式处理连接出错
+ *
+ */
+void WebSocketServer::HandleError(spTcpConnection &sptcpconn)
+{
+    LOG(LoggerLevel::INFO, "%s\n", "函数触发");
+}
@@ -6,8 +6,12 @@
 #ifndef JSON_ALLOCATOR_H_INCLUDED
 #define JSON_ALLOCATOR_H_INCLUDED
 
+#include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <new>
+#include <type_traits>
 
 #pragma pack(push)
 #pragma pack()
@@ -82,6 +86,136 @@ bool operator!=(const SecureAllocator<T>&, const SecureAllocator<U>&) {
   return false;
 }
 
+/** \brief Monotonic (bump) arena.
+ *
+ * Memory is carved out of large blocks and is never freed individually;
+ * reset() rewinds every block so that a warmed-up arena serves subsequent
+ * documents without touching the heap.  Intended to be kept per thread and
+ * reset per request.  Objects placed in the arena must be trivially
+ * destructible, no destructor is ever run.
+ */
+class MonotonicArena {
+public:
+  explicit MonotonicArena(size_t blockSize = 4096) : blockSize_(blockSize) {}
+  ~MonotonicArena() {
+    while (head_ != nullptr) {
+      Block* next = head_->next;
+      std::free(head_);
+      head_ = next;
+    }
+  }
+  MonotonicArena(const MonotonicArena&) = delete;
+  MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+  /**
+   * Allocate \c bytes aligned on \c align (power of two).
+   * \throw std::bad_alloc when the system is out of memory.
+   */
+  void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+    for (;;) {
+      if (current_ != nullptr) {
+        size_t offset = (current_->used + align - 1) & ~(align - 1);
+        if (offset + bytes <= current_->size) {
+          current_->used = offset + bytes;
+          return current_->data() + offset;
+        }
+        if (current_->next != nullptr) {
+          // reuse blocks kept by reset()
+          current_ = current_->next;
+          current_->used = 0;
+          continue;
+        }
+      }
+      grow(bytes + align);
+    }
+  }
+
+  template <typename T> T* create() {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "arena objects are never destroyed");
+    return ::new (allocate(sizeof(T), alignof(T))) T();
+  }
+
+  /// Rewind all blocks; previously returned pointers become invalid.
+  void reset() {
+    current_ = head_;
+    if (current_ != nullptr)
+      current_->used = 0;
+  }
+
+  /// Total bytes reserved from the heap.
+  size_t capacity() const {
+    size_t total = 0;
+    for (Block* b = head_; b != nullptr; b = b->next)
+      total += b->size;
+    return total;
+  }
+
+private:
+  struct Block {
+    Block* next;
+    size_t size;
+    size_t used;
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+  };
+
+  void grow(size_t minSize) {
+    size_t size = blockSize_ > minSize ? blockSize_ : minSize;
+    Block* block = static_cast<Block*>(std::malloc(sizeof(Block) + size));
+    if (block == nullptr)
+      throw std::bad_alloc();
+    block->next = nullptr;
+    block->size = size;
+    block->used = 0;
+    // chain after the current block so reset() reuses blocks in order
+    if (current_ == nullptr) {
+      block->next = head_;
+      head_ = block;
+    } else {
+      block->next = current_->next;
+      current_->next = block;
+    }
+    current_ = block;
+  }
+
+  Block* head_{nullptr};
+  Block* current_{nullptr};
+  size_t blockSize_;
+};
+
+/** \brief STL allocator drawing from a MonotonicArena.
+ *
+ * deallocate() is a no-op, memory returns to the arena on reset().
+ */
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+
+  explicit ArenaAllocator(MonotonicArena& arena) : arena_(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T*, size_t) {}
+
+  MonotonicArena* arena() const { return arena_; }
+
+private:
+  MonotonicArena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() != b.arena();
+}
+
 } // namespace Json
 
 #pragma pack(pop)
@@ -12,6 +12,7 @@
 #endif // if !defined(JSON_IS_AMALGAMATION)
 #include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <cmath>
 #include <cstring>
 #include <iostream>
@@ -23,6 +24,12 @@
 #include <utility>
 
 #include <cstdio>
+#if (defined(__GNUC__) || defined(__clang__)) &&                              \
+    (defined(__x86_64__) || defined(__i386__))
+#define JSONCPP_SIMD_SCAN 1
+#include <immintrin.h>
+#endif
+
 #if __cplusplus >= 201103L
 
 #if !defined(sscanf)
@@ -59,6 +66,145 @@ using CharReaderPtr = std::unique_ptr<CharReader>;
 using CharReaderPtr = std::auto_ptr<CharReader>;
 #endif
 
+// SIMD scanning
+// ////////////////////////////////
+//
+// Outside of number parsing the readers mostly look for two things: the end
+// of a whitespace run and the next '"' or '\\' inside a string.  Both
+// searches are vectorized; the widest implementation the CPU supports is
+// picked once at runtime, with a portable scalar fallback.
+
+namespace {
+
+inline bool isJsonSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+char const* skipSpacesScalar(char const* p, char const* end) {
+  while (p != end && isJsonSpace(*p))
+    ++p;
+  return p;
+}
+
+char const* findStringSpecialScalar(char const* p, char const* end) {
+  while (p != end && *p != '"' && *p != '\\')
+    ++p;
+  return p;
+}
+
+#if defined(JSONCPP_SIMD_SCAN)
+__attribute__((target("sse4.2"))) char const*
+skipSpacesSse42(char const* p, char const* end) {
+  const __m128i spaces = _mm_setr_epi8(' ', '\t', '\r', '\n', 0, 0, 0, 0, 0,
+                                       0, 0, 0, 0, 0, 0, 0);
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int index = _mm_cmpestri(spaces, 4, chunk, 16,
+                             _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY |
+                                 _SIDD_MASKED_NEGATIVE_POLARITY);
+    if (index != 16)
+      return p + index;
+    p += 16;
+  }
+  return skipSpacesScalar(p, end);
+}
+
+__attribute__((target("sse4.2"))) char const*
+findStringSpecialSse42(char const* p, char const* end) {
+  const __m128i specials =
+      _mm_setr_epi8('"', '\\', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int index = _mm_cmpestri(specials, 2, chunk, 16,
+                             _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+    if (index != 16)
+      return p + index;
+    p += 16;
+  }
+  return findStringSpecialScalar(p, end);
+}
+
+__attribute__((target("avx2"))) char const* skipSpacesAvx2(char const* p,
+                                                            char const* end) {
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  while (end - p >= 32) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i ws = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space),
+                        _mm256_cmpeq_epi8(chunk, tab)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, cr),
+                        _mm256_cmpeq_epi8(chunk, lf)));
+    unsigned int mask = ~static_cast<unsigned int>(_mm256_movemask_epi8(ws));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return skipSpacesScalar(p, end);
+}
+
+__attribute__((target("avx2"))) char const*
+findStringSpecialAvx2(char const* p, char const* end) {
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  while (end - p >= 32) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                        _mm256_cmpeq_epi8(chunk, backslash))));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return findStringSpecialScalar(p, end);
+}
+#endif // if defined(JSONCPP_SIMD_SCAN)
+
+struct Scanner {
+  char const* (*skipSpaces)(char const*, char const*);
+  char const* (*findStringSpecial)(char const*, char const*);
+  const char* name;
+};
+
+Scanner detectScanner() {
+#if defined(JSONCPP_SIMD_SCAN)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return {skipSpacesAvx2, findStringSpecialAvx2, "avx2"};
+  if (__builtin_cpu_supports("sse4.2"))
+    return {skipSpacesSse42, findStringSpecialSse42, "sse4.2"};
+#endif
+  return {skipSpacesScalar, findStringSpecialScalar, "scalar"};
+}
+
+Scanner& scanner() {
+  static Scanner current = detectScanner();
+  return current;
+}
+
+// Single spaces between tokens are the common case, only runs of two or
+// more go through the vector scanner.
+inline char const* skipJsonSpaces(char const* p, char const* end) {
+  if (p == end || !isJsonSpace(*p))
+    return p;
+  ++p;
+  if (p == end || !isJsonSpace(*p))
+    return p;
+  return scanner().skipSpaces(p + 1, end);
+}
+
+} // namespace
+
+const char* getScannerName() { return scanner().name; }
+
+void setScalarScanner(bool scalar) {
+  scanner() = scalar ? Scanner{skipSpacesScalar, findStringSpecialScalar,
+                               "scalar"}
+                     : detectScanner();
+}
+
 // Implementation of class Features
 // ////////////////////////////////
 
@@ -306,15 +452,7 @@ bool Reader::readToken(Token& token) {
   return ok;
 }
 
-void Reader::skipSpaces() {
-  while (current_ != end_) {
-    Char c = *current_;
-    if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
-      ++current_;
-    else
-      break;
-  }
-}
+void Reader::skipSpaces() { current_ = skipJsonSpaces(current_, end_); }
 
 bool Reader::match(const Char* pattern, int patternLength) {
   if (end_ - current_ < patternLength)
@@ -429,15 +567,16 @@ void Reader::readNumber() {
 }
 
 bool Reader::readString() {
-  Char c = '\0';
-  while (current_ != end_) {
-    c = getNextChar();
-    if (c == '\\')
-      getNextChar();
-    else if (c == '"')
-      break;
+  for (;;) {
+    current_ = scanner().findStringSpecial(current_, end_);
+    if (current_ == end_)
+      return false;
+    if (*current_++ == '"')
+      return true;
+    // skip the escaped character
+    if (current_ != end_)
+      ++current_;
   }
-  return c == '"';
 }
 
 bool Reader::readObject(Token& token) {
@@ -630,6 +769,10 @@ bool Reader::decodeString(Token& token, String& decoded) {
   Location current = token.start_ + 1; // skip '"'
   Location end = token.end_ - 1;       // do not include '"'
   while (current != end) {
+    Location special = scanner().findStringSpecial(current, end);
+    decoded.append(current, special);
+    if ((current = special) == end)
+      break;
     Char c = *current++;
     if (c == '"')
       break;
@@ -1266,15 +1409,7 @@ bool OurReader::readToken(Token& token) {
   return ok;
 }
 
-void OurReader::skipSpaces() {
-  while (current_ != end_) {
-    Char c = *current_;
-    if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
-      ++current_;
-    else
-      break;
-  }
-}
+void OurReader::skipSpaces() { current_ = skipJsonSpaces(current_, end_); }
 
 void OurReader::skipBom(bool skipBom) {
   // The default behavior is to skip BOM.
@@ -1420,15 +1555,16 @@ bool OurReader::readNumber(bool checkInf) {
   return true;
 }
 bool OurReader::readString() {
-  Char c = 0;
-  while (current_ != end_) {
-    c = getNextChar();
-    if (c == '\\')
-      getNextChar();
-    else if (c == '"')
-      break;
+  for (;;) {
+    current_ = scanner().findStringSpecial(current_, end_);
+    if (current_ == end_)
+      return false;
+    if (*current_++ == '"')
+      return true;
+    // skip the escaped character
+    if (current_ != end_)
+      ++current_;
   }
-  return c == '"';
 }
 
 bool OurReader::readStringSingleQuote() {
@@ -1682,6 +1818,10 @@ bool OurReader::decodeString(Token& token, String& decoded) {
   Location current = token.start_ + 1; // skip '"'
   Location end = token.end_ - 1;       // do not include '"'
   while (current != end) {
+    Location special = scanner().findStringSpecial(current, end);
+    decoded.append(current, special);
+    if ((current = special) == end)
+      break;
     Char c = *current++;
     if (c == '"')
       break;
@@ -2001,4 +2141,399 @@ IStream& operator>>(IStream& sin, Value& root) {
   return sin;
 }
 
+// Implementation of class InSituValue
+// ////////////////////////////////
+
+bool InSituValue::getString(char const** begin, char const** end) const {
+  if (type_ != stringValue)
+    return false;
+  *begin = text_;
+  *end = text_ + length_;
+  return true;
+}
+
+String InSituValue::asString() const {
+  return type_ == stringValue ? String(text_, length_) : String();
+}
+
+bool InSituValue::asBool() const {
+  switch (type_) {
+  case booleanValue:
+    return number_.bool_;
+  case intValue:
+    return number_.int_ != 0;
+  case uintValue:
+    return number_.uint_ != 0;
+  case realValue:
+    return number_.real_ != 0.0;
+  default:
+    return false;
+  }
+}
+
+Int64 InSituValue::asInt64() const {
+  switch (type_) {
+  case booleanValue:
+    return number_.bool_ ? 1 : 0;
+  case intValue:
+    return number_.int_;
+  case uintValue:
+    return static_cast<Int64>(number_.uint_);
+  case realValue:
+    return static_cast<Int64>(number_.real_);
+  default:
+    return 0;
+  }
+}
+
+UInt64 InSituValue::asUInt64() const {
+  switch (type_) {
+  case booleanValue:
+    return number_.bool_ ? 1 : 0;
+  case intValue:
+    return static_cast<UInt64>(number_.int_);
+  case uintValue:
+    return number_.uint_;
+  case realValue:
+    return static_cast<UInt64>(number_.real_);
+  default:
+    return 0;
+  }
+}
+
+double InSituValue::asDouble() const {
+  switch (type_) {
+  case booleanValue:
+    return number_.bool_ ? 1.0 : 0.0;
+  case intValue:
+    return static_cast<double>(number_.int_);
+  case uintValue:
+    return static_cast<double>(number_.uint_);
+  case realValue:
+    return number_.real_;
+  default:
+    return 0.0;
+  }
+}
+
+bool InSituValue::getMemberName(char const** begin, char const** end) const {
+  if (name_ == nullptr)
+    return false;
+  *begin = name_;
+  *end = name_ + nameLength_;
+  return true;
+}
+
+const InSituValue* InSituValue::find(char const* begin,
+                                     char const* end) const {
+  if (type_ != objectValue)
+    return nullptr;
+  size_t length = static_cast<size_t>(end - begin);
+  const InSituValue* found = nullptr;
+  for (const InSituValue* member = child_; member != nullptr;
+       member = member->next_) {
+    if (member->nameLength_ == length &&
+        memcmp(member->name_, begin, length) == 0)
+      found = member;
+  }
+  return found;
+}
+
+const InSituValue* InSituValue::find(const char* key) const {
+  return find(key, key + strlen(key));
+}
+
+// Implementation of class InSituReader
+// ////////////////////////////////
+
+const InSituValue* InSituReader::parse(char* begin, char* end) {
+  begin_ = current_ = begin;
+  end_ = end;
+  error_ = nullptr;
+  errorPos_ = nullptr;
+  InSituValue* root = arena_.create<InSituValue>();
+  if (!readValue(*root, 0))
+    return nullptr;
+  skipSpaces();
+  if (current_ != end_) {
+    fail("Extra non-whitespace after JSON value.");
+    return nullptr;
+  }
+  return root;
+}
+
+bool InSituReader::readValue(InSituValue& value, unsigned depth) {
+  skipSpaces();
+  if (current_ == end_)
+    return fail("Syntax error: value, object or array expected.");
+  switch (*current_) {
+  case '{':
+    if (depth >= maxDepth_)
+      return fail("Exceeded stack limit while parsing.");
+    return readObject(value, depth + 1);
+  case '[':
+    if (depth >= maxDepth_)
+      return fail("Exceeded stack limit while parsing.");
+    return readArray(value, depth + 1);
+  case '"':
+    value.type_ = stringValue;
+    return readString(&value.text_, &value.length_);
+  case 't':
+    value.type_ = booleanValue;
+    value.number_.bool_ = true;
+    return readLiteral("true", 4);
+  case 'f':
+    value.type_ = booleanValue;
+    value.number_.bool_ = false;
+    return readLiteral("false", 5);
+  case 'n':
+    value.type_ = nullValue;
+    return readLiteral("null", 4);
+  default:
+    return readNumber(value);
+  }
+}
+
+bool InSituReader::readObject(InSituValue& value, unsigned depth) {
+  ++current_;
+  value.type_ = objectValue;
+  skipSpaces();
+  if (current_ != end_ && *current_ == '}') {
+    ++current_;
+    return true;
+  }
+  InSituValue* last = nullptr;
+  for (;;) {
+    skipSpaces();
+    if (current_ == end_ || *current_ != '"')
+      return fail("Missing '}' or object member name");
+    InSituValue* member = arena_.create<InSituValue>();
+    if (!readString(&member->name_, &member->nameLength_))
+      return false;
+    skipSpaces();
+    if (current_ == end_ || *current_ != ':')
+      return fail("Missing ':' after object member name");
+    ++current_;
+    if (!readValue(*member, depth))
+      return false;
+    (last != nullptr ? last->next_ : value.child_) = member;
+    last = member;
+    ++value.size_;
+    skipSpaces();
+    if (current_ != end_ && *current_ == '}') {
+      ++current_;
+      return true;
+    }
+    if (current_ == end_ || *current_ != ',')
+      return fail("Missing ',' or '}' in object declaration");
+    ++current_;
+  }
+}
+
+bool InSituReader::readArray(InSituValue& value, unsigned depth) {
+  ++current_;
+  value.type_ = arrayValue;
+  skipSpaces();
+  if (current_ != end_ && *current_ == ']') {
+    ++current_;
+    return true;
+  }
+  InSituValue* last = nullptr;
+  for (;;) {
+    InSituValue* element = arena_.create<InSituValue>();
+    if (!readValue(*element, depth))
+      return false;
+    (last != nullptr ? last->next_ : value.child_) = element;
+    last = element;
+    ++value.size_;
+    skipSpaces();
+    if (current_ != end_ && *current_ == ']') {
+      ++current_;
+      return true;
+    }
+    if (current_ == end_ || *current_ != ',')
+      return fail("Missing ',' or ']' in array declaration");
+    ++current_;
+  }
+}
+
+bool InSituReader::readString(char const** begin, size_t* length) {
+  // Decoded output never outgrows the escaped input, so it is written back
+  // over the buffer behind the read cursor.
+  char* start = ++current_;
+  char* out = start;
+  while (current_ != end_) {
+    char* special =
+        const_cast<char*>(scanner().findStringSpecial(current_, end_));
+    if (out != current_)
+      memmove(out, current_, static_cast<size_t>(special - current_));
+    out += special - current_;
+    current_ = special;
+    if (current_ == end_)
+      break;
+    char c = *current_++;
+    if (c == '"') {
+      *begin = start;
+      *length = static_cast<size_t>(out - start);
+      return true;
+    }
+    if (c != '\\') {
+      *out++ = c;
+      continue;
+    }
+    if (current_ == end_)
+      break;
+    char escape = *current_++;
+    switch (escape) {
+    case '"':
+    case '/':
+    case '\\':
+      *out++ = escape;
+      break;
+    case 'b':
+      *out++ = '\b';
+      break;
+    case 'f':
+      *out++ = '\f';
+      break;
+    case 'n':
+      *out++ = '\n';
+      break;
+    case 'r':
+      *out++ = '\r';
+      break;
+    case 't':
+      *out++ = '\t';
+      break;
+    case 'u': {
+      unsigned int unicode;
+      if (!readHex4(unicode))
+        return false;
+      if (unicode >= 0xD800 && unicode <= 0xDBFF) {
+        unsigned int surrogatePair;
+        if (end_ - current_ < 6 || current_[0] != '\\' || current_[1] != 'u')
+          return fail("expecting another \\u token to begin the second half "
+                      "of a unicode surrogate pair");
+        current_ += 2;
+        if (!readHex4(surrogatePair))
+          return false;
+        if (surrogatePair < 0xDC00 || surrogatePair > 0xDFFF)
+          return fail("expecting another \\u token to begin the second half "
+                      "of a unicode surrogate pair");
+        unicode = 0x10000 + ((unicode & 0x3FF) << 10) + (surrogatePair & 0x3FF);
+      } else if (unicode >= 0xDC00 && unicode <= 0xDFFF) {
+        return fail("unpaired low surrogate in unicode escape");
+      }
+      if (unicode < 0x80) {
+        *out++ = static_cast<char>(unicode);
+      } else if (unicode < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (unicode >> 6));
+        *out++ = static_cast<char>(0x80 | (unicode & 0x3F));
+      } else if (unicode < 0x10000) {
+        *out++ = static_cast<char>(0xE0 | (unicode >> 12));
+        *out++ = static_cast<char>(0x80 | ((unicode >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (unicode & 0x3F));
+      } else {
+        *out++ = static_cast<char>(0xF0 | (unicode >> 18));
+        *out++ = static_cast<char>(0x80 | ((unicode >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((unicode >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (unicode & 0x3F));
+      }
+    } break;
+    default:
+      return fail("Bad escape sequence in string");
+    }
+  }
+  return fail("Missing '\"' at end of string");
+}
+
+bool InSituReader::readHex4(unsigned int& unicode) {
+  if (end_ - current_ < 4)
+    return fail("Bad unicode escape sequence in string: four digits expected.");
+  unicode = 0;
+  for (int index = 0; index < 4; ++index) {
+    char c = *current_++;
+    unicode *= 16;
+    if (c >= '0' && c <= '9')
+      unicode += static_cast<unsigned int>(c - '0');
+    else if (c >= 'a' && c <= 'f')
+      unicode += static_cast<unsigned int>(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F')
+      unicode += static_cast<unsigned int>(c - 'A' + 10);
+    else
+      return fail("Bad unicode escape sequence in string: hexadecimal digit "
+                  "expected.");
+  }
+  return true;
+}
+
+bool InSituReader::readNumber(InSituValue& value) {
+  char* start = current_;
+  bool isReal = false;
+  if (current_ != end_ && *current_ == '-')
+    ++current_;
+  if (current_ == end_ || *current_ < '0' || *current_ > '9')
+    return fail("Syntax error: value, object or array expected.");
+  if (*current_ == '0')
+    ++current_;
+  else
+    while (current_ != end_ && *current_ >= '0' && *current_ <= '9')
+      ++current_;
+  if (current_ != end_ && *current_ == '.') {
+    isReal = true;
+    ++current_;
+    if (current_ == end_ || *current_ < '0' || *current_ > '9')
+      return fail("Bad number: digit expected after '.'");
+    while (current_ != end_ && *current_ >= '0' && *current_ <= '9')
+      ++current_;
+  }
+  if (current_ != end_ && (*current_ == 'e' || *current_ == 'E')) {
+    isReal = true;
+    ++current_;
+    if (current_ != end_ && (*current_ == '+' || *current_ == '-'))
+      ++current_;
+    if (current_ == end_ || *current_ < '0' || *current_ > '9')
+      return fail("Bad number: digit expected in exponent");
+    while (current_ != end_ && *current_ >= '0' && *current_ <= '9')
+      ++current_;
+  }
+  value.text_ = start;
+  value.length_ = static_cast<size_t>(current_ - start);
+  if (!isReal) {
+    std::from_chars_result result;
+    if (*start == '-') {
+      value.type_ = intValue;
+      result = std::from_chars(start, current_, value.number_.int_);
+    } else {
+      value.type_ = uintValue;
+      result = std::from_chars(start, current_, value.number_.uint_);
+    }
+    if (result.ec == std::errc())
+      return true;
+    // integer overflow, keep it as a double like Reader does
+  }
+  value.type_ = realValue;
+  if (std::from_chars(start, current_, value.number_.real_).ec != std::errc())
+    return fail("Bad number: out of range");
+  return true;
+}
+
+bool InSituReader::readLiteral(const char* literal, size_t length) {
+  if (static_cast<size_t>(end_ - current_) < length ||
+      memcmp(current_, literal, length) != 0)
+    return fail("Syntax error: value, object or array expected.");
+  current_ += length;
+  return true;
+}
+
+void InSituReader::skipSpaces() {
+  current_ = const_cast<char*>(skipJsonSpaces(current_, end_));
+}
+
+bool InSituReader::fail(const char* message) {
+  error_ = message;
+  errorPos_ = current_;
+  return false;
+}
+
 } // namespace Json
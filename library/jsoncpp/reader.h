@@ -7,6 +7,7 @@
 #define JSON_READER_H_INCLUDED
 
 #if !defined(JSON_IS_AMALGAMATION)
+#include "allocator.h"
 #include "json_features.h"
 #include "value.h"
 #endif // if !defined(JSON_IS_AMALGAMATION)
@@ -395,6 +396,128 @@ bool JSON_API parseFromStream(CharReader::Factory const&, IStream&, Value* root,
  */
 JSON_API IStream& operator>>(IStream&, Value&);
 
+/** \brief Read-only value produced by InSituReader.
+ *
+ * Nodes live in a MonotonicArena and strings point straight into the parsed
+ * document, so the document buffer and the arena must outlive the tree.
+ * Members/elements are kept as a singly linked list in document order.
+ */
+class JSON_API InSituValue {
+public:
+  ValueType type() const { return type_; }
+  bool isNull() const { return type_ == nullValue; }
+  bool isBool() const { return type_ == booleanValue; }
+  bool isString() const { return type_ == stringValue; }
+  bool isNumeric() const {
+    return type_ == intValue || type_ == uintValue || type_ == realValue;
+  }
+  bool isArray() const { return type_ == arrayValue; }
+  bool isObject() const { return type_ == objectValue; }
+
+  /** Get the raw pointers of a string value (not NUL-terminated).
+   * \return false if the value is not a string.
+   */
+  bool getString(char const** begin, char const** end) const;
+  /// Copy of the string value, empty if the value is not a string.
+  String asString() const;
+  bool asBool() const;
+  Int64 asInt64() const;
+  UInt64 asUInt64() const;
+  double asDouble() const;
+
+  /// Number of members/elements of an object/array, 0 otherwise.
+  ArrayIndex size() const { return size_; }
+  /// First member/element, follow next() for the rest.
+  const InSituValue* first() const { return child_; }
+  const InSituValue* next() const { return next_; }
+  /// Member name when this value is an object member.
+  bool getMemberName(char const** begin, char const** end) const;
+
+  /** Lookup an object member (last one wins on duplicate names).
+   * \return nullptr if this is not an object or the member is absent.
+   */
+  const InSituValue* find(char const* begin, char const* end) const;
+  const InSituValue* find(const char* key) const;
+
+private:
+  friend class InSituReader;
+
+  ValueType type_{nullValue};
+  ArrayIndex size_{0};
+  union {
+    Int64 int_;
+    UInt64 uint_;
+    double real_;
+    bool bool_;
+  } number_{};
+  char const* text_{nullptr};
+  size_t length_{0};
+  char const* name_{nullptr};
+  size_t nameLength_{0};
+  InSituValue* child_{nullptr};
+  InSituValue* next_{nullptr};
+};
+
+/** \brief Allocation-free strict JSON reader.
+ *
+ * Parses a mutable buffer in place: string escapes are decoded over the
+ * buffer itself and every node is taken from the given arena.  Once the
+ * arena has grown to the size of a typical document, parsing does not touch
+ * the heap.  Comments are not accepted.
+ *
+ * Usage:
+ *   \code
+ *   thread_local Json::MonotonicArena arena;
+ *   arena.reset();
+ *   Json::InSituReader reader(arena);
+ *   const Json::InSituValue* root = reader.parse(&body[0], &body[0] + body.size());
+ *   \endcode
+ */
+class JSON_API InSituReader {
+public:
+  explicit InSituReader(MonotonicArena& arena, unsigned maxDepth = 256)
+      : arena_(arena), maxDepth_(maxDepth) {}
+
+  /** Parse [begin, end).  The buffer is modified.
+   * \return the root value, or nullptr on error (see getError()).
+   */
+  const InSituValue* parse(char* begin, char* end);
+
+  /// Description of the last error, nullptr if none.
+  const char* getError() const { return error_; }
+  /// Offset of the last error from the start of the document.
+  ptrdiff_t getErrorOffset() const { return errorPos_ - begin_; }
+
+private:
+  bool readValue(InSituValue& value, unsigned depth);
+  bool readObject(InSituValue& value, unsigned depth);
+  bool readArray(InSituValue& value, unsigned depth);
+  bool readString(char const** begin, size_t* length);
+  bool readNumber(InSituValue& value);
+  bool readLiteral(const char* literal, size_t length);
+  bool readHex4(unsigned int& unicode);
+  void skipSpaces();
+  bool fail(const char* message);
+
+  MonotonicArena& arena_;
+  unsigned maxDepth_;
+  char* begin_{nullptr};
+  char* end_{nullptr};
+  char* current_{nullptr};
+  const char* error_{nullptr};
+  char const* errorPos_{nullptr};
+};
+
+/** Name of the character scanner used by the readers: "avx2", "sse4.2" or
+ * "scalar".  It is picked once from the CPU features.
+ */
+JSON_API const char* getScannerName();
+
+/** Force the portable scalar scanner, or restore CPU detection.
+ * Meant for benchmarks, must not race with parsing on other threads.
+ */
+JSON_API void setScalarScanner(bool scalar);
+
 } // namespace Json
 
 #pragma pack(pop)
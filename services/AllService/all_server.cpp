@@ -7,21 +7,18 @@
  */
 int main(int argc, char *argv[])
 {
-    signal(SIGUSR1, sighandler1);
-    signal(SIGUSR2, sighandler2);
-    signal(SIGINT, sighandler2); // SIG_IGN = Ctrl+C
-    signal(SIGPIPE, SIG_IGN);    // 忽略信号的处理程序
-
-    // 默认初始化参数
-    int port = 8000;          // 服务端口
-    int iothreadnum = 5;     // EventLoop工作线程数量
-    int workerthreadnum = 5; // 线程池工作线程数量
+    // 默认初始化参数，配置文件（见ServerConfig.hpp）可覆盖，命令行参数优先
+    ServerConfig *config = ServerConfig::GetInstance();
+    int port = config->Port(8000);                   // 服务端口
+    int httpport = config->HttpPort(80);             // 网站式HttpServer服务端口
+    int iothreadnum = config->IoThreads(5);          // EventLoop工作线程数量
+    int workerthreadnum = config->WorkerThreads(5);  // 线程池工作线程数量
     if (argc == 4)
     {
         // 启动初始化参数
         port = atoi(argv[1]);
-        iothreadnum = atoi(argv[2]);     // EventLoop工作线程数量，负责连接监听与数据收发
-        workerthreadnum = atoi(argv[3]); // 线程池工作线程数量，负责收到的请求数据进行逻辑处理
+        iothreadnum = CpuAffinity::ThreadNum(argv[2], CpuAffinity::IO);     // EventLoop工作线程数量，负责连接监听与数据收发
+        workerthreadnum = CpuAffinity::ThreadNum(argv[3], CpuAffinity::WORKER); // 线程池工作线程数量，负责收到的请求数据进行逻辑处理
     }
 
     LOG_INIT(logPath.data());   // 初始化日志类单例
@@ -31,12 +28,28 @@ int main(int argc, char *argv[])
     ThreadPool threadPool(workerthreadnum); // 多服务共享线程池
     threadPool.Start();
 
-    // 网站式HttpServer服务一般部署于80端口，此处HttpServer共享线程池threadPool，但独立创建一个监听80端口的TcpServer
-    HttpServer httpServer(&loop, 0, &threadPool, iothreadnum, 80, nullptr); // NULL与nullptr相等
+    // 网站式HttpServer服务一般部署于80端口（配置项httpPort），此处HttpServer共享线程池threadPool，但独立创建一个监听80端口的TcpServer
+    HttpServer httpServer(&loop, 0, &threadPool, iothreadnum, httpport, nullptr); // NULL与nullptr相等
     // 以下多个服务构造时使用共享的tcpServer和threadPool，则其相应构造参数可以置为0
     // 这样做的好处是析构时每个服务内部可根据构造参数判断是否需要delete对象指针：tcpServer和threadPool
     ResourceServer resourceServer(&loop, 0, &threadPool, 0, 0, &tcpServer);
-
+    // WebSocket服务共享tcpServer，/WebSocketService/Echo回显消息，/WebSocketService/Chat将消息广播给所有聊天连接
+    WebSocketServer webSocketServer(&loop, 0, 0, &tcpServer);
+    webSocketServer.RegisterHandler("Echo", [](TcpServer::spTcpConnection &sptcpconn, WebSocket::Opcode opcode, std::string &message)
+                                    { sptcpconn->SendWebSocketFrame(opcode, message); });
+    webSocketServer.RegisterHandler("Chat", [&webSocketServer](TcpServer::spTcpConnection &sptcpconn, WebSocket::Opcode opcode, std::string &message)
+                                    { webSocketServer.Broadcast("Chat", message, opcode); },
+                                    [&webSocketServer](TcpServer::spTcpConnection &sptcpconn)
+                                    { webSocketServer.Subscribe("Chat", sptcpconn); });
+#ifdef ENABLE_PROTOBUF_RPC
+    // 二进制RPC服务共享tcpServer和threadPool，客户端经"/RpcService/Connect"升级连接后按方法id调用注册的protobuf服务
+    RpcServer rpcServer(&loop, 0, &threadPool, 0, 0, &tcpServer);
+    EchoServiceImpl echoServiceImpl;
+    rpcServer.RegisterService(&echoServiceImpl);
+#endif
+
+    // SIGTERM/SIGINT时优雅退出，设置NETSERVER_HANDOFF_PATH时支持热重启，见ServerLifecycle.hpp
+    ServerLifecycle::GetInstance()->Start(&loop);
     try
     {
         loop.loop();
@@ -3,29 +3,28 @@
 #ifndef _ALL_SERVICE_H_
 #define _ALL_SERVICE_H_
 
-#include <csignal>
 #include "../../library/HttpServer.hpp"
 #include "../../library/ResourceServer.hpp"
+#include "../../library/WebSocketServer.hpp"
 
-EventLoop *lp; // 事件池指针
+#ifdef ENABLE_PROTOBUF_RPC
+#include "../../library/RpcServer.hpp"
+#include "echo.pb.h"
 
 /*
- * 信号处理函数，SIGUSR1->退出服务器程序
+ * echoService测试服务，原样回发请求消息
  *
  */
-static void sighandler1(int sig_no)
+class EchoServiceImpl : public echoService::echoService
 {
-    exit(0);
-}
-
-/*
- * 信号处理函数，SIGUSR2->关闭服务
- *
- */
-static void sighandler2(int sig_no)
-{
-    lp->Quit();
-}
-
+public:
+    void EchoFun(google::protobuf::RpcController *controller, const ::echoService::EchoRequest *request,
+                 ::echoService::EchoResponse *response, google::protobuf::Closure *done) override
+    {
+        response->set_message(request->message());
+        done->Run();
+    }
+};
+#endif
 
 #endif
\ No newline at end of file
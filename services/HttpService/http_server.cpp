@@ -9,16 +9,18 @@
  */
 int main(int argc, char *argv[])
 {
-    // 默认初始化参数
-    int port = 80;             // 服务端口
-    int iothreadnum = 100;     // EventLoop工作线程数量
-    int workerthreadnum = 300; // 线程池工作线程数量
+    // 默认初始化参数，配置文件（见ServerConfig.hpp）可覆盖，命令行参数优先
+    ServerConfig *config = ServerConfig::GetInstance();
+    int port = config->Port(80);             // 服务端口
+    // 线程数参数可为auto，按进程可用的CPU数确定，默认即为auto，避免线程数远超CPU数
+    int iothreadnum = config->IoThreads(CpuAffinity::ThreadNum("auto", CpuAffinity::IO));             // EventLoop工作线程数量
+    int workerthreadnum = config->WorkerThreads(CpuAffinity::ThreadNum("auto", CpuAffinity::WORKER)); // 线程池工作线程数量
     if (argc == 4)
     {
         // 启动初始化参数
         port = atoi(argv[1]);
-        iothreadnum = atoi(argv[2]);     // EventLoop工作线程数量
-        workerthreadnum = atoi(argv[3]); // 线程池工作线程数量
+        iothreadnum = CpuAffinity::ThreadNum(argv[2], CpuAffinity::IO);     // EventLoop工作线程数量
+        workerthreadnum = CpuAffinity::ThreadNum(argv[3], CpuAffinity::WORKER); // 线程池工作线程数量
     }
 
     LOG_INIT(logPath.data());   // 初始化日志类单例
@@ -27,7 +29,10 @@ int main(int argc, char *argv[])
     EventLoop loop; // 该EventLoop是TcpServer的参数，其可以执行监听逻辑主函数
     LOG(LoggerLevel::INFO, "%s\n", "即将启动HttpServer服务，开始初始化业务逻辑");
     HttpServer httpServer(&loop, workerthreadnum, NULL, iothreadnum, port, nullptr);
+    httpServer.SetCacheControl("/fzg/", "public, max-age=86400"); // 图片等静态资源允许浏览器缓存一天
 
+    // SIGTERM/SIGINT时优雅退出，设置NETSERVER_HANDOFF_PATH时支持热重启，见ServerLifecycle.hpp
+    ServerLifecycle::GetInstance()->Start(&loop);
     try
     {
         LOG(LoggerLevel::INFO, "%s\n", "启动HttpServer服务，开始监听网络请求");
@@ -7,20 +7,37 @@
  */
 int main(int argc, char *argv[])
 {
-    // 默认初始化参数
-    int port = 80;             // 服务端口
-    int iothreadnum = 100;     // EventLoop工作线程数量
-    int workerthreadnum = 100; // 线程池工作线程数量
-    if (argc == 4)
+    // 默认初始化参数，配置文件（见ServerConfig.hpp）可覆盖，命令行参数优先
+    ServerConfig *config = ServerConfig::GetInstance();
+    int port = config->Port(80);               // 服务端口
+    int iothreadnum = config->IoThreads(CpuAffinity::ThreadNum("auto", CpuAffinity::IO)); // EventLoop工作线程数量，按可用CPU数确定
+    int workerthreadnum = config->WorkerThreads(100); // 线程池工作线程数量
+    std::string rawTargetIp;   // 原始TCP转发模式的目标地址，为空时按http请求的服务名转发
+    int rawTargetPort = 0;
+    if (argc == 4 || argc == 6)
     {
         // 启动初始化参数
         port = atoi(argv[1]);
-        iothreadnum = atoi(argv[2]);     // EventLoop工作线程数量
-        workerthreadnum = atoi(argv[3]); // 线程池工作线程数量
+        iothreadnum = CpuAffinity::ThreadNum(argv[2], CpuAffinity::IO);     // EventLoop工作线程数量
+        workerthreadnum = CpuAffinity::ThreadNum(argv[3], CpuAffinity::WORKER); // 线程池工作线程数量
+    }
+    if (argc == 6)
+    {
+        rawTargetIp = argv[4];
+        rawTargetPort = atoi(argv[5]);
     }
 
     PortProxyServer portProxyServer(workerthreadnum, iothreadnum, "0.0.0.0", port);
-    portProxyServer.registerPortProxy("HttpService", "0.0.0.0", 8000);
+    if (rawTargetIp.empty())
+    {
+        portProxyServer.registerPortProxy("HttpService", "0.0.0.0", 8000);
+    }
+    else
+    {
+        // 原始TCP转发，任意协议的字节流原样转发到目标地址
+        portProxyServer.registerPortProxy("RawService", rawTargetIp, rawTargetPort);
+        portProxyServer.SetRawProxy("RawService");
+    }
     portProxyServer.Start();
 
     return 0;
@@ -7,25 +7,24 @@
  */
 int main(int argc, char *argv[])
 {
-    signal(SIGUSR1, sighandler1);
-    signal(SIGUSR2, sighandler2);
-    signal(SIGINT, sighandler2); // SIG_IGN = Ctrl+C
-    signal(SIGPIPE, SIG_IGN);    // 忽略信号的处理程序
-    // 默认初始化参数
-    int port = 8005;          // 服务端口
-    int iothreadnum = 20;     // EventLoop工作线程数量
-    int workerthreadnum = 20; // 线程池工作线程数量
+    // 默认初始化参数，配置文件（见ServerConfig.hpp）可覆盖，命令行参数优先
+    ServerConfig *config = ServerConfig::GetInstance();
+    int port = config->Port(8005);                    // 服务端口
+    int iothreadnum = config->IoThreads(20);          // EventLoop工作线程数量
+    int workerthreadnum = config->WorkerThreads(20);  // 线程池工作线程数量
     if (argc == 4)
     {
         // 启动初始化参数
         port = atoi(argv[1]);
-        iothreadnum = atoi(argv[2]);     // EventLoop工作线程数量
-        workerthreadnum = atoi(argv[3]); // 线程池工作线程数量
+        iothreadnum = CpuAffinity::ThreadNum(argv[2], CpuAffinity::IO);     // EventLoop工作线程数量
+        workerthreadnum = CpuAffinity::ThreadNum(argv[3], CpuAffinity::WORKER); // 线程池工作线程数量
     }
 
     EventLoop loop; // 该EventLoop是TcpServer的参数，其可以执行监听逻辑主函数
     HttpServer httpServer(&loop, workerthreadnum, nullptr, iothreadnum, port, NULL);
 
+    // SIGTERM/SIGINT时优雅退出，设置NETSERVER_HANDOFF_PATH时支持热重启，见ServerLifecycle.hpp
+    ServerLifecycle::GetInstance()->Start(&loop);
     try
     {
         loop.loop();